@@ -0,0 +1,20 @@
+function pulse(deviceID, duration, tacNum)
+%PULSE Pulse the tactor for the given duration (milliseconds), validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.pulse(deviceID, duration);
+%   tdk.fast.pulse(deviceID, duration, tacNum);
+%
+% Same as tdk.pulse without the MATLAB arguments block; out-of-range values
+% are handled by the MEX per tdk.configureValidation.
+%
+% See also: tdk.pulse, tdk.configureValidation
+
+if nargin < 3
+    tacNum = 1;
+end
+
+% uint8(11) == 'pulse' code
+tactor(uint8(11), deviceID, tacNum, duration, 0);
+
+end
@@ -0,0 +1,15 @@
+function pushFeatures(deviceID, frame)
+%PUSHFEATURES Hand a feature frame (double or single) to the mapping, validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.pushFeatures(deviceID, frame);
+%
+% Same as tdk.pushFeatures without the MATLAB arguments block, for decoder
+% loops pushing every frame.
+%
+% See also: tdk.pushFeatures, tdk.configureMapping
+
+% uint8(63) == 'pushFeatures' code
+tactor(uint8(63), deviceID, frame);
+
+end
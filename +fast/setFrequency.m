@@ -0,0 +1,15 @@
+function setFrequency(deviceID, freq)
+%SETFREQUENCY Sets the frequency (Hz), validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.setFrequency(deviceID, freq);
+%
+% Same as tdk.setFrequency without the MATLAB arguments block; out-of-range
+% values are handled by the MEX per tdk.configureValidation.
+%
+% See also: tdk.setFrequency, tdk.configureValidation
+
+% uint8(8) == 'changeFreq' code
+tactor(uint8(8), deviceID, 1, freq, 0);
+
+end
@@ -0,0 +1,15 @@
+function setFrequencyRamp(deviceID, startFreq, endFreq, duration)
+%SETFREQUENCYRAMP Sets a frequency ramp (Hz), validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.setFrequencyRamp(deviceID, startFreq, endFreq, duration);
+%
+% Same as tdk.setFrequencyRamp without the MATLAB arguments block;
+% out-of-range values are handled by the MEX per tdk.configureValidation.
+%
+% See also: tdk.setFrequencyRamp, tdk.configureValidation
+
+% uint8(10) == 'rampFreq' code
+tactor(uint8(10), deviceID, 1, startFreq, endFreq, duration, 0);
+
+end
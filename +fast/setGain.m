@@ -0,0 +1,15 @@
+function setGain(deviceID, gain)
+%SETGAIN Sets the intensity (0 - 1), validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.setGain(deviceID, gain);
+%
+% Same as tdk.setGain without the MATLAB arguments block; out-of-range values
+% are handled by the MEX per tdk.configureValidation.
+%
+% See also: tdk.setGain, tdk.configureValidation
+
+% uint8(7) == 'changeGain' code
+tactor(uint8(7), deviceID, 1, round(255.0 * gain), 0);
+
+end
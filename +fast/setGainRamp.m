@@ -0,0 +1,15 @@
+function setGainRamp(deviceID, startGain, endGain, duration)
+%SETGAINRAMP Sets an intensity ramp (0 - 1), validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.setGainRamp(deviceID, startGain, endGain, duration);
+%
+% Same as tdk.setGainRamp without the MATLAB arguments block; out-of-range
+% values are handled by the MEX per tdk.configureValidation.
+%
+% See also: tdk.setGainRamp, tdk.configureValidation
+
+% uint8(9) == 'rampGain' code
+tactor(uint8(9), deviceID, 1, round(255.0 * startGain), round(255.0 * endGain), duration, 0);
+
+end
@@ -0,0 +1,19 @@
+function setSigSource(deviceID, source)
+%SETSIGSOURCE Sets which signal sources drive the tactor, validated in the MEX.
+%
+% Syntax:
+%   tdk.fast.setSigSource(deviceID, source);
+%
+% Same as tdk.setSigSource without the MATLAB arguments block. The MEX
+% rejects a source outside 1 - 7 whatever the validation policy.
+%
+% See also: tdk.setSigSource, tdk.configureValidation
+
+if nargin < 2
+    source = 1;
+end
+
+% uint8(30) == 'changeSigSource' code
+tactor(uint8(30), deviceID, 1, source, 0);
+
+end
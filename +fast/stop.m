@@ -0,0 +1,12 @@
+function stop(deviceID)
+%STOP Stops all pulsing tactors, without MATLAB argument validation.
+%
+% Syntax:
+%   tdk.fast.stop(deviceID);
+%
+% See also: tdk.stop
+
+% uint8(12) == 'stop' code
+tactor(uint8(12), deviceID, 0);
+
+end
@@ -0,0 +1,32 @@
+function status = ackStatus()
+%ACKSTATUS Returns controller acknowledgement latency and unacknowledged commands.
+%
+% Syntax:
+%   status = tdk.ackStatus();
+%   struct2table(status.commands)
+%
+% Output:
+%   status - Struct with
+%              tracked, acked, timedOut - command counts since tracking began
+%              missed      - commands whose response never came while a later
+%                            command's did (counted in timedOut)
+%              overflowed  - commands dropped from a full in-flight list
+%              unmatched   - responses with no outstanding command to match
+%              outstanding - commands still waiting for a response
+%              lastSequence - sequence number of the newest tracked command
+%              edgesMs     - histogram bin edges (quarter octaves)
+%              commands    - per command type: acked, rejected (non-zero
+%                            status), timedOut, minMs, meanMs, p50Ms, p90Ms,
+%                            p99Ms, maxMs and counts (per bin)
+%              timeouts    - the last 64 commands given up on: sequence,
+%                            deviceID, command, tactor, ageMs
+%
+% Percentiles are read off the histogram, so they are upper bin edges
+% (within 19%).
+%
+% See also: tdk.configureAckTracking, tdk.stats
+
+% uint8(61) == 'ackStatus' code
+status = tactor(uint8(61));
+
+end
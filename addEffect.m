@@ -0,0 +1,43 @@
+function effectID = addEffect(deviceID, tacNum, envelope, options)
+%ADDEFFECT Layers a haptic effect on a tactor (see tdk.configureMixer).
+%
+% Syntax:
+%   id = tdk.addEffect(deviceID, tacNum, gain);
+%   id = tdk.addEffect(deviceID, tacNum, [0 20 150; 0 255 0], 'Mode', 'sum', 'Priority', 1);
+%   id = tdk.addEffect(deviceID, tacNum, 255, 'Mode', 'override', 'Duration', 100, 'Frequency', 250);
+%
+% Inputs:
+%   deviceID  - Identifier for device
+%   tacNum    - Tactor number (1-indexed)
+%   envelope  - Constant gain (0 - 255), or a 2 x N [t_ms; gain]
+%               piecewise-linear envelope (up to 16 points)
+%   Mode      - How the effect blends with lower-priority effects on the
+%               same tactor: 'max', 'sum' (clamped to 255), or 'override'
+%   Priority  - Effects blend in ascending priority
+%   Frequency - Hz; the highest-priority effect with a frequency sets it.
+%               0 leaves the frequency to other effects.
+%   Duration  - ms; 0 = the envelope's length, or until removed for a
+%               constant gain
+%   Delay     - ms before the effect starts
+%
+% Output:
+%   effectID  - Handle for tdk.updateEffect / tdk.removeEffect
+%
+% See also: tdk.configureMixer, tdk.updateEffect, tdk.removeEffect
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    tacNum (1,1) {mustBeInteger, mustBeInRange(tacNum,1,64)}
+    envelope double {mustBeFinite}
+    options.Mode {mustBeMember(options.Mode,{'max','sum','override'})} = 'max';
+    options.Priority (1,1) {mustBeInteger} = 0;
+    options.Frequency (1,1) {mustBeInteger, mustBeNonnegative} = 0;
+    options.Duration (1,1) double {mustBeNonnegative} = 0;
+    options.Delay (1,1) double {mustBeNonnegative} = 0;
+end
+
+% uint8(38) == 'addEffect' code
+effectID = tactor(uint8(38), deviceID, tacNum, envelope, options.Mode, ...
+    options.Priority, options.Frequency, options.Duration, options.Delay);
+
+end
@@ -0,0 +1,45 @@
+function id = addLfo(deviceID, tacNum, target, shape, depth, offset, period, options)
+%ADDLFO Modulates a tactor's gain or frequency natively (no MATLAB loop).
+%
+% Syntax:
+%   id = tdk.addLfo(deviceID, tacNum, target, shape, depth, offset, period);
+%   id = tdk.addLfo(deviceID, 1, 'gain', 'sine', 90, 128, 650);
+%   id = tdk.addLfo(deviceID, 2, 'freq', 'triangle', 1000, 1500, 1300, 'SyncGroup', 1, 'Phase', 0.5);
+%
+% value(t) = offset + depth * wave(t), wave in [-1, 1], with period in ms.
+% The engine tracks the waveform with the fewest RampGain/RampFreq segments
+% that stay within Tolerance (gain steps or Hz). tdk.updateLfo changes
+% parameters mid-flight without a step in the output.
+%
+% Inputs:
+%   deviceID  - Identifier for device
+%   tacNum    - Tactor number (0 = all)
+%   target    - 'gain' (0 - 255) or 'freq' (300 - 3500 Hz)
+%   shape     - 'sine', 'triangle', 'square' or 'sawtooth'
+%   Phase     - Phase offset in cycles (0 - 1)
+%   SyncGroup - LFOs with the same group (1 - 32) share one phase clock
+%   Tolerance - Allowed tracking error of the ramp segments
+%
+% Output:
+%   id - LFO ID for tdk.updateLfo / tdk.removeLfo
+%
+% See also: tdk.updateLfo, tdk.removeLfo, tdk.stats
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    tacNum (1,1) {mustBeInteger, mustBeInRange(tacNum,0,64)}
+    target {mustBeMember(target,{'gain','freq'})}
+    shape {mustBeMember(shape,{'sine','triangle','square','sawtooth'})}
+    depth (1,1) double {mustBeFinite}
+    offset (1,1) double {mustBeFinite}
+    period (1,1) double {mustBeGreaterThanOrEqual(period,10)} % ms
+    options.Phase (1,1) double {mustBeFinite} = 0;
+    options.SyncGroup (1,1) {mustBeInteger, mustBeInRange(options.SyncGroup,0,32)} = 0;
+    options.Tolerance (1,1) double {mustBePositive} = 2;
+end
+
+% uint8(45) == 'addLfo' code
+id = tactor(uint8(45), deviceID, tacNum, char(target), char(shape), depth, offset, period, ...
+    options.Phase, options.SyncGroup, options.Tolerance);
+
+end
@@ -0,0 +1,43 @@
+function report = applyProfile(deviceID, profile)
+%APPLYPROFILE Applies a device configuration profile in one burst.
+%
+% Syntax:
+%   report = tdk.applyProfile(deviceID, profile);
+%   report = tdk.applyProfile(deviceID, 'profile.json');
+%
+% Inputs:
+%   deviceID - Device ID returned by tdk.open or tactor('connect', ...)
+%   profile  - Struct (or JSON file decoded with jsondecode) with any of:
+%                timeFactor        - 1 - 255 (applies to every device)
+%                endOnZeroCrossing - true to end actions on a zero crossing
+%                tactorType        - 'C3', 'C2', 'EMS' or 'EMR', all tactors
+%                sigSource         - 1 - 7, all tactors
+%                freq              - Hz, all tactors
+%                gain              - 0 - 255, all tactors
+%                tactors           - Struct array of per-tactor overrides,
+%                                    each with 'tactor' (1 - 64) and any of
+%                                    tactorType, sigSource, freq, gain
+%
+% Output:
+%   report - Struct with applied (vendor calls issued), skipped (settings
+%            already in place) and elapsedMs.
+%
+% Settings the device already holds are skipped, so re-applying a profile
+% before each block only costs what changed. Pass the same profile to
+% tdk.open('Profile', profile) to apply it at connect time.
+%
+% See also: tdk.open, tdk.stats
+
+arguments
+    deviceID (1,1) {mustBeInteger}
+    profile {mustBeA(profile, {'struct', 'char', 'string'})}
+end
+
+if ~isstruct(profile)
+    profile = jsondecode(fileread(profile));
+end
+
+% uint8(52) == 'applyProfile' code
+report = tactor(uint8(52), deviceID, profile);
+
+end
@@ -0,0 +1,29 @@
+function n = arm(slot, commands)
+%ARM Validates and pre-encodes tactor commands into a slot for tdk.fire.
+%
+% Syntax:
+%   tdk.arm(slot, {'pulse', deviceID, 1, 100, 0});
+%   tdk.arm(slot, {{'changeGain', deviceID, 1, 255, 0}, {'pulse', deviceID, 1, 50, 0}});
+%   tdk.arm(slot, {});   % disarm
+%
+% Inputs:
+%   slot     - Slot number (1 - 64).
+%   commands - One command as a cell of its usual tactor arguments, or a
+%              cell array of such cells (up to 16), issued in order when
+%              fired. Supported: changeGain, changeFreq, rampGain, rampFreq,
+%              pulse, stop, setState, changeSigSource, silence.
+%
+% Output:
+%   n - Number of commands armed.
+%
+% See also: tdk.fire
+
+arguments
+    slot (1,1) {mustBeInteger, mustBeInRange(slot,1,64)}
+    commands cell
+end
+
+% uint8(33) == 'arm' code
+n = tactor(uint8(33), slot, commands);
+
+end
@@ -0,0 +1,27 @@
+function deviceIDs = attach(ringName)
+%ATTACH Sends commands to a running tdkd daemon instead of the DLL (Linux).
+%
+% Syntax:
+%   deviceIDs = tdk.attach();              % default ring, '/tdk_ring'
+%   deviceIDs = tdk.attach('/tdk_ring2');
+%
+% tdkd owns the connected devices; several MATLAB sessions (or other
+% processes) can attach to it at once. After attaching, tdk.pulse,
+% tdk.setGain, renderers, frame commits, tdk.stop/tdk.silence and fired
+% slots are written to the daemon's shared-memory command ring. Do not call
+% tdk.open() in the same session. Submit-to-issue latency and ring counters
+% are kept by the daemon (tdkd --verbose).
+%
+% Output:
+%   deviceIDs - Device IDs the daemon has connected.
+%
+% See also: tdk.detach
+
+arguments
+    ringName {mustBeTextScalar} = '/tdk_ring';
+end
+
+% uint8(35) == 'attach' code
+deviceIDs = tactor(uint8(35), char(ringName));
+
+end
@@ -0,0 +1,68 @@
+function results = benchmarkWrappers(deviceID, numLoops)
+%BENCHMARKWRAPPERS Times the validated wrappers against the tdk.fast.* wrappers and raw MEX calls.
+%
+% Syntax:
+%   results = tdk.benchmarkWrappers(deviceID, numLoops);
+%
+% Inputs:
+%   deviceID - Integer index of tactor device
+%   numLoops - Number of calls timed per wrapper.
+%
+% Output:
+%   results - Table of mean call times (us) per command: wrapper (MATLAB
+%             arguments block), fast (validated in the MEX), and mex (direct
+%             uint8 call), plus the wrapper/fast speedup.
+%
+% See also: tdk.configureValidation, tdk.test
+
+arguments
+    deviceID (1,1) {mustBeInteger}
+    numLoops (1,1) {mustBeInteger, mustBePositive} = 1000;
+end
+
+fprintf(1, '\nRunning wrapper benchmark...\n');
+tdk.configureValidation('clamp');
+
+names = {'pulse'; 'setGain'; 'setFrequency'; 'setGainRamp'; 'setFrequencyRamp'};
+wrapper = {@() tdk.pulse(deviceID, 10), ...
+           @() tdk.setGain(deviceID, 0.5), ...
+           @() tdk.setFrequency(deviceID, 300), ...
+           @() tdk.setGainRamp(deviceID, 0, 1, 100), ...
+           @() tdk.setFrequencyRamp(deviceID, 300, 600, 100)};
+fast = {@() tdk.fast.pulse(deviceID, 10), ...
+        @() tdk.fast.setGain(deviceID, 0.5), ...
+        @() tdk.fast.setFrequency(deviceID, 300), ...
+        @() tdk.fast.setGainRamp(deviceID, 0, 1, 100), ...
+        @() tdk.fast.setFrequencyRamp(deviceID, 300, 600, 100)};
+raw = {@() tactor(uint8(11), deviceID, 1, 10, 0), ...
+       @() tactor(uint8(7), deviceID, 1, 128, 0), ...
+       @() tactor(uint8(8), deviceID, 1, 300, 0), ...
+       @() tactor(uint8(9), deviceID, 1, 0, 255, 100, 0), ...
+       @() tactor(uint8(10), deviceID, 1, 300, 600, 100, 0)};
+
+n = numel(names);
+wrapperUs = zeros(n, 1);
+fastUs = zeros(n, 1);
+mexUs = zeros(n, 1);
+for k = 1:n
+    wrapperUs(k) = timeCalls(wrapper{k}, numLoops);
+    fastUs(k) = timeCalls(fast{k}, numLoops);
+    mexUs(k) = timeCalls(raw{k}, numLoops);
+end
+tdk.stop(deviceID);
+
+speedup = wrapperUs ./ fastUs;
+results = table(wrapperUs, fastUs, mexUs, speedup, 'RowNames', names);
+fprintf(1, 'Mean call time (us, %d calls each):\n', numLoops);
+disp(results);
+
+end
+
+function us = timeCalls(fn, numLoops)
+fn(); % Warm-up (JIT, first-call setup)
+t = tic;
+for i = 1:numLoops
+    fn();
+end
+us = toc(t) / numLoops * 1e6;
+end
@@ -0,0 +1,22 @@
+function count = cancelPattern(target)
+%CANCELPATTERN Cancels a pattern instance, or every instance of a named pattern.
+%
+% Syntax:
+%   tdk.cancelPattern(id);
+%   n = tdk.cancelPattern('sweep');
+%
+% tdk.stop / tdk.silence also cancel the patterns on that device / tactor.
+%
+% See also: tdk.launchPattern, tdk.patternStatus
+
+arguments
+    target
+end
+
+% uint8(42) == 'cancelPattern' code
+if isstring(target)
+    target = char(target);
+end
+count = tactor(uint8(42), target);
+
+end
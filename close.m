@@ -1,5 +1,8 @@
 function close()
 %CLOSE Close the tdk tactor interface.
-tactor('shutdown');
+%
+% Also ends a persistent engine (tdk.open('Persistent', true)): 'unlock'
+% closes the devices and shuts the interface down before the MEX is cleared.
+tactor('unlock');
 clear tactor;
-end
\ No newline at end of file
+end
@@ -0,0 +1,12 @@
+function closeStimulusLibrary()
+%CLOSESTIMULUSLIBRARY Cancels playing stimuli and unmaps the library.
+%
+% Syntax:
+%   tdk.closeStimulusLibrary();
+%
+% See also: tdk.openStimulusLibrary
+
+% uint8(54) == 'closeStimulusLibrary' code
+tactor(uint8(54));
+
+end
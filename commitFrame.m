@@ -0,0 +1,16 @@
+function nSent = commitFrame(deviceID)
+%COMMITFRAME Sends whatever changed between the written frame and the last committed frame.
+%
+% Syntax:
+%   nSent = tdk.commitFrame(deviceID);
+%
+% See also: tdk.writeFrame, tdk.startFrameCommit
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+end
+
+% uint8(23) == 'commitFrame' code
+nSent = tactor(uint8(23), deviceID);
+
+end
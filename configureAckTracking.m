@@ -0,0 +1,34 @@
+function configureAckTracking(enabled, options)
+%CONFIGUREACKTRACKING Tracks each command until the controller acknowledges it.
+%
+% Syntax:
+%   tdk.configureAckTracking(true);                         % 1 s timeout
+%   tdk.configureAckTracking(true, 'TimeoutMs', 50, 'Reset', true);
+%   tdk.configureAckTracking(false);                        % Off (clears everything)
+%
+% Inputs:
+%   enabled   - true to tag every accepted command with a sequence number and
+%               wait for the controller's response to it
+%   TimeoutMs - Commands unanswered after this long are given up on and
+%               logged (default 1000)
+%   Reset     - Clear the latency histograms and the timeout log
+%
+% A vendor call returning 0 only means the DLL took the command; the
+% acknowledgement latency is how long the controller took to answer it.
+% Responses arrive through the Connect callback, which only the native
+% serial backend (tdk.install 'SerialBackend' build) provides. With the EAI
+% DLL or the stub backend, enabling tracking raises TDK:Unsupported. Costs
+% one lock and a list append per command while on, and nothing while off.
+%
+% See also: tdk.ackStatus, tdk.stats
+
+arguments
+    enabled (1,1) logical
+    options.TimeoutMs (1,1) double {mustBeInRange(options.TimeoutMs, 1, 60000)} = 1000;
+    options.Reset (1,1) logical = false;
+end
+
+% uint8(60) == 'configureAckTracking' code
+tactor(uint8(60), enabled, options.TimeoutMs, options.Reset);
+
+end
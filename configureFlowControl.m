@@ -0,0 +1,28 @@
+function configureFlowControl(enabled, options)
+%CONFIGUREFLOWCONTROL Enables adaptive per-device flow control in the MEX engine.
+%
+% Syntax:
+%   tdk.configureFlowControl(true);
+%   tdk.configureFlowControl(true, 'Rate', 300, 'Burst', 16, 'QueueLimit', 128, 'MaxWait', 10);
+%   tdk.configureFlowControl(false);
+%
+% Each device gets a token bucket in front of the DLL. The admitted rate grows
+% while commands succeed (up to the measured link capacity) and halves when the
+% controller reports an action-limit error, which is then retried. Queued
+% commands wait for credit (up to QueueLimit per device); direct calls wait up
+% to MaxWait ms and otherwise fail with a flow-control error.
+%
+% See also: tdk.flowStatus, tdk.configureQueue
+
+arguments
+    enabled (1,1) logical
+    options.Rate (1,1) double {mustBeGreaterThanOrEqual(options.Rate,10)} = 200; % commands/s
+    options.Burst (1,1) double {mustBeGreaterThanOrEqual(options.Burst,1)} = 32;
+    options.QueueLimit (1,1) double {mustBeInteger, mustBePositive} = 256;
+    options.MaxWait (1,1) double {mustBeNonnegative} = 20; % ms
+end
+
+% uint8(28) == 'configureFlowControl' code
+tactor(uint8(28), enabled, options.Rate, options.Burst, options.QueueLimit, options.MaxWait);
+
+end
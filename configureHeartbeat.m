@@ -0,0 +1,38 @@
+function status = configureHeartbeat(intervalMs)
+%CONFIGUREHEARTBEAT Stops every device if the control loop stops calling.
+%
+% Syntax:
+%   status = tdk.configureHeartbeat(100); % Stop all devices after 100 ms without a call
+%   status = tdk.configureHeartbeat(0);   % Off
+%   status = tdk.configureHeartbeat();    % Status only
+%
+% Inputs:
+%   intervalMs - Longest allowed time between tactor calls (>= 5 ms), or 0
+%                to turn the watchdog off. Any call (a command, tdk.stats,
+%                tdk.heartbeat) counts as a heartbeat.
+%
+% Output:
+%   status - Struct with intervalMs, armed, tripped, trips, stopFailures,
+%            maxGapMs (longest time between calls while armed),
+%            maxTripLatencyMs (deadline to Stop sent) and log (the last 16
+%            trips: time (POSIX seconds), gapMs, devices, failures).
+%
+% A trip sends Stop through the priority lane on each connected device,
+% which also cancels renderers, patterns and LFOs, and is written to the
+% trace as a marker when tracing is on. After a trip the watchdog waits for
+% the next call before it can trip again.
+%
+% See also: tdk.heartbeat, tdk.stop, tdk.stats
+
+arguments
+    intervalMs double {mustBeScalarOrEmpty, mustBeNonnegative} = [];
+end
+
+% uint8(59) == 'configureHeartbeat' code
+if isempty(intervalMs)
+    status = tactor(uint8(59));
+else
+    status = tactor(uint8(59), intervalMs);
+end
+
+end
@@ -0,0 +1,99 @@
+function configureMapping(deviceID, rules, options)
+%CONFIGUREMAPPING Maps streamed features to tactor gain and frequency in the MEX.
+%
+% Syntax:
+%   rule = struct('tactor', 1, 'target', 'gain', 'channel', 1, ...
+%                 'transfer', 'power', 'inputRange', [0 0.8], ...
+%                 'outputRange', [0 255], 'exponent', 0.5);
+%   tdk.configureMapping(deviceID, rule, 'Rate', 200);
+%   tdk.pushFeatures(deviceID, envelopes);        % each new frame
+%   tdk.configureMapping(deviceID, []);           % stop, mapped gains back to 0
+%
+%   % Frames written by a decoder process instead (Linux):
+%   tdk.configureMapping(deviceID, rules, 'Source', '/tdk_features');
+%
+% Inputs:
+%   deviceID - Identifier for device
+%   rules    - Struct array, one element per tactor and target, with fields
+%                tactor      - Tactor number
+%                target      - 'gain' or 'freq'
+%                channel     - Feature channel (1-based)
+%                transfer    - (Optional) 'linear' (default), 'power',
+%                              'sigmoid' or 'table'
+%                inputRange  - (Optional) [min max] feature values mapped to
+%                              0 - 1 (clamped); default [0 1]
+%                outputRange - (Optional) [min max] gain (0 - 255) or
+%                              frequency (Hz); default [0 255] / [200 300]
+%                exponent    - (Optional) 'power' exponent (default 1)
+%                slope       - (Optional) 'sigmoid' slope (default 10)
+%                center      - (Optional) 'sigmoid' center in 0 - 1 (default 0.5)
+%                table       - (Optional) 'table' output samples (0 - 1) over
+%                              evenly spaced inputs 0 - 1; resampled to 33
+%                deadband    - (Optional) Smallest change sent (default 1)
+%              [] stops the mapping.
+%   Rate     - Output rate (Hz). Frames arriving between ticks supersede
+%              each other.
+%   Source   - Shared-memory feature block name ('' == tdk.pushFeatures).
+%
+% Mapping only sets gain and frequency; turn the tactors on as usual. A
+% priority stop ends the mapping and a silence mutes that tactor's rules
+% until the mapping is configured again.
+%
+% See also: tdk.pushFeatures, tdk.mappingStatus, tdk.stats
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    rules struct
+    options.Rate (1,1) double {mustBeInRange(options.Rate,1,1000)} = 100;
+    options.Source {mustBeTextScalar} = '';
+end
+
+matrix = zeros(numel(rules), 11);
+tables = zeros(0, 33);
+for k = 1:numel(rules)
+    r = rules(k);
+    target = find(strcmpi(r.target, {'gain', 'freq'}), 1);
+    if isempty(target)
+        error('TDK:InputError', 'Rule %d: target must be ''gain'' or ''freq''.', k);
+    end
+    transfer = 'linear';
+    if isfield(r, 'transfer') && ~isempty(r.transfer)
+        transfer = lower(r.transfer);
+    end
+    kind = find(strcmp(transfer, {'linear', 'power', 'sigmoid', 'table'}), 1);
+    if isempty(kind)
+        error('TDK:InputError', 'Rule %d: unknown transfer ''%s''.', k, transfer);
+    end
+    inputRange = field(r, 'inputRange', [0 1]);
+    defaultOutput = [0 255; 200 300];
+    outputRange = field(r, 'outputRange', defaultOutput(target, :));
+    shape = 1;
+    switch transfer
+        case 'power'
+            shape = field(r, 'exponent', 1);
+        case 'sigmoid'
+            shape = field(r, 'slope', 10);
+        case 'table'
+            samples = double(r.table(:)');
+            if numel(samples) < 2
+                error('TDK:InputError', 'Rule %d: a table needs at least 2 samples.', k);
+            end
+            tables(end+1, :) = interp1(linspace(0, 1, numel(samples)), samples, linspace(0, 1, 33)); %#ok<AGROW>
+            shape = size(tables, 1);
+    end
+    matrix(k, :) = [r.tactor, target, r.channel, kind, inputRange(1), inputRange(2), ...
+                    outputRange(1), outputRange(2), shape, field(r, 'center', 0.5), field(r, 'deadband', 1)];
+end
+
+% uint8(62) == 'configureMapping' code
+tactor(uint8(62), deviceID, matrix, tables, options.Rate, char(options.Source));
+
+end
+
+function value = field(s, name, default)
+if isfield(s, name) && ~isempty(s.(name))
+    value = double(s.(name));
+else
+    value = default;
+end
+end
@@ -0,0 +1,31 @@
+function configureMixer(deviceID, enabled, options)
+%CONFIGUREMIXER Starts or stops the effect mixer for a device.
+%
+% Syntax:
+%   tdk.configureMixer(deviceID, true);
+%   tdk.configureMixer(deviceID, true, 'Rate', 200, 'Budget', 16, 'PulseMs', 50);
+%   tdk.configureMixer(deviceID, false);   % removes all effects, gains back to 0
+%
+% Inputs:
+%   deviceID - Identifier for device
+%   enabled  - true to start mixing, false to stop
+%   Rate     - Mixer tick rate (Hz)
+%   Budget   - Maximum commands issued per tick (at least 3); changes over
+%              budget are deferred to the next tick
+%   PulseMs  - If > 0, sounding tactors are kept on with Pulse commands of
+%              this length (must be longer than one tick)
+%
+% See also: tdk.addEffect, tdk.updateEffect, tdk.removeEffect, tdk.stats
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    enabled (1,1) logical
+    options.Rate (1,1) double {mustBeInRange(options.Rate,1,1000)} = 100;
+    options.Budget (1,1) {mustBeInteger, mustBeGreaterThanOrEqual(options.Budget,3)} = 32;
+    options.PulseMs (1,1) {mustBeInteger, mustBeNonnegative} = 0;
+end
+
+% uint8(37) == 'configureMixer' code
+tactor(uint8(37), deviceID, enabled, options.Rate, options.Budget, options.PulseMs);
+
+end
@@ -0,0 +1,24 @@
+function configureQueue(enabled, maxStaleness)
+%CONFIGUREQUEUE Routes commands through the coalescing I/O queue in the MEX engine.
+%
+% Syntax:
+%   tdk.configureQueue(true);        % queue commands, unbounded staleness
+%   tdk.configureQueue(true, 50);    % drop anything older than 50 ms (except stop)
+%   tdk.configureQueue(false);       % drain and go back to direct calls
+%
+% While enabled, pending gain/frequency updates (and ramps) for the same
+% tactor are replaced by the newest value instead of queueing up behind a
+% slow link. Pulse, stop and setState keep their order. Vendor errors are
+% counted in tdk.stats() instead of raising in the calling function.
+%
+% See also: tdk.stats
+
+arguments
+    enabled (1,1) logical
+    maxStaleness (1,1) double {mustBeNonnegative} = 0; % ms; 0 == unbounded
+end
+
+% uint8(26) == 'configureQueue' code
+tactor(uint8(26), enabled, maxStaleness);
+
+end
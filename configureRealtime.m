@@ -0,0 +1,55 @@
+function report = configureRealtime(options)
+%CONFIGUREREALTIME Sets scheduling policy, CPU affinity and memory locking for engine threads.
+%
+% Syntax:
+%   report = tdk.configureRealtime();   % Status only
+%   report = tdk.configureRealtime('Thread', 'scheduler', 'Policy', 'fifo', 'Priority', 80);
+%   report = tdk.configureRealtime('Thread', 'all', 'Policy', 'fifo', 'CPUs', [2 3], 'LockMemory', 'engine');
+%
+% Options:
+%   Thread     - 'scheduler' (renderers, patterns, LFOs, frame commits), 'io'
+%                (command queue), 'watchdog' (reconnects), 'heartbeat'
+%                (stall stops, see tdk.configureHeartbeat) or 'all'
+%   Policy     - 'normal', 'fifo' (SCHED_FIFO) or 'rr' (SCHED_RR)
+%   Priority   - 1 - 99 for 'fifo' / 'rr'
+%   CPUs       - CPU numbers (0-based) the thread may run on; [] == any
+%   LockMemory - 'none', 'engine' (lock and fault in the engine's buffers)
+%                or 'all' (mlockall: every page MATLAB has, now and later)
+%
+% Output:
+%   report - Struct with threads (per thread: policy, priority, cpus,
+%            running, applied, message) and memory, memoryApplied,
+%            memoryMessage.
+%
+% Settings apply to running threads at once and to threads started later.
+% Nothing is fatal: if the OS refuses (SCHED_FIFO needs CAP_SYS_NICE or an
+% rtprio limit, locking needs RLIMIT_MEMLOCK), the message says so and the
+% thread runs on with default settings. Real-time policies and mlockall are
+% Linux features; on Windows fifo/rr map to thread priorities and only the
+% engine buffers can be locked.
+%
+% See also: tdk.configureQueue, tdk.stats
+
+arguments
+    options.Thread {mustBeMember(options.Thread, {'scheduler', 'io', 'watchdog', 'heartbeat', 'all'})} = 'all';
+    options.Policy {mustBeMember(options.Policy, {'normal', 'fifo', 'rr'})};
+    options.Priority (1,1) double {mustBeInteger, mustBeInRange(options.Priority, 1, 99)} = 50;
+    options.CPUs double {mustBeInteger, mustBeInRange(options.CPUs, 0, 63)} = [];
+    options.LockMemory {mustBeMember(options.LockMemory, {'none', 'engine', 'all'})};
+end
+
+% uint8(56) == 'configureRealtime' code
+if ~isfield(options, 'Policy')
+    if isfield(options, 'LockMemory')
+        error('TDK:InputError', 'LockMemory requires a Policy (use ''normal'' to leave scheduling alone).');
+    end
+    report = tactor(uint8(56));
+    return;
+end
+memory = [];
+if isfield(options, 'LockMemory')
+    memory = char(options.LockMemory);
+end
+report = tactor(uint8(56), char(options.Thread), char(options.Policy), options.Priority, options.CPUs, memory);
+
+end
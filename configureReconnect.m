@@ -0,0 +1,27 @@
+function configureReconnect(enabled, maxBackoff)
+%CONFIGURERECONNECT Reconnects automatically after USB/Bluetooth dropouts.
+%
+% Syntax:
+%   tdk.configureReconnect(true);        % watch connected devices
+%   tdk.configureReconnect(true, 500);   % retry at least every 500 ms while down
+%   tdk.configureReconnect(false);
+%
+% On a connection error (ERROR_CONNECTION, ERROR_EAITIMEOUT,
+% ERROR_FAILED_TO_WRITE) the device is reopened in the background with the
+% name/type it was opened with, and each tactor's last gain, frequency and
+% sig source (plus the last tdk.setState) are restored. The deviceID returned
+% by tdk.open() stays valid. While the device is down, commands only update
+% the state to restore and do not raise errors. Outages and reconnects are
+% reported by tdk.stats().
+%
+% See also: tdk.stats, tdk.open
+
+arguments
+    enabled (1,1) logical
+    maxBackoff (1,1) double {mustBeGreaterThanOrEqual(maxBackoff,10)} = 1000; % ms
+end
+
+% uint8(31) == 'configureReconnect' code
+tactor(uint8(31), enabled, maxBackoff);
+
+end
@@ -0,0 +1,23 @@
+function configureTrace(enabled, options)
+%CONFIGURETRACE Starts or stops recording engine activity for tdk.dumpTrace.
+%
+% Syntax:
+%   tdk.configureTrace(true);                 % start recording
+%   tdk.configureTrace(true, 'Clear', true);  % start over
+%   tdk.configureTrace(false);                % stop (keeps what was recorded)
+%
+% Recorded: MEX calls, argument decode, UpdateTI, each vendor call, and the
+% scheduler, I/O queue and reconnect threads. Each thread keeps its newest
+% 65536 events.
+%
+% See also: tdk.traceMarker, tdk.dumpTrace
+
+arguments
+    enabled (1,1) logical
+    options.Clear (1,1) logical = false;
+end
+
+% uint8(48) == 'configureTrace' code
+tactor(uint8(48), enabled, options.Clear);
+
+end
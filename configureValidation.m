@@ -0,0 +1,27 @@
+function configureValidation(policy)
+%CONFIGUREVALIDATION Sets how the MEX handles out-of-range command values.
+%
+% Syntax:
+%   tdk.configureValidation('clamp');  % default
+%   tdk.configureValidation('error');
+%   tdk.configureValidation('off');
+%
+% Inputs:
+%   policy - 'clamp' clamps tactor (1 - 64), gain (0 - 255), frequency
+%            (300 - 3500 Hz), duration (10 - 2500 ms) and delay (>= 0) into
+%            the EAI_Defines.h limits; 'error' rejects the command; 'off'
+%            passes raw values to the DLL. stats.validationClamped and
+%            stats.validationRejected count what the policy did.
+%
+% The tdk.fast.* wrappers rely on this instead of MATLAB arguments blocks.
+%
+% See also: tdk.fast.pulse, tdk.stats
+
+arguments
+    policy {mustBeMember(policy, {'clamp', 'error', 'off'})}
+end
+
+% uint8(51) == 'configureValidation' code
+tactor(uint8(51), char(policy));
+
+end
@@ -0,0 +1,12 @@
+function detach()
+%DETACH Leaves client mode (see tdk.attach). The daemon keeps running.
+%
+% Syntax:
+%   tdk.detach();
+%
+% See also: tdk.attach
+
+% uint8(36) == 'detach' code
+tactor(uint8(36));
+
+end
@@ -0,0 +1,21 @@
+function n = dumpTrace(filename)
+%DUMPTRACE Writes the recorded trace as Chrome trace-event JSON.
+%
+% Syntax:
+%   n = tdk.dumpTrace('session.json');
+%
+% Open the file in https://ui.perfetto.dev or chrome://tracing.
+%
+% Output:
+%   n - Number of events written
+%
+% See also: tdk.configureTrace, tdk.traceMarker
+
+arguments
+    filename {mustBeTextScalar}
+end
+
+% uint8(50) == 'dumpTrace' code
+n = tactor(uint8(50), char(filename));
+
+end
@@ -96,6 +96,28 @@ while isvalid(fig)
 end
 
 
+%% Native modulation loop (engine LFOs, same AM/FM as above)
+fig = figure('Name','Buzzer Modulation','Color','k', ...
+    'Position',[350   444   727   138], ...
+    'MenuBar', 'none', 'ToolBar', 'none');
+uicontrol(fig,'Style','text','String',[""; "Native AM + FM Loop"; ""], ...
+    'FontName','Consolas','FontSize',32,'ForegroundColor','w', ...
+    'BackgroundColor', 'k', 'Units', 'normalized', 'Position', [0 0 1 1], ...
+    'HorizontalAlignment','center');
+am = tdk.addLfo(deviceID, 0, 'gain', 'sine', 255*(MAX_AMP-MIN_AMP)/2, 255*(MAX_AMP+MIN_AMP)/2, 1e3*AMP_MOD_PERIOD, 'Phase', 0.25);
+fm = tdk.addLfo(deviceID, 0, 'freq', 'sine', (MAX_FREQ-MIN_FREQ)/2, (MAX_FREQ+MIN_FREQ)/2, 1e3*FREQ_MOD_PERIOD, 'Phase', 0.25);
+
+pulseTic = tic;
+while isvalid(fig)
+    tPulse = toc(pulseTic);
+    if (tPulse > PULSE_REFRESH_PERIOD)
+        tdk.pulse(deviceID,PULSE_MS); % Keep buzzing; the engine handles the modulation
+        pulseTic = tic;
+    end
+    pause(0.01);
+end
+tdk.removeLfo(am);
+tdk.removeLfo(fm);
 
 %% Close tactor connection
 tdk.close();
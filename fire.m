@@ -0,0 +1,20 @@
+function fire(slot)
+%FIRE Issues the commands armed in a slot by tdk.arm.
+%
+% Syntax:
+%   tdk.fire(slot);
+%
+% Nothing is decoded or validated at fire time; the prepared calls go to the
+% DLL ahead of other traffic (bypassing the I/O queue and flow control).
+% There is deliberately no arguments block here. In latency-critical loops
+% call the MEX directly instead:
+%   tactor(uint8(34), slot);
+%
+% Fire-to-DLL latency is reported by tdk.stats().
+%
+% See also: tdk.arm, tdk.stats
+
+% uint8(34) == 'fire' code
+tactor(uint8(34), slot);
+
+end
@@ -0,0 +1,16 @@
+function s = flowStatus()
+%FLOWSTATUS Returns flow-control credit and queue depth for each connected device.
+%
+% Syntax:
+%   s = tdk.flowStatus();
+%
+% Output:
+%   s - struct array with fields deviceID, rate, burst, credit, capacity,
+%       queueDepth, throttled, limitErrors, retries, rejected
+%
+% See also: tdk.configureFlowControl
+
+% uint8(29) == 'flowStatus' code
+s = tactor(uint8(29));
+
+end
@@ -0,0 +1,50 @@
+function report = healthCheck(options)
+%HEALTHCHECK Checks every connected controller and tactor in one pass.
+%
+% Syntax:
+%   report = tdk.healthCheck();
+%   report = tdk.healthCheck('Tactors', 1:16, 'PulseMs', 30, 'SpacingMs', 60);
+%   report = tdk.healthCheck('Tactors', []);   % queries only, no sweep
+%   struct2table(report.devices)
+%
+% Runs SelfTest, ReadSegmentList and ReadBatteryLevel on all connected devices
+% at once, then sweeps the tactors with short pulses scheduled on the
+% controllers (all devices in parallel). Total time is about the slowest
+% device's answers plus numel(Tactors) * SpacingMs, whatever the number of
+% devices.
+%
+% Inputs:
+%   Tactors   - Tactors to pulse, one every SpacingMs ([] == no sweep)
+%   PulseMs   - Sweep pulse length (ms)
+%   SpacingMs - Time between sweep pulses (ms)
+%   TimeoutMs - How long each phase waits for the controllers' answers
+%
+% Output:
+%   report - Struct with
+%              healthy   - true if every device passed
+%              responses - false when the backend can't deliver controller
+%                          answers (EAI DLL); only call results are checked
+%              elapsedMs - duration of the whole check
+%              devices   - per device: deviceID, healthy, selfTest, segments
+%                          and battery (ok, errorCode, answered, status ==
+%                          first answer byte, latencyMs, data == answer
+%                          bytes), pulsesIssued, pulsesFailed,
+%                          pulsesAnswered, pulsesRejected, failedTactors,
+%                          answeredMs (last answer, from the start)
+%
+% The segment list and battery answers are returned as raw bytes: their
+% layout isn't documented.
+%
+% See also: tdk.ackStatus, tdk.stats
+
+arguments
+    options.Tactors {mustBeInteger, mustBeInRange(options.Tactors,1,64)} = 1:8;
+    options.PulseMs (1,1) {mustBeInteger, mustBePositive} = 50;
+    options.SpacingMs (1,1) {mustBeInteger, mustBePositive} = 100;
+    options.TimeoutMs (1,1) double {mustBeNonnegative} = 500;
+end
+
+% uint8(65) == 'healthCheck' code
+report = tactor(uint8(65), double(options.Tactors), options.PulseMs, options.SpacingMs, options.TimeoutMs);
+
+end
@@ -0,0 +1,16 @@
+function heartbeat()
+%HEARTBEAT Tells the heartbeat watchdog the control loop is still running.
+%
+% Syntax:
+%   tdk.heartbeat();
+%
+% Any tactor call counts as a heartbeat, so this is only needed in loop
+% iterations that send nothing. It has no arguments to decode, so it costs
+% one MEX round trip.
+%
+% See also: tdk.configureHeartbeat
+
+% uint8(58) == 'heartbeat' code
+tactor(uint8(58));
+
+end
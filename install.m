@@ -1,24 +1,38 @@
-function install(force)
+function install(force, options)
 %INSTALL Compile the tactor.cpp file to a MEX file.
 %
 %   INSTALL compiles the tactor.cpp file to a MEX file. 
 %   The MEX file is saved in the same directory as the 
 %   tactor.cpp file.
 %
+%   On Windows the MEX links the EAI TactorInterface DLL. On Linux and
+%   macOS, where there is no DLL, it is built with the stub backend
+%   (src/stub_backend.cpp, no hardware) unless 'SerialBackend' is true.
+%   The native serial backend (src/serial_backend.cpp) talks to the
+%   controller's serial port directly; pass the port path as the device
+%   name (e.g. tactor('connect', '/dev/ttyACM0', 1)). That build also
+%   passes controller responses to tdk.configureAckTracking. Its packet
+%   framing is EXPERIMENTAL: it has not been verified against TDK hardware.
+%
 % Syntax:
 %   tdk.install();
 %   tdk.install(force); % Default: false - set true to overwrite existing mex
+%   tdk.install(true, 'CountAllocations', true); % Build for tdk.testAllocations
+%   tdk.install(true, 'SerialBackend', true); % Linux/macOS: experimental serial backend
 %
 % See also: tdk.setup, tdk.example, `~/+tdk/src/tactor.cpp`
 
 arguments
     force (1,1) logical = false;
+    options.CountAllocations (1,1) logical = false; % Count C++ heap allocations (stats.heapAllocations)
+    options.SerialBackend (1,1) logical = false; % Linux/macOS: native serial backend (unverified framing)
 end
 
 % Get the path of this script
 thisDir = fileparts(mfilename('fullpath'));
+mexFile = ['tactor.' mexext];
 if ~force
-    if exist(fullfile(thisDir, 'tactor.mexw64'), 'file') == 0
+    if exist(fullfile(thisDir, mexFile), 'file') == 0
         fprintf(1, 'No mex file detected. Installing...\n');
     else
         tdk.setup(); % Just in case
@@ -36,29 +50,59 @@ libPathOutput = fullfile(pwd, 'TDK_API');
 outputPath = thisDir; % MEX file will go in the +tdk directory
 sourceFile = fullfile(thisDir, 'src', 'tactor.cpp');
 
-% Explicitly specify the C++17 standard for the compiler
-mexCmd = sprintf(['mex -outdir "%s" -output tactor ', ...
-                  '-I"%s" -L"%s" -lTactorInterface -lTActionManager ', ...
-                  '%s COMPFLAGS="$COMPFLAGS /std:c++17"'], ...
-                  outputPath, headerPath, libPath, sourceFile);
+defines = '';
+if options.CountAllocations
+    defines = '-DTDK_COUNT_ALLOCS ';
+end
+
+% Explicitly specify the C++20 standard for the compiler (coroutine patterns)
+if ispc
+    mexCmd = sprintf(['mex -outdir "%s" -output tactor %s', ...
+                      '-I"%s" -L"%s" -lTactorInterface -lTActionManager ', ...
+                      '%s COMPFLAGS="$COMPFLAGS /std:c++20"'], ...
+                      outputPath, defines, headerPath, libPath, sourceFile);
+elseif options.SerialBackend
+    warning('TDK:Experimental', ['The native serial backend''s packet framing has not been ', ...
+            'verified against TDK hardware.']);
+    backendFile = fullfile(thisDir, 'src', 'serial_backend.cpp');
+    mexCmd = sprintf(['mex -outdir "%s" -output tactor %s-DTDK_SERIAL_BACKEND ', ...
+                      '-I"%s" "%s" "%s" CXXFLAGS="$CXXFLAGS -std=c++20 -pthread" ', ...
+                      'LDFLAGS="$LDFLAGS -pthread"'], ...
+                      outputPath, defines, headerPath, sourceFile, backendFile);
+else
+    fprintf(1, 'No EAI DLL on this platform: building with the stub backend (no hardware).\n');
+    fprintf(1, '\t->\t(Run tdk.install(true, ''SerialBackend'', true) for the experimental serial backend)\n');
+    backendFile = fullfile(thisDir, 'src', 'stub_backend.cpp');
+    mexCmd = sprintf(['mex -outdir "%s" -output tactor %s', ...
+                      '-I"%s" "%s" "%s" CXXFLAGS="$CXXFLAGS -std=c++20 -pthread" ', ...
+                      'LDFLAGS="$LDFLAGS -pthread"'], ...
+                      outputPath, defines, headerPath, sourceFile, backendFile);
+end
 
 % Run the command
 disp('Compiling tactor.cpp...');
 eval(mexCmd);
 disp('Compilation complete.');
 if exist(libPathOutput,'dir')==0
-    disp('Copying link libraries...');
-    copyfile(libPath,libPathOutput);
-    disp('Libraries installed.');
+    if ispc
+        disp('Copying link libraries...');
+        copyfile(libPath,libPathOutput);
+        disp('Libraries installed.');
+    else
+        mkdir(libPathOutput); % Only the MEX goes here; the backend is built in
+    end
 end
 if contains(path, libPathOutput)
     rmpath(libPathOutput);
 end
-if exist(fullfile(libPathOutput,'tactor.mexw64'),'file')~=0
+if exist(fullfile(libPathOutput,mexFile),'file')~=0
+    if mislocked('tactor')
+        tactor('unlock'); % A persistent engine (tdk.open('Persistent', true)) can't be cleared otherwise
+    end
     clear tactor; % Ensures that MATLAB is not using the mex file, if it already existed.
 end
-copyfile(fullfile(outputPath,'tactor.mexw64'), ...
-             fullfile(libPathOutput, 'tactor.mexw64'), 'f');
+copyfile(fullfile(outputPath,mexFile), ...
+             fullfile(libPathOutput, mexFile), 'f');
 tdk.setup();
 
 end
@@ -0,0 +1,36 @@
+function id = launchPattern(name, deviceID, tacNum, params, options)
+%LAUNCHPATTERN Starts a native haptic pattern (C++ coroutine) on a tactor.
+%
+% Syntax:
+%   id = tdk.launchPattern('pulseTrain', deviceID, 1);
+%   id = tdk.launchPattern('sweep', deviceID, 1, [8 80 200]);
+%   id = tdk.launchPattern('cue', deviceID, 3, [2 255 100], 'Delay', 500);
+%
+% Patterns run inside the MEX on the scheduler thread, so timing does not
+% depend on MATLAB (no pause loops, one call per pattern). Built-in patterns
+% and their parameters (defaults in brackets):
+%   pulseTrain - [count 3, onMs 50, offMs 150, gain 255]
+%   sweep      - [lastTactor 8, stepMs 100, gain 255, pulseMs stepMs]
+%   swell      - [peak 255, riseMs 200, holdMs 200, fallMs 200]
+%   cue        - [event 1, gain 255, pulseMs 100, repeat 1]; pulses each
+%                time tdk.patternEvent(event) is raised
+% A sweep to a lastTactor outside 1 - 64, or a cue on an event outside
+% 1 - 64, fails (counted in tdk.patternStatus) without driving anything.
+%
+% Output:
+%   id - Instance ID for tdk.cancelPattern
+%
+% See also: tdk.cancelPattern, tdk.patternStatus, tdk.patternEvent
+
+arguments
+    name {mustBeTextScalar}
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    tacNum (1,1) {mustBeInteger, mustBeInRange(tacNum,1,64)}
+    params double = [];
+    options.Delay (1,1) double {mustBeNonnegative} = 0; % ms
+end
+
+% uint8(41) == 'launchPattern' code
+id = tactor(uint8(41), char(name), deviceID, tacNum, params, options.Delay);
+
+end
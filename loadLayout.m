@@ -0,0 +1,35 @@
+function radius = loadLayout(deviceID, positions, options)
+%LOADLAYOUT Loads the spatial tactor layout used by the phantom-sensation renderer.
+%
+% Syntax:
+%   radius = tdk.loadLayout(deviceID, positions);
+%   radius = tdk.loadLayout(deviceID, positions, 'Tactors', tactors, 'Radius', radius, 'CheckController', true);
+%
+% Inputs:
+%   deviceID  - Identifier for device
+%   positions - N x 2 or N x 3 tactor positions (e.g. mm on the forearm)
+%
+% Options:
+%   Tactors         - Tactor number for each row (default 1:N)
+%   Radius          - Funneling radius; at least the layout's extent / 255
+%                     (default 1.5x the mean neighbour spacing)
+%   CheckController - true to check the controller answers ReadSegmentList
+%                     first. The segment list isn't compared with the layout.
+%
+% Output:
+%   radius - Funneling radius used by the renderer (same units as positions)
+%
+% See also: tdk.setStimulus, tdk.startRenderer, tdk.stopRenderer
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    positions (:,:) double {mustBeFinite}
+    options.Tactors (1,:) double {mustBeInteger, mustBeInRange(options.Tactors,1,64)} = 1:size(positions,1);
+    options.Radius double {mustBeScalarOrEmpty, mustBePositive} = [];
+    options.CheckController (1,1) logical = false;
+end
+
+% uint8(18) == 'loadLayout' code
+radius = tactor(uint8(18), deviceID, positions, options.Tactors, options.Radius, options.CheckController);
+
+end
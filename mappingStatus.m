@@ -0,0 +1,30 @@
+function status = mappingStatus(deviceID)
+%MAPPINGSTATUS Returns a device's feature mapping counters and latency.
+%
+% Syntax:
+%   status = tdk.mappingStatus(deviceID);
+%
+% Inputs:
+%   deviceID - Identifier for device
+%
+% Output:
+%   status - Struct with
+%              running, rateHz, source
+%              frames      - frames received
+%              superseded  - frames replaced before a tick used them
+%              ticks, commands, failed
+%              last/mean/maxLatencyMs - frame arrival to its last command
+%                            handed off
+%              maxTickMs   - longest mapping tick
+%              targets     - latest computed value per rule (as configured)
+%
+% See also: tdk.configureMapping, tdk.pushFeatures, tdk.stats
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+end
+
+% uint8(64) == 'mappingStatus' code
+status = tactor(uint8(64), deviceID);
+
+end
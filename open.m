@@ -1,9 +1,19 @@
 function deviceID = open(options)
 %OPEN Opens first detected tactor device connected via WinUSB. 
+%
+% Options:
+%   Profile    - Configuration profile (struct or JSON filename) applied in
+%                one burst right after connecting. See tdk.applyProfile.
+%   Persistent - Keep the engine loaded through 'clear all' and 'clear
+%                tactor' (mexLock). Connections, configuration and engine
+%                threads survive, and the next tdk.open reattaches to them
+%                in milliseconds. tdk.close ends it.
 
 arguments
     options.Reset (1,1) logical = false;
     options.Verbose (1,1) logical = true;
+    options.Profile {mustBeA(options.Profile, {'struct', 'char', 'string'})} = struct.empty;
+    options.Persistent (1,1) logical = false;
 end
 
 tdk.setup();
@@ -23,7 +33,11 @@ if isConnected
         tactor('initialize');
         pause(0.1);
     else
-        deviceID = 0;
+        deviceIDs = tactor('getDeviceIDs');
+        deviceID = deviceIDs(1);
+        if options.Persistent
+            tactor('lock');
+        end
         return;
     end
 end
@@ -46,6 +60,17 @@ if options.Verbose
 end
 
 % Connect to the device via WindowsUSB (1)
-deviceID = tactor('connect', deviceName, 1);
+if isempty(options.Profile)
+    deviceID = tactor('connect', deviceName, 1);
+else
+    profile = options.Profile;
+    if ~isstruct(profile)
+        profile = jsondecode(fileread(profile));
+    end
+    deviceID = tactor('connect', deviceName, 1, profile);
+end
+if options.Persistent
+    tactor('lock');
+end
 end
 
@@ -0,0 +1,26 @@
+function count = openStimulusLibrary(filename)
+%OPENSTIMULUSLIBRARY Memory-maps a stimulus library for native playback.
+%
+% Syntax:
+%   count = tdk.openStimulusLibrary('stimuli.tdkstim');
+%
+% Inputs:
+%   filename - Library written by tdk.writeStimulusLibrary
+%
+% Output:
+%   count - Number of stimuli in the library
+%
+% The file is mapped read-only and only its header is read, so opening takes
+% constant time regardless of the library size. Opening a library replaces
+% (and closes) any open one.
+%
+% See also: tdk.playStimulus, tdk.closeStimulusLibrary, tdk.writeStimulusLibrary
+
+arguments
+    filename {mustBeTextScalar}
+end
+
+% uint8(53) == 'openStimulusLibrary' code
+count = tactor(uint8(53), char(filename));
+
+end
@@ -0,0 +1,16 @@
+function patternEvent(event)
+%PATTERNEVENT Raises an event for patterns waiting on it (e.g. 'cue').
+%
+% Syntax:
+%   tdk.patternEvent(event);
+%
+% See also: tdk.launchPattern
+
+arguments
+    event (1,1) {mustBeInteger, mustBeInRange(event,1,64)}
+end
+
+% uint8(44) == 'patternEvent' code
+tactor(uint8(44), event);
+
+end
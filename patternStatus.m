@@ -0,0 +1,26 @@
+function status = patternStatus(name)
+%PATTERNSTATUS Lists registered patterns and running instances.
+%
+% Syntax:
+%   s = tdk.patternStatus();
+%   s = tdk.patternStatus('sweep');   % only instances of 'sweep'
+%
+% Output:
+%   status - Struct with fields registered (cell of names), running (struct
+%            array: id, name, deviceID, tactor, state, elapsedMs), launched,
+%            completed, cancelled, failed, commands, maxTickMs
+%
+% See also: tdk.launchPattern, tdk.cancelPattern
+
+arguments
+    name {mustBeTextScalar} = '';
+end
+
+% uint8(43) == 'patternStatus' code
+if strlength(name) == 0
+    status = tactor(uint8(43));
+else
+    status = tactor(uint8(43), char(name));
+end
+
+end
@@ -0,0 +1,42 @@
+function id = playStimulus(deviceID, tacNum, stimulus, options)
+%PLAYSTIMULUS Plays a stimulus from the open library natively.
+%
+% Syntax:
+%   id = tdk.playStimulus(deviceID, 1, 42);
+%   id = tdk.playStimulus(deviceID, 1, 'sweepLeft', 'GainScale', 0.5, 'Loops', 3);
+%
+% Inputs:
+%   deviceID - Device ID
+%   tacNum   - First tactor; channel c of the stimulus drives tacNum + c - 1
+%   stimulus - Stimulus ID or name
+%
+% Options:
+%   GainScale - Multiplies every gain (default 1)
+%   Loops     - Number of repetitions (1 - 1000000, default 1)
+%   Delay     - Start delay (ms)
+%
+% Output:
+%   id - Pattern instance ID for tdk.cancelPattern / tdk.patternStatus
+%
+% Rows are read straight from the mapped library on the pattern tick and
+% ChangeGain is sent only for channels that changed since the previous row.
+%
+% See also: tdk.openStimulusLibrary, tdk.cancelPattern
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    tacNum (1,1) {mustBeInteger, mustBeInRange(tacNum, 1, 64)}
+    stimulus
+    options.GainScale (1,1) double {mustBeNonnegative} = 1;
+    options.Loops (1,1) {mustBeInteger, mustBeInRange(options.Loops, 1, 1000000)} = 1;
+    options.Delay (1,1) double {mustBeNonnegative} = 0; % ms
+end
+
+if isstring(stimulus)
+    stimulus = char(stimulus);
+end
+
+% uint8(55) == 'playStimulus' code
+id = tactor(uint8(55), deviceID, tacNum, stimulus, options.GainScale, options.Loops, options.Delay);
+
+end
@@ -0,0 +1,26 @@
+function pushFeatures(deviceID, frame)
+%PUSHFEATURES Hands a feature frame to the device's mapping.
+%
+% Syntax:
+%   tdk.pushFeatures(deviceID, frame);
+%
+% Inputs:
+%   deviceID - Identifier for device
+%   frame    - Feature values (up to 64 channels). The next mapping tick
+%              uses the newest frame; latency is measured from this call.
+%
+% See also: tdk.configureMapping, tdk.fast.pushFeatures, tdk.mappingStatus
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    frame {mustBeNumeric, mustBeReal, mustBeVector}
+end
+
+if ~isa(frame, 'single')
+    frame = double(frame);
+end
+
+% uint8(63) == 'pushFeatures' code
+tactor(uint8(63), deviceID, frame);
+
+end
@@ -0,0 +1,16 @@
+function removeEffect(effectID)
+%REMOVEEFFECT Removes an effect; the tactor falls back to its other effects.
+%
+% Syntax:
+%   tdk.removeEffect(effectID);
+%
+% See also: tdk.addEffect, tdk.configureMixer
+
+arguments
+    effectID (1,1) {mustBeInteger}
+end
+
+% uint8(40) == 'removeEffect' code
+tactor(uint8(40), effectID);
+
+end
@@ -0,0 +1,16 @@
+function removeLfo(id)
+%REMOVELFO Stops an LFO, holding the tactor at the value it has reached.
+%
+% Syntax:
+%   tdk.removeLfo(id);
+%
+% See also: tdk.addLfo
+
+arguments
+    id (1,1) {mustBeInteger}
+end
+
+% uint8(47) == 'removeLfo' code
+tactor(uint8(47), id);
+
+end
@@ -0,0 +1,92 @@
+function signal = renderDrive(commands, options)
+%RENDERDRIVE Renders the drive signal a command stream produces, offline.
+%
+% Syntax:
+%   signal = tdk.renderDrive(commands);
+%   signal = tdk.renderDrive(commands, 'SampleRate', 48000, 'Tactors', 1:8);
+%   frames = tdk.renderDrive(commands, 'Duration', 600, 'File', 'session.wav');
+%
+% Inputs:
+%   commands - Struct array, one element per command, with fields
+%                time      - Send time (ms)
+%                command   - 'pulse', 'gain', 'freq', 'rampGain',
+%                            'rampFreq', 'stop', 'state' (on/off) or
+%                            'endOnZeroCrossing'
+%                tactor    - Tactor number; 0 == all
+%                value     - Gain, frequency (Hz), ramp start, or 1/0 for
+%                            'state' and 'endOnZeroCrossing'
+%                and optionally endValue (ramp end), duration (ms) and
+%                delay (ms, added to time).
+%              Or an N x 6 matrix [timeMs type tactor value endValue
+%              durationMs] with the type codes of tactor('h', 'renderDrive').
+%
+% Options:
+%   SampleRate       - Hz (default 16000; keep above 7000 for 3500 Hz)
+%   Duration         - Seconds (default: until the last command ends,
+%                      plus 100 ms)
+%   Tactors          - Tactor for each output channel (default 1 to the
+%                      highest tactor used)
+%   File             - Write to a .wav (32-bit float, one channel per
+%                      tactor) or raw float32 file (frames interleaved,
+%                      read with fread(fid, [numel(Tactors) Inf], 'single')')
+%                      instead of returning the signal
+%   InitialGain      - Gain before the first command (default 255)
+%   InitialFrequency - Frequency before the first command (default 300 Hz)
+%
+% Output:
+%   signal - samples x tactors single matrix, or frames written with File.
+%
+% Each channel is sin(phase) * gain / 255 while its tactor is on. Phase is
+% continuous across frequency changes, ramps are linear per sample, and
+% with endOnZeroCrossing a pulse runs on to the next zero of its sine, as
+% SetFreqTimeDelay does on the device. Out-of-range values are clamped as
+% the command path clamps them. Use it to check a generated stream (or a
+% recorded one) before running it on hardware, or as a reference rendering
+% for regression tests.
+%
+% See also: tdk.pulse, tdk.setGainRamp, tdk.setFrequencyRamp, tdk.applyProfile
+
+arguments
+    commands {mustBeA(commands, {'struct', 'double'})}
+    options.SampleRate (1,1) double {mustBeInRange(options.SampleRate, 1000, 384000)} = 16000;
+    options.Duration double {mustBeScalarOrEmpty, mustBePositive} = [];
+    options.Tactors double {mustBeInteger, mustBeInRange(options.Tactors, 1, 64)} = [];
+    options.File {mustBeTextScalar} = '';
+    options.InitialGain (1,1) double {mustBeInteger, mustBeInRange(options.InitialGain, 0, 255)} = 255;
+    options.InitialFrequency (1,1) double {mustBeInteger, mustBeInRange(options.InitialFrequency, 300, 3500)} = 300;
+end
+
+if isstruct(commands)
+    commands = commandMatrix(commands);
+end
+
+% uint8(57) == 'renderDrive' code
+signal = tactor(uint8(57), commands, options.SampleRate, options.Duration, ...
+    options.Tactors, char(options.File), options.InitialGain, options.InitialFrequency);
+if isempty(options.File)
+    signal = signal.';
+end
+
+end
+
+function m = commandMatrix(commands)
+names = {'pulse', 'gain', 'freq', 'rampGain', 'rampFreq', 'stop', 'state', '', '', 'endOnZeroCrossing'};
+n = numel(commands);
+m = zeros(n, 6);
+for k = 1:n
+    c = commands(k);
+    type = find(strcmp(names, char(c.command)), 1);
+    if isempty(type)
+        error('TDK:InputError', 'Command %d: unknown command ''%s''.', k, char(c.command));
+    end
+    m(k, :) = [c.time + field(c, 'delay'), type, c.tactor, c.value, ...
+        field(c, 'endValue'), field(c, 'duration')];
+end
+end
+
+function v = field(c, name)
+v = 0;
+if isfield(c, name) && ~isempty(c.(name))
+    v = c.(name);
+end
+end
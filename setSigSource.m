@@ -0,0 +1,19 @@
+function setSigSource(deviceID, source)
+%SETSIGSOURCE Sets which signal sources drive the tactor.
+%
+% Syntax:
+%   tdk.setSigSource(deviceID, source);
+%
+% Inputs:
+%   source - Bitwise OR of 1 (primary), 2 (modulation), 4 (noise); e.g. 3
+%            for primary + modulation.
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    source (1,1) {mustBeInteger, mustBeInRange(source,1,7)} = 1;
+end
+
+% uint8(30) == 'changeSigSource' code
+tactor(uint8(30), deviceID, 1, double(source), 0);
+
+end
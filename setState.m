@@ -1,14 +1,20 @@
 function setState(deviceID, state)
 %SETSTATE  Sets the state of up to 64 connected tactors based on bit value.
+%
+% Syntax:
+%   tdk.setState(deviceID, state);
+%
+% Inputs:
+%   deviceID - Identifier for device
+%   state    - uint64 bit mask (tactor 1 == LSB) or logical vector of up to 64 tactor states.
+%
+% See also: tdk.writeFrame
 arguments
     deviceID (1,1) {mustBeInteger} %#ok<*INUSA>
-    state (1,1) {mustBeInteger}
+    state (1,:) {mustBeA(state,["uint64","logical"])}
 end
 
-error("This really does not seem to work, and possibly makes it impossible to use the device until after you restart MATLAB.");
-
 % uint8(13) == 'setState'
-tactor(uint8(13), deviceID, state); %#ok<*UNRCH>
+tactor(uint8(13), deviceID, state);
 
 end
-
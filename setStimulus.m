@@ -0,0 +1,29 @@
+function setStimulus(deviceID, position, intensity, options)
+%SETSTIMULUS Moves the virtual stimulus rendered on the loaded tactor layout.
+%
+% Syntax:
+%   tdk.setStimulus(deviceID, position, intensity);
+%   tdk.setStimulus(deviceID, position, intensity, 'EndPosition', endPosition);
+%   tdk.setStimulus(deviceID, position, intensity, 'Model', 'linear');
+%
+% Inputs:
+%   deviceID    - Identifier for device
+%   position    - Stimulus point (same units as the layout)
+%   intensity   - 0 (off) to 1 (maximum)
+%   EndPosition - Renders a line from position to EndPosition
+%   Model       - 'energy' (default) or 'linear' summation
+%
+% See also: tdk.loadLayout, tdk.startRenderer
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    position (1,:) double {mustBeFinite}
+    intensity (1,1) double {mustBeInRange(intensity,0,1)}
+    options.EndPosition (1,:) double = [];
+    options.Model {mustBeMember(options.Model,{'energy','linear'})} = 'energy';
+end
+
+% uint8(19) == 'setStimulus' code
+tactor(uint8(19), deviceID, position, intensity, options.EndPosition, options.Model);
+
+end
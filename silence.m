@@ -0,0 +1,21 @@
+function silence(deviceID, tacNum)
+%SILENCE Immediately sets one tactor's gain to zero, ahead of any queued work.
+%
+% Syntax:
+%   tdk.silence(deviceID, tacNum);
+%
+% Like tdk.stop, this goes through the MEX priority lane: queued commands
+% for the tactor are cancelled and the gain change reaches the DLL before
+% other traffic. A phantom-sensation renderer using the tactor is stopped.
+%
+% See also: tdk.stop
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    tacNum (1,1) {mustBeInteger, mustBeInRange(tacNum,1,64)} = 1;
+end
+
+% uint8(32) == 'silence' code
+tactor(uint8(32), deviceID, tacNum);
+
+end
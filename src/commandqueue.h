@@ -0,0 +1,327 @@
+#ifndef TDK_COMMANDQUEUE_H
+#define TDK_COMMANDQUEUE_H
+
+// Coalescing command queue in front of the vendor calls.
+//
+// When queue mode is on, commands are handed to an I/O thread instead of being
+// issued on the caller's thread. Continuous parameters (gain, frequency, and the
+// ramps that set them) are latest-value-wins: a new value for the same
+// device/tactor/parameter replaces the pending one in place instead of being
+// queued behind it. Discrete events (Pulse, Stop, SetTactors) keep their order,
+// and a continuous update never jumps over a discrete event queued after it for
+// the same tactor, so "set gain, then pulse" still arrives in that order. An
+// "all tactors" (tactor 0) update and a per-tactor update of the same parameter
+// don't pass each other either, so the last value written still wins.
+//
+// Storage is fixed-size so steady-state submission never allocates.
+//
+// Stop and silence bypass all of this through the priority lane at the bottom:
+// they purge what is queued for the device/tactor, go to the DLL ahead of normal
+// traffic, and then cancel scheduled work through the registered cancel hooks.
+
+#include "engine.h"
+#include "flowcontrol.h"
+
+constexpr int QUEUE_CAPACITY = 1024;       // Must be a power of two
+constexpr int QUEUE_MAX_DEVICES = 8;       // Device IDs 0-7 are coalesced; others are queued as-is
+constexpr int QUEUE_MAX_TACTOR = 64;       // Tactor numbers 0 (all) - 64 are coalesced
+
+enum QueueParam : uint8_t {
+    PARAM_GAIN = 0,
+    PARAM_FREQ = 1,
+    PARAM_NONE = 2
+};
+
+struct QueuedCommand {
+    TactorCommand cmd;
+    int64_t enqueuedUs; // Time of the newest value written to this entry
+    uint64_t seq;       // Position in the queue
+};
+
+struct QueueStats {
+    uint64_t submitted = 0;  // Commands accepted by submitCommand
+    uint64_t coalesced = 0;  // Continuous updates that replaced a pending value
+    uint64_t issued = 0;     // Commands handed to the DLL
+    uint64_t failed = 0;     // Vendor calls that returned an error
+    uint64_t expired = 0;    // Commands dropped for exceeding the staleness bound
+    uint64_t rejected = 0;   // Commands refused because the queue was full
+    uint64_t purged = 0;     // Commands cancelled by a priority stop/silence
+    uint64_t maxDepth = 0;
+    int64_t maxAgeUs = 0;    // Worst observed submit-to-issue age
+    int lastError = 0;       // Last EAI error code seen by the I/O thread
+};
+
+inline std::atomic<bool> queueEnabled{false};
+inline std::mutex queueMutex;
+inline std::condition_variable queueWake;
+inline std::thread ioThread;
+inline bool ioRunning = false;
+inline QueuedCommand queueRing[QUEUE_CAPACITY];
+inline uint64_t queueHead = 1; // Next entry to issue (0 is reserved as "no barrier")
+inline uint64_t queueTail = 1; // Next free entry
+inline int64_t maxStalenessUs = 0; // 0 = unbounded
+inline QueueStats queueStats;
+
+// Queue position of the pending continuous update per device/tactor/param
+// (UINT64_MAX when none), and of the last discrete event per device/tactor.
+inline uint64_t pendingSeq[QUEUE_MAX_DEVICES][QUEUE_MAX_TACTOR + 1][2];
+inline uint64_t barrierSeq[QUEUE_MAX_DEVICES][QUEUE_MAX_TACTOR + 1];
+inline uint64_t deviceBarrierSeq[QUEUE_MAX_DEVICES];
+inline uint64_t tactorParamSeq[QUEUE_MAX_DEVICES][2]; // Newest per-tactor (1 - 64) continuous update
+inline int deviceDepth[QUEUE_MAX_DEVICES]; // Queued entries per device, for flow-control limits
+inline const bool queueLockable = registerRtRegion(queueRing, sizeof(queueRing)) &&
+                                  registerRtRegion(pendingSeq, sizeof(pendingSeq)) &&
+                                  registerRtRegion(barrierSeq, sizeof(barrierSeq));
+
+inline QueueParam queueParamOf(uint8_t type) {
+    switch (type) {
+        case CMD_CHANGE_GAIN:
+        case CMD_RAMP_GAIN:
+            return PARAM_GAIN;
+        case CMD_CHANGE_FREQ:
+        case CMD_RAMP_FREQ:
+            return PARAM_FREQ;
+        default:
+            return PARAM_NONE;
+    }
+}
+
+inline bool coalescable(const TactorCommand& cmd) {
+    return cmd.deviceID >= 0 && cmd.deviceID < QUEUE_MAX_DEVICES &&
+           cmd.tacNum >= 0 && cmd.tacNum <= QUEUE_MAX_TACTOR;
+}
+
+inline void resetQueueIndex() {
+    for (auto& device : pendingSeq)
+        for (auto& tactor : device)
+            tactor[PARAM_GAIN] = tactor[PARAM_FREQ] = UINT64_MAX;
+    for (auto& device : barrierSeq)
+        for (auto& seq : device) seq = 0;
+    for (auto& seq : deviceBarrierSeq) seq = 0;
+    for (auto& device : tactorParamSeq) device[PARAM_GAIN] = device[PARAM_FREQ] = 0;
+    for (auto& depth : deviceDepth) depth = 0;
+}
+
+// Caller holds queueMutex
+inline int enqueueLocked(const TactorCommand& cmd, int64_t now, int* errorCode) {
+    QueueParam param = queueParamOf(cmd.type);
+    bool indexed = coalescable(cmd);
+    if (param != PARAM_NONE && indexed) {
+        uint64_t seq = pendingSeq[cmd.deviceID][cmd.tacNum][param];
+        uint64_t allSeq = pendingSeq[cmd.deviceID][0][param];
+        // Tactor 0 and per-tactor updates of the parameter are barriers for each other
+        uint64_t crossSeq = cmd.tacNum == 0 ? tactorParamSeq[cmd.deviceID][param] : (allSeq == UINT64_MAX ? 0 : allSeq);
+        if (seq != UINT64_MAX && seq >= queueHead &&
+            seq > barrierSeq[cmd.deviceID][cmd.tacNum] &&
+            seq > deviceBarrierSeq[cmd.deviceID] &&
+            seq > crossSeq) {
+            QueuedCommand& entry = queueRing[seq & (QUEUE_CAPACITY - 1)];
+            entry.cmd = cmd;
+            entry.enqueuedUs = now;
+            queueStats.submitted++;
+            queueStats.coalesced++;
+            return 0;
+        }
+    }
+    if (queueTail - queueHead >= QUEUE_CAPACITY) {
+        queueStats.rejected++;
+        if (errorCode) *errorCode = ENGINE_ERROR_QUEUE_FULL;
+        return -1;
+    }
+    FlowConfig flow = getFlowConfig();
+    if (indexed && flow.enabled && deviceDepth[cmd.deviceID] >= flow.queueLimit) {
+        queueStats.rejected++;
+        if (errorCode) *errorCode = ENGINE_ERROR_FLOW_LIMIT;
+        return -1;
+    }
+    uint64_t seq = queueTail++;
+    queueRing[seq & (QUEUE_CAPACITY - 1)] = {cmd, now, seq};
+    if (indexed) {
+        deviceDepth[cmd.deviceID]++;
+        if (param != PARAM_NONE) {
+            pendingSeq[cmd.deviceID][cmd.tacNum][param] = seq;
+            if (cmd.tacNum != 0) tactorParamSeq[cmd.deviceID][param] = seq;
+        } else if (cmd.type == CMD_PULSE && cmd.tacNum != 0) {
+            barrierSeq[cmd.deviceID][cmd.tacNum] = seq;
+            barrierSeq[cmd.deviceID][0] = seq; // "All tactors" updates can't pass it either
+        } else {
+            deviceBarrierSeq[cmd.deviceID] = seq;
+        }
+    }
+    queueStats.submitted++;
+    if (queueTail - queueHead > queueStats.maxDepth) queueStats.maxDepth = queueTail - queueHead;
+    return 0;
+}
+
+inline void ioLoop() {
+    traceThreadName("io");
+    rtThreadStart(RT_IO);
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueWake.wait(lock, [] { return !ioRunning || queueHead != queueTail; });
+        if (queueHead == queueTail) {
+            if (!ioRunning) break;
+            continue;
+        }
+        lock.unlock();
+        updateInterface(); // Once per batch, as the DLL expects once per frame
+        lock.lock();
+        while (queueHead != queueTail) {
+            QueuedCommand entry = queueRing[queueHead & (QUEUE_CAPACITY - 1)];
+            queueHead++;
+            if (coalescable(entry.cmd)) deviceDepth[entry.cmd.deviceID]--;
+            if (entry.cmd.type == CMD_NONE) continue; // Purged by the priority lane
+            int64_t age = nowUs() - entry.enqueuedUs;
+            if (maxStalenessUs > 0 && age > maxStalenessUs && entry.cmd.type != CMD_STOP) {
+                queueStats.expired++;
+                continue;
+            }
+            lock.unlock();
+            int errorCode = 0;
+            int result;
+            {
+                TRACE_SCOPE_ARG("dequeue", age);
+                result = issueWithFlowControl(entry.cmd, &errorCode, -1); // Queued commands wait for credit
+            }
+            lock.lock();
+            queueStats.issued++;
+            if (age > queueStats.maxAgeUs) queueStats.maxAgeUs = age;
+            if (result < 0) {
+                queueStats.failed++;
+                queueStats.lastError = errorCode;
+            }
+        }
+    }
+    lock.unlock();
+    rtThreadExit(RT_IO);
+}
+
+// Queue a command for the I/O thread. Returns 0, or -1 with *errorCode set.
+inline int enqueueCommand(const TactorCommand& cmd, int* errorCode = nullptr) {
+    int result;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        result = enqueueLocked(cmd, nowUs(), errorCode);
+    }
+    queueWake.notify_one();
+    return result;
+}
+
+// Route a command through the queue when it's enabled, otherwise issue it now
+inline int submitCommand(const TactorCommand& cmd, int* errorCode = nullptr) {
+    if (CommandSink sink = commandSink.load(std::memory_order_acquire)) return sink(cmd, 0, errorCode);
+    if (queueEnabled.load(std::memory_order_acquire)) return enqueueCommand(cmd, errorCode);
+    return issueWithFlowControl(cmd, errorCode, getFlowConfig().maxWaitUs);
+}
+
+inline void startQueue(int64_t stalenessUs) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    maxStalenessUs = stalenessUs;
+    if (!ioRunning) {
+        resetQueueIndex();
+        ioRunning = true;
+        ioThread = std::thread(ioLoop);
+    }
+    queueEnabled.store(true, std::memory_order_release);
+}
+
+// Stop accepting commands, let the I/O thread drain what is queued, and join it
+inline void stopQueue() {
+    queueEnabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        ioRunning = false;
+    }
+    queueWake.notify_all();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+}
+
+inline QueueStats getQueueStats(uint64_t* depth = nullptr) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (depth) *depth = queueTail - queueHead;
+    return queueStats;
+}
+
+// Cancel queued commands for a device (tacNum 0) or one tactor. Purged slots
+// become barriers, so later updates can't coalesce back in front of the stop.
+inline int purgeQueued(int deviceID, int tacNum) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    int purged = 0;
+    for (uint64_t seq = queueHead; seq != queueTail; seq++) {
+        TactorCommand& cmd = queueRing[seq & (QUEUE_CAPACITY - 1)].cmd;
+        if (cmd.type == CMD_NONE || cmd.deviceID != deviceID) continue;
+        if (tacNum != 0 && cmd.tacNum != tacNum) continue;
+        cmd.type = CMD_NONE;
+        purged++;
+    }
+    if (deviceID >= 0 && deviceID < QUEUE_MAX_DEVICES && queueTail > queueHead) {
+        if (tacNum == 0) {
+            deviceBarrierSeq[deviceID] = queueTail - 1;
+        } else if (tacNum <= QUEUE_MAX_TACTOR) {
+            barrierSeq[deviceID][tacNum] = queueTail - 1;
+        }
+    }
+    queueStats.purged += purged;
+    return purged;
+}
+
+struct PriorityStats {
+    uint64_t stops = 0;
+    uint64_t silences = 0;
+    int64_t lastLatencyUs = 0;  // MATLAB call to vendor call, last priority command
+    int64_t maxLatencyUs = 0;
+    int64_t totalLatencyUs = 0;
+};
+
+inline std::mutex priorityMutex; // Guards priorityStats
+inline PriorityStats priorityStats;
+
+// Priority lane for Stop (whole device) and silence (ChangeGain 0 on one
+// tactor). callUs is when the request entered the MEX, for latency stats.
+// Not for use from scheduler tasks: cancel hooks unregister periodic tasks.
+inline int issuePriority(const TactorCommand& cmd, int64_t callUs, int* errorCode = nullptr) {
+    if (CommandSink sink = commandSink.load(std::memory_order_acquire)) {
+        return sink(cmd, COMMAND_FLAG_PREEMPT, errorCode); // The daemon runs the priority lane
+    }
+    bool tracked = cmd.deviceID >= 0 && cmd.deviceID < ENGINE_MAX_DEVICES;
+    int tacNum = cmd.type == CMD_STOP ? 0 : cmd.tacNum;
+    uint64_t bits = tacNum == 0 ? ~uint64_t(0) : uint64_t(1) << (tacNum - 1);
+
+    urgentPending.fetch_add(1, std::memory_order_acq_rel);
+    if (tracked) haltMask[cmd.deviceID].fetch_or(bits, std::memory_order_acq_rel);
+    purgeQueued(cmd.deviceID, tacNum);
+    int64_t issueUs = 0;
+    int result = issueUrgent(cmd, errorCode, &issueUs);
+    urgentPending.fetch_sub(1, std::memory_order_acq_rel);
+
+    {
+        std::lock_guard<std::mutex> lock(priorityMutex);
+        int64_t latency = issueUs - callUs;
+        if (cmd.type == CMD_STOP) {
+            priorityStats.stops++;
+        } else {
+            priorityStats.silences++;
+        }
+        priorityStats.lastLatencyUs = latency;
+        priorityStats.totalLatencyUs += latency;
+        if (latency > priorityStats.maxLatencyUs) priorityStats.maxLatencyUs = latency;
+    }
+
+    // Anything still in flight for the halted tactors is dropped until scheduled
+    // work is gone and whatever it queued meanwhile has been purged.
+    for (int i = 0; i < numCancelHooks; i++) {
+        cancelHooks[i](cmd.deviceID, tacNum);
+    }
+    purgeQueued(cmd.deviceID, tacNum);
+    if (tracked) haltMask[cmd.deviceID].fetch_and(~bits, std::memory_order_acq_rel);
+    return result;
+}
+
+inline PriorityStats getPriorityStats() {
+    std::lock_guard<std::mutex> lock(priorityMutex);
+    return priorityStats;
+}
+
+#endif
@@ -0,0 +1,417 @@
+#ifndef TDK_ENGINE_H
+#define TDK_ENGINE_H
+
+// Shared engine state for the tactor MEX.
+//
+// Everything that talks to TactorInterface.dll from more than one thread goes
+// through this header: vendor calls are serialized on tiMutex, and fixed-rate
+// work (renderers, frame commits, ...) runs on a single scheduler thread.
+// issueCommand also keeps the per-device link state (logical -> DLL device ID
+// and the last value sent to each tactor) that the reconnect watchdog replays.
+
+#include "TactorInterface.h"
+#include "EAI_Defines.h"
+#include "trace.h"
+#include "rt.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Engine status codes, reported through handleError like EAI codes
+#define ENGINE_ERROR_QUEUE_FULL 902000 // Command rejected: I/O queue full
+#define ENGINE_ERROR_FLOW_LIMIT 902001 // Command rejected: no flow-control credit in time
+#define ENGINE_ERROR_RING_FULL 902002  // Command rejected: daemon command ring full
+#define ENGINE_ERROR_NO_DAEMON 902003  // Command rejected: daemon not running
+
+// Vendor command codes understood by issueCommand
+enum CommandType : uint8_t {
+    CMD_NONE = 0,
+    CMD_PULSE,
+    CMD_CHANGE_GAIN,
+    CMD_CHANGE_FREQ,
+    CMD_RAMP_GAIN,
+    CMD_RAMP_FREQ,
+    CMD_STOP,
+    CMD_SET_TACTORS,
+    CMD_SIG_SOURCE,
+    CMD_TACTOR_TYPE,     // SetTactorType: value = TDK_TACTOR_TYPE_*
+    CMD_FREQ_TIME_DELAY  // SetFreqTimeDelay: value = 1 to end on a zero crossing
+};
+
+// One call into TactorInterface, decoded and ready to issue
+struct TactorCommand {
+    uint8_t type = CMD_NONE;
+    int deviceID = 0;
+    int tacNum = 0;
+    int value = 0;      // gain, frequency, sig source, or ramp start value
+    int endValue = 0;   // ramp end value
+    int duration = 0;   // ms
+    int delay = 0;      // ms
+    uint64_t mask = 0;  // SetTactors states (tactor 1 == LSB)
+};
+
+constexpr int ENGINE_MAX_DEVICES = 8; // Device IDs 0-7 keep link and shadow state
+constexpr int ENGINE_MAX_TACTOR = 64;
+
+// Last value sent to a tactor (-1 = never set)
+struct TactorShadow {
+    int gain = -1;
+    int freq = -1;
+    int sigSource = -1;
+    int type = -1;
+};
+
+// Connection state of one device ID as MATLAB knows it. After a reconnect the
+// DLL may hand out a different ID, so commands are translated on the way out.
+struct DeviceLink {
+    int physicalID = -1;  // DLL device ID, -1 = same as the logical ID
+    bool down = false;    // Lost; waiting for the watchdog to reconnect
+    int64_t downUs = 0;
+    uint64_t dropped = 0; // Commands absorbed into the shadow state while down
+    bool hasMask = false;
+    uint64_t mask = 0;    // Last SetTactors state
+    int freqTimeDelay = -1; // Last SetFreqTimeDelay (0/1)
+    TactorShadow tactors[ENGINE_MAX_TACTOR + 1]; // [0] == "all tactors"
+};
+
+// All TactorInterface calls are made while holding this lock. It also guards deviceLinks.
+inline std::mutex tiMutex;
+inline DeviceLink deviceLinks[ENGINE_MAX_DEVICES];
+inline const bool deviceLinksLockable = registerRtRegion(deviceLinks, sizeof(deviceLinks));
+inline std::atomic<bool> autoReconnect{false};
+inline std::atomic<bool> linkFault{false};      // Set when a link goes down
+inline std::condition_variable linkWake;        // Wakes the reconnect watchdog
+
+// Monotonic time in microseconds
+inline int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Index of the lowest set bit (bits must be non-zero)
+inline int countTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// Unpack a 64-bit tactor mask into the 8-byte SetTactors layout
+inline void packTactorStates(uint64_t mask, unsigned char states[8]) {
+    for (int i = 0; i < 8; i++) {
+        states[i] = static_cast<unsigned char>((mask >> (8 * i)) & 0xFF);
+    }
+}
+
+inline bool isConnectionError(int errorCode) {
+    return errorCode == ERROR_CONNECTION || errorCode == ERROR_EAITIMEOUT || errorCode == ERROR_FAILED_TO_WRITE;
+}
+
+// DLL device ID for a logical device ID. Caller holds tiMutex.
+inline int physicalDeviceID(int deviceID) {
+    if (deviceID < 0 || deviceID >= ENGINE_MAX_DEVICES) return deviceID;
+    int physicalID = deviceLinks[deviceID].physicalID;
+    return physicalID < 0 ? deviceID : physicalID;
+}
+
+// Remember what a command leaves the device doing. Ramps are recorded at their
+// end value. Caller holds tiMutex.
+inline void recordShadowLocked(const TactorCommand& cmd) {
+    if (cmd.deviceID < 0 || cmd.deviceID >= ENGINE_MAX_DEVICES) return;
+    DeviceLink& link = deviceLinks[cmd.deviceID];
+    auto set = [&](int TactorShadow::*field, int value) {
+        if (cmd.tacNum < 0 || cmd.tacNum > ENGINE_MAX_TACTOR) return;
+        if (cmd.tacNum == 0) {
+            for (auto& tactor : link.tactors) tactor.*field = -1; // "All" supersedes per-tactor values
+        }
+        link.tactors[cmd.tacNum].*field = value;
+    };
+    switch (cmd.type) {
+        case CMD_CHANGE_GAIN:
+            set(&TactorShadow::gain, cmd.value);
+            break;
+        case CMD_RAMP_GAIN:
+            set(&TactorShadow::gain, cmd.endValue);
+            break;
+        case CMD_CHANGE_FREQ:
+            set(&TactorShadow::freq, cmd.value);
+            break;
+        case CMD_RAMP_FREQ:
+            set(&TactorShadow::freq, cmd.endValue);
+            break;
+        case CMD_SIG_SOURCE:
+            set(&TactorShadow::sigSource, cmd.value);
+            break;
+        case CMD_TACTOR_TYPE:
+            set(&TactorShadow::type, cmd.value);
+            break;
+        case CMD_FREQ_TIME_DELAY:
+            link.freqTimeDelay = cmd.value;
+            break;
+        case CMD_SET_TACTORS:
+            link.hasMask = true;
+            link.mask = cmd.mask;
+            break;
+        case CMD_STOP:
+            link.hasMask = true;
+            link.mask = 0;
+            break;
+        default:
+            break; // Pulses are transient and not replayed
+    }
+}
+
+// Call into TactorInterface under the vendor lock, capturing the EAI error on failure
+template <typename F>
+inline int callTI(F&& fn, int& errorCode) {
+    std::lock_guard<std::mutex> lock(tiMutex);
+    int result = fn();
+    errorCode = result < 0 ? GetLastEAIError() : 0;
+    return result;
+}
+
+// Run UpdateTI under the vendor lock
+inline int updateInterface(int* errorCode = nullptr) {
+    std::lock_guard<std::mutex> lock(tiMutex);
+    TRACE_SCOPE("UpdateTI");
+    int result = UpdateTI();
+    if (result < 0 && errorCode) *errorCode = GetLastEAIError();
+    return result;
+}
+
+// Issue a single command to the DLL (caller holds tiMutex, translates the device ID)
+inline int issueCommandLocked(const TactorCommand& cmd, int device) {
+    TRACE_SCOPE_ARG("vendor", cmd.type);
+    switch (cmd.type) {
+        case CMD_PULSE:
+            return Pulse(device, cmd.tacNum, cmd.duration, cmd.delay);
+        case CMD_CHANGE_GAIN:
+            return ChangeGain(device, cmd.tacNum, cmd.value, cmd.delay);
+        case CMD_CHANGE_FREQ:
+            return ChangeFreq(device, cmd.tacNum, cmd.value, cmd.delay);
+        case CMD_RAMP_GAIN:
+            return RampGain(device, cmd.tacNum, cmd.value, cmd.endValue, cmd.duration, TDK_LINEAR_RAMP, cmd.delay);
+        case CMD_RAMP_FREQ:
+            return RampFreq(device, cmd.tacNum, cmd.value, cmd.endValue, cmd.duration, TDK_LINEAR_RAMP, cmd.delay);
+        case CMD_STOP:
+            return Stop(device, cmd.delay);
+        case CMD_SET_TACTORS: {
+            unsigned char states[8];
+            packTactorStates(cmd.mask, states);
+            return SetTactors(device, cmd.delay, states);
+        }
+        case CMD_SIG_SOURCE:
+            return ChangeSigSource(device, cmd.tacNum, cmd.value, cmd.delay);
+        case CMD_TACTOR_TYPE:
+            return SetTactorType(device, cmd.delay, cmd.tacNum, cmd.value);
+        case CMD_FREQ_TIME_DELAY:
+            return SetFreqTimeDelay(device, cmd.value != 0);
+        default:
+            SetLastEAIError(ERROR_BADPARAMETER);
+            return -1;
+    }
+}
+
+// Called under tiMutex after the DLL accepts a command, with the DLL device ID
+// and the time the call started (ack tracking, inflight.h)
+using IssueObserver = void (*)(const TactorCommand& cmd, int device, int64_t issuedUs);
+inline std::atomic<IssueObserver> issueObserver{nullptr};
+
+// Issue with link bookkeeping. Caller holds tiMutex; the EAI error is captured
+// under the same lock so concurrent callers can't clobber it.
+//
+// With auto-reconnect on, a connection-class error marks the device's link down
+// and wakes the watchdog. Until it is back, commands for that device only update
+// its shadow state (so the newest values are replayed) and report success.
+inline int issueTrackedLocked(const TactorCommand& cmd, int* errorCode) {
+    bool tracked = cmd.deviceID >= 0 && cmd.deviceID < ENGINE_MAX_DEVICES;
+    bool watched = tracked && autoReconnect.load(std::memory_order_relaxed);
+    if (watched && deviceLinks[cmd.deviceID].down) {
+        recordShadowLocked(cmd);
+        deviceLinks[cmd.deviceID].dropped++;
+        return 0;
+    }
+    int device = physicalDeviceID(cmd.deviceID);
+    IssueObserver observe = issueObserver.load(std::memory_order_relaxed);
+    int64_t issuedUs = observe ? nowUs() : 0;
+    int result = issueCommandLocked(cmd, device);
+    if (result >= 0) {
+        recordShadowLocked(cmd);
+        if (observe) observe(cmd, device, issuedUs);
+        return result;
+    }
+    int lastError = GetLastEAIError();
+    if (watched && isConnectionError(lastError)) {
+        DeviceLink& link = deviceLinks[cmd.deviceID];
+        link.down = true;
+        link.downUs = nowUs();
+        link.dropped++;
+        recordShadowLocked(cmd);
+        linkFault.store(true, std::memory_order_release);
+        linkWake.notify_one();
+        return 0;
+    }
+    if (errorCode) *errorCode = lastError;
+    return result;
+}
+
+// Priority lane state. While a Stop/silence is pending, normal issuers stand
+// back from the vendor lock, and anything addressed to the halted device or
+// tactors is dropped until the priority command's cancellation has finished.
+inline std::atomic<int> urgentPending{0};
+inline std::atomic<uint64_t> haltMask[ENGINE_MAX_DEVICES]; // Halted tactors (bit t-1), ~0 = whole device
+inline std::atomic<uint64_t> haltDropped{0};               // Commands dropped by a halt
+
+inline bool isHalted(const TactorCommand& cmd) {
+    if (cmd.deviceID < 0 || cmd.deviceID >= ENGINE_MAX_DEVICES) return false;
+    uint64_t halted = haltMask[cmd.deviceID].load(std::memory_order_acquire);
+    if (halted == 0) return false;
+    if (halted == ~uint64_t(0)) return true;
+    return cmd.tacNum >= 1 && cmd.tacNum <= ENGINE_MAX_TACTOR && ((halted >> (cmd.tacNum - 1)) & 1);
+}
+
+// Issue a single command to the DLL
+inline int issueCommand(const TactorCommand& cmd, int* errorCode = nullptr) {
+    TRACE_SCOPE("issue");
+    while (urgentPending.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> lock(tiMutex);
+    if (isHalted(cmd)) {
+        haltDropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return issueTrackedLocked(cmd, errorCode);
+}
+
+// Issue ahead of normal traffic (caller has raised urgentPending).
+// *issueUs receives the time the vendor call started.
+inline int issueUrgent(const TactorCommand& cmd, int* errorCode, int64_t* issueUs) {
+    std::lock_guard<std::mutex> lock(tiMutex);
+    *issueUs = nowUs();
+    return issueTrackedLocked(cmd, errorCode);
+}
+
+// Client mode: when set, commands are handed to the sink (the tdkd command ring)
+// instead of the DLL. Flags tell the daemon how to issue them.
+constexpr uint8_t COMMAND_FLAG_PREEMPT = 0x01; // Stop/silence: priority lane with purge and cancel
+constexpr uint8_t COMMAND_FLAG_UPDATE = 0x02;  // Run UpdateTI before issuing
+constexpr uint8_t COMMAND_FLAG_URGENT = 0x04;  // Fired slot: ahead of normal traffic, no cancellation
+
+using CommandSink = int (*)(const TactorCommand& cmd, uint8_t flags, int* errorCode);
+inline std::atomic<CommandSink> commandSink{nullptr};
+
+// Modules with scheduled work register a hook to cancel it when a device
+// (tacNum 0) or a single tactor is stopped through the priority lane.
+using CancelHook = void (*)(int deviceID, int tacNum);
+constexpr int MAX_CANCEL_HOOKS = 8;
+inline CancelHook cancelHooks[MAX_CANCEL_HOOKS];
+inline int numCancelHooks = 0;
+
+inline bool registerCancelHook(CancelHook hook) {
+    if (numCancelHooks >= MAX_CANCEL_HOOKS) return false;
+    cancelHooks[numCancelHooks++] = hook;
+    return true;
+}
+
+// Fixed-rate task run on the scheduler thread
+struct PeriodicTask {
+    int id;
+    int64_t periodUs;
+    int64_t nextUs;
+    std::function<void(int64_t)> tick; // Called with the scheduled time (us)
+};
+
+inline std::mutex schedulerMutex;
+inline std::condition_variable schedulerWake;
+inline std::vector<PeriodicTask> schedulerTasks;
+inline std::thread schedulerThread;
+inline bool schedulerRunning = false;
+inline int nextTaskID = 1;
+inline uint64_t schedulerOverruns = 0; // Ticks skipped because a task fell a full period behind
+
+inline void schedulerLoop() {
+    traceThreadName("scheduler");
+    rtThreadStart(RT_SCHEDULER);
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    while (schedulerRunning) {
+        if (schedulerTasks.empty()) {
+            schedulerWake.wait(lock);
+            continue;
+        }
+        int64_t nextUs = schedulerTasks.front().nextUs;
+        for (const auto& task : schedulerTasks) {
+            if (task.nextUs < nextUs) nextUs = task.nextUs;
+        }
+        int64_t now = nowUs();
+        if (nextUs > now) {
+            schedulerWake.wait_for(lock, std::chrono::microseconds(nextUs - now));
+            continue;
+        }
+        // Tasks run with the scheduler lock held, so removePeriodicTask() returning
+        // guarantees the task will not tick again.
+        for (auto& task : schedulerTasks) {
+            if (task.nextUs > now) continue;
+            TRACE_SCOPE_ARG("task", task.id);
+            task.tick(task.nextUs);
+            task.nextUs += task.periodUs;
+            if (task.nextUs <= now) {
+                schedulerOverruns++;
+                task.nextUs = now + task.periodUs;
+            }
+        }
+    }
+    lock.unlock();
+    rtThreadExit(RT_SCHEDULER);
+}
+
+// Register a task to run at rateHz. Returns a handle for removePeriodicTask.
+inline int addPeriodicTask(double rateHz, std::function<void(int64_t)> tick) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    int64_t periodUs = static_cast<int64_t>(1e6 / rateHz);
+    if (periodUs < 1) periodUs = 1;
+    int id = nextTaskID++;
+    schedulerTasks.push_back({id, periodUs, nowUs(), std::move(tick)});
+    if (!schedulerRunning) {
+        schedulerRunning = true;
+        schedulerThread = std::thread(schedulerLoop);
+    }
+    schedulerWake.notify_one();
+    return id;
+}
+
+inline void removePeriodicTask(int id) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    for (auto it = schedulerTasks.begin(); it != schedulerTasks.end(); ++it) {
+        if (it->id == id) {
+            schedulerTasks.erase(it);
+            break;
+        }
+    }
+}
+
+// Join the scheduler thread. Must run before ShutdownTI or MEX unload.
+inline void stopScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        schedulerRunning = false;
+        schedulerTasks.clear();
+        schedulerWake.notify_all();
+    }
+    if (schedulerThread.joinable()) {
+        schedulerThread.join();
+    }
+}
+
+#endif
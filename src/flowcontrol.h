@@ -0,0 +1,137 @@
+#ifndef TDK_FLOWCONTROL_H
+#define TDK_FLOWCONTROL_H
+
+// Adaptive per-device flow control.
+//
+// Each device gets a token bucket in front of the DLL. The admitted rate climbs
+// additively while commands succeed, capped by the link capacity measured from
+// vendor call durations, and is halved whenever the controller reports an action
+// limit (ERROR_DM_ACTION_LIMIT_REACHED / ERROR_TM_MAX_ACTION_LIMIT_REACHED).
+// Commands refused that way are retried once credit is available again.
+
+#include "engine.h"
+#include <algorithm>
+
+constexpr int FLOW_MAX_DEVICES = 8;     // Device IDs 0-7 are flow controlled
+constexpr int FLOW_MAX_RETRIES = 3;     // Retries after an action-limit error
+constexpr double FLOW_MIN_RATE = 10.0;  // Commands/s floor after repeated back-off
+constexpr double FLOW_BURST_WINDOW = 0.05; // Burst follows rate over this window (s)
+
+struct FlowConfig {
+    bool enabled = false;
+    double initialRate = 200.0; // Commands/s before anything has been measured
+    double maxBurst = 32.0;
+    int queueLimit = 256;       // Per-device queued commands before rejecting
+    int64_t maxWaitUs = 20000;  // Longest a direct (unqueued) call may wait for credit
+};
+
+struct FlowState {
+    double rate = 0.0;     // Currently admitted commands/s
+    double burst = 0.0;    // Bucket size
+    double tokens = 0.0;   // Current credit
+    double capacity = 0.0; // Measured link capacity (commands/s), 0 until measured
+    double callUs = 0.0;   // EWMA of vendor call duration
+    int64_t refillUs = 0;
+    uint64_t throttled = 0;   // Commands that had to wait for credit
+    uint64_t limitErrors = 0; // Action-limit errors seen
+    uint64_t retries = 0;
+    uint64_t rejected = 0;    // Commands refused by flow control
+};
+
+inline std::mutex flowMutex;
+inline FlowConfig flowConfig;
+inline FlowState flowStates[FLOW_MAX_DEVICES];
+
+inline FlowConfig getFlowConfig() {
+    std::lock_guard<std::mutex> lock(flowMutex);
+    return flowConfig;
+}
+
+inline bool isActionLimitError(int errorCode) {
+    return errorCode == ERROR_DM_ACTION_LIMIT_REACHED || errorCode == ERROR_TM_MAX_ACTION_LIMIT_REACHED;
+}
+
+inline bool flowControlled(int deviceID) {
+    return deviceID >= 0 && deviceID < FLOW_MAX_DEVICES;
+}
+
+// Caller holds flowMutex
+inline void refillLocked(FlowState& fs, int64_t now) {
+    if (fs.rate <= 0.0) {
+        fs.rate = flowConfig.initialRate;
+        fs.burst = std::min(flowConfig.maxBurst, std::max(1.0, fs.rate * FLOW_BURST_WINDOW));
+        fs.tokens = fs.burst;
+        fs.refillUs = now;
+        return;
+    }
+    fs.tokens = std::min(fs.burst, fs.tokens + fs.rate * (now - fs.refillUs) * 1e-6);
+    fs.refillUs = now;
+}
+
+// Take one token. Returns 0 if admitted, otherwise the wait (us) until a token is due.
+inline int64_t flowAcquire(int deviceID) {
+    std::lock_guard<std::mutex> lock(flowMutex);
+    FlowState& fs = flowStates[deviceID];
+    refillLocked(fs, nowUs());
+    if (fs.tokens >= 1.0) {
+        fs.tokens -= 1.0;
+        return 0;
+    }
+    return static_cast<int64_t>((1.0 - fs.tokens) / fs.rate * 1e6) + 1;
+}
+
+// Feed the result of a vendor call back into the bucket
+inline void flowRecord(int deviceID, int result, int errorCode, int64_t callUs) {
+    std::lock_guard<std::mutex> lock(flowMutex);
+    FlowState& fs = flowStates[deviceID];
+    if (result < 0 && isActionLimitError(errorCode)) {
+        fs.limitErrors++;
+        fs.rate = std::max(FLOW_MIN_RATE, fs.rate * 0.5);
+        fs.burst = std::max(1.0, fs.burst * 0.5);
+        fs.tokens = 0.0;
+        return;
+    }
+    fs.callUs = fs.callUs > 0.0 ? 0.9 * fs.callUs + 0.1 * callUs : static_cast<double>(callUs);
+    fs.capacity = 1e6 / std::max(fs.callUs, 1.0);
+    fs.rate = std::min(fs.capacity, fs.rate + 1.0); // Additive increase, one command/s per success
+    fs.burst = std::min(flowConfig.maxBurst, std::max(1.0, fs.rate * FLOW_BURST_WINDOW));
+}
+
+// Issue a command through the device's token bucket. Waits for credit up to
+// maxWaitUs (< 0: no limit) and retries action-limit errors after backing off.
+inline int issueWithFlowControl(const TactorCommand& cmd, int* errorCode, int64_t maxWaitUs) {
+    if (!getFlowConfig().enabled || !flowControlled(cmd.deviceID)) return issueCommand(cmd, errorCode);
+
+    int localError = 0;
+    int result = -1;
+    int64_t waited = 0;
+    for (int attempt = 0; attempt <= FLOW_MAX_RETRIES; attempt++) {
+        int64_t waitUs;
+        bool throttled = false;
+        while ((waitUs = flowAcquire(cmd.deviceID)) > 0) {
+            if (maxWaitUs >= 0 && waited + waitUs > maxWaitUs) {
+                std::lock_guard<std::mutex> lock(flowMutex);
+                flowStates[cmd.deviceID].rejected++;
+                if (errorCode) *errorCode = ENGINE_ERROR_FLOW_LIMIT;
+                return -1;
+            }
+            throttled = true;
+            std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+            waited += waitUs;
+        }
+        if (throttled) {
+            std::lock_guard<std::mutex> lock(flowMutex);
+            flowStates[cmd.deviceID].throttled++;
+        }
+        int64_t t0 = nowUs();
+        result = issueCommand(cmd, &localError);
+        flowRecord(cmd.deviceID, result, localError, nowUs() - t0);
+        if (result >= 0 || !isActionLimitError(localError) || attempt == FLOW_MAX_RETRIES) break;
+        std::lock_guard<std::mutex> lock(flowMutex);
+        flowStates[cmd.deviceID].retries++;
+    }
+    if (result < 0 && errorCode) *errorCode = localError;
+    return result;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef TDK_FRAMEBUFFER_H
+#define TDK_FRAMEBUFFER_H
+
+// Double-buffered 64-tactor frames.
+//
+// MATLAB writes the back frame (on/off mask plus optional per-tactor gains);
+// a commit diffs it against the front (last committed) frame and only sends
+// what changed: ChangeGain for changed gains, then one SetTactors if the mask
+// changed. Commits run on demand or at a fixed rate on the engine scheduler.
+
+#include "commandqueue.h"
+#include <map>
+
+struct TactorFrame {
+    uint64_t mask = 0;     // On/off state, tactor 1 == LSB
+    uint64_t gainMask = 0; // Tactors whose gain is set in this frame
+    uint8_t gain[64] = {};
+};
+
+struct FrameBuffer {
+    TactorFrame back;  // Written by MATLAB
+    TactorFrame front; // Last frame committed to the device
+    bool dirty = false;
+    bool committed = false; // front is only meaningful after the first commit
+    int taskID = 0;
+    uint64_t commits = 0;
+    uint64_t commandsSent = 0;
+    int lastError = 0;
+};
+
+inline std::mutex frameMutex;  // Guards back buffers and the map itself
+inline std::mutex commitMutex; // Serializes commits (front buffers)
+inline std::map<int, FrameBuffer> frameBuffers; // deviceID -> frames
+
+// Merge a new frame into the back buffer. Gains not set in `frame` keep their
+// previously written value.
+inline void writeBackFrame(int deviceID, const TactorFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    FrameBuffer& fb = frameBuffers[deviceID];
+    fb.back.mask = frame.mask;
+    uint64_t bits = frame.gainMask;
+    while (bits) {
+        int i = countTrailingZeros(bits);
+        fb.back.gain[i] = frame.gain[i];
+        bits &= bits - 1;
+    }
+    fb.back.gainMask |= frame.gainMask;
+    fb.dirty = true;
+}
+
+// Commit the back frame for a device. Returns the number of commands sent, or
+// -1 if a vendor call failed (EAI code in *errorCode).
+inline int commitFrame(int deviceID, int* errorCode = nullptr) {
+    std::lock_guard<std::mutex> commit(commitMutex);
+    TactorFrame next;
+    TactorFrame front;
+    bool committed;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        auto it = frameBuffers.find(deviceID);
+        if (it == frameBuffers.end() || !it->second.dirty) return 0;
+        next = it->second.back;
+        front = it->second.front;
+        committed = it->second.committed;
+        it->second.dirty = false;
+    }
+
+    int sent = 0;
+    int result = 0;
+    TactorCommand cmd;
+    cmd.deviceID = deviceID;
+
+    // Gains first, so tactors switched on below start at their new gain
+    uint64_t changed = next.gainMask & ~(committed ? front.gainMask : 0);
+    uint64_t both = next.gainMask & (committed ? front.gainMask : 0);
+    while (both) {
+        int i = countTrailingZeros(both);
+        if (next.gain[i] != front.gain[i]) changed |= uint64_t(1) << i;
+        both &= both - 1;
+    }
+    cmd.type = CMD_CHANGE_GAIN;
+    while (changed && result >= 0) {
+        int i = countTrailingZeros(changed);
+        cmd.tacNum = i + 1;
+        cmd.value = next.gain[i];
+        result = submitCommand(cmd, errorCode);
+        if (result >= 0) {
+            front.gain[i] = next.gain[i];
+            front.gainMask |= uint64_t(1) << i;
+            sent++;
+        }
+        changed &= changed - 1;
+    }
+    if (result >= 0 && (!committed || next.mask != front.mask)) {
+        cmd.type = CMD_SET_TACTORS;
+        cmd.mask = next.mask;
+        result = submitCommand(cmd, errorCode);
+        if (result >= 0) {
+            front.mask = next.mask;
+            sent++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(frameMutex);
+    FrameBuffer& fb = frameBuffers[deviceID];
+    fb.front = front;
+    fb.commits++;
+    fb.commandsSent += sent;
+    if (result < 0) {
+        fb.dirty = true; // Retry what didn't make it on the next commit
+        fb.lastError = errorCode ? *errorCode : -1;
+        return -1;
+    }
+    fb.committed = true;
+    return sent;
+}
+
+// Priority stop: background commits end and nothing pending survives (Stop
+// leaves every tactor off). Silence: the tactor's gain is known to be 0.
+inline void cancelFrameCommit(int deviceID, int tacNum) {
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> commit(commitMutex);
+        std::lock_guard<std::mutex> lock(frameMutex);
+        auto it = frameBuffers.find(deviceID);
+        if (it == frameBuffers.end()) return;
+        FrameBuffer& fb = it->second;
+        if (tacNum == 0) {
+            taskID = fb.taskID;
+            fb.taskID = 0;
+            fb.back.mask = 0;
+            fb.front.mask = 0;
+            fb.dirty = false;
+        } else if (tacNum <= 64) {
+            int i = tacNum - 1;
+            fb.back.gain[i] = 0;
+            fb.front.gain[i] = 0;
+            fb.back.gainMask |= uint64_t(1) << i;
+            fb.front.gainMask |= uint64_t(1) << i;
+        }
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+}
+
+inline const bool frameCancelRegistered = registerCancelHook(cancelFrameCommit);
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef TDK_HEALTH_H
+#define TDK_HEALTH_H
+
+// Pre-session health check.
+//
+// Every connected controller is checked at once rather than one after the
+// other. SelfTest, ReadSegmentList and ReadBatteryLevel go out to all devices
+// back to back, and a single wait collects the answers as the Connect callback
+// delivers them (healthResponse). So the query phase lasts as long as the
+// slowest controller. The sweep then schedules one short pulse per tactor on
+// every device through the controller's own delay argument (tactor k starts at
+// k * spacing). All devices sweep in parallel while the MEX thread only
+// collects the Pulse acknowledgements and waits for the last pulse to end.
+//
+// Only the native serial backend delivers responses. With the EAI DLL the
+// report has each call's result but nothing answered, and the check doesn't
+// wait for answers that can't come.
+
+#include "commandqueue.h"
+#include "inflight.h"
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+enum HealthQuery {
+    HEALTH_SELF_TEST,
+    HEALTH_SEGMENTS,
+    HEALTH_BATTERY,
+    HEALTH_NUM_QUERIES
+};
+
+inline const char* const healthQueryNames[HEALTH_NUM_QUERIES] = {"selfTest", "segments", "battery"};
+inline const uint8_t healthQueryWire[HEALTH_NUM_QUERIES] = {TDK_COMMAND_SELFTEST, TDK_COMMAND_GETSEGMENTLIST,
+                                                            TDK_COMMAND_READ_BAT_DATA};
+
+struct HealthAnswer {
+    int result = 0;        // Vendor call result (< 0 == failed)
+    int errorCode = 0;
+    bool pending = false;  // Sent, no answer yet
+    bool answered = false;
+    int64_t issuedUs = 0;
+    int64_t latencyUs = 0;
+    SerialFrame frame;     // The answer (status byte or data)
+};
+
+struct HealthDevice {
+    int deviceID = 0;   // Logical
+    int physicalID = 0; // DLL device ID the responses carry
+    HealthAnswer answers[HEALTH_NUM_QUERIES];
+    int pulsesIssued = 0;
+    int pulsesFailed = 0;
+    int pulsesAnswered = 0;
+    int pulsesRejected = 0;   // Answered with a non-zero status
+    uint64_t failedMask = 0;  // Tactors whose pulse couldn't be issued (bit n == tactor n + 1)
+    int64_t lastAnswerUs = 0;
+};
+
+struct HealthOptions {
+    uint64_t tactors = 0; // Swept tactors (bit n == tactor n + 1)
+    int pulseMs = 50;
+    int spacingMs = 100;
+    int64_t timeoutUs = 500000; // Per phase, for answers
+};
+
+// Guarded by healthMutex; only populated while a check runs
+inline std::mutex healthMutex;
+inline std::condition_variable healthWake;
+inline std::vector<HealthDevice> healthDevices;
+inline bool healthSweeping = false;
+
+// Response observer: runs on the backend's reader thread
+inline void healthResponse(int device, const SerialFrame& frame) {
+    int64_t now = nowUs();
+    std::lock_guard<std::mutex> lock(healthMutex);
+    for (HealthDevice& d : healthDevices) {
+        if (d.physicalID != device) continue;
+        if (healthSweeping && frame.command == TDK_COMMAND_PULSE) {
+            d.pulsesAnswered++;
+            if (frame.length == 1 && frame.payload[0] != SERIAL_STATUS_OK) d.pulsesRejected++;
+        }
+        for (int q = 0; q < HEALTH_NUM_QUERIES; q++) {
+            HealthAnswer& a = d.answers[q];
+            if (!a.pending || frame.command != healthQueryWire[q]) continue;
+            a.pending = false;
+            a.answered = true;
+            a.latencyUs = now - a.issuedUs;
+            a.frame = frame;
+        }
+        d.lastAnswerUs = now;
+    }
+    healthWake.notify_all();
+}
+
+inline bool healthResponsesAvailable() {
+    return ackCallback() != nullptr;
+}
+
+inline int issueHealthQuery(int device, int query, int& errorCode) {
+    switch (query) {
+        case HEALTH_SELF_TEST: return callTI([&] { return TactorSelfTest(device, 0); }, errorCode);
+        case HEALTH_SEGMENTS: return callTI([&] { return ReadSegmentList(device, 0); }, errorCode);
+        default: return callTI([&] { return ReadBatteryLevel(device, 0); }, errorCode);
+    }
+}
+
+// Query every device, then wait once for all the answers
+inline void runHealthQueries(const std::vector<int>& deviceIDs, const HealthOptions& options) {
+    for (size_t i = 0; i < deviceIDs.size(); i++) {
+        int device;
+        {
+            std::lock_guard<std::mutex> lock(tiMutex);
+            device = physicalDeviceID(deviceIDs[i]);
+        }
+        for (int q = 0; q < HEALTH_NUM_QUERIES; q++) {
+            {
+                std::lock_guard<std::mutex> lock(healthMutex); // Armed first: the answer can beat the call's return
+                HealthDevice& d = healthDevices[i];
+                d.physicalID = device;
+                d.answers[q].issuedUs = nowUs();
+                d.answers[q].pending = true;
+            }
+            int errorCode = 0;
+            int result = issueHealthQuery(device, q, errorCode);
+            std::lock_guard<std::mutex> lock(healthMutex);
+            HealthAnswer& a = healthDevices[i].answers[q];
+            a.result = result;
+            a.errorCode = errorCode;
+            if (result < 0) a.pending = false;
+        }
+    }
+    if (!queueEnabled.load(std::memory_order_acquire)) updateInterface();
+    if (!healthResponsesAvailable()) return;
+    int64_t deadlineUs = nowUs() + options.timeoutUs;
+    std::unique_lock<std::mutex> lock(healthMutex);
+    healthWake.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(deadlineUs)), [] {
+        for (const HealthDevice& d : healthDevices) {
+            for (const HealthAnswer& a : d.answers) {
+                if (a.pending) return false;
+            }
+        }
+        return true;
+    });
+}
+
+// Schedule the pulse sweep on every device at once, then wait for it to play out
+inline void runHealthSweep(const std::vector<int>& deviceIDs, const HealthOptions& options) {
+    if (options.tactors == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(healthMutex);
+        healthSweeping = true;
+    }
+    int64_t startUs = nowUs();
+    int slot = 0;
+    TactorCommand cmd;
+    cmd.type = CMD_PULSE;
+    cmd.duration = options.pulseMs;
+    for (uint64_t bits = options.tactors; bits; bits &= bits - 1, slot++) {
+        cmd.tacNum = countTrailingZeros(bits) + 1;
+        cmd.delay = slot * options.spacingMs;
+        for (size_t i = 0; i < deviceIDs.size(); i++) {
+            cmd.deviceID = deviceIDs[i];
+            bool ok = submitCommand(cmd) >= 0;
+            std::lock_guard<std::mutex> lock(healthMutex);
+            HealthDevice& d = healthDevices[i];
+            d.pulsesIssued++;
+            if (!ok) {
+                d.pulsesFailed++;
+                d.failedMask |= uint64_t(1) << (cmd.tacNum - 1);
+            }
+        }
+    }
+    if (!queueEnabled.load(std::memory_order_acquire)) updateInterface();
+    int64_t playedUs = startUs + (static_cast<int64_t>(slot - 1) * options.spacingMs + options.pulseMs) * 1000;
+    int64_t remainingUs = playedUs - nowUs();
+    if (remainingUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(remainingUs)); // Acks are counted meanwhile
+    if (!healthResponsesAvailable()) return;
+    int64_t deadlineUs = playedUs + options.timeoutUs;
+    std::unique_lock<std::mutex> lock(healthMutex);
+    healthWake.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(deadlineUs)), [] {
+        for (const HealthDevice& d : healthDevices) {
+            if (d.pulsesAnswered < d.pulsesIssued - d.pulsesFailed) return false;
+        }
+        return true;
+    });
+}
+
+// Run a full check on the given logical devices and return the per-device results
+inline std::vector<HealthDevice> runHealthCheck(const std::vector<int>& deviceIDs, const HealthOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(healthMutex);
+        healthDevices.assign(deviceIDs.size(), HealthDevice());
+        for (size_t i = 0; i < deviceIDs.size(); i++) healthDevices[i].deviceID = deviceIDs[i];
+        healthSweeping = false;
+    }
+    responseObserver.store(&healthResponse, std::memory_order_release);
+    runHealthQueries(deviceIDs, options);
+    runHealthSweep(deviceIDs, options);
+    responseObserver.store(nullptr, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(healthMutex);
+    std::vector<HealthDevice> results;
+    results.swap(healthDevices);
+    healthSweeping = false;
+    return results;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef TDK_HEARTBEAT_H
+#define TDK_HEARTBEAT_H
+
+// Heartbeat watchdog.
+//
+// Opt-in dead-man switch for the controlling MATLAB loop. Every MEX call
+// (a command or an explicit 'heartbeat') stores its time in heartbeatLastUs;
+// that is the only cost on the command path. The heartbeat thread sleeps
+// until the current deadline (last call + interval). If no call came in
+// meanwhile, it issues Stop through the priority lane on every connected
+// device, which also purges queued commands and cancels renderers, patterns
+// and LFOs through the cancel hooks. So a GC pause, a redraw or an error
+// dialog can't leave tactors running for longer than the interval plus one
+// wake-up. A trip is counted, kept in a short log, and written as a trace
+// marker when tracing is on. The watchdog re-arms on the next call.
+//
+// Runs on its own thread rather than as a scheduler task: issuePriority's
+// cancel hooks unregister periodic tasks, which a task must not do.
+
+#include "engine.h"
+#include "commandqueue.h"
+#include "rt.h"
+#include "trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+constexpr int HEARTBEAT_LOG_SIZE = 16;
+constexpr int64_t HEARTBEAT_MIN_INTERVAL_US = 5000;
+
+struct HeartbeatTrip {
+    double unixTime = 0.0; // Wall clock at the trip, for matching against host logs
+    int64_t gapUs = 0;     // Time since the last call when Stop went out
+    int devices = 0;       // Devices stopped
+    int failures = 0;      // Stops that failed
+};
+
+struct HeartbeatStats {
+    uint64_t trips = 0;
+    uint64_t stopFailures = 0;
+    int64_t maxTripLatencyUs = 0;  // Deadline to Stop issued, worst case
+    HeartbeatTrip log[HEARTBEAT_LOG_SIZE];
+    int logCount = 0;              // Trips in the log (newest at (logNext - 1))
+    int logNext = 0;
+};
+
+inline std::atomic<int64_t> heartbeatLastUs{0};     // Last MEX call
+inline std::atomic<int64_t> heartbeatIntervalUs{0}; // 0 == off
+inline std::atomic<int64_t> heartbeatMaxGapUs{0};   // Longest gap between calls while armed
+inline std::atomic<uint64_t> heartbeatDevices{0};   // Connected device IDs (bit n == device n)
+
+// Guarded by heartbeatMutex
+inline std::mutex heartbeatMutex;
+inline std::condition_variable heartbeatWake;
+inline std::thread heartbeatThread;
+inline bool heartbeatRunning = false;
+inline bool heartbeatTripped = false; // Until the next call
+inline HeartbeatStats heartbeatStats;
+
+// Record a call (MEX entry). Lock-free; the gap is only tracked while armed.
+inline void heartbeat(int64_t callUs) {
+    int64_t previousUs = heartbeatLastUs.exchange(callUs, std::memory_order_relaxed);
+    if (heartbeatIntervalUs.load(std::memory_order_relaxed) <= 0 || previousUs == 0) return;
+    int64_t gap = callUs - previousUs;
+    int64_t seen = heartbeatMaxGapUs.load(std::memory_order_relaxed);
+    while (gap > seen && !heartbeatMaxGapUs.compare_exchange_weak(seen, gap, std::memory_order_relaxed)) {
+    }
+}
+
+// Stop every connected device. Called on the heartbeat thread without
+// heartbeatMutex held.
+inline void tripHeartbeat(int64_t lastUs, int64_t deadlineUs) {
+    uint64_t devices = heartbeatDevices.load(std::memory_order_acquire);
+    int stopped = 0;
+    int failures = 0;
+    int64_t issuedUs = nowUs();
+    for (int d = 0; d < 64; d++) {
+        if (!(devices >> d & 1)) continue;
+        TactorCommand cmd;
+        cmd.type = CMD_STOP;
+        cmd.deviceID = d;
+        int errorCode = 0;
+        TRACE_SCOPE_ARG("heartbeat-stop", d);
+        if (issuePriority(cmd, deadlineUs, &errorCode) < 0) failures++;
+        stopped++;
+    }
+    if (traceEnabled.load(std::memory_order_relaxed)) { // Correlate with the host stall in the timeline
+        char text[TRACE_MARKER_CHARS];
+        std::snprintf(text, sizeof(text), "heartbeat trip: %.1f ms without a call", (issuedUs - lastUs) / 1000.0);
+        traceMarker(text);
+    }
+    std::lock_guard<std::mutex> lock(heartbeatMutex);
+    HeartbeatStats& s = heartbeatStats;
+    HeartbeatTrip& trip = s.log[s.logNext];
+    trip.unixTime = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    trip.gapUs = issuedUs - lastUs;
+    trip.devices = stopped;
+    trip.failures = failures;
+    s.logNext = (s.logNext + 1) % HEARTBEAT_LOG_SIZE;
+    if (s.logCount < HEARTBEAT_LOG_SIZE) s.logCount++;
+    s.trips++;
+    s.stopFailures += failures;
+    if (issuedUs - deadlineUs > s.maxTripLatencyUs) s.maxTripLatencyUs = issuedUs - deadlineUs;
+}
+
+inline void heartbeatLoop() {
+    traceThreadName("heartbeat");
+    rtThreadStart(RT_HEARTBEAT);
+    std::unique_lock<std::mutex> lock(heartbeatMutex);
+    int64_t seenUs = heartbeatLastUs.load(std::memory_order_relaxed);
+    while (heartbeatRunning) {
+        int64_t intervalUs = heartbeatIntervalUs.load(std::memory_order_relaxed);
+        if (intervalUs <= 0) {
+            heartbeatWake.wait(lock);
+            continue;
+        }
+        int64_t lastUs = heartbeatLastUs.load(std::memory_order_relaxed);
+        if (lastUs != seenUs) {
+            heartbeatTripped = false; // A call came in: re-arm
+            seenUs = lastUs;
+        }
+        int64_t now = nowUs();
+        int64_t deadlineUs = lastUs + intervalUs;
+        if (heartbeatTripped || now < deadlineUs) {
+            // After a trip, poll for the next call at the interval
+            int64_t waitUs = heartbeatTripped ? intervalUs : deadlineUs - now;
+            heartbeatWake.wait_for(lock, std::chrono::microseconds(waitUs));
+            continue;
+        }
+        heartbeatTripped = true;
+        lock.unlock();
+        tripHeartbeat(lastUs, deadlineUs);
+        lock.lock();
+    }
+    lock.unlock();
+    rtThreadExit(RT_HEARTBEAT);
+}
+
+// Arm with an interval, or disarm with 0. The interval counts from now.
+inline void configureHeartbeat(int64_t intervalUs) {
+    std::lock_guard<std::mutex> lock(heartbeatMutex);
+    heartbeatLastUs.store(nowUs(), std::memory_order_relaxed);
+    heartbeatIntervalUs.store(intervalUs, std::memory_order_relaxed);
+    heartbeatTripped = false;
+    if (intervalUs > 0 && !heartbeatRunning) {
+        heartbeatRunning = true;
+        heartbeatThread = std::thread(heartbeatLoop);
+    }
+    heartbeatWake.notify_one();
+}
+
+// Join the heartbeat thread. Must run before the queue and devices are shut down.
+inline void stopHeartbeat() {
+    {
+        std::lock_guard<std::mutex> lock(heartbeatMutex);
+        heartbeatRunning = false;
+        heartbeatIntervalUs.store(0, std::memory_order_relaxed);
+        heartbeatWake.notify_all();
+    }
+    if (heartbeatThread.joinable()) heartbeatThread.join();
+    std::lock_guard<std::mutex> lock(heartbeatMutex);
+    heartbeatTripped = false;
+    heartbeatStats = HeartbeatStats();
+    heartbeatMaxGapUs.store(0, std::memory_order_relaxed);
+    heartbeatDevices.store(0, std::memory_order_release);
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef TDK_INFLIGHT_H
+#define TDK_INFLIGHT_H
+
+// In-flight command tracking.
+//
+// A vendor call returning 0 only means the DLL took the command. When tracking
+// is on, every accepted command gets a sequence number and its issue time, and
+// waits in its device's in-flight list for the controller's response. The
+// responses come in through the Connect callback (ackResponse) with the
+// command byte they answer, and the controller answers in order: a response
+// settles the oldest outstanding command with its byte, and any older command
+// still outstanding has lost its response. Settled commands add their latency
+// to a histogram for their command type. Commands that lost their response,
+// got none within the timeout, or were pushed out of a full list are counted
+// and kept in a short log. The wire carries no sequence number, so a lost
+// response inside a run of one command type shows up as the run's last
+// command timing out (and the others reading late) rather than the lost one.
+//
+// Only the native serial backend (serial_backend.cpp) passes responses up in
+// a documented form, so ackCallback() is null with the EAI DLL and the MEX
+// refuses to turn tracking on. Lists are kept per DLL device ID:
+// the callback runs on the backend's reader thread and can't take tiMutex to
+// translate IDs.
+
+#include "engine.h"
+#include "serial.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr int INFLIGHT_MAX_PENDING = 512;   // Per device; the oldest is dropped when full
+constexpr int INFLIGHT_TIMEOUT_LOG = 64;
+constexpr int ACK_BUCKETS = 64;             // Quarter-octave latency bins from 1 us (top bin ~55 s and up)
+constexpr int ACK_NUM_TYPES = CMD_FREQ_TIME_DELAY + 1;
+constexpr int64_t ACK_DEFAULT_TIMEOUT_US = 1000000;
+
+inline const char* const ackTypeNames[ACK_NUM_TYPES] = {"none", "pulse", "changeGain", "changeFreq", "rampGain", "rampFreq",
+                                                        "stop", "setTactors", "sigSource", "tactorType", "freqTimeDelay"};
+
+// TDK command byte the controller answers a command with
+inline uint8_t wireCommand(uint8_t type) {
+    switch (type) {
+        case CMD_PULSE: return TDK_COMMAND_PULSE;
+        case CMD_CHANGE_GAIN: return TDK_COMMAND_GAIN;
+        case CMD_CHANGE_FREQ: return TDK_COMMAND_FREQ;
+        case CMD_RAMP_GAIN:
+        case CMD_RAMP_FREQ: return TDK_COMMAND_RAMP;
+        case CMD_STOP: return TDK_COMMAND_STOP;
+        case CMD_SET_TACTORS: return TDK_COMMAND_SET_TACTORS;
+        case CMD_SIG_SOURCE: return TDK_COMMAND_SETSIGSOURCE;
+        case CMD_TACTOR_TYPE: return TDK_COMMAND_SET_TACTOR_TYPE;
+        case CMD_FREQ_TIME_DELAY: return TDK_COMMAND_SET_FREQ_TIME_DELAY;
+        default: return 0;
+    }
+}
+
+struct InflightEntry {
+    uint64_t sequence = 0;
+    int64_t issuedUs = 0;
+    int deviceID = 0;   // Logical
+    int tacNum = 0;
+    uint8_t type = CMD_NONE;
+    uint8_t wire = 0;
+};
+
+struct InflightList {
+    InflightEntry entries[INFLIGHT_MAX_PENDING];
+    int head = 0;
+    int count = 0;
+};
+
+struct AckHistogram {
+    uint64_t counts[ACK_BUCKETS] = {};
+    uint64_t acked = 0;
+    uint64_t rejected = 0; // Answered with a non-zero status (included in acked)
+    uint64_t timedOut = 0;
+    int64_t minUs = 0;
+    int64_t maxUs = 0;
+    int64_t totalUs = 0;
+};
+
+struct AckTimeout {
+    uint64_t sequence = 0;
+    int deviceID = 0;
+    int tacNum = 0;
+    uint8_t type = CMD_NONE;
+    int64_t ageUs = 0; // When given up on
+};
+
+struct AckStats {
+    uint64_t tracked = 0;
+    uint64_t acked = 0;
+    uint64_t timedOut = 0;
+    uint64_t missed = 0;     // Passed over by a later command's response (also counted as timed out)
+    uint64_t overflowed = 0; // Dropped from a full list (also counted as timed out)
+    uint64_t unmatched = 0;  // Responses with nothing outstanding to match
+};
+
+inline std::atomic<uint64_t> commandSequence{0};
+
+// Also sees every response (before ack matching), e.g. the health check's query answers
+using ResponseObserver = void (*)(int device, const SerialFrame& frame);
+inline std::atomic<ResponseObserver> responseObserver{nullptr};
+
+inline std::mutex ackMutex; // Guards everything below; taken under tiMutex, never the other way round
+inline InflightList inflight[ENGINE_MAX_DEVICES];
+inline AckHistogram ackHistograms[ACK_NUM_TYPES];
+inline AckTimeout ackTimeouts[INFLIGHT_TIMEOUT_LOG];
+inline int ackTimeoutCount = 0;
+inline int ackTimeoutNext = 0;
+inline AckStats ackStats;
+inline int64_t ackTimeoutUs = ACK_DEFAULT_TIMEOUT_US;
+inline const bool inflightLockable = registerRtRegion(inflight, sizeof(inflight));
+
+inline int ackBucket(int64_t us) {
+    if (us <= 1) return 0;
+    int bucket = static_cast<int>(4.0 * std::log2(static_cast<double>(us)));
+    return bucket < ACK_BUCKETS ? bucket : ACK_BUCKETS - 1;
+}
+
+// Lower edge of a bucket (us)
+inline double ackBucketEdgeUs(int bucket) {
+    return bucket == 0 ? 0.0 : std::exp2(bucket / 4.0);
+}
+
+inline void giveUpLocked(const InflightEntry& entry, int64_t now) {
+    ackStats.timedOut++;
+    ackHistograms[entry.type].timedOut++;
+    AckTimeout& t = ackTimeouts[ackTimeoutNext];
+    t.sequence = entry.sequence;
+    t.deviceID = entry.deviceID;
+    t.tacNum = entry.tacNum;
+    t.type = entry.type;
+    t.ageUs = now - entry.issuedUs;
+    ackTimeoutNext = (ackTimeoutNext + 1) % INFLIGHT_TIMEOUT_LOG;
+    if (ackTimeoutCount < INFLIGHT_TIMEOUT_LOG) ackTimeoutCount++;
+}
+
+inline void popLocked(InflightList& list) {
+    list.head = (list.head + 1) % INFLIGHT_MAX_PENDING;
+    list.count--;
+}
+
+// Time out stale entries at the front of a list
+inline void expireLocked(InflightList& list, int64_t now) {
+    while (list.count > 0 && now - list.entries[list.head].issuedUs >= ackTimeoutUs) {
+        giveUpLocked(list.entries[list.head], now);
+        popLocked(list);
+    }
+}
+
+inline void expireAllLocked(int64_t now) {
+    for (auto& list : inflight) expireLocked(list, now);
+}
+
+// Issue observer: runs under tiMutex on whichever thread issued the command
+inline void trackCommand(const TactorCommand& cmd, int device, int64_t issuedUs) {
+    uint8_t wire = wireCommand(cmd.type);
+    if (device < 0 || device >= ENGINE_MAX_DEVICES || wire == 0) return;
+    std::lock_guard<std::mutex> lock(ackMutex);
+    InflightList& list = inflight[device];
+    expireLocked(list, issuedUs);
+    if (list.count == INFLIGHT_MAX_PENDING) {
+        ackStats.overflowed++;
+        giveUpLocked(list.entries[list.head], issuedUs);
+        popLocked(list);
+    }
+    InflightEntry& entry = list.entries[(list.head + list.count) % INFLIGHT_MAX_PENDING];
+    entry.sequence = ++commandSequence;
+    entry.issuedUs = issuedUs;
+    entry.deviceID = cmd.deviceID;
+    entry.tacNum = cmd.tacNum;
+    entry.type = cmd.type;
+    entry.wire = wire;
+    list.count++;
+    ackStats.tracked++;
+}
+
+// Connect callback: runs on the backend's reader thread
+inline void ackResponse(int device, const SerialFrame& frame) {
+    if (ResponseObserver observe = responseObserver.load(std::memory_order_acquire)) observe(device, frame);
+    if (!issueObserver.load(std::memory_order_relaxed)) return;
+    int64_t now = nowUs();
+    if (device < 0 || device >= ENGINE_MAX_DEVICES) return;
+    std::lock_guard<std::mutex> lock(ackMutex);
+    InflightList& list = inflight[device];
+    expireLocked(list, now); // A response later than the timeout can't be told from the next one
+    for (int i = 0; i < list.count; i++) {
+        InflightEntry& entry = list.entries[(list.head + i) % INFLIGHT_MAX_PENDING];
+        if (entry.wire != frame.command) continue;
+        for (int j = 0; j < i; j++) { // Answered in order, so these lost their responses
+            ackStats.missed++;
+            giveUpLocked(list.entries[list.head], now);
+            popLocked(list);
+        }
+        int64_t latency = now - entry.issuedUs;
+        AckHistogram& h = ackHistograms[entry.type];
+        h.counts[ackBucket(latency)]++;
+        if (h.acked == 0 || latency < h.minUs) h.minUs = latency;
+        if (latency > h.maxUs) h.maxUs = latency;
+        h.totalUs += latency;
+        h.acked++;
+        if (frame.length == 1 && frame.payload[0] != SERIAL_STATUS_OK) h.rejected++;
+        ackStats.acked++;
+        popLocked(list);
+        return;
+    }
+    ackStats.unmatched++;
+}
+
+// Connect's callback argument
+inline void* ackCallback() {
+#if defined(TDK_SERIAL_BACKEND)
+    return reinterpret_cast<void*>(&ackResponse);
+#else
+    return nullptr; // The EAI DLL's response packet layout isn't documented
+#endif
+}
+
+inline void resetAckTrackingLocked() {
+    for (auto& list : inflight) {
+        list.head = 0;
+        list.count = 0;
+    }
+    for (auto& h : ackHistograms) h = AckHistogram();
+    ackTimeoutCount = 0;
+    ackTimeoutNext = 0;
+    ackStats = AckStats();
+}
+
+inline void configureAckTracking(bool enabled, int64_t timeoutUs, bool reset) {
+    std::lock_guard<std::mutex> lock(ackMutex);
+    ackTimeoutUs = timeoutUs;
+    if (reset || !enabled) resetAckTrackingLocked();
+    issueObserver.store(enabled ? &trackCommand : nullptr, std::memory_order_relaxed);
+}
+
+// Approximate percentile (us) from a histogram: the upper edge of the bucket
+// holding it, capped at the largest latency seen
+inline double ackPercentileUs(const AckHistogram& h, double p) {
+    if (h.acked == 0) return 0.0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * h.acked));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < ACK_BUCKETS; b++) {
+        seen += h.counts[b];
+        if (seen >= rank) return std::min(ackBucketEdgeUs(b + 1), static_cast<double>(h.maxUs));
+    }
+    return static_cast<double>(h.maxUs);
+}
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef TDK_LAYOUT_H
+#define TDK_LAYOUT_H
+
+// Spatial tactor layouts and the phantom-sensation renderer.
+//
+// A layout places each controller tactor at a 2-D or 3-D position (e.g. mm on
+// the forearm). A virtual stimulus (a point or a line segment with an intensity)
+// is turned into per-tactor gains using the funneling models:
+//   energy: A_i = A * sqrt(w_i)   (sum of A_i^2 == A^2, Alles 1970)
+//   linear: A_i = A * w_i
+// with w_i the normalized inverse-distance weights of the tactors around the
+// stimulus. The renderer runs at a fixed rate on the engine scheduler and only
+// emits ChangeGain for tactors whose gain actually changed.
+
+#include "commandqueue.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+enum GainModel : uint8_t {
+    MODEL_ENERGY = 0,
+    MODEL_LINEAR = 1
+};
+
+constexpr int LAYOUT_MAX_GRID_SIDE = 256; // Grid index cells per side
+
+struct TactorLayout {
+    int dims = 2;
+    std::vector<int> tacNum;    // Controller tactor number for each site
+    std::vector<float> x, y, z; // Site positions, stored SoA so distance loops vectorize
+    float radius = 0.0f;        // Neighbourhood radius used for funneling
+
+    // Uniform grid index over (x, y); cells are `radius` wide so any query only
+    // touches a 3x3 block of cells regardless of array size.
+    float originX = 0.0f, originY = 0.0f;
+    int gridW = 0, gridH = 0;
+    std::vector<int> cellStart; // CSR offsets, gridW * gridH + 1 entries
+    std::vector<int> cellItems; // Site indices sorted by cell
+};
+
+struct PhantomStimulus {
+    bool active = false;
+    bool isLine = false;
+    float p0[3] = {0.0f, 0.0f, 0.0f};
+    float p1[3] = {0.0f, 0.0f, 0.0f};
+    float intensity = 0.0f; // 0 - 1
+    uint8_t model = MODEL_ENERGY;
+};
+
+struct PhantomRenderer {
+    TactorLayout layout;
+    PhantomStimulus stimulus;
+    std::vector<uint8_t> sentGain; // Last gain issued for each site
+    std::vector<int> activeSites;  // Sites currently holding a non-zero gain
+    int taskID = 0;                // Scheduler task, 0 when not running
+    uint64_t frames = 0;
+    uint64_t commands = 0;
+};
+
+inline std::mutex renderMutex; // Guards renderers (layouts, bookkeeping)
+inline std::mutex stimulusMutex; // Guards PhantomRenderer::stimulus only
+inline std::map<int, PhantomRenderer> renderers; // deviceID -> renderer
+
+// Mean nearest-neighbour spacing, used to pick a default funneling radius
+inline float meanNeighbourSpacing(const TactorLayout& layout) {
+    size_t n = layout.x.size();
+    if (n < 2) return 1.0f;
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        float best = INFINITY;
+        for (size_t j = 0; j < n; j++) {
+            if (i == j) continue;
+            float dx = layout.x[i] - layout.x[j];
+            float dy = layout.y[i] - layout.y[j];
+            float dz = layout.z[i] - layout.z[j];
+            best = std::min(best, dx * dx + dy * dy + dz * dz);
+        }
+        total += std::sqrt(best);
+    }
+    return static_cast<float>(total / n);
+}
+
+// Smallest radius whose grid stays within LAYOUT_MAX_GRID_SIDE cells per side
+inline float minLayoutRadius(const TactorLayout& layout) {
+    auto [minX, maxX] = std::minmax_element(layout.x.begin(), layout.x.end());
+    auto [minY, maxY] = std::minmax_element(layout.y.begin(), layout.y.end());
+    return std::max(*maxX - *minX, *maxY - *minY) / (LAYOUT_MAX_GRID_SIDE - 1);
+}
+
+// Build the grid index. Call after positions and radius are set.
+inline void buildSpatialIndex(TactorLayout& layout) {
+    size_t n = layout.x.size();
+    float minX = *std::min_element(layout.x.begin(), layout.x.end());
+    float maxX = *std::max_element(layout.x.begin(), layout.x.end());
+    float minY = *std::min_element(layout.y.begin(), layout.y.end());
+    float maxY = *std::max_element(layout.y.begin(), layout.y.end());
+    layout.originX = minX;
+    layout.originY = minY;
+    layout.gridW = static_cast<int>((maxX - minX) / layout.radius) + 1;
+    layout.gridH = static_cast<int>((maxY - minY) / layout.radius) + 1;
+
+    std::vector<int> cellOf(n);
+    layout.cellStart.assign(layout.gridW * layout.gridH + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        int cx = static_cast<int>((layout.x[i] - minX) / layout.radius);
+        int cy = static_cast<int>((layout.y[i] - minY) / layout.radius);
+        cellOf[i] = cy * layout.gridW + cx;
+        layout.cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 1; c < layout.cellStart.size(); c++) {
+        layout.cellStart[c] += layout.cellStart[c - 1];
+    }
+    layout.cellItems.assign(n, 0);
+    std::vector<int> fill(layout.cellStart.begin(), layout.cellStart.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+        layout.cellItems[fill[cellOf[i]]++] = static_cast<int>(i);
+    }
+}
+
+// Collect sites whose cell intersects the box [x0, x1] x [y0, y1]
+inline void querySpatialIndex(const TactorLayout& layout, float x0, float y0, float x1, float y1, std::vector<int>& out) {
+    out.clear();
+    int cx0 = std::max(0, static_cast<int>(std::floor((x0 - layout.originX) / layout.radius)));
+    int cy0 = std::max(0, static_cast<int>(std::floor((y0 - layout.originY) / layout.radius)));
+    int cx1 = std::min(layout.gridW - 1, static_cast<int>(std::floor((x1 - layout.originX) / layout.radius)));
+    int cy1 = std::min(layout.gridH - 1, static_cast<int>(std::floor((y1 - layout.originY) / layout.radius)));
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            int cell = cy * layout.gridW + cx;
+            for (int k = layout.cellStart[cell]; k < layout.cellStart[cell + 1]; k++) {
+                out.push_back(layout.cellItems[k]);
+            }
+        }
+    }
+}
+
+// Compute the target gain (0 - 255) of every candidate site for a stimulus.
+// `sites` receives the candidate indices and `gains` their gains.
+inline void computePhantomGains(const TactorLayout& layout, const PhantomStimulus& stim,
+                                std::vector<int>& sites, std::vector<float>& dist, std::vector<uint8_t>& gains) {
+    sites.clear();
+    gains.clear();
+    if (!stim.active || stim.intensity <= 0.0f) return;
+    const float r = layout.radius;
+    float bx0 = std::min(stim.p0[0], stim.isLine ? stim.p1[0] : stim.p0[0]) - r;
+    float by0 = std::min(stim.p0[1], stim.isLine ? stim.p1[1] : stim.p0[1]) - r;
+    float bx1 = std::max(stim.p0[0], stim.isLine ? stim.p1[0] : stim.p0[0]) + r;
+    float by1 = std::max(stim.p0[1], stim.isLine ? stim.p1[1] : stim.p0[1]) + r;
+    querySpatialIndex(layout, bx0, by0, bx1, by1, sites);
+
+    size_t n = sites.size();
+    dist.resize(n);
+    if (stim.isLine) {
+        float ux = stim.p1[0] - stim.p0[0];
+        float uy = stim.p1[1] - stim.p0[1];
+        float uz = stim.p1[2] - stim.p0[2];
+        float len2 = ux * ux + uy * uy + uz * uz;
+        float inv = len2 > 0.0f ? 1.0f / len2 : 0.0f;
+        for (size_t k = 0; k < n; k++) {
+            int i = sites[k];
+            float dx = layout.x[i] - stim.p0[0];
+            float dy = layout.y[i] - stim.p0[1];
+            float dz = layout.z[i] - stim.p0[2];
+            float t = std::clamp((dx * ux + dy * uy + dz * uz) * inv, 0.0f, 1.0f);
+            dx -= t * ux;
+            dy -= t * uy;
+            dz -= t * uz;
+            dist[k] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    } else {
+        for (size_t k = 0; k < n; k++) {
+            int i = sites[k];
+            float dx = layout.x[i] - stim.p0[0];
+            float dy = layout.y[i] - stim.p0[1];
+            float dz = layout.z[i] - stim.p0[2];
+            dist[k] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+
+    // Weights: a line drives every site along it with a linear falloff; a point
+    // is funneled between its neighbours with inverse-distance weights.
+    std::vector<float>& w = dist; // Reuse the buffer in place
+    float total = 0.0f;
+    const float eps = 1e-3f * r;
+    for (size_t k = 0; k < n; k++) {
+        float d = dist[k];
+        float inside = d < r ? 1.0f : 0.0f;
+        w[k] = stim.isLine ? inside * (1.0f - d / r) : inside / std::max(d, eps);
+        total += w[k];
+    }
+    if (total <= 0.0f) {
+        sites.clear();
+        return;
+    }
+    float norm = stim.isLine ? 1.0f : 1.0f / total;
+    float scale = 255.0f * std::clamp(stim.intensity, 0.0f, 1.0f);
+    gains.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        float wk = w[k] * norm;
+        float a = stim.model == MODEL_LINEAR ? wk : std::sqrt(wk);
+        gains[k] = static_cast<uint8_t>(std::lround(scale * a));
+    }
+}
+
+// One render frame: issue ChangeGain for every site whose gain changed.
+// Caller holds renderMutex.
+inline void renderPhantomFrame(int deviceID, PhantomRenderer& renderer) {
+    PhantomStimulus stim;
+    {
+        std::lock_guard<std::mutex> lock(stimulusMutex);
+        stim = renderer.stimulus;
+    }
+    thread_local std::vector<int> sites;
+    thread_local std::vector<float> scratch;
+    thread_local std::vector<uint8_t> gains;
+    thread_local std::vector<uint8_t> target;
+    computePhantomGains(renderer.layout, stim, sites, scratch, gains);
+
+    size_t n = renderer.layout.tacNum.size();
+    target.assign(n, 0);
+    for (size_t k = 0; k < sites.size(); k++) {
+        target[sites[k]] = gains[k];
+    }
+
+    TactorCommand cmd;
+    cmd.type = CMD_CHANGE_GAIN;
+    cmd.deviceID = deviceID;
+    bool updated = false;
+    auto emit = [&](int i) {
+        if (target[i] == renderer.sentGain[i]) return;
+        if (!updated && !queueEnabled.load(std::memory_order_acquire)) {
+            updateInterface(); // The I/O thread does this itself in queue mode
+            updated = true;
+        }
+        cmd.tacNum = renderer.layout.tacNum[i];
+        cmd.value = target[i];
+        if (submitCommand(cmd) >= 0) {
+            renderer.sentGain[i] = target[i];
+            renderer.commands++;
+        }
+    };
+    for (int i : renderer.activeSites) emit(i); // Sites leaving the stimulus fall to 0
+    for (int i : sites) emit(i);
+
+    renderer.activeSites.clear();
+    for (size_t i = 0; i < n; i++) {
+        if (renderer.sentGain[i] != 0) renderer.activeSites.push_back(static_cast<int>(i));
+    }
+    renderer.frames++;
+}
+
+// Priority stop/silence: stop rendering on the device, or on a layout that
+// drives the silenced tactor (a silenced site is known to be at gain 0)
+inline void cancelRenderer(int deviceID, int tacNum) {
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        auto it = renderers.find(deviceID);
+        if (it == renderers.end()) return;
+        PhantomRenderer& renderer = it->second;
+        const std::vector<int>& tactors = renderer.layout.tacNum;
+        auto site = std::find(tactors.begin(), tactors.end(), tacNum);
+        if (tacNum != 0 && site == tactors.end()) return;
+        if (site != tactors.end()) renderer.sentGain[site - tactors.begin()] = 0;
+        taskID = renderer.taskID;
+        renderer.taskID = 0;
+        std::lock_guard<std::mutex> stimLock(stimulusMutex);
+        renderer.stimulus.active = false;
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+}
+
+inline const bool rendererCancelRegistered = registerCancelHook(cancelRenderer);
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef TDK_LFO_H
+#define TDK_LFO_H
+
+// Native modulation generators (LFOs).
+//
+// An LFO drives one tactor's gain or frequency with
+//   value(t) = offset + depth * wave(phase(t)),   wave in [-1, 1]
+// for a sine, triangle, square or sawtooth wave. Instead of streaming samples,
+// the engine plans linear segments and issues each as one RampGain/RampFreq
+// (or a Change for the steps of square and sawtooth waves):
+//   - triangle and sawtooth segments end at the wave's corners (exact),
+//   - sine segments are grown by doubling then bisection to the longest one
+//     whose chord stays within the LFO's tolerance of the curve.
+// Each segment starts at the value the previous one has actually reached, so
+// a parameter change mid-flight glides onto the new waveform over one short
+// segment rather than stepping. Period changes keep the phase continuous.
+// LFOs in the same sync group share one phase clock.
+
+#include "commandqueue.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+enum LfoShape : uint8_t {
+    LFO_SINE = 0,
+    LFO_TRIANGLE = 1,
+    LFO_SQUARE = 2,
+    LFO_SAWTOOTH = 3
+};
+
+enum LfoTarget : uint8_t {
+    LFO_GAIN = 0,
+    LFO_FREQ = 1
+};
+
+constexpr int LFO_MAX = 256;
+constexpr int LFO_SYNC_GROUPS = 32;         // Groups 1 - 32, 0 == free running
+constexpr double LFO_TICK_HZ = 1000.0;
+constexpr int64_t LFO_MIN_SEGMENT_US = 5000;   // Shortest ramp issued for a curve
+constexpr int64_t LFO_MAX_SEGMENT_US = 1000000;
+constexpr int64_t LFO_GLIDE_US = 20000;        // Segment used to join a changed waveform
+constexpr int LFO_CHORD_SAMPLES = 16;          // Points checked along a candidate chord
+constexpr double LFO_TWO_PI = 6.283185307179586;
+
+// Phase clock: phase(t) = (t - originUs) / periodUs cycles
+struct LfoClock {
+    int64_t originUs = 0;
+    int64_t periodUs = 1000000;
+
+    double phase(int64_t t) const { return static_cast<double>(t - originUs) / static_cast<double>(periodUs); }
+    // New period from `now` on without a phase jump
+    void retime(int64_t now, int64_t newPeriodUs) {
+        double p = phase(now);
+        periodUs = newPeriodUs;
+        originUs = now - static_cast<int64_t>(p * static_cast<double>(newPeriodUs));
+    }
+};
+
+struct Lfo {
+    int id = 0; // 0 == free
+    int deviceID = 0;
+    int tacNum = 0;
+    uint8_t target = LFO_GAIN;
+    uint8_t shape = LFO_SINE;
+    double depth = 0.0;
+    double offset = 0.0;
+    double phase0 = 0.0;     // Cycles added to the clock phase
+    double tolerance = 2.0;  // Allowed chord error (gain steps or Hz)
+    int syncGroup = 0;
+    LfoClock clock;          // Used when syncGroup == 0
+    // Segment in flight
+    double segFrom = 0.0;
+    double segTo = 0.0;
+    int64_t segStartUs = 0;
+    int64_t segEndUs = 0;    // Next planning time
+    bool started = false;
+    bool glide = false;      // Next segment joins a changed waveform
+};
+
+struct LfoStats {
+    uint64_t segments = 0;
+    uint64_t steps = 0;   // Changes issued for square/sawtooth edges
+    uint64_t glides = 0;
+    int64_t maxTickUs = 0;
+};
+
+inline std::mutex lfoMutex; // Guards everything below; the LFO tick holds it
+inline Lfo lfos[LFO_MAX];
+inline LfoClock lfoGroups[LFO_SYNC_GROUPS + 1];
+inline const bool lfosLockable = registerRtRegion(lfos, sizeof(lfos));
+inline int nextLfoID = 1;
+inline int lfoTaskID = 0;
+inline LfoStats lfoStats;
+
+inline const LfoClock& lfoClock(const Lfo& lfo) {
+    return lfo.syncGroup > 0 ? lfoGroups[lfo.syncGroup] : lfo.clock;
+}
+
+inline double lfoPhase(const Lfo& lfo, int64_t t) {
+    double p = lfoClock(lfo).phase(t) + lfo.phase0;
+    return p - std::floor(p);
+}
+
+inline double lfoWave(uint8_t shape, double p) {
+    switch (shape) {
+        case LFO_TRIANGLE:
+            return p < 0.5 ? 4.0 * p - 1.0 : 3.0 - 4.0 * p;
+        case LFO_SQUARE:
+            return p < 0.5 ? 1.0 : -1.0;
+        case LFO_SAWTOOTH:
+            return 2.0 * p - 1.0;
+        default:
+            return std::sin(LFO_TWO_PI * p);
+    }
+}
+
+inline double lfoLimit(uint8_t target, double value) {
+    return target == LFO_FREQ ? std::clamp(value, double(MIN_ACTION_FREQUENCY), double(MAX_ACTION_FREQUENCY)) : std::clamp(value, 0.0, 255.0);
+}
+
+inline double lfoValue(const Lfo& lfo, int64_t t) {
+    return lfoLimit(lfo.target, lfo.offset + lfo.depth * lfoWave(lfo.shape, lfoPhase(lfo, t)));
+}
+
+// Value the device is at now, given the segment in flight
+inline double lfoCurrent(const Lfo& lfo, int64_t t) {
+    if (!lfo.started || t >= lfo.segEndUs || lfo.segEndUs <= lfo.segStartUs) return lfo.segTo;
+    double f = static_cast<double>(t - lfo.segStartUs) / static_cast<double>(lfo.segEndUs - lfo.segStartUs);
+    return lfo.segFrom + (lfo.segTo - lfo.segFrom) * f;
+}
+
+// Time of the next corner/edge after t (the wave is linear between corners), or
+// INT64_MAX for the sine
+inline int64_t lfoNextCorner(const Lfo& lfo, int64_t t) {
+    if (lfo.shape == LFO_SINE) return INT64_MAX;
+    const LfoClock& clock = lfoClock(lfo);
+    double cornerStep = lfo.shape == LFO_SAWTOOTH ? 1.0 : 0.5;
+    double p = clock.phase(t) + lfo.phase0;
+    double next = (std::floor(p / cornerStep) + 1.0) * cornerStep;
+    int64_t at = clock.originUs + static_cast<int64_t>(std::ceil((next - lfo.phase0) * static_cast<double>(clock.periodUs)));
+    return std::max(at, t + 1000);
+}
+
+// Largest chord error of the segment (t0, v0) -> (t1, value(t1)) against the curve
+inline double lfoChordError(const Lfo& lfo, int64_t t0, double v0, int64_t t1) {
+    double v1 = lfoValue(lfo, t1);
+    double worst = 0.0;
+    for (int k = 1; k < LFO_CHORD_SAMPLES; k++) {
+        double f = static_cast<double>(k) / LFO_CHORD_SAMPLES;
+        int64_t t = t0 + static_cast<int64_t>(f * static_cast<double>(t1 - t0));
+        worst = std::max(worst, std::fabs(v0 + (v1 - v0) * f - lfoValue(lfo, t)));
+    }
+    return worst;
+}
+
+// Longest sine segment from (t0, v0) within tolerance, in whole ms
+inline int64_t lfoPlanCurve(const Lfo& lfo, int64_t t0, double v0) {
+    int64_t good = LFO_MIN_SEGMENT_US;
+    int64_t limit = std::min<int64_t>(LFO_MAX_SEGMENT_US, lfoClock(lfo).periodUs / 2);
+    int64_t bad = 0;
+    while (good < limit) {
+        int64_t trial = std::min(2 * good, limit);
+        if (lfoChordError(lfo, t0, v0, t0 + trial) > lfo.tolerance) {
+            bad = trial;
+            break;
+        }
+        good = trial;
+    }
+    while (bad != 0 && bad - good > 1000) {
+        int64_t mid = (good + bad) / 2;
+        if (lfoChordError(lfo, t0, v0, t0 + mid) > lfo.tolerance) {
+            bad = mid;
+        } else {
+            good = mid;
+        }
+    }
+    return std::max<int64_t>(good / 1000, 1) * 1000;
+}
+
+// Issue the next segment of an LFO at `now`. Caller holds lfoMutex.
+inline void lfoPlanSegment(Lfo& lfo, int64_t now, bool& updated) {
+    double current = lfoCurrent(lfo, now);
+    double target = lfoValue(lfo, now);
+    int64_t durationUs;
+    bool step = false;
+    if (!lfo.started || (lfo.glide && lfo.shape != LFO_SQUARE)) {
+        // Start or rejoin: glide from where the device is onto the waveform
+        durationUs = lfo.started ? LFO_GLIDE_US : 0;
+        if (lfo.glide) lfoStats.glides++;
+        step = !lfo.started;
+    } else if (lfo.shape == LFO_SINE) {
+        durationUs = lfoPlanCurve(lfo, now, current);
+    } else {
+        // Corners are exact; square/sawtooth edges are steps
+        step = std::fabs(current - target) > lfo.tolerance;
+        durationUs = ((lfoNextCorner(lfo, now) - now) / 1000) * 1000;
+        if (durationUs < 1000) durationUs = 1000;
+        if (durationUs > LFO_MAX_SEGMENT_US) durationUs = LFO_MAX_SEGMENT_US;
+    }
+    lfo.glide = false;
+
+    TactorCommand cmd;
+    cmd.deviceID = lfo.deviceID;
+    cmd.tacNum = lfo.tacNum;
+    if (!updated && !queueEnabled.load(std::memory_order_acquire)) {
+        updateInterface(); // The I/O thread does this itself in queue mode
+        updated = true;
+    }
+    double from = current;
+    if (step) {
+        from = target;
+        cmd.type = lfo.target == LFO_FREQ ? CMD_CHANGE_FREQ : CMD_CHANGE_GAIN;
+        cmd.value = static_cast<int>(std::lround(target));
+        submitCommand(cmd);
+        lfoStats.steps++;
+    }
+    double to = durationUs > 0 ? lfoValue(lfo, now + durationUs - 1) : from; // Left of a sawtooth wrap
+    if (lfo.shape == LFO_SQUARE) to = from; // Flat until the next edge
+    if (durationUs > 0 && std::lround(from) != std::lround(to)) {
+        cmd.type = lfo.target == LFO_FREQ ? CMD_RAMP_FREQ : CMD_RAMP_GAIN;
+        cmd.value = static_cast<int>(std::lround(from));
+        cmd.endValue = static_cast<int>(std::lround(to));
+        cmd.duration = static_cast<int>(durationUs / 1000);
+        cmd.delay = 0;
+        submitCommand(cmd);
+        lfoStats.segments++;
+    }
+    lfo.segFrom = from;
+    lfo.segTo = to;
+    lfo.segStartUs = now;
+    lfo.segEndUs = now + std::max<int64_t>(durationUs, 1000);
+    lfo.started = true;
+}
+
+inline void lfoTick(int64_t tickUs) {
+    std::lock_guard<std::mutex> lock(lfoMutex);
+    TRACE_SCOPE("lfo");
+    int64_t t0 = nowUs();
+    bool updated = false;
+    for (auto& lfo : lfos) {
+        if (lfo.id != 0 && (lfo.glide || tickUs >= lfo.segEndUs)) lfoPlanSegment(lfo, tickUs, updated);
+    }
+    int64_t elapsed = nowUs() - t0;
+    if (elapsed > lfoStats.maxTickUs) lfoStats.maxTickUs = elapsed;
+}
+
+inline Lfo* findLfoLocked(int id) {
+    for (auto& lfo : lfos) {
+        if (lfo.id == id && id != 0) return &lfo;
+    }
+    return nullptr;
+}
+
+// Change the period; grouped LFOs retime their whole group. Caller holds lfoMutex.
+inline void setLfoPeriodLocked(Lfo& lfo, int64_t periodUs, int64_t now) {
+    LfoClock& clock = lfo.syncGroup > 0 ? lfoGroups[lfo.syncGroup] : lfo.clock;
+    if (clock.periodUs == periodUs) return;
+    clock.retime(now, periodUs);
+    for (auto& other : lfos) {
+        if (other.id != 0 && (&other == &lfo || (lfo.syncGroup > 0 && other.syncGroup == lfo.syncGroup))) {
+            other.glide = true;
+        }
+    }
+}
+
+// Add an LFO. A sync group's clock starts with its first member. Returns the
+// LFO ID, or 0 if the table is full. Caller holds lfoMutex.
+inline int addLfoLocked(const Lfo& config, int64_t periodUs, int64_t now) {
+    for (auto& lfo : lfos) {
+        if (lfo.id != 0) continue;
+        lfo = config;
+        lfo.id = nextLfoID++;
+        lfo.started = false;
+        lfo.glide = false;
+        if (lfo.syncGroup > 0) {
+            bool used = false;
+            for (const auto& other : lfos) {
+                if (other.id != 0 && &other != &lfo && other.syncGroup == lfo.syncGroup) used = true;
+            }
+            if (!used) lfoGroups[lfo.syncGroup] = {now, periodUs};
+            else setLfoPeriodLocked(lfo, periodUs, now);
+        } else {
+            lfo.clock = {now, periodUs};
+        }
+        lfo.segEndUs = now;
+        return lfo.id;
+    }
+    return 0;
+}
+
+// Remove LFOs by ID, or every LFO on a device/tactor (tacNum 0 == any); each
+// tactor is held at the value it has reached. Caller holds lfoMutex.
+inline int removeLfosLocked(int id, int deviceID = -1, int tacNum = 0, bool freeze = true) {
+    int count = 0;
+    int64_t now = nowUs();
+    for (auto& lfo : lfos) {
+        if (lfo.id == 0) continue;
+        bool match = id > 0 ? lfo.id == id : lfo.deviceID == deviceID && (tacNum == 0 || lfo.tacNum == tacNum);
+        if (!match) continue;
+        if (freeze && lfo.started) {
+            TactorCommand cmd;
+            cmd.type = lfo.target == LFO_FREQ ? CMD_CHANGE_FREQ : CMD_CHANGE_GAIN;
+            cmd.deviceID = lfo.deviceID;
+            cmd.tacNum = lfo.tacNum;
+            cmd.value = static_cast<int>(std::lround(lfoCurrent(lfo, now)));
+            submitCommand(cmd); // Ends the ramp in flight
+        }
+        lfo = Lfo();
+        count++;
+    }
+    return count;
+}
+
+// Priority stop/silence: drop the LFOs without touching the device again
+inline void cancelLfos(int deviceID, int tacNum) {
+    std::lock_guard<std::mutex> lock(lfoMutex);
+    removeLfosLocked(0, deviceID, tacNum, false);
+}
+
+inline const bool lfoCancelRegistered = registerCancelHook(cancelLfos);
+
+#endif
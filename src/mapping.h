@@ -0,0 +1,396 @@
+#ifndef TDK_MAPPING_H
+#define TDK_MAPPING_H
+
+// Feature-to-haptics mapping.
+//
+// Closed-loop feedback without a MATLAB round trip per tactor: a decoder pushes
+// a feature frame (EMG envelopes, force estimates, ...) and per-tactor rules
+// map feature channels to gain or frequency. Each rule normalizes its channel
+// to x = clamp((f - inMin) / (inMax - inMin), 0, 1), applies a transfer
+//   linear:  y = x
+//   power:   y = x^exponent
+//   sigmoid: logistic with a slope and center, rescaled so x = 0 -> 0, 1 -> 1
+//   table:   y interpolated from MAP_TABLE_POINTS samples over x in [0, 1]
+// and scales to out = outMin + (outMax - outMin) * y. Rules are kept as
+// structure-of-arrays sorted by transfer, so each transfer is one straight
+// loop over contiguous floats (linear and table vectorize). At a fixed rate a
+// scheduler task computes every target from the newest frame and emits only
+// the changes larger than each rule's deadband (ChangeFreq first, then
+// ChangeGain); frames that arrive between ticks supersede each other. The
+// latency reported is from the frame's arrival (the pushFeatures call, or the
+// writer's timestamp) to the last command it produced being handed off.
+//
+// Frames come from pushFeatures, or on Linux from a shared-memory feature
+// block a decoder in another process writes directly (FeatureBlock below).
+// Mapping only sets gain and frequency; tactors are switched on as usual.
+
+#include "commandqueue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum MapTransfer : uint8_t {
+    MAP_LINEAR = 1,
+    MAP_POWER = 2,
+    MAP_SIGMOID = 3,
+    MAP_TABLE = 4
+};
+
+enum MapTarget : uint8_t {
+    MAP_GAIN = 1,
+    MAP_FREQ = 2
+};
+
+constexpr int MAP_MAX_FEATURES = 64;
+constexpr int MAP_MAX_RULES = 2 * ENGINE_MAX_TACTOR; // A gain and a frequency rule per tactor
+constexpr int MAP_TABLE_POINTS = 33;
+
+// One rule as decoded from MATLAB
+struct MappingRule {
+    int tacNum = 1;
+    uint8_t target = MAP_GAIN;
+    int channel = 0; // 0-based
+    uint8_t transfer = MAP_LINEAR;
+    float inMin = 0.0f, inMax = 1.0f;
+    float outMin = 0.0f, outMax = 255.0f;
+    float shape = 1.0f;  // Exponent (power) or slope (sigmoid)
+    float center = 0.5f; // Sigmoid center (normalized input)
+    float deadband = 1.0f;
+    float table[MAP_TABLE_POINTS] = {};
+};
+
+// Rules as structure-of-arrays, sorted by transfer: rules
+// [kindStart[k], kindStart[k + 1]) use transfer k
+struct MappingPlan {
+    int count = 0;
+    int kindStart[MAP_TABLE + 2] = {};
+    int order[MAP_MAX_RULES];   // Index of each rule as configured
+    int channel[MAP_MAX_RULES];
+    int tacNum[MAP_MAX_RULES];
+    uint8_t target[MAP_MAX_RULES];
+    float inMin[MAP_MAX_RULES];
+    float inScale[MAP_MAX_RULES];
+    float outMin[MAP_MAX_RULES];
+    float outScale[MAP_MAX_RULES];
+    float shape[MAP_MAX_RULES];
+    float center[MAP_MAX_RULES];
+    float sigmoidLo[MAP_MAX_RULES];    // Logistic at x = 0
+    float sigmoidScale[MAP_MAX_RULES]; // 1 / (logistic at 1 - logistic at 0)
+    float deadband[MAP_MAX_RULES];
+    float table[MAP_MAX_RULES][MAP_TABLE_POINTS];
+};
+
+inline float logistic(float slope, float center, float x) {
+    return 1.0f / (1.0f + std::exp(-slope * (x - center)));
+}
+
+inline void buildMappingPlan(const MappingRule* rules, int count, MappingPlan& plan) {
+    plan.count = count;
+    int next = 0;
+    for (int kind = MAP_LINEAR; kind <= MAP_TABLE; kind++) {
+        plan.kindStart[kind] = next;
+        for (int r = 0; r < count; r++) {
+            const MappingRule& rule = rules[r];
+            if (rule.transfer != kind) continue;
+            int i = next++;
+            plan.order[i] = r;
+            plan.channel[i] = rule.channel;
+            plan.tacNum[i] = rule.tacNum;
+            plan.target[i] = rule.target;
+            plan.inMin[i] = rule.inMin;
+            plan.inScale[i] = 1.0f / (rule.inMax - rule.inMin);
+            plan.outMin[i] = rule.outMin;
+            plan.outScale[i] = rule.outMax - rule.outMin;
+            plan.shape[i] = rule.shape;
+            plan.center[i] = rule.center;
+            float lo = logistic(rule.shape, rule.center, 0.0f);
+            float hi = logistic(rule.shape, rule.center, 1.0f);
+            plan.sigmoidLo[i] = lo;
+            plan.sigmoidScale[i] = hi > lo ? 1.0f / (hi - lo) : 0.0f;
+            plan.deadband[i] = rule.deadband;
+            std::copy(std::begin(rule.table), std::end(rule.table), plan.table[i]);
+        }
+    }
+    plan.kindStart[MAP_TABLE + 1] = next;
+}
+
+// Every rule's target from one feature frame
+inline void computeTargets(const MappingPlan& plan, const float* features, float* out) {
+    const int n = plan.count;
+    for (int i = 0; i < n; i++) {
+        out[i] = std::clamp((features[plan.channel[i]] - plan.inMin[i]) * plan.inScale[i], 0.0f, 1.0f);
+    }
+    for (int i = plan.kindStart[MAP_POWER]; i < plan.kindStart[MAP_POWER + 1]; i++) {
+        out[i] = std::pow(out[i], plan.shape[i]);
+    }
+    for (int i = plan.kindStart[MAP_SIGMOID]; i < plan.kindStart[MAP_SIGMOID + 1]; i++) {
+        out[i] = (logistic(plan.shape[i], plan.center[i], out[i]) - plan.sigmoidLo[i]) * plan.sigmoidScale[i];
+    }
+    for (int i = plan.kindStart[MAP_TABLE]; i < plan.kindStart[MAP_TABLE + 1]; i++) {
+        float pos = out[i] * (MAP_TABLE_POINTS - 1);
+        int k = std::min(static_cast<int>(pos), MAP_TABLE_POINTS - 2);
+        const float* t = plan.table[i];
+        out[i] = t[k] + (t[k + 1] - t[k]) * (pos - static_cast<float>(k));
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = plan.outMin[i] + plan.outScale[i] * out[i];
+    }
+}
+
+// Shared-memory feature block, written by a decoder in another process.
+//
+// Layout (little-endian, offsets in bytes), for non-C++ writers:
+//    0  uint32 magic     FEATURE_MAGIC once initialized
+//    4  uint32 version
+//    8  uint32 capacity  MAP_MAX_FEATURES
+//   12  uint32 sequence  even when stable; odd while a frame is being written
+//   16  int64  writeUs   CLOCK_MONOTONIC microseconds of the frame
+//   24  int32  count     channels in the frame
+//   32  float  values[capacity]
+// To publish a frame: sequence += 1, write writeUs/count/values, then
+// sequence += 1, with release ordering on both increments
+// (writeFeatureBlock does this).
+constexpr uint32_t FEATURE_MAGIC = 0x46444B54; // "TKDF"
+constexpr uint32_t FEATURE_VERSION = 1;
+
+struct FeatureBlock {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<uint32_t> sequence;
+    int64_t writeUs;
+    int32_t count;
+    int32_t reserved;
+    float values[MAP_MAX_FEATURES];
+};
+static_assert(sizeof(FeatureBlock) == 32 + 4 * MAP_MAX_FEATURES, "Feature block layout is fixed");
+
+inline void writeFeatureBlock(FeatureBlock* block, const float* values, int count, int64_t writeUs) {
+    uint32_t seq = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    block->writeUs = writeUs;
+    block->count = std::min(count, MAP_MAX_FEATURES);
+    std::copy(values, values + block->count, block->values);
+    block->sequence.store(seq + 2, std::memory_order_release);
+}
+
+// Copy the block's frame if it changed since *seen. Returns false if there is
+// nothing new or the writer kept it mid-update.
+inline bool readFeatureBlock(const FeatureBlock* block, uint32_t* seen, float* values, int* count, int64_t* writeUs) {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint32_t before = block->sequence.load(std::memory_order_acquire);
+        if (before == *seen) return false;
+        if (before & 1) continue;
+        int n = std::clamp(block->count, 0, MAP_MAX_FEATURES);
+        int64_t us = block->writeUs;
+        std::copy(block->values, block->values + n, values);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block->sequence.load(std::memory_order_relaxed) != before) continue;
+        *seen = before;
+        *count = n;
+        *writeUs = us;
+        return true;
+    }
+    return false;
+}
+
+#if defined(__linux__)
+// Open (creating if needed) a named feature block, e.g. "/tdk_features"
+inline FeatureBlock* openFeatureBlock(const char* name) {
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < static_cast<off_t>(sizeof(FeatureBlock)) && ftruncate(fd, sizeof(FeatureBlock)) != 0)) {
+        ::close(fd);
+        return nullptr;
+    }
+    void* p = mmap(nullptr, sizeof(FeatureBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return nullptr;
+    FeatureBlock* block = static_cast<FeatureBlock*>(p);
+    if (block->magic != FEATURE_MAGIC) { // New object (zero-filled)
+        block->version = FEATURE_VERSION;
+        block->capacity = MAP_MAX_FEATURES;
+        std::atomic_thread_fence(std::memory_order_release);
+        block->magic = FEATURE_MAGIC;
+    }
+    return block;
+}
+
+inline void closeFeatureBlock(FeatureBlock* block) {
+    if (block) munmap(block, sizeof(FeatureBlock));
+}
+#else
+inline FeatureBlock* openFeatureBlock(const char*) {
+    return nullptr;
+}
+
+inline void closeFeatureBlock(FeatureBlock*) {}
+#endif
+
+struct MappingStats {
+    uint64_t frames = 0;     // Frames received
+    uint64_t superseded = 0; // Replaced by a newer frame before a tick used them
+    uint64_t ticks = 0;
+    uint64_t commands = 0;
+    uint64_t failed = 0;
+    uint64_t latencySamples = 0; // Frames that produced commands
+    int64_t lastLatencyUs = 0;   // Frame arrival to its last command handed off
+    int64_t maxLatencyUs = 0;
+    int64_t totalLatencyUs = 0;
+    int64_t maxTickUs = 0;
+};
+
+struct FeatureMapper {
+    MappingPlan plan;
+    float features[MAP_MAX_FEATURES] = {};
+    float targets[MAP_MAX_RULES] = {};
+    int sent[MAP_MAX_RULES];      // Last value submitted per rule, -1 == none yet
+    uint64_t muted = 0;           // Tactors silenced through the priority lane (bit n == tactor n + 1)
+    bool fresh = false;           // A frame (or a failed send) is waiting for the next tick
+    int64_t frameUs = 0;
+    int64_t periodUs = 10000;
+    int taskID = 0;
+    FeatureBlock* source = nullptr;
+    char sourceName[64] = "";
+    uint32_t sourceSeen = 0;
+    MappingStats stats;
+
+    FeatureMapper() { std::fill(std::begin(sent), std::end(sent), -1); }
+};
+
+inline std::mutex mapMutex; // Guards mappers
+inline std::map<int, FeatureMapper> mappers; // deviceID -> mapper
+
+// Store a frame for the next tick. Caller holds mapMutex.
+inline void pushFeaturesLocked(FeatureMapper& mapper, const float* values, int count, int64_t frameUs) {
+    if (mapper.fresh) mapper.stats.superseded++;
+    std::copy(values, values + std::min(count, MAP_MAX_FEATURES), mapper.features);
+    mapper.frameUs = frameUs;
+    mapper.fresh = true;
+    mapper.stats.frames++;
+}
+
+// One mapping tick: compute from the newest frame and emit what changed.
+// Caller holds mapMutex.
+inline void mapTick(int deviceID, FeatureMapper& mapper, int64_t tickUs) {
+    (void)tickUs;
+    TRACE_SCOPE_ARG("map", deviceID);
+    int64_t t0 = nowUs();
+    if (mapper.source) {
+        float values[MAP_MAX_FEATURES];
+        int count = 0;
+        int64_t writeUs = 0;
+        uint32_t before = mapper.sourceSeen;
+        if (readFeatureBlock(mapper.source, &mapper.sourceSeen, values, &count, &writeUs)) {
+            pushFeaturesLocked(mapper, values, count, writeUs);
+            if (before != 0) mapper.stats.superseded += (mapper.sourceSeen - before) / 2 - 1;
+        }
+    }
+    mapper.stats.ticks++;
+    if (!mapper.fresh) return;
+    mapper.fresh = false;
+    const MappingPlan& plan = mapper.plan;
+    computeTargets(plan, mapper.features, mapper.targets);
+
+    TactorCommand cmd;
+    cmd.deviceID = deviceID;
+    int sent = 0;
+    bool updated = false;
+    for (uint8_t target : {MAP_FREQ, MAP_GAIN}) { // Frequency first, so a gain change plays at its new frequency
+        for (int i = 0; i < plan.count; i++) {
+            if (plan.target[i] != target || (mapper.muted >> (plan.tacNum[i] - 1) & 1)) continue;
+            int value = target == MAP_GAIN
+                            ? static_cast<int>(std::clamp(mapper.targets[i] + 0.5f, 0.0f, 255.0f))
+                            : static_cast<int>(std::clamp(mapper.targets[i] + 0.5f, static_cast<float>(MIN_ACTION_FREQUENCY),
+                                                          static_cast<float>(MAX_ACTION_FREQUENCY)));
+            if (mapper.sent[i] >= 0 && std::fabs(static_cast<float>(value - mapper.sent[i])) < plan.deadband[i]) continue;
+            if (!updated && !queueEnabled.load(std::memory_order_acquire)) {
+                updateInterface(); // The I/O thread does this itself in queue mode
+                updated = true;
+            }
+            cmd.type = target == MAP_GAIN ? CMD_CHANGE_GAIN : CMD_CHANGE_FREQ;
+            cmd.tacNum = plan.tacNum[i];
+            cmd.value = value;
+            if (submitCommand(cmd) >= 0) {
+                mapper.sent[i] = value;
+                sent++;
+            } else {
+                mapper.stats.failed++;
+                mapper.fresh = true; // Retry on the next tick
+            }
+        }
+    }
+    int64_t t1 = nowUs();
+    mapper.stats.commands += sent;
+    if (sent > 0) {
+        int64_t latency = t1 - mapper.frameUs;
+        mapper.stats.lastLatencyUs = latency;
+        mapper.stats.totalLatencyUs += latency;
+        mapper.stats.latencySamples++;
+        if (latency > mapper.stats.maxLatencyUs) mapper.stats.maxLatencyUs = latency;
+    }
+    if (t1 - t0 > mapper.stats.maxTickUs) mapper.stats.maxTickUs = t1 - t0;
+}
+
+// Totals over every device, for 'stats'
+inline MappingStats getMappingStats() {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    MappingStats total;
+    for (const auto& [deviceID, mapper] : mappers) {
+        const MappingStats& s = mapper.stats;
+        total.frames += s.frames;
+        total.superseded += s.superseded;
+        total.commands += s.commands;
+        total.latencySamples += s.latencySamples;
+        total.totalLatencyUs += s.totalLatencyUs;
+        total.maxLatencyUs = std::max(total.maxLatencyUs, s.maxLatencyUs);
+    }
+    return total;
+}
+
+// Caller holds mapMutex; the mapper's task must already be removed
+inline void eraseMapperLocked(int deviceID) {
+    auto it = mappers.find(deviceID);
+    if (it == mappers.end()) return;
+    closeFeatureBlock(it->second.source);
+    mappers.erase(it);
+}
+
+inline void clearMappersLocked() {
+    for (auto& [deviceID, mapper] : mappers) closeFeatureBlock(mapper.source);
+    mappers.clear();
+}
+
+// Priority stop: the mapping task ends (values are re-sent if it is restarted).
+// Silence: the tactor's rules stay quiet until the mapping is reconfigured.
+inline void cancelMapping(int deviceID, int tacNum) {
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        auto it = mappers.find(deviceID);
+        if (it == mappers.end()) return;
+        FeatureMapper& mapper = it->second;
+        if (tacNum == 0) {
+            taskID = mapper.taskID;
+            mapper.taskID = 0;
+            mapper.fresh = false;
+            std::fill(std::begin(mapper.sent), std::end(mapper.sent), -1);
+        } else if (tacNum <= ENGINE_MAX_TACTOR) {
+            mapper.muted |= uint64_t(1) << (tacNum - 1);
+        }
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+}
+
+inline const bool mappingCancelRegistered = registerCancelHook(cancelMapping);
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef TDK_MIXER_H
+#define TDK_MIXER_H
+
+// Haptic effect mixer.
+//
+// Producers register effects on a tactor instead of writing its gain directly:
+// a gain envelope (piecewise linear, or a constant level a producer keeps
+// updating), an optional frequency, a priority and a blend mode. At a fixed
+// tick the mixer resolves every active effect per tactor and emits only the
+// resulting changes (ChangeFreq, ChangeGain, and Pulse to keep a sounding
+// tactor on). Effects are kept sorted by priority, so resolving is one pass
+// over the active effects; blending in that order gives
+//   max:      gain = max(gain, effect)
+//   sum:      gain = min(gain + effect, 255)
+//   override: gain = effect (lower priorities are masked while it is active)
+// and the highest-priority effect with a frequency sets the frequency. A
+// per-tick command budget bounds the work done on the scheduler thread;
+// changes over budget are deferred to the next tick, round robin.
+
+#include "commandqueue.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+enum BlendMode : uint8_t {
+    BLEND_MAX = 0,
+    BLEND_SUM = 1,
+    BLEND_OVERRIDE = 2
+};
+
+constexpr int MIX_MAX_POINTS = 16;   // Envelope breakpoints per effect
+constexpr int MIX_MAX_EFFECTS = 256; // Active effects per device
+constexpr int MIX_MIN_BUDGET = 3;    // Frequency + gain + pulse: one tactor's largest change
+
+struct EnvelopePoint {
+    int64_t tUs;  // From the effect start
+    float gain;   // 0 - 255
+};
+
+struct HapticEffect {
+    int id = 0;
+    int tacNum = 0;
+    int priority = 0;
+    uint8_t mode = BLEND_MAX;
+    int freq = 0;            // Hz, 0 == leave to other effects
+    int64_t startUs = 0;
+    int64_t durationUs = 0;  // 0 == until removed
+    int points = 0;
+    int cursor = 0;          // Envelope segment of the last evaluation
+    EnvelopePoint envelope[MIX_MAX_POINTS];
+};
+
+struct MixerStats {
+    uint64_t ticks = 0;
+    uint64_t commands = 0;
+    uint64_t deferred = 0; // Tactor changes pushed to a later tick by the budget
+    uint64_t expired = 0;
+    int64_t maxTickUs = 0;
+};
+
+struct EffectMixer {
+    std::vector<HapticEffect> effects; // Sorted by priority; equal priorities in arrival order
+    int budget = 32;                   // Commands per tick
+    int pulseMs = 0;                   // Re-pulse length for sounding tactors, 0 == off
+    int64_t periodUs = 10000;
+    int taskID = 0;                    // Scheduler task, 0 when not running
+    int nextTactor = 1;                // Round-robin start when the budget runs out
+    uint8_t sentGain[ENGINE_MAX_TACTOR + 1] = {};
+    int sentFreq[ENGINE_MAX_TACTOR + 1] = {};
+    int64_t pulseUntilUs[ENGINE_MAX_TACTOR + 1] = {};
+    MixerStats stats;
+};
+
+inline std::mutex mixMutex; // Guards mixers and every effect
+inline std::map<int, EffectMixer> mixers; // deviceID -> mixer
+inline int nextEffectID = 1;
+
+// Envelope gain at t (us from the effect start); holds the last point.
+// Evaluation times only move forward, so the cursor makes this O(1).
+inline float evaluateEnvelope(HapticEffect& effect, int64_t t) {
+    const EnvelopePoint* p = effect.envelope;
+    if (effect.points == 1 || t <= p[0].tUs) return p[0].gain;
+    while (effect.cursor + 1 < effect.points && t >= p[effect.cursor + 1].tUs) effect.cursor++;
+    if (effect.cursor + 1 >= effect.points) return p[effect.points - 1].gain;
+    const EnvelopePoint& a = p[effect.cursor];
+    const EnvelopePoint& b = p[effect.cursor + 1];
+    return a.gain + (b.gain - a.gain) * static_cast<float>(t - a.tUs) / static_cast<float>(b.tUs - a.tUs);
+}
+
+// Insert after every effect of equal or lower priority. Caller holds mixMutex.
+inline void insertEffectLocked(EffectMixer& mixer, const HapticEffect& effect) {
+    auto at = std::upper_bound(mixer.effects.begin(), mixer.effects.end(), effect.priority,
+                               [](int priority, const HapticEffect& e) { return priority < e.priority; });
+    mixer.effects.insert(at, effect);
+}
+
+// Find an effect on any device. Caller holds mixMutex.
+inline HapticEffect* findEffectLocked(int effectID, int* deviceID = nullptr) {
+    for (auto& [id, mixer] : mixers) {
+        for (auto& effect : mixer.effects) {
+            if (effect.id == effectID) {
+                if (deviceID) *deviceID = id;
+                return &effect;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// One mixer tick: resolve, then emit the changes within the budget.
+// Caller holds mixMutex.
+inline void mixTick(int deviceID, EffectMixer& mixer, int64_t tickUs) {
+    TRACE_SCOPE_ARG("mix", deviceID);
+    int64_t t0 = nowUs();
+    float gain[ENGINE_MAX_TACTOR + 1] = {};
+    int freq[ENGINE_MAX_TACTOR + 1] = {};
+
+    // Resolve, dropping expired effects in the same pass
+    size_t kept = 0;
+    for (size_t k = 0; k < mixer.effects.size(); k++) {
+        HapticEffect& effect = mixer.effects[k];
+        int64_t t = tickUs - effect.startUs;
+        if (effect.durationUs > 0 && t >= effect.durationUs) {
+            mixer.stats.expired++;
+            continue;
+        }
+        if (kept != k) mixer.effects[kept] = effect;
+        HapticEffect& live = mixer.effects[kept++];
+        if (t < 0) continue; // Scheduled to start later
+        float g = evaluateEnvelope(live, t);
+        float& out = gain[live.tacNum];
+        switch (live.mode) {
+            case BLEND_SUM:
+                out = std::min(out + g, 255.0f);
+                break;
+            case BLEND_OVERRIDE:
+                out = g;
+                break;
+            default:
+                out = std::max(out, g);
+                break;
+        }
+        if (live.freq > 0) freq[live.tacNum] = live.freq;
+    }
+    mixer.effects.resize(kept);
+
+    // Emit, starting where the last over-budget tick stopped
+    TactorCommand cmd;
+    cmd.deviceID = deviceID;
+    int used = 0;
+    bool updated = false;
+    int deferredFrom = 0;
+    for (int n = 0; n < ENGINE_MAX_TACTOR; n++) {
+        int tac = 1 + (mixer.nextTactor - 1 + n) % ENGINE_MAX_TACTOR;
+        uint8_t g = static_cast<uint8_t>(std::clamp(gain[tac] + 0.5f, 0.0f, 255.0f));
+        bool freqChange = freq[tac] > 0 && freq[tac] != mixer.sentFreq[tac];
+        bool gainChange = g != mixer.sentGain[tac];
+        bool pulse = mixer.pulseMs > 0 && g > 0 && tickUs + mixer.periodUs >= mixer.pulseUntilUs[tac];
+        int cost = (freqChange ? 1 : 0) + (gainChange ? 1 : 0) + (pulse ? 1 : 0);
+        if (cost == 0) continue;
+        if (used + cost > mixer.budget) {
+            if (deferredFrom == 0) deferredFrom = tac;
+            mixer.stats.deferred++;
+            continue;
+        }
+        if (!updated && !queueEnabled.load(std::memory_order_acquire)) {
+            updateInterface(); // The I/O thread does this itself in queue mode
+            updated = true;
+        }
+        cmd.tacNum = tac;
+        if (freqChange) {
+            cmd.type = CMD_CHANGE_FREQ;
+            cmd.value = freq[tac];
+            if (submitCommand(cmd) >= 0) mixer.sentFreq[tac] = freq[tac];
+        }
+        if (gainChange) {
+            cmd.type = CMD_CHANGE_GAIN;
+            cmd.value = g;
+            if (submitCommand(cmd) >= 0) mixer.sentGain[tac] = g;
+        }
+        if (pulse) {
+            cmd.type = CMD_PULSE;
+            cmd.duration = mixer.pulseMs;
+            cmd.delay = 0;
+            if (submitCommand(cmd) >= 0) mixer.pulseUntilUs[tac] = tickUs + mixer.pulseMs * 1000;
+        }
+        if (g == 0) mixer.pulseUntilUs[tac] = 0;
+        used += cost;
+        mixer.stats.commands += cost;
+    }
+    mixer.nextTactor = deferredFrom != 0 ? deferredFrom : 1;
+    mixer.stats.ticks++;
+    int64_t elapsed = nowUs() - t0;
+    if (elapsed > mixer.stats.maxTickUs) mixer.stats.maxTickUs = elapsed;
+}
+
+// Totals over every device, for 'stats'
+inline MixerStats getMixerStats(int* activeEffects = nullptr) {
+    std::lock_guard<std::mutex> lock(mixMutex);
+    MixerStats total;
+    int active = 0;
+    for (const auto& [deviceID, mixer] : mixers) {
+        total.ticks += mixer.stats.ticks;
+        total.commands += mixer.stats.commands;
+        total.deferred += mixer.stats.deferred;
+        total.expired += mixer.stats.expired;
+        total.maxTickUs = std::max(total.maxTickUs, mixer.stats.maxTickUs);
+        active += static_cast<int>(mixer.effects.size());
+    }
+    if (activeEffects) *activeEffects = active;
+    return total;
+}
+
+// Priority stop/silence: drop the device's (or the tactor's) effects. A device
+// stop also stops the mixer task.
+inline void cancelMixer(int deviceID, int tacNum) {
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        auto it = mixers.find(deviceID);
+        if (it == mixers.end()) return;
+        EffectMixer& mixer = it->second;
+        auto& effects = mixer.effects;
+        effects.erase(std::remove_if(effects.begin(), effects.end(),
+                                     [tacNum](const HapticEffect& e) { return tacNum == 0 || e.tacNum == tacNum; }),
+                      effects.end());
+        for (int t = 0; t <= ENGINE_MAX_TACTOR; t++) {
+            if (tacNum != 0 && t != tacNum) continue;
+            mixer.sentGain[t] = 0;
+            mixer.pulseUntilUs[t] = 0;
+        }
+        if (tacNum == 0) {
+            taskID = mixer.taskID;
+            mixer.taskID = 0;
+        }
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+}
+
+inline const bool mixerCancelRegistered = registerCancelHook(cancelMixer);
+
+#endif
@@ -0,0 +1,486 @@
+#ifndef TDK_PATTERNS_H
+#define TDK_PATTERNS_H
+
+// Coroutine haptic patterns (C++20).
+//
+// A pattern is a coroutine that drives one device/tactor through a
+// PatternContext and suspends on timing:
+//
+//   Pattern pulseTrain(PatternContext& ctx) {
+//       for (int i = 0; i < ctx.param(0, 3); i++) {
+//           ctx.pulse(ctx.tactor, 50);
+//           co_await wait(200);
+//       }
+//   }
+//
+// A pattern that can't run with its parameters calls ctx.fail() and co_returns
+// (no exceptions: they allocate on the scheduler thread).
+//
+// Awaitables: wait(ms), rampGain/rampFreq(tactor, from, to, ms) (stepped in
+// software on every tick), and until(event) (an event raised by MATLAB or
+// another pattern). Every running pattern is resumed from one scheduler task;
+// timers sit in a binary heap, so a tick only touches patterns that are due.
+// Coroutine frames come from a fixed pool and instances from a fixed table, so
+// launching and stepping patterns never allocates.
+//
+// Patterns are registered by name at static init (registerPattern) and
+// launched, cancelled and queried from MATLAB through 'launchPattern',
+// 'cancelPattern' and 'patternStatus'.
+
+#include "commandqueue.h"
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+constexpr int PATTERN_MAX_INSTANCES = 4096;  // Concurrently running patterns
+constexpr size_t PATTERN_FRAME_BYTES = 1024; // Largest coroutine frame the pool holds
+constexpr int PATTERN_MAX_REGISTERED = 32;
+constexpr int PATTERN_MAX_PARAMS = 8;
+constexpr int PATTERN_EVENTS = 64;           // Event numbers 1 - 64
+constexpr double PATTERN_TICK_HZ = 1000.0;
+
+struct PatternPromise;
+using PatternHandle = std::coroutine_handle<PatternPromise>;
+
+// Coroutine return type. An empty handle means the frame pool was exhausted.
+struct Pattern {
+    using promise_type = PatternPromise;
+    PatternHandle handle;
+};
+
+struct PatternContext {
+    int deviceID = 0;
+    int tactor = 0; // Tactor given at launch (patterns may drive others)
+    double params[PATTERN_MAX_PARAMS] = {};
+    int numParams = 0;
+
+    mutable bool failed = false; // Set by fail()
+
+    double param(int i, double fallback) const { return i < numParams ? params[i] : fallback; }
+    void fail() const { failed = true; } // Mark the instance failed; follow with co_return
+    void gain(int tacNum, int value) const;
+    void freq(int tacNum, int value) const;
+    void pulse(int tacNum, int durationMs) const;
+    void signal(int event) const;
+};
+
+enum PatternWait : uint8_t {
+    PATTERN_READY = 0,
+    PATTERN_WAIT_TIME,
+    PATTERN_WAIT_RAMP,
+    PATTERN_WAIT_EVENT
+};
+
+struct PatternInstance {
+    int id = 0;        // 0 == free slot
+    uint32_t serial = 0; // Bumped per launch; stale timer entries are skipped
+    int pattern = -1;  // Index in the registry
+    PatternContext ctx;
+    PatternHandle handle;
+    uint8_t wait = PATTERN_READY;
+    bool failed = false;
+    int64_t startUs = 0;
+    int64_t resumeUs = 0;
+    int event = 0;
+    // Software ramp in progress
+    uint8_t rampType = CMD_CHANGE_GAIN;
+    int rampTactor = 0;
+    float rampFrom = 0.0f;
+    float rampTo = 0.0f;
+    int64_t rampStartUs = 0;
+    int64_t rampEndUs = 0;
+    int rampLast = -1;
+};
+
+struct PatternTimer {
+    int64_t resumeUs;
+    int slot;
+    uint32_t serial;
+    bool operator<(const PatternTimer& other) const { return resumeUs > other.resumeUs; } // Min-heap
+};
+
+using PatternFn = Pattern (*)(PatternContext& ctx);
+
+struct RegisteredPattern {
+    const char* name;
+    PatternFn fn;
+};
+
+struct PatternStats {
+    uint64_t launched = 0;
+    uint64_t completed = 0;
+    uint64_t cancelled = 0;
+    uint64_t failed = 0;
+    uint64_t resumes = 0;
+    uint64_t commands = 0;
+    int64_t maxTickUs = 0;
+};
+
+// Everything below is guarded by patternMutex (the runner tick holds it)
+inline std::mutex patternMutex;
+inline RegisteredPattern registeredPatterns[PATTERN_MAX_REGISTERED];
+inline int numRegisteredPatterns = 0;
+inline PatternInstance patternInstances[PATTERN_MAX_INSTANCES];
+inline std::vector<PatternTimer> patternTimers;
+inline int runningPatterns = 0;
+inline int nextPatternID = 1;
+inline int patternTaskID = 0;
+inline int64_t patternTickUs = 0; // Time of the tick being run
+inline bool patternTickUpdated = false; // UpdateTI issued this tick
+inline PatternStats patternStats;
+
+// ---- Frame pool ------------------------------------------------------------
+
+struct alignas(std::max_align_t) PatternFrame {
+    unsigned char bytes[PATTERN_FRAME_BYTES];
+};
+
+inline PatternFrame patternFrames[PATTERN_MAX_INSTANCES];
+inline int patternFreeFrames[PATTERN_MAX_INSTANCES];
+inline int numFreeFrames = -1; // -1 until the free list is built
+inline const bool patternsLockable = registerRtRegion(patternFrames, sizeof(patternFrames)) &&
+                                     registerRtRegion(patternFreeFrames, sizeof(patternFreeFrames)) &&
+                                     registerRtRegion(patternInstances, sizeof(patternInstances));
+
+inline void* allocatePatternFrame(size_t size) {
+    if (numFreeFrames < 0) {
+        for (int i = 0; i < PATTERN_MAX_INSTANCES; i++) patternFreeFrames[i] = PATTERN_MAX_INSTANCES - 1 - i;
+        numFreeFrames = PATTERN_MAX_INSTANCES;
+    }
+    if (size > PATTERN_FRAME_BYTES || numFreeFrames == 0) return nullptr;
+    return &patternFrames[patternFreeFrames[--numFreeFrames]];
+}
+
+inline void freePatternFrame(void* frame) {
+    patternFreeFrames[numFreeFrames++] = static_cast<int>(static_cast<PatternFrame*>(frame) - patternFrames);
+}
+
+struct PatternPromise {
+    PatternInstance* instance = nullptr;
+
+    Pattern get_return_object() { return {PatternHandle::from_promise(*this)}; }
+    static Pattern get_return_object_on_allocation_failure() { return {}; }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {
+        if (instance) instance->failed = true;
+    }
+    static void* operator new(size_t size) noexcept { return allocatePatternFrame(size); }
+    static void operator delete(void* frame) noexcept { freePatternFrame(frame); }
+};
+
+// ---- Awaitables --------------------------------------------------------------
+
+struct WaitAwaiter {
+    int64_t us;
+    bool await_ready() const noexcept { return us <= 0; }
+    void await_suspend(PatternHandle h) const noexcept {
+        PatternInstance* p = h.promise().instance;
+        p->wait = PATTERN_WAIT_TIME;
+        p->resumeUs = patternTickUs + us;
+    }
+    void await_resume() const noexcept {}
+};
+
+struct RampAwaiter {
+    uint8_t type;
+    int tactor;
+    float from, to;
+    int64_t us;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(PatternHandle h) const noexcept {
+        PatternInstance* p = h.promise().instance;
+        p->wait = PATTERN_WAIT_RAMP;
+        p->rampType = type;
+        p->rampTactor = tactor;
+        p->rampFrom = from;
+        p->rampTo = to;
+        p->rampStartUs = patternTickUs;
+        p->rampEndUs = patternTickUs + std::max<int64_t>(us, 0);
+        p->rampLast = -1;
+        p->resumeUs = patternTickUs;
+    }
+    void await_resume() const noexcept {}
+};
+
+// An event outside 1 - PATTERN_EVENTS can never be signalled; the pattern fails
+// instead of waiting forever (or spinning, had the wait completed at once).
+struct EventAwaiter {
+    int event;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(PatternHandle h) const noexcept {
+        PatternInstance* p = h.promise().instance;
+        if (event < 1 || event > PATTERN_EVENTS) {
+            p->failed = true;
+            return;
+        }
+        p->wait = PATTERN_WAIT_EVENT;
+        p->event = event;
+    }
+    void await_resume() const noexcept {}
+};
+
+inline WaitAwaiter wait(double ms) { return {static_cast<int64_t>(ms * 1000.0)}; }
+inline RampAwaiter rampGain(int tactor, int from, int to, double ms) {
+    return {CMD_CHANGE_GAIN, tactor, static_cast<float>(from), static_cast<float>(to), static_cast<int64_t>(ms * 1000.0)};
+}
+inline RampAwaiter rampFreq(int tactor, int from, int to, double ms) {
+    return {CMD_CHANGE_FREQ, tactor, static_cast<float>(from), static_cast<float>(to), static_cast<int64_t>(ms * 1000.0)};
+}
+inline EventAwaiter until(int event) { return {event}; }
+
+// ---- Runner ------------------------------------------------------------------
+
+// Issue a pattern command. Runs on the scheduler thread with patternMutex held.
+inline void emitPatternCommand(uint8_t type, int deviceID, int tacNum, int value, int duration) {
+    if (!patternTickUpdated && !queueEnabled.load(std::memory_order_acquire)) {
+        updateInterface(); // The I/O thread does this itself in queue mode
+        patternTickUpdated = true;
+    }
+    TactorCommand cmd;
+    cmd.type = type;
+    cmd.deviceID = deviceID;
+    cmd.tacNum = tacNum;
+    cmd.value = value;
+    cmd.duration = duration;
+    if (submitCommand(cmd) >= 0) patternStats.commands++;
+}
+
+inline void PatternContext::gain(int tacNum, int value) const { emitPatternCommand(CMD_CHANGE_GAIN, deviceID, tacNum, value, 0); }
+inline void PatternContext::freq(int tacNum, int value) const { emitPatternCommand(CMD_CHANGE_FREQ, deviceID, tacNum, value, 0); }
+inline void PatternContext::pulse(int tacNum, int durationMs) const { emitPatternCommand(CMD_PULSE, deviceID, tacNum, 0, durationMs); }
+
+// Drop timers left behind by cancelled or relaunched instances. Each live
+// instance has at most one timer, so this always frees room in the reservation.
+inline void compactPatternTimersLocked() {
+    auto stale = [](const PatternTimer& t) {
+        const PatternInstance& p = patternInstances[t.slot];
+        return p.id == 0 || p.serial != t.serial;
+    };
+    patternTimers.erase(std::remove_if(patternTimers.begin(), patternTimers.end(), stale), patternTimers.end());
+    std::make_heap(patternTimers.begin(), patternTimers.end());
+}
+
+inline void schedulePatternLocked(int slot, int64_t resumeUs) {
+    if (patternTimers.size() == patternTimers.capacity()) compactPatternTimersLocked(); // Never reallocate on the tick
+    patternTimers.push_back({resumeUs, slot, patternInstances[slot].serial});
+    std::push_heap(patternTimers.begin(), patternTimers.end());
+}
+
+// Wake every pattern waiting on an event. Caller holds patternMutex.
+inline void signalPatternEventLocked(int event, int64_t now) {
+    for (int slot = 0; slot < PATTERN_MAX_INSTANCES; slot++) {
+        PatternInstance& p = patternInstances[slot];
+        if (p.id != 0 && p.wait == PATTERN_WAIT_EVENT && p.event == event) {
+            p.wait = PATTERN_READY;
+            schedulePatternLocked(slot, now);
+        }
+    }
+}
+
+inline void PatternContext::signal(int event) const { signalPatternEventLocked(event, patternTickUs); }
+
+inline void releasePatternLocked(PatternInstance& p) {
+    if (p.handle) p.handle.destroy(); // Frame goes back to the pool
+    p.handle = {};
+    p.id = 0;
+    p.wait = PATTERN_READY;
+    runningPatterns--;
+}
+
+// Resume one pattern and file it under whatever it now waits on
+inline void resumePatternLocked(int slot) {
+    PatternInstance& p = patternInstances[slot];
+    p.wait = PATTERN_READY;
+    p.handle.resume();
+    patternStats.resumes++;
+    if (p.ctx.failed) p.failed = true;
+    if (p.handle.done() || p.failed) {
+        if (p.failed) {
+            patternStats.failed++;
+        } else {
+            patternStats.completed++;
+        }
+        releasePatternLocked(p);
+        return;
+    }
+    if (p.wait == PATTERN_WAIT_TIME || p.wait == PATTERN_WAIT_RAMP) schedulePatternLocked(slot, p.resumeUs);
+}
+
+// One ramp step. Returns true once the ramp has reached its end.
+inline bool stepRampLocked(PatternInstance& p, int64_t now, int64_t periodUs) {
+    float f = p.rampEndUs > p.rampStartUs ? static_cast<float>(now - p.rampStartUs) / (p.rampEndUs - p.rampStartUs) : 1.0f;
+    f = std::clamp(f, 0.0f, 1.0f);
+    int value = static_cast<int>(p.rampFrom + (p.rampTo - p.rampFrom) * f + 0.5f);
+    if (value != p.rampLast) {
+        emitPatternCommand(p.rampType, p.ctx.deviceID, p.rampTactor, value, 0);
+        p.rampLast = value;
+    }
+    p.resumeUs = now + periodUs;
+    return f >= 1.0f;
+}
+
+inline void patternTick(int64_t tickUs) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    TRACE_SCOPE("patterns");
+    int64_t t0 = nowUs();
+    patternTickUs = tickUs;
+    patternTickUpdated = false;
+    const int64_t periodUs = static_cast<int64_t>(1e6 / PATTERN_TICK_HZ);
+    while (!patternTimers.empty() && patternTimers.front().resumeUs <= tickUs) {
+        PatternTimer timer = patternTimers.front();
+        std::pop_heap(patternTimers.begin(), patternTimers.end());
+        patternTimers.pop_back();
+        PatternInstance& p = patternInstances[timer.slot];
+        if (p.id == 0 || p.serial != timer.serial) continue; // Cancelled
+        if (p.wait == PATTERN_WAIT_RAMP && !stepRampLocked(p, tickUs, periodUs)) {
+            schedulePatternLocked(timer.slot, p.resumeUs);
+            continue;
+        }
+        resumePatternLocked(timer.slot);
+    }
+    int64_t elapsed = nowUs() - t0;
+    if (elapsed > patternStats.maxTickUs) patternStats.maxTickUs = elapsed;
+}
+
+// ---- Registry and control ----------------------------------------------------
+
+inline bool registerPattern(const char* name, PatternFn fn) {
+    if (numRegisteredPatterns >= PATTERN_MAX_REGISTERED) return false;
+    registeredPatterns[numRegisteredPatterns++] = {name, fn};
+    return true;
+}
+
+inline int findPattern(const char* name) {
+    for (int i = 0; i < numRegisteredPatterns; i++) {
+        if (std::strcmp(registeredPatterns[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Start a pattern. Returns its instance ID, or 0 if the instance table or frame
+// pool is full. The first step runs on the next tick after delayUs.
+// Caller holds patternMutex.
+inline int launchPatternLocked(int pattern, const PatternContext& ctx, int64_t delayUs) {
+    if (patternTimers.capacity() == 0) patternTimers.reserve(2 * PATTERN_MAX_INSTANCES);
+    int slot = 0;
+    while (slot < PATTERN_MAX_INSTANCES && patternInstances[slot].id != 0) slot++;
+    if (slot == PATTERN_MAX_INSTANCES) return 0;
+    PatternInstance& p = patternInstances[slot];
+    p.ctx = ctx;
+    p.ctx.failed = false;
+    Pattern coroutine = registeredPatterns[pattern].fn(p.ctx);
+    if (!coroutine.handle) return 0;
+    p.id = nextPatternID++;
+    p.serial++;
+    p.pattern = pattern;
+    p.handle = coroutine.handle;
+    p.handle.promise().instance = &p;
+    p.failed = false;
+    p.startUs = nowUs() + delayUs;
+    p.wait = PATTERN_WAIT_TIME;
+    schedulePatternLocked(slot, p.startUs);
+    runningPatterns++;
+    patternStats.launched++;
+    return p.id;
+}
+
+// Cancel by instance ID (id > 0), by pattern index (pattern >= 0), or every
+// pattern on a device/tactor (tacNum 0 == any). Returns the number cancelled.
+// Caller holds patternMutex.
+inline int cancelPatternsLocked(int id, int pattern, int deviceID = -1, int tacNum = 0) {
+    int count = 0;
+    for (auto& p : patternInstances) {
+        if (p.id == 0) continue;
+        bool match = id > 0 ? p.id == id
+                   : pattern >= 0 ? p.pattern == pattern
+                   : p.ctx.deviceID == deviceID && (tacNum == 0 || p.ctx.tactor == tacNum);
+        if (!match) continue;
+        releasePatternLocked(p);
+        patternStats.cancelled++;
+        count++;
+    }
+    return count;
+}
+
+inline void clearPatternsLocked() {
+    for (auto& p : patternInstances) {
+        if (p.id != 0) releasePatternLocked(p);
+    }
+    patternTimers.clear();
+    runningPatterns = 0;
+    patternStats = PatternStats();
+}
+
+// Priority stop/silence: cancel the device's (or the tactor's) patterns. The
+// runner task stays registered; an idle tick only checks an empty heap.
+inline void cancelDevicePatterns(int deviceID, int tacNum) {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    cancelPatternsLocked(0, -1, deviceID, tacNum);
+}
+
+inline const bool patternCancelRegistered = registerCancelHook(cancelDevicePatterns);
+
+// ---- Built-in patterns ---------------------------------------------------------
+// Parameters are the launch vector, in order; defaults in brackets.
+
+// [count 3, onMs 50, offMs 150, gain 255]: a rhythm of pulses
+inline Pattern pulseTrainPattern(PatternContext& ctx) {
+    int count = static_cast<int>(ctx.param(0, 3));
+    int onMs = static_cast<int>(ctx.param(1, 50));
+    double offMs = ctx.param(2, 150);
+    ctx.gain(ctx.tactor, static_cast<int>(ctx.param(3, 255)));
+    for (int i = 0; i < count; i++) {
+        ctx.pulse(ctx.tactor, onMs);
+        co_await wait(onMs + offMs);
+    }
+}
+
+// [lastTactor 8, stepMs 100, gain 255, pulseMs stepMs]: pulse tactors launch tactor..lastTactor in turn
+inline Pattern sweepPattern(PatternContext& ctx) {
+    int last = static_cast<int>(ctx.param(0, 8));
+    if (last < 1 || last > ENGINE_MAX_TACTOR) {
+        ctx.fail();
+        co_return;
+    }
+    double stepMs = ctx.param(1, 100);
+    int gain = static_cast<int>(ctx.param(2, 255));
+    int pulseMs = static_cast<int>(ctx.param(3, stepMs));
+    int step = last >= ctx.tactor ? 1 : -1;
+    for (int tac = ctx.tactor;; tac += step) {
+        ctx.gain(tac, gain);
+        ctx.pulse(tac, pulseMs);
+        if (tac == last) break;
+        co_await wait(stepMs);
+    }
+}
+
+// [peak 255, riseMs 200, holdMs 200, fallMs 200]: gain envelope in software
+inline Pattern swellPattern(PatternContext& ctx) {
+    int peak = static_cast<int>(ctx.param(0, 255));
+    co_await rampGain(ctx.tactor, 0, peak, ctx.param(1, 200));
+    co_await wait(ctx.param(2, 200));
+    co_await rampGain(ctx.tactor, peak, 0, ctx.param(3, 200));
+}
+
+// [event 1, gain 255, pulseMs 100, repeat 1]: pulse each time the event is signalled
+inline Pattern cuePattern(PatternContext& ctx) {
+    int event = static_cast<int>(ctx.param(0, 1));
+    int repeat = static_cast<int>(ctx.param(3, 1));
+    for (int i = 0; i < repeat; i++) {
+        co_await until(event);
+        ctx.gain(ctx.tactor, static_cast<int>(ctx.param(1, 255)));
+        ctx.pulse(ctx.tactor, static_cast<int>(ctx.param(2, 100)));
+    }
+}
+
+inline const bool builtinPatternsRegistered = registerPattern("pulseTrain", pulseTrainPattern) &&
+                                              registerPattern("sweep", sweepPattern) &&
+                                              registerPattern("swell", swellPattern) &&
+                                              registerPattern("cue", cuePattern);
+
+#endif
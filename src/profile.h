@@ -0,0 +1,147 @@
+#ifndef TDK_PROFILE_H
+#define TDK_PROFILE_H
+
+// Device configuration profiles.
+//
+// A profile declares how a device should be set up: the time factor (global to
+// TactorInterface), end-on-zero-crossing (SetFreqTimeDelay), and tactor type,
+// sig source, frequency and gain, device-wide (tactor 0, "all tactors") and
+// per tactor. applyProfileLocked issues the whole profile as one burst: a
+// single UpdateTI, then every setting back to back under one hold of tiMutex.
+// Settings the device's shadow state says already hold are skipped, so
+// re-applying a profile before each block only costs the settings that changed.
+// The link shadow also lets the reconnect watchdog replay the configuration.
+
+#include "engine.h"
+
+constexpr int PROFILE_UNSET = -1;
+
+struct TactorSettings {
+    int type = PROFILE_UNSET;      // TDK_TACTOR_TYPE_*
+    int sigSource = PROFILE_UNSET; // TDK_SIG_SRC_* combination (1 - 7)
+    int freq = PROFILE_UNSET;      // Hz
+    int gain = PROFILE_UNSET;      // 0 - 255
+};
+
+struct DeviceProfile {
+    int timeFactor = PROFILE_UNSET;    // 1 - 255, applies to every device
+    int freqTimeDelay = PROFILE_UNSET; // 1 == end on a zero crossing
+    TactorSettings tactors[ENGINE_MAX_TACTOR + 1]; // [0] == device-wide
+};
+
+struct ProfileReport {
+    int applied = 0;  // Vendor calls issued
+    int skipped = 0;  // Settings already in place
+    int64_t elapsedUs = 0;
+    int result = 0;   // < 0 if a call failed
+    int errorCode = 0;
+    const char* failedCall = nullptr;
+};
+
+inline int appliedTimeFactor = PROFILE_UNSET; // Guarded by tiMutex
+inline ProfileReport lastProfileReport;      // Guarded by tiMutex
+
+// Whether a tactor setting already holds. Tactor 0 holds only if no tactor
+// overrides it with another value, other than tactors the profile sets itself
+// (those are checked on their own). Caller holds tiMutex.
+inline bool settingHoldsLocked(const DeviceLink& link, const DeviceProfile& profile,
+                               int TactorShadow::*field, int TactorSettings::*setting, int tacNum, int value) {
+    const TactorShadow* shadow = link.tactors;
+    if (tacNum != 0) {
+        int current = shadow[tacNum].*field >= 0 ? shadow[tacNum].*field : shadow[0].*field;
+        return current == value;
+    }
+    if (shadow[0].*field != value) return false;
+    for (int t = 1; t <= ENGINE_MAX_TACTOR; t++) {
+        if (profile.tactors[t].*setting != PROFILE_UNSET) continue;
+        if (shadow[t].*field >= 0 && shadow[t].*field != value) return false;
+    }
+    return true;
+}
+
+// Issue every setting that doesn't hold yet, stopping at the first failure.
+// Caller holds tiMutex.
+inline void issueProfileLocked(int deviceID, const DeviceProfile& profile, ProfileReport& report) {
+    // Only tracked device IDs have shadow state; untracked ones get every setting
+    const DeviceLink* link = deviceID >= 0 && deviceID < ENGINE_MAX_DEVICES ? &deviceLinks[deviceID] : nullptr;
+
+    auto fail = [&](const char* call, int errorCode) {
+        report.result = -1;
+        report.failedCall = call;
+        report.errorCode = errorCode;
+    };
+    auto issue = [&](uint8_t type, int tacNum, int value, const char* call) {
+        TactorCommand cmd;
+        cmd.type = type;
+        cmd.deviceID = deviceID;
+        cmd.tacNum = tacNum;
+        cmd.value = value;
+        int errorCode = 0;
+        if (issueTrackedLocked(cmd, &errorCode) < 0) {
+            fail(call, errorCode);
+            return false;
+        }
+        report.applied++;
+        return true;
+    };
+
+    if (UpdateTI() < 0) {
+        fail("UpdateTI", GetLastEAIError());
+        return;
+    }
+    if (profile.timeFactor != PROFILE_UNSET) {
+        if (profile.timeFactor == appliedTimeFactor) {
+            report.skipped++;
+        } else if (SetTimeFactor(profile.timeFactor) < 0) {
+            fail("SetTimeFactor", GetLastEAIError());
+            return;
+        } else {
+            appliedTimeFactor = profile.timeFactor;
+            report.applied++;
+        }
+    }
+    if (profile.freqTimeDelay != PROFILE_UNSET) {
+        if (link && link->freqTimeDelay == profile.freqTimeDelay) {
+            report.skipped++;
+        } else if (!issue(CMD_FREQ_TIME_DELAY, 0, profile.freqTimeDelay, "SetFreqTimeDelay")) {
+            return;
+        }
+    }
+    struct Field {
+        int TactorSettings::*setting;
+        int TactorShadow::*shadow;
+        uint8_t type;
+        const char* call;
+    };
+    static const Field fields[] = {
+        {&TactorSettings::type, &TactorShadow::type, CMD_TACTOR_TYPE, "SetTactorType"},
+        {&TactorSettings::sigSource, &TactorShadow::sigSource, CMD_SIG_SOURCE, "ChangeSigSource"},
+        {&TactorSettings::freq, &TactorShadow::freq, CMD_CHANGE_FREQ, "ChangeFreq"},
+        {&TactorSettings::gain, &TactorShadow::gain, CMD_CHANGE_GAIN, "ChangeGain"}
+    };
+    for (int t = 0; t <= ENGINE_MAX_TACTOR; t++) { // Device-wide first, then overrides
+        const TactorSettings& settings = profile.tactors[t];
+        for (const Field& f : fields) {
+            int value = settings.*f.setting;
+            if (value == PROFILE_UNSET) continue;
+            if (link && settingHoldsLocked(*link, profile, f.shadow, f.setting, t, value)) {
+                report.skipped++;
+                continue;
+            }
+            if (!issue(f.type, t, value, f.call)) return;
+        }
+    }
+}
+
+// Apply a profile to one device and time it. Caller holds tiMutex.
+inline ProfileReport applyProfileLocked(int deviceID, const DeviceProfile& profile) {
+    TRACE_SCOPE_ARG("profile", deviceID);
+    ProfileReport report;
+    int64_t t0 = nowUs();
+    issueProfileLocked(deviceID, profile, report);
+    report.elapsedUs = nowUs() - t0;
+    lastProfileReport = report;
+    return report;
+}
+
+#endif
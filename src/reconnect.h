@@ -0,0 +1,208 @@
+#ifndef TDK_RECONNECT_H
+#define TDK_RECONNECT_H
+
+// Reconnect watchdog.
+//
+// When auto-reconnect is on, issueCommand marks a device's link down on a
+// connection-class error (ERROR_CONNECTION, ERROR_EAITIMEOUT,
+// ERROR_FAILED_TO_WRITE). This thread then reconnects with the name/type the
+// device was opened with, maps the logical ID MATLAB holds onto whatever ID the
+// DLL hands back, and replays its configuration (end-on-zero-crossing, each
+// tactor's type), each tactor's last sig source, frequency and gain, and the
+// last SetTactors state. Attempts back off exponentially while the
+// device stays unreachable.
+
+#include "engine.h"
+#include "inflight.h"
+#include <algorithm>
+#include <map>
+#include <string>
+
+constexpr int64_t RECONNECT_POLL_US = 20000;        // Link check period without a fault wake-up
+constexpr int64_t RECONNECT_MIN_BACKOFF_US = 10000; // First retry delay after a failed attempt
+
+struct ReconnectTarget {
+    std::string name; // Port name given to Connect (e.g. 'COM9')
+    int type = 0;
+};
+
+struct ReconnectStats {
+    uint64_t outages = 0;    // Links seen going down
+    uint64_t reconnects = 0; // Successful reconnect + replay
+    uint64_t failures = 0;   // Failed attempts
+    int64_t lastOutageUs = 0;
+    int64_t maxOutageUs = 0;
+    int64_t totalOutageUs = 0;
+    int64_t lastReplayUs = 0; // Time spent replaying the shadow state
+    int lastError = 0;
+};
+
+inline std::mutex watchdogMutex; // Guards targets, stats and thread state; never held with tiMutex
+inline std::map<int, ReconnectTarget> reconnectTargets; // Logical deviceID -> how to reach it
+inline ReconnectStats reconnectStats;
+inline std::thread watchdogThread;
+inline bool watchdogRunning = false;
+inline int64_t reconnectMaxBackoffUs = 1000000;
+
+// Replay a device's shadow state. Caller holds tiMutex.
+inline int replayLinkLocked(int deviceID, int* errorCode) {
+    DeviceLink& link = deviceLinks[deviceID];
+    int device = physicalDeviceID(deviceID);
+    int result = UpdateTI();
+    if (link.freqTimeDelay >= 0 && result >= 0) result = SetFreqTimeDelay(device, link.freqTimeDelay != 0);
+    for (int t = 0; t <= ENGINE_MAX_TACTOR && result >= 0; t++) {
+        const TactorShadow& shadow = link.tactors[t];
+        if (shadow.type >= 0 && result >= 0) result = SetTactorType(device, 0, t, shadow.type);
+        if (shadow.sigSource >= 0 && result >= 0) result = ChangeSigSource(device, t, shadow.sigSource, 0);
+        if (shadow.freq >= 0 && result >= 0) result = ChangeFreq(device, t, shadow.freq, 0);
+        if (shadow.gain >= 0 && result >= 0) result = ChangeGain(device, t, shadow.gain, 0);
+    }
+    if (link.hasMask && result >= 0) {
+        unsigned char states[8];
+        packTactorStates(link.mask, states);
+        result = SetTactors(device, 0, states);
+    }
+    if (result < 0) *errorCode = GetLastEAIError();
+    return result;
+}
+
+// One reconnect attempt. Returns true once the device is back and replayed.
+// Close and Connect run under tiMutex like every other vendor call; commands
+// for the device meanwhile only update its shadow state, since its link is
+// already down.
+inline bool tryReconnect(int deviceID, const ReconnectTarget& target, int* errorCode,
+                         int64_t* outageUs, int64_t* replayUs) {
+    std::lock_guard<std::mutex> lock(tiMutex);
+    DeviceLink& link = deviceLinks[deviceID];
+    if (!link.down) return false; // Reopened or closed from MATLAB meanwhile
+    Close(physicalDeviceID(deviceID)); // Release the dead handle; errors expected here
+    int physicalID = Connect(target.name.c_str(), target.type, ackCallback());
+    if (physicalID < 0) {
+        *errorCode = GetLastEAIError();
+        return false;
+    }
+    link.physicalID = physicalID;
+    int64_t t0 = nowUs();
+    if (replayLinkLocked(deviceID, errorCode) < 0) return false;
+    int64_t now = nowUs();
+    *replayUs = now - t0;
+    *outageUs = now - link.downUs;
+    link.down = false;
+    return true;
+}
+
+inline void watchdogLoop() {
+    traceThreadName("watchdog");
+    rtThreadStart(RT_WATCHDOG);
+    int64_t backoffUs[ENGINE_MAX_DEVICES] = {};
+    int64_t nextAttemptUs[ENGINE_MAX_DEVICES] = {};
+    std::unique_lock<std::mutex> lock(watchdogMutex);
+    while (watchdogRunning) {
+        linkWake.wait_for(lock, std::chrono::microseconds(RECONNECT_POLL_US), [] {
+            return !watchdogRunning || linkFault.load(std::memory_order_acquire);
+        });
+        if (!watchdogRunning) break;
+        linkFault.store(false, std::memory_order_release);
+        std::map<int, ReconnectTarget> targets = reconnectTargets;
+        int64_t maxBackoffUs = reconnectMaxBackoffUs;
+        lock.unlock();
+
+        for (const auto& [deviceID, target] : targets) {
+            if (deviceID < 0 || deviceID >= ENGINE_MAX_DEVICES) continue;
+            bool down;
+            {
+                std::lock_guard<std::mutex> tiLock(tiMutex);
+                down = deviceLinks[deviceID].down;
+            }
+            if (!down) {
+                backoffUs[deviceID] = 0;
+                continue;
+            }
+            int64_t now = nowUs();
+            if (backoffUs[deviceID] == 0) {
+                std::lock_guard<std::mutex> statsLock(watchdogMutex);
+                reconnectStats.outages++;
+            } else if (now < nextAttemptUs[deviceID]) {
+                continue;
+            }
+            int errorCode = 0;
+            int64_t outageUs = 0;
+            int64_t replayUs = 0;
+            bool ok;
+            {
+                TRACE_SCOPE_ARG("reconnect", deviceID);
+                ok = tryReconnect(deviceID, target, &errorCode, &outageUs, &replayUs);
+            }
+            std::lock_guard<std::mutex> statsLock(watchdogMutex);
+            if (ok) {
+                backoffUs[deviceID] = 0;
+                reconnectStats.reconnects++;
+                reconnectStats.lastOutageUs = outageUs;
+                reconnectStats.totalOutageUs += outageUs;
+                reconnectStats.lastReplayUs = replayUs;
+                if (outageUs > reconnectStats.maxOutageUs) reconnectStats.maxOutageUs = outageUs;
+            } else {
+                backoffUs[deviceID] = backoffUs[deviceID] == 0 ? RECONNECT_MIN_BACKOFF_US
+                                                               : std::min(2 * backoffUs[deviceID], maxBackoffUs);
+                nextAttemptUs[deviceID] = nowUs() + backoffUs[deviceID];
+                reconnectStats.failures++;
+                reconnectStats.lastError = errorCode;
+            }
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    rtThreadExit(RT_WATCHDOG);
+}
+
+// Remember how to reach a newly connected device and reset its link state
+inline void watchDevice(int deviceID, const std::string& name, int type) {
+    {
+        std::lock_guard<std::mutex> lock(watchdogMutex);
+        reconnectTargets[deviceID] = {name, type};
+    }
+    if (deviceID < 0 || deviceID >= ENGINE_MAX_DEVICES) return;
+    std::lock_guard<std::mutex> lock(tiMutex);
+    deviceLinks[deviceID] = DeviceLink();
+}
+
+inline void startWatchdog(int64_t maxBackoffUs) {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    reconnectMaxBackoffUs = maxBackoffUs;
+    autoReconnect.store(true, std::memory_order_release);
+    if (!watchdogRunning) {
+        watchdogRunning = true;
+        watchdogThread = std::thread(watchdogLoop);
+    }
+}
+
+// Stop reconnecting. Links still down stay down until the device is reopened.
+inline void stopWatchdog() {
+    autoReconnect.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(watchdogMutex);
+        watchdogRunning = false;
+    }
+    linkWake.notify_all();
+    if (watchdogThread.joinable()) {
+        watchdogThread.join();
+    }
+}
+
+inline ReconnectStats getReconnectStats(int* linksDown = nullptr, uint64_t* dropped = nullptr) {
+    if (linksDown || dropped) {
+        std::lock_guard<std::mutex> lock(tiMutex);
+        int down = 0;
+        uint64_t total = 0;
+        for (const auto& link : deviceLinks) {
+            down += link.down ? 1 : 0;
+            total += link.dropped;
+        }
+        if (linksDown) *linksDown = down;
+        if (dropped) *dropped = total;
+    }
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    return reconnectStats;
+}
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef TDK_RING_H
+#define TDK_RING_H
+
+// Shared-memory command ring between tdkd (the device-owning daemon) and its
+// clients (the MEX in client mode, other processes).
+//
+// The ring lives in a POSIX shared-memory object (default "/tdk_ring"). Any
+// number of producers submit fixed-size 64-byte records; the daemon is the only
+// consumer. Slots carry a sequence number (bounded MPMC scheme, Vyukov), so a
+// producer claims a slot with one CAS on `tail` and publishes it by storing the
+// slot sequence; nothing is ever locked. The consumer sleeps on a futex in the
+// header when the ring is empty and producers wake it only if it is sleeping.
+//
+// Record layout (little-endian, offsets in bytes), for non-C++ clients:
+//    0  uint64 seq       slot sequence, owned by the ring
+//    8  int64  submitUs  CLOCK_MONOTONIC microseconds at submission
+//   16  uint8  type      CommandType (engine.h)
+//   17  uint8  flags     COMMAND_FLAG_* (engine.h)
+//   20  int32  deviceID, tacNum, value, endValue, duration, delay
+//   44  uint32 clientID  e.g. the client's pid
+//   48  uint64 mask      SetTactors states, tactor 1 == LSB
+
+#include "engine.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstring>
+#include <new>
+
+constexpr uint32_t RING_MAGIC = 0x52444B54; // "TKDR"
+constexpr uint32_t RING_VERSION = 1;
+constexpr uint32_t RING_CAPACITY = 4096;    // Must be a power of two
+constexpr int RING_MAX_DEVICES = 8;
+constexpr const char* RING_DEFAULT_NAME = "/tdk_ring";
+constexpr int64_t RING_STALE_US = 1000000;  // Daemon heartbeat older than this == not running
+
+struct RingRecord {
+    std::atomic<uint64_t> seq;
+    int64_t submitUs;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t deviceID;
+    int32_t tacNum;
+    int32_t value;
+    int32_t endValue;
+    int32_t duration;
+    int32_t delay;
+    uint32_t clientID;
+    uint64_t mask;
+    uint64_t pad;
+};
+static_assert(sizeof(RingRecord) == 64, "Ring records are 64 bytes");
+
+struct RingHeader {
+    uint32_t magic;      // Written last by the daemon, once the ring is ready
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t recordSize;
+    int32_t daemonPid;
+    int32_t deviceCount;
+    int32_t deviceIDs[RING_MAX_DEVICES]; // Devices the daemon has connected
+    alignas(64) std::atomic<uint64_t> tail; // Next slot producers claim
+    alignas(64) std::atomic<uint64_t> head; // Next slot the daemon reads
+    alignas(64) std::atomic<uint32_t> wakeWord; // Futex word, bumped on every submission
+    std::atomic<uint32_t> sleepers;
+    alignas(64) std::atomic<int64_t> heartbeatUs; // Daemon liveness
+    std::atomic<uint64_t> submitted;
+    std::atomic<uint64_t> full;      // Submissions refused because the ring was full
+    std::atomic<uint64_t> issued;
+    std::atomic<uint64_t> failed;
+    std::atomic<int32_t> lastError;
+    std::atomic<int64_t> maxLatencyUs; // Submit to issue
+    std::atomic<int64_t> totalLatencyUs;
+};
+
+struct SharedRing {
+    RingHeader header;
+    RingRecord records[RING_CAPACITY];
+};
+
+inline long futexCall(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+// Daemon side: create (or reset) the shared-memory object, map it, and publish
+// the connected device IDs
+inline SharedRing* createRing(const char* name, const int* deviceIDs, int deviceCount) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0660);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, sizeof(SharedRing)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return nullptr;
+    std::memset(mem, 0, sizeof(SharedRing));
+    SharedRing* ring = new (mem) SharedRing;
+    for (uint32_t i = 0; i < RING_CAPACITY; i++) {
+        ring->records[i].seq.store(i, std::memory_order_relaxed);
+    }
+    ring->header.version = RING_VERSION;
+    ring->header.capacity = RING_CAPACITY;
+    ring->header.recordSize = sizeof(RingRecord);
+    ring->header.daemonPid = getpid();
+    ring->header.deviceCount = deviceCount < RING_MAX_DEVICES ? deviceCount : RING_MAX_DEVICES;
+    for (int i = 0; i < ring->header.deviceCount; i++) {
+        ring->header.deviceIDs[i] = deviceIDs[i];
+    }
+    ring->header.heartbeatUs.store(nowUs(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    reinterpret_cast<std::atomic<uint32_t>*>(&ring->header.magic)->store(RING_MAGIC, std::memory_order_release);
+    return ring;
+}
+
+// Client side: map an existing ring. Returns nullptr if it is missing or incompatible.
+inline SharedRing* openRing(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedRing)) {
+        close(fd);
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return nullptr;
+    SharedRing* ring = static_cast<SharedRing*>(mem);
+    uint32_t magic = reinterpret_cast<std::atomic<uint32_t>*>(&ring->header.magic)->load(std::memory_order_acquire);
+    if (magic != RING_MAGIC || ring->header.version != RING_VERSION ||
+        ring->header.capacity != RING_CAPACITY || ring->header.recordSize != sizeof(RingRecord)) {
+        munmap(mem, sizeof(SharedRing));
+        return nullptr;
+    }
+    return ring;
+}
+
+inline void closeRing(SharedRing* ring) {
+    if (ring) munmap(ring, sizeof(SharedRing));
+}
+
+inline bool daemonAlive(const SharedRing* ring) {
+    return nowUs() - ring->header.heartbeatUs.load(std::memory_order_relaxed) < RING_STALE_US;
+}
+
+// Producer: copy `record` (everything but seq) into the ring. False if full.
+inline bool ringPush(SharedRing* ring, const RingRecord& record) {
+    RingHeader& h = ring->header;
+    uint64_t pos = h.tail.load(std::memory_order_relaxed);
+    RingRecord* slot;
+    while (true) {
+        slot = &ring->records[pos & (RING_CAPACITY - 1)];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (h.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            h.full.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = h.tail.load(std::memory_order_relaxed);
+        }
+    }
+    std::memcpy(reinterpret_cast<char*>(slot) + sizeof(slot->seq),
+                reinterpret_cast<const char*>(&record) + sizeof(record.seq),
+                sizeof(RingRecord) - sizeof(record.seq));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    h.submitted.fetch_add(1, std::memory_order_relaxed);
+
+    h.wakeWord.fetch_add(1, std::memory_order_seq_cst);
+    if (h.sleepers.load(std::memory_order_seq_cst) != 0) {
+        futexCall(&h.wakeWord, FUTEX_WAKE, 1, nullptr);
+    }
+    return true;
+}
+
+// Consumer: take the next record. False if the ring is empty.
+inline bool ringPop(SharedRing* ring, RingRecord& out) {
+    RingHeader& h = ring->header;
+    uint64_t pos = h.head.load(std::memory_order_relaxed);
+    RingRecord& slot = ring->records[pos & (RING_CAPACITY - 1)];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != pos + 1) return false;
+    std::memcpy(reinterpret_cast<char*>(&out) + sizeof(out.seq),
+                reinterpret_cast<const char*>(&slot) + sizeof(slot.seq),
+                sizeof(RingRecord) - sizeof(slot.seq));
+    slot.seq.store(pos + RING_CAPACITY, std::memory_order_release);
+    h.head.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+inline bool ringEmpty(const SharedRing* ring) {
+    uint64_t pos = ring->header.head.load(std::memory_order_relaxed);
+    return ring->records[pos & (RING_CAPACITY - 1)].seq.load(std::memory_order_acquire) != pos + 1;
+}
+
+// Consumer: sleep until a producer submits something (or the timeout passes)
+inline void ringWait(SharedRing* ring, int64_t timeoutUs) {
+    RingHeader& h = ring->header;
+    h.sleepers.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t word = h.wakeWord.load(std::memory_order_seq_cst);
+    if (ringEmpty(ring)) {
+        timespec timeout = {static_cast<time_t>(timeoutUs / 1000000), static_cast<long>((timeoutUs % 1000000) * 1000)};
+        futexCall(&h.wakeWord, FUTEX_WAIT, word, &timeout);
+    }
+    h.sleepers.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+// Wake the consumer regardless of the ring state (shutdown)
+inline void ringWake(SharedRing* ring) {
+    ring->header.wakeWord.fetch_add(1, std::memory_order_seq_cst);
+    futexCall(&ring->header.wakeWord, FUTEX_WAKE, 1, nullptr);
+}
+
+// Fill a record for submission (records hold an atomic, so they are filled in place)
+inline void toRingRecord(const TactorCommand& cmd, uint8_t flags, RingRecord& record) {
+    std::memset(static_cast<void*>(&record), 0, sizeof(record));
+    record.submitUs = nowUs();
+    record.type = cmd.type;
+    record.flags = flags;
+    record.deviceID = cmd.deviceID;
+    record.tacNum = cmd.tacNum;
+    record.value = cmd.value;
+    record.endValue = cmd.endValue;
+    record.duration = cmd.duration;
+    record.delay = cmd.delay;
+    record.clientID = static_cast<uint32_t>(getpid());
+    record.mask = cmd.mask;
+}
+
+inline TactorCommand fromRingRecord(const RingRecord& record) {
+    TactorCommand cmd;
+    cmd.type = record.type;
+    cmd.deviceID = record.deviceID;
+    cmd.tacNum = record.tacNum;
+    cmd.value = record.value;
+    cmd.endValue = record.endValue;
+    cmd.duration = record.duration;
+    cmd.delay = record.delay;
+    cmd.mask = record.mask;
+    return cmd;
+}
+
+// Client side: the MEX (or any C++ client) attaches to the daemon's ring and
+// installs ringSink as the engine's command sink. Pushes can come from the
+// scheduler, heartbeat and watchdog threads; clientRingUsers counts those in
+// flight so detaching can wait them out before unmapping the ring.
+inline std::atomic<SharedRing*> clientRing{nullptr};
+inline std::atomic<int> clientRingUsers{0};
+
+inline int ringSink(const TactorCommand& cmd, uint8_t flags, int* errorCode) {
+    clientRingUsers.fetch_add(1);
+    SharedRing* ring = clientRing.load();
+    int result = 0;
+    RingRecord record;
+    if (!ring || !daemonAlive(ring)) {
+        if (errorCode) *errorCode = ENGINE_ERROR_NO_DAEMON;
+        result = -1;
+    } else {
+        toRingRecord(cmd, flags, record);
+        if (!ringPush(ring, record)) {
+            if (errorCode) *errorCode = ENGINE_ERROR_RING_FULL;
+            result = -1;
+        }
+    }
+    clientRingUsers.fetch_sub(1, std::memory_order_release);
+    return result;
+}
+
+// Take the ring away from the sink and wait for pushes still using it.
+// Returns the ring for the caller to unmap, or nullptr if none was attached.
+inline SharedRing* releaseClientRing() {
+    SharedRing* ring = clientRing.exchange(nullptr);
+    if (!ring) return nullptr;
+    while (clientRingUsers.load() > 0) {
+        std::this_thread::yield();
+    }
+    return ring;
+}
+
+#endif // __linux__
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef TDK_RT_H
+#define TDK_RT_H
+
+// Real-time configuration of the engine threads.
+//
+// Each engine thread has a role (scheduler, I/O, watchdog, daemon serve loop)
+// with a scheduling policy, priority and CPU affinity mask. A thread applies
+// its role's configuration when it starts (rtThreadStart), and configuring a
+// role applies it at once to the thread if it is running. Memory locking is
+// process-wide: 'engine' locks (and so faults in) the static buffers modules
+// register with registerRtRegion, 'all' calls mlockall. Nothing here is fatal:
+// what the OS refuses (SCHED_FIFO without CAP_SYS_NICE or an rtprio limit,
+// RLIMIT_MEMLOCK, ...) is recorded in the role's status and the thread keeps
+// running with what it has.
+//
+// Linux supports everything. Windows maps fifo/rr onto thread priorities and
+// locks regions with VirtualLock; mlockall has no equivalent there.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+enum RtRole : uint8_t {
+    RT_SCHEDULER = 0,
+    RT_IO,
+    RT_WATCHDOG,
+    RT_HEARTBEAT,
+    RT_SERVE, // tdkd's ring serve loop
+    RT_NUM_ROLES
+};
+
+enum RtPolicy : uint8_t {
+    RT_POLICY_NORMAL = 0, // SCHED_OTHER
+    RT_POLICY_FIFO,       // SCHED_FIFO
+    RT_POLICY_RR          // SCHED_RR
+};
+
+enum RtMemory : uint8_t {
+    RT_MEMORY_NONE = 0,
+    RT_MEMORY_ENGINE, // Lock registered engine buffers
+    RT_MEMORY_ALL     // mlockall(MCL_CURRENT | MCL_FUTURE)
+};
+
+inline const char* const rtRoleNames[RT_NUM_ROLES] = {"scheduler", "io", "watchdog", "heartbeat", "serve"};
+
+constexpr int RT_MAX_REGIONS = 16;
+constexpr size_t RT_STACK_PREFAULT_BYTES = 64 * 1024;
+
+struct RtConfig {
+    uint8_t policy = RT_POLICY_NORMAL;
+    int priority = 0;     // 1 - 99 for fifo/rr
+    uint64_t cpuMask = 0; // CPU n == bit n; 0 == any CPU
+};
+
+struct RtStatus {
+    bool running = false;  // Configuration was applied to a live thread
+    bool applied = false;  // Everything requested took effect
+    bool boosted = false;  // The live thread has a real-time policy from us
+    bool pinned = false;   // The live thread has an affinity mask from us
+    char message[128] = ""; // What the OS refused, if anything
+};
+
+struct RtRegion {
+    const void* address;
+    size_t bytes;
+};
+
+// Guarded by rtMutex
+inline std::mutex rtMutex;
+inline RtConfig rtConfigs[RT_NUM_ROLES];
+inline RtStatus rtStatus[RT_NUM_ROLES];
+inline uint8_t rtMemoryMode = RT_MEMORY_NONE;
+inline bool rtMemoryApplied = true;
+inline char rtMemoryMessage[128] = "";
+inline RtRegion rtRegions[RT_MAX_REGIONS];
+inline int numRtRegions = 0;
+
+// Register a static buffer for 'engine' memory locking (at static init)
+inline bool registerRtRegion(const void* address, size_t bytes) {
+    if (numRtRegions >= RT_MAX_REGIONS) return false;
+    rtRegions[numRtRegions++] = {address, bytes};
+    return true;
+}
+
+#if defined(_WIN32)
+using RtThreadHandle = HANDLE;
+inline RtThreadHandle rtCurrentThread() { return GetCurrentThread(); }
+#else
+using RtThreadHandle = pthread_t;
+inline RtThreadHandle rtCurrentThread() { return pthread_self(); }
+#endif
+
+// Append "what: reason" to a status message. `hint` says what usually fixes
+// a permission error.
+inline void rtAppendMessage(char* message, size_t size, const char* what, int error, const char* hint) {
+    size_t used = std::strlen(message);
+    if (used + 2 >= size) return;
+#if defined(_WIN32)
+    (void)hint;
+    std::snprintf(message + used, size - used, "%s%s failed (error %d)", used ? "; " : "", what, error);
+#else
+    bool permission = error == EPERM || error == ENOMEM || error == EAGAIN;
+    std::snprintf(message + used, size - used, "%s%s: %s%s", used ? "; " : "", what, std::strerror(error),
+                  permission ? hint : "");
+#endif
+}
+
+// Apply a role's configuration to a thread. Default settings are only
+// written back to a thread we changed, so an affinity inherited from the
+// process (taskset, MATLAB's -singleCompThread, ...) is left alone.
+// Caller holds rtMutex.
+inline void applyRtConfigLocked(RtThreadHandle thread, int role) {
+    const RtConfig& config = rtConfigs[role];
+    RtStatus& status = rtStatus[role];
+    status.running = true;
+    status.applied = true;
+    status.message[0] = '\0';
+    auto fail = [&](const char* what, int error) {
+        status.applied = false;
+        rtAppendMessage(status.message, sizeof(status.message), what, error, " (needs CAP_SYS_NICE or an rtprio limit)");
+    };
+#if defined(_WIN32)
+    if (config.policy != RT_POLICY_NORMAL || status.boosted) {
+        int priority = config.policy == RT_POLICY_FIFO ? THREAD_PRIORITY_TIME_CRITICAL
+                     : config.policy == RT_POLICY_RR ? THREAD_PRIORITY_HIGHEST
+                     : THREAD_PRIORITY_NORMAL;
+        if (!SetThreadPriority(thread, priority)) {
+            fail("SetThreadPriority", static_cast<int>(GetLastError()));
+        } else {
+            status.boosted = config.policy != RT_POLICY_NORMAL;
+        }
+    }
+    if (config.cpuMask || status.pinned) {
+        DWORD_PTR mask = static_cast<DWORD_PTR>(config.cpuMask);
+        if (!mask) {
+            DWORD_PTR systemMask = 0;
+            GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask);
+        }
+        if (!SetThreadAffinityMask(thread, mask)) {
+            fail("SetThreadAffinityMask", static_cast<int>(GetLastError()));
+        } else {
+            status.pinned = config.cpuMask != 0;
+        }
+    }
+#else
+    if (config.policy != RT_POLICY_NORMAL || status.boosted) {
+        sched_param param{};
+        int policy = SCHED_OTHER;
+        if (config.policy != RT_POLICY_NORMAL) {
+            policy = config.policy == RT_POLICY_FIFO ? SCHED_FIFO : SCHED_RR;
+            param.sched_priority = config.priority;
+        }
+        if (int error = pthread_setschedparam(thread, policy, &param)) {
+            fail("scheduling policy", error);
+        } else {
+            status.boosted = config.policy != RT_POLICY_NORMAL;
+        }
+    }
+    if (config.cpuMask || status.pinned) {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+            if (!config.cpuMask || (config.cpuMask >> cpu & 1)) CPU_SET(cpu, &cpus);
+        }
+        if (int error = pthread_setaffinity_np(thread, sizeof(cpus), &cpus)) {
+            fail("CPU affinity", error);
+        } else {
+            status.pinned = config.cpuMask != 0;
+        }
+#else
+        fail("CPU affinity", ENOTSUP);
+#endif
+    }
+#endif
+}
+
+// Lock or unlock memory per rtMemoryMode. Caller holds rtMutex.
+inline void applyRtMemoryLocked(uint8_t mode) {
+    rtMemoryApplied = true;
+    rtMemoryMessage[0] = '\0';
+    auto fail = [&](const char* what, int error) {
+        rtMemoryApplied = false;
+        rtAppendMessage(rtMemoryMessage, sizeof(rtMemoryMessage), what, error, " (raise RLIMIT_MEMLOCK)");
+    };
+#if defined(_WIN32)
+    if (rtMemoryMode != RT_MEMORY_NONE) {
+        for (int i = 0; i < numRtRegions; i++) VirtualUnlock(const_cast<void*>(rtRegions[i].address), rtRegions[i].bytes);
+    }
+    if (mode != RT_MEMORY_NONE) {
+        // Locked pages count against the working set minimum, so grow it first
+        SIZE_T lockBytes = 0;
+        for (int i = 0; i < numRtRegions; i++) lockBytes += rtRegions[i].bytes;
+        SIZE_T minimum = 0, maximum = 0;
+        if (GetProcessWorkingSetSize(GetCurrentProcess(), &minimum, &maximum)) {
+            SetProcessWorkingSetSize(GetCurrentProcess(), minimum + lockBytes, std::max(maximum, minimum + 2 * lockBytes));
+        }
+        for (int i = 0; i < numRtRegions; i++) {
+            if (!VirtualLock(const_cast<void*>(rtRegions[i].address), rtRegions[i].bytes)) {
+                fail("VirtualLock", static_cast<int>(GetLastError()));
+                break;
+            }
+        }
+        if (mode == RT_MEMORY_ALL) fail("mlockall (engine buffers locked instead)", ERROR_NOT_SUPPORTED);
+    }
+#else
+    if (rtMemoryMode == RT_MEMORY_ALL) munlockall();
+    if (rtMemoryMode == RT_MEMORY_ENGINE) {
+        for (int i = 0; i < numRtRegions; i++) munlock(rtRegions[i].address, rtRegions[i].bytes);
+    }
+    if (mode == RT_MEMORY_ENGINE) {
+        // mlock faults the pages in (writable private pages are populated for write)
+        for (int i = 0; i < numRtRegions; i++) {
+            if (mlock(rtRegions[i].address, rtRegions[i].bytes) != 0) {
+                fail("mlock", errno);
+                break;
+            }
+        }
+    } else if (mode == RT_MEMORY_ALL && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fail("mlockall", errno);
+    }
+#endif
+    rtMemoryMode = mode;
+}
+
+// Touch the top of the calling thread's stack so its first deep call doesn't
+// fault
+inline void prefaultStack() {
+    volatile unsigned char stack[RT_STACK_PREFAULT_BYTES];
+    for (size_t k = 0; k < sizeof(stack); k += 4096) stack[k] = 0;
+}
+
+// Called by each engine thread as it starts
+inline void rtThreadStart(int role) {
+    bool lockMemory;
+    {
+        std::lock_guard<std::mutex> lock(rtMutex);
+        applyRtConfigLocked(rtCurrentThread(), role);
+        lockMemory = rtMemoryMode != RT_MEMORY_NONE;
+    }
+    if (lockMemory) prefaultStack();
+}
+
+// Called by each engine thread before it exits
+inline void rtThreadExit(int role) {
+    std::lock_guard<std::mutex> lock(rtMutex);
+    rtStatus[role].running = false;
+    rtStatus[role].boosted = false;
+    rtStatus[role].pinned = false;
+}
+
+inline void resetRtConfig() {
+    std::lock_guard<std::mutex> lock(rtMutex);
+    if (rtMemoryMode != RT_MEMORY_NONE) applyRtMemoryLocked(RT_MEMORY_NONE);
+    for (auto& config : rtConfigs) config = RtConfig();
+    for (auto& status : rtStatus) status = RtStatus();
+    rtMemoryApplied = true;
+    rtMemoryMessage[0] = '\0';
+}
+
+#endif
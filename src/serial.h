@@ -0,0 +1,158 @@
+#ifndef TDK_SERIAL_H
+#define TDK_SERIAL_H
+
+// TDK serial wire format, shared by the termios backend (serial_backend.cpp)
+// and the pseudo-terminal stand-in device in tdkd's serial self-test.
+//
+// Every packet, in both directions, is framed as
+//
+//   STX (0x02) | length | command | payload... | checksum | ETX (0x03)
+//
+// where length counts the command byte and payload, and checksum is the XOR
+// of length, command and payload. Command bytes are the TDK_COMMAND_* values
+// in EAI_Defines.h; multi-byte fields are big-endian. The controller answers
+// each command with a packet carrying the same command byte and a status
+// byte (0 == accepted); ReadFW and the other queries answer with their data.
+//
+// Status: UNVERIFIED. EAI does not publish the wire protocol, and this framing
+// (STX/length/XOR/ETX) and the field layouts below are a reconstruction that
+// follows the DLL's API arguments in order. They have not been checked against
+// a capture of the DLL's traffic or against a controller. tdkd --serial-test
+// only shows that this encoder and its own decoder agree. That's why the MEX
+// only uses this backend when built with tdk.install(..., 'SerialBackend',
+// true), and warns once at connect.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+constexpr uint8_t SERIAL_STX = 0x02;
+constexpr uint8_t SERIAL_ETX = 0x03;
+constexpr int SERIAL_MAX_PAYLOAD = 32;
+constexpr int SERIAL_MAX_PACKET = SERIAL_MAX_PAYLOAD + 5; // STX, length, command, checksum, ETX
+constexpr uint8_t SERIAL_STATUS_OK = 0x00;
+
+// Builds one framed packet in place
+class SerialPacket {
+public:
+    explicit SerialPacket(uint8_t command) {
+        bytes_[0] = SERIAL_STX;
+        bytes_[2] = command;
+        size_ = 3;
+    }
+    SerialPacket& u8(int v) {
+        if (size_ < SERIAL_MAX_PACKET - 2) bytes_[size_++] = static_cast<uint8_t>(v);
+        return *this;
+    }
+    SerialPacket& u16(int v) { // Clamped into 0 - 65535
+        unsigned c = v < 0 ? 0u : v > 0xFFFF ? 0xFFFFu : static_cast<unsigned>(v);
+        return u8(static_cast<int>(c >> 8)).u8(static_cast<int>(c & 0xFF));
+    }
+    SerialPacket& bytes(const unsigned char* data, int count) {
+        for (int i = 0; i < count; i++) u8(data[i]);
+        return *this;
+    }
+    // Close the frame; returns the packet bytes and their count
+    const uint8_t* finish(size_t* size) {
+        bytes_[1] = static_cast<uint8_t>(size_ - 2);
+        uint8_t checksum = 0;
+        for (size_t i = 1; i < size_; i++) checksum ^= bytes_[i];
+        bytes_[size_] = checksum;
+        bytes_[size_ + 1] = SERIAL_ETX;
+        *size = size_ + 2;
+        return bytes_;
+    }
+
+private:
+    uint8_t bytes_[SERIAL_MAX_PACKET];
+    size_t size_;
+};
+
+// A decoded packet
+struct SerialFrame {
+    uint8_t command = 0;
+    uint8_t length = 0; // Payload bytes
+    uint8_t payload[SERIAL_MAX_PAYLOAD] = {};
+    int u16(int offset) const { return payload[offset] << 8 | payload[offset + 1]; }
+};
+
+// Incremental frame parser. Bytes can arrive split or merged anywhere; a bad
+// checksum, a missing ETX or an oversized length counts as an error and the
+// parser resynchronizes on the next STX.
+class SerialParser {
+public:
+    uint64_t frames = 0;
+    uint64_t errors = 0;
+
+    template <typename OnFrame>
+    void feed(const uint8_t* data, size_t count, OnFrame&& onFrame) {
+        for (size_t i = 0; i < count; i++) {
+            uint8_t b = data[i];
+            switch (state_) {
+                case WAIT_STX:
+                    if (b == SERIAL_STX) state_ = LENGTH;
+                    break;
+                case LENGTH:
+                    if (b < 1 || b > SERIAL_MAX_PAYLOAD + 1) {
+                        errors++;
+                        state_ = b == SERIAL_STX ? LENGTH : WAIT_STX;
+                        break;
+                    }
+                    length_ = b;
+                    checksum_ = b;
+                    got_ = 0;
+                    state_ = BODY;
+                    break;
+                case BODY:
+                    body_[got_++] = b;
+                    checksum_ ^= b;
+                    if (got_ == length_) state_ = CHECKSUM;
+                    break;
+                case CHECKSUM:
+                    state_ = b == checksum_ ? END : WAIT_STX;
+                    if (state_ == WAIT_STX) errors++;
+                    break;
+                case END:
+                    state_ = WAIT_STX;
+                    if (b != SERIAL_ETX) {
+                        errors++;
+                        if (b == SERIAL_STX) state_ = LENGTH;
+                        break;
+                    }
+                    SerialFrame frame;
+                    frame.command = body_[0];
+                    frame.length = static_cast<uint8_t>(length_ - 1);
+                    std::memcpy(frame.payload, body_ + 1, frame.length);
+                    frames++;
+                    onFrame(frame);
+                    break;
+            }
+        }
+    }
+
+private:
+    enum State : uint8_t { WAIT_STX, LENGTH, BODY, CHECKSUM, END };
+    State state_ = WAIT_STX;
+    uint8_t length_ = 0;
+    uint8_t checksum_ = 0;
+    uint8_t got_ = 0;
+    uint8_t body_[SERIAL_MAX_PAYLOAD + 1];
+};
+
+// Backend counters (serial_backend.cpp), for tdkd's serial self-test
+struct SerialCounters {
+    uint64_t packets;     // Command packets queued
+    uint64_t writes;      // write() calls that sent them
+    uint64_t bytes;       // Bytes written
+    uint64_t responses;   // Frames parsed from the device
+    uint64_t rejected;    // Responses with a non-zero status
+    uint64_t parseErrors; // Framing and checksum errors
+};
+
+SerialCounters serialCounters(); // Totals over every open and closed device
+
+// Called on the reader thread for every frame the device sends, if passed as
+// Connect's callback
+using SerialResponseCallback = void (*)(int deviceID, const SerialFrame& frame);
+
+#endif
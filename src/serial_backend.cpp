@@ -0,0 +1,518 @@
+// Native serial TactorInterface backend (Linux, macOS).
+//
+// Implements the TactorInterface.h API by encoding TDK packets itself
+// (serial.h) and talking to the controller's serial port through termios, so
+// the engine runs where the EAI DLLs don't. Link it in place of
+// TactorInterface.lib; tdk.install does this on Linux:
+//
+//   g++ -std=c++17 -O2 -DTDK_SERIAL_BACKEND -ITDK_API src/tdkd.cpp src/serial_backend.cpp -lpthread -lrt -o tdkd
+//
+// Device commands don't block on the port. Each call appends its packet to
+// the device's pending buffer, and the device's I/O thread hands everything
+// pending to one write(): commands issued while the previous write or a full
+// port was in progress go out together. The same thread parses responses,
+// counts rejections, and passes frames to the Connect callback. A hang-up or
+// I/O error marks the device failed, and later commands return
+// ERROR_CONNECTION so the engine's reconnect watchdog takes over.
+//
+// Connect takes a port path, optionally with a baud rate ("/dev/ttyUSB0",
+// "/dev/ttyACM0@921600"; default 115200). Discover lists /dev/ttyUSB* and
+// /dev/ttyACM*, plus any paths in TDK_SERIAL_PORTS (comma-separated).
+
+#include "TactorInterface.h"
+#include "EAI_Defines.h"
+#include "serial.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+std::atomic<unsigned long long> backendCommandCount{0}; // Device commands only (Pulse, ChangeGain, ...)
+
+namespace {
+
+constexpr int SERIAL_MAX_DEVICES = 8;
+constexpr int SERIAL_MAX_DISCOVERED = 16;
+constexpr size_t SERIAL_PENDING_BYTES = 64 * 1024;
+constexpr auto SERIAL_FULL_TIMEOUT = std::chrono::seconds(1); // Wait for buffer space before failing
+constexpr auto SERIAL_CLOSE_DRAIN = std::chrono::milliseconds(200);
+
+struct SerialDevice {
+    int fd = -1;
+    int wakeFds[2] = {-1, -1}; // Self-pipe: pending data or shutdown
+    std::thread io;
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::vector<uint8_t> pending; // Guarded by mutex
+    bool stopping = false;        // Guarded by mutex
+    std::atomic<bool> failed{false};
+    SerialResponseCallback callback = nullptr;
+    std::atomic<uint64_t> packets{0}, writes{0}, bytes{0}, responses{0}, rejected{0}, parseErrors{0};
+};
+
+std::mutex apiMutex; // Guards the device table and discovery list
+SerialDevice* devices[SERIAL_MAX_DEVICES] = {};
+std::vector<std::string> discovered;
+SerialCounters closedTotals = {};
+std::atomic<int> lastError{0};
+std::atomic<int> timeFactor{1};
+bool initialized = false;
+
+int fail(int errorCode) {
+    lastError = errorCode;
+    return -1;
+}
+
+speed_t baudConstant(long baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+        default: return 0;
+    }
+}
+
+// Open and configure a port: raw 8N1, no flow control, non-blocking
+int openPort(const char* name) {
+    std::string path = name;
+    long baud = 115200;
+    size_t at = path.rfind('@');
+    if (at != std::string::npos) {
+        baud = std::atol(path.c_str() + at + 1);
+        path.resize(at);
+    }
+    speed_t speed = baudConstant(baud);
+    if (!speed) return -1;
+    int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+    termios tio{};
+    if (tcgetattr(fd, &tio) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+void wake(SerialDevice& device) {
+    uint8_t b = 1;
+    while (::write(device.wakeFds[1], &b, 1) < 0 && errno == EINTR) {
+    }
+}
+
+// Per-device I/O thread: one write() for everything pending, responses parsed
+// as they arrive
+void ioLoop(SerialDevice* device, int deviceID) {
+    SerialParser parser;
+    std::vector<uint8_t> out; // Being written; swapped with pending
+    size_t written = 0;
+    uint8_t in[512];
+    bool stopping = false;
+    auto stopAt = std::chrono::steady_clock::time_point::max();
+    while (!device->failed.load(std::memory_order_relaxed)) {
+        if (written == out.size()) {
+            out.clear();
+            written = 0;
+            std::lock_guard<std::mutex> lock(device->mutex);
+            out.swap(device->pending);
+            stopping = device->stopping;
+            device->drained.notify_all();
+        }
+        bool sending = written < out.size();
+        if (stopping && (!sending || std::chrono::steady_clock::now() >= stopAt)) break;
+        if (stopping && stopAt == std::chrono::steady_clock::time_point::max()) {
+            stopAt = std::chrono::steady_clock::now() + SERIAL_CLOSE_DRAIN;
+        }
+        pollfd fds[2] = {{device->fd, static_cast<short>(POLLIN | (sending ? POLLOUT : 0)), 0},
+                         {device->wakeFds[0], POLLIN, 0}};
+        if (::poll(fds, 2, stopping ? 10 : -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint8_t drain[64];
+            while (::read(device->wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t n = ::read(device->fd, in, sizeof(in));
+            if (n > 0) {
+                parser.feed(in, static_cast<size_t>(n), [&](const SerialFrame& frame) {
+                    device->responses++;
+                    if (frame.length == 1 && frame.payload[0] != SERIAL_STATUS_OK) device->rejected++;
+                    if (device->callback) device->callback(deviceID, frame);
+                });
+                device->parseErrors = parser.errors;
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                device->failed = true;
+            }
+        }
+        if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) device->failed = true;
+        if (sending && (fds[0].revents & POLLOUT)) {
+            ssize_t n = ::write(device->fd, out.data() + written, out.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+                device->writes++;
+                device->bytes += static_cast<uint64_t>(n);
+            } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                device->failed = true;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    device->pending.clear();
+    device->drained.notify_all();
+}
+
+// Callers serialize device commands against Close (the engine holds tiMutex
+// around every vendor call), as with the DLL
+SerialDevice* deviceFor(int deviceID) {
+    if (deviceID < 0 || deviceID >= SERIAL_MAX_DEVICES) return nullptr;
+    return devices[deviceID];
+}
+
+// Queue one packet for the device's I/O thread
+int send(int deviceID, SerialPacket& packet) {
+    if (!initialized) return fail(ERROR_NOINIT);
+    SerialDevice* device = deviceFor(deviceID);
+    if (!device || device->failed.load(std::memory_order_relaxed)) return fail(ERROR_CONNECTION);
+    size_t size;
+    const uint8_t* bytes = packet.finish(&size);
+    bool wasEmpty;
+    {
+        std::unique_lock<std::mutex> lock(device->mutex);
+        if (device->pending.size() + size > SERIAL_PENDING_BYTES &&
+            !device->drained.wait_for(lock, SERIAL_FULL_TIMEOUT, [&] {
+                return device->pending.size() + size <= SERIAL_PENDING_BYTES || device->failed.load();
+            })) {
+            return fail(ERROR_EAITIMEOUT);
+        }
+        if (device->failed.load()) return fail(ERROR_CONNECTION);
+        wasEmpty = device->pending.empty();
+        device->pending.insert(device->pending.end(), bytes, bytes + size);
+    }
+    if (wasEmpty) wake(*device); // Later packets ride along with this wake-up
+    device->packets++;
+    backendCommandCount++;
+    return 0;
+}
+
+// Delays are scaled by the time factor, as the DLL does
+int scaledDelay(int delay) {
+    return delay * timeFactor.load(std::memory_order_relaxed);
+}
+
+void closeDevice(int deviceID) {
+    SerialDevice* device = devices[deviceID];
+    devices[deviceID] = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(device->mutex);
+        device->stopping = true;
+    }
+    wake(*device);
+    device->io.join();
+    ::close(device->fd);
+    ::close(device->wakeFds[0]);
+    ::close(device->wakeFds[1]);
+    closedTotals.packets += device->packets;
+    closedTotals.writes += device->writes;
+    closedTotals.bytes += device->bytes;
+    closedTotals.responses += device->responses;
+    closedTotals.rejected += device->rejected;
+    closedTotals.parseErrors += device->parseErrors;
+    delete device;
+}
+
+void addPorts(const char* pattern) {
+    glob_t found;
+    if (glob(pattern, 0, nullptr, &found) == 0) {
+        for (size_t i = 0; i < found.gl_pathc && discovered.size() < SERIAL_MAX_DISCOVERED; i++) {
+            discovered.push_back(found.gl_pathv[i]);
+        }
+    }
+    globfree(&found);
+}
+
+} // namespace
+
+SerialCounters serialCounters() {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    SerialCounters totals = closedTotals;
+    for (SerialDevice* device : devices) {
+        if (!device) continue;
+        totals.packets += device->packets;
+        totals.writes += device->writes;
+        totals.bytes += device->bytes;
+        totals.responses += device->responses;
+        totals.rejected += device->rejected;
+        totals.parseErrors += device->parseErrors;
+    }
+    return totals;
+}
+
+int InitializeTI() {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    initialized = true;
+    return 0;
+}
+
+int ShutdownTI() {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    for (int i = 0; i < SERIAL_MAX_DEVICES; i++) {
+        if (devices[i]) closeDevice(i);
+    }
+    initialized = false;
+    return 0;
+}
+
+const char* GetVersionNumber() {
+    return "serial";
+}
+
+int Connect(const char* name, int type, void* _callback) {
+    (void)type;
+    std::lock_guard<std::mutex> lock(apiMutex);
+    if (!initialized) return fail(ERROR_NOINIT);
+    if (!name) return fail(ERROR_BADPARAMETER);
+    int slot = -1;
+    for (int i = 0; i < SERIAL_MAX_DEVICES && slot < 0; i++) {
+        if (!devices[i]) slot = i;
+    }
+    if (slot < 0) return fail(ERROR_TM_MAX_CONTROLLER_LIMIT_REACHED);
+    int fd = openPort(name);
+    if (fd < 0) return fail(ERROR_CONNECTION);
+    SerialDevice* device = new SerialDevice;
+    device->fd = fd;
+    device->callback = reinterpret_cast<SerialResponseCallback>(_callback);
+    device->pending.reserve(SERIAL_PENDING_BYTES);
+    if (::pipe(device->wakeFds) != 0) {
+        ::close(fd);
+        delete device;
+        return fail(ERROR_INTERNALERROR);
+    }
+    for (int wakeFd : device->wakeFds) {
+        ::fcntl(wakeFd, F_SETFL, O_NONBLOCK);
+        ::fcntl(wakeFd, F_SETFD, FD_CLOEXEC);
+    }
+    device->io = std::thread(ioLoop, device, slot);
+    devices[slot] = device;
+    return slot;
+}
+
+int Discover(int type) {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    if (!initialized) return fail(ERROR_NOINIT);
+    discovered.clear();
+    if (!(type & DEVICE_TYPE_SERIAL)) return 0;
+    if (const char* env = std::getenv("TDK_SERIAL_PORTS")) {
+        std::string list = env;
+        size_t start = 0;
+        while (start < list.size() && discovered.size() < SERIAL_MAX_DISCOVERED) {
+            size_t comma = list.find(',', start);
+            if (comma == std::string::npos) comma = list.size();
+            if (comma > start) discovered.push_back(list.substr(start, comma - start));
+            start = comma + 1;
+        }
+    }
+    addPorts("/dev/ttyUSB*");
+    addPorts("/dev/ttyACM*");
+    return static_cast<int>(discovered.size());
+}
+
+int DiscoverLimited(int type, int amount) {
+    int found = Discover(type);
+    if (found < 0) return found;
+    std::lock_guard<std::mutex> lock(apiMutex);
+    if (amount >= 0 && found > amount) discovered.resize(amount);
+    return static_cast<int>(discovered.size());
+}
+
+const char* GetDiscoveredDeviceName(int index) {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    if (index < 0 || index >= static_cast<int>(discovered.size())) {
+        lastError = ERROR_BADPARAMETER;
+        return nullptr;
+    }
+    return discovered[index].c_str();
+}
+
+int GetDiscoveredDeviceType(int index) {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    return index >= 0 && index < static_cast<int>(discovered.size()) ? DEVICE_TYPE_SERIAL : 0;
+}
+
+int Close(int deviceID) {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    if (!deviceFor(deviceID)) return fail(ERROR_BADPARAMETER);
+    closeDevice(deviceID);
+    return 0;
+}
+
+int CloseAll() {
+    std::lock_guard<std::mutex> lock(apiMutex);
+    for (int i = 0; i < SERIAL_MAX_DEVICES; i++) {
+        if (devices[i]) closeDevice(i);
+    }
+    return 0;
+}
+
+int Pulse(int deviceID, int _tacNum, int _msDuration, int _delay) {
+    SerialPacket packet(TDK_COMMAND_PULSE);
+    packet.u8(_tacNum).u16(_msDuration).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int SendActionWait(int deviceID, int _msDuration, int _delay) {
+    SerialPacket packet(TDK_COMMAND_ACTION_WAIT);
+    packet.u16(_msDuration).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ChangeGain(int deviceID, int _tacNum, int gainval, int _delay) {
+    SerialPacket packet(TDK_COMMAND_GAIN);
+    packet.u8(_tacNum).u8(gainval).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ChangeFreq(int deviceID, int _tacNum, int freqVal, int _delay) {
+    SerialPacket packet(TDK_COMMAND_FREQ);
+    packet.u8(_tacNum).u16(freqVal).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+// Ramps share one command byte; the first payload byte says what is ramped
+int RampGain(int deviceID, int _tacNum, int _gainStart, int _gainEnd, int _duration, int _func, int _delay) {
+    SerialPacket packet(TDK_COMMAND_RAMP);
+    packet.u8(TDK_COMMAND_GAIN).u8(_tacNum).u16(_gainStart).u16(_gainEnd).u16(_duration).u8(_func).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int RampFreq(int deviceID, int _tacNum, int _freqStart, int _freqEnd, int _duration, int _func, int _delay) {
+    SerialPacket packet(TDK_COMMAND_RAMP);
+    packet.u8(TDK_COMMAND_FREQ).u8(_tacNum).u16(_freqStart).u16(_freqEnd).u16(_duration).u8(_func).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ChangeSigSource(int deviceID, int _tacNum, int _type, int _delay) {
+    SerialPacket packet(TDK_COMMAND_SETSIGSOURCE);
+    packet.u8(_tacNum).u8(_type).u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ReadFW(int deviceID) {
+    SerialPacket packet(TDK_COMMAND_READFW);
+    return send(deviceID, packet);
+}
+
+int TactorSelfTest(int deviceID, int _delay) {
+    SerialPacket packet(TDK_COMMAND_SELFTEST);
+    packet.u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ReadSegmentList(int deviceID, int _delay) {
+    SerialPacket packet(TDK_COMMAND_GETSEGMENTLIST);
+    packet.u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int ReadBatteryLevel(int deviceID, int _delay) {
+    SerialPacket packet(TDK_COMMAND_READ_BAT_DATA);
+    packet.u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int Stop(int deviceID, int _delay) {
+    SerialPacket packet(TDK_COMMAND_STOP);
+    packet.u16(scaledDelay(_delay));
+    return send(deviceID, packet);
+}
+
+int SetTactors(int device_id, int delay, unsigned char* states) {
+    if (!states) return fail(ERROR_BADPARAMETER);
+    SerialPacket packet(TDK_COMMAND_SET_TACTORS);
+    packet.u16(scaledDelay(delay)).bytes(states, 8);
+    return send(device_id, packet);
+}
+
+int SetTactorType(int device_id, int delay, int tactor, int type) {
+    SerialPacket packet(TDK_COMMAND_SET_TACTOR_TYPE);
+    packet.u8(tactor).u8(type).u16(scaledDelay(delay));
+    return send(device_id, packet);
+}
+
+int BeginStoreTAction(int _deviceID, int tacID) {
+    SerialPacket packet(TDK_COMMAND_TACTION_START);
+    packet.u8(tacID);
+    return send(_deviceID, packet);
+}
+
+int FinishStoreTAction(int _deviceID) {
+    SerialPacket packet(TDK_COMMAND_TACTION_END);
+    return send(_deviceID, packet);
+}
+
+int PlayStoredTAction(int _deviceID, int _delay, int tacId) {
+    SerialPacket packet(TDK_COMMAND_TACTION_PLAY);
+    packet.u8(tacId).u16(scaledDelay(_delay));
+    return send(_deviceID, packet);
+}
+
+int SetFreqTimeDelay(int _deviceID, bool _delayOn) {
+    SerialPacket packet(TDK_COMMAND_SET_FREQ_TIME_DELAY);
+    packet.u8(_delayOn ? 1 : 0);
+    return send(_deviceID, packet);
+}
+
+// Responses are handled on the I/O threads, and a failed port shows up on its
+// next command, so there is nothing to pump here
+int UpdateTI() {
+    return initialized ? 0 : fail(ERROR_NOINIT);
+}
+
+int GetLastEAIError() {
+    return lastError;
+}
+
+int SetLastEAIError(int e) {
+    lastError = e;
+    return 0;
+}
+
+int SetTimeFactor(int value) {
+    if (value < 1 || value > 255) return fail(ERROR_BADPARAMETER);
+    timeFactor = value;
+    return 0;
+}
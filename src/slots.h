@@ -0,0 +1,87 @@
+#ifndef TDK_SLOTS_H
+#define TDK_SLOTS_H
+
+// Pre-armed command slots.
+//
+// 'arm' decodes and validates a command (or a short sequence) once and stores
+// the ready-to-issue TactorCommands in a slot. Firing a slot skips all argument
+// handling: it takes the priority lane, holds the vendor lock once, runs UpdateTI
+// if any armed command needs it, and issues the prepared calls back to back.
+// Fired commands bypass the I/O queue and flow control.
+
+#include "engine.h"
+
+constexpr int ARM_SLOTS = 64;        // Slots 1 - 64
+constexpr int ARM_MAX_COMMANDS = 16; // Commands per slot
+
+struct ArmedSlot {
+    int count = 0;       // 0 == not armed
+    bool update = false; // Run UpdateTI before the first command
+    TactorCommand cmds[ARM_MAX_COMMANDS];
+    uint64_t fires = 0;
+};
+
+struct FireStats {
+    uint64_t fires = 0;
+    uint64_t failed = 0;
+    int64_t lastLatencyUs = 0; // MEX entry to the first vendor call
+    int64_t maxLatencyUs = 0;
+    int64_t totalLatencyUs = 0;
+};
+
+// Slots and fire statistics are only touched from the MATLAB thread
+inline ArmedSlot armedSlots[ARM_SLOTS];
+inline const bool armedSlotsLockable = registerRtRegion(armedSlots, sizeof(armedSlots));
+inline FireStats fireStats;
+
+// Issue everything armed in a slot (0-indexed). callUs is when the request
+// entered the MEX. Returns -1 with *errorCode set if a vendor call failed.
+inline int fireSlot(int slot, int64_t callUs, int* errorCode) {
+    ArmedSlot& armed = armedSlots[slot];
+    int result = 0;
+    int64_t issueUs;
+    if (CommandSink sink = commandSink.load(std::memory_order_acquire)) {
+        uint8_t flags = COMMAND_FLAG_URGENT | (armed.update ? COMMAND_FLAG_UPDATE : 0);
+        for (int i = 0; i < armed.count && result >= 0; i++) {
+            result = sink(armed.cmds[i], flags, errorCode);
+            flags &= ~COMMAND_FLAG_UPDATE; // Once per fire, as below
+        }
+        armed.fires++;
+        fireStats.fires++;
+        if (result < 0) fireStats.failed++;
+        return result; // Latency is measured by the daemon
+    }
+    urgentPending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(tiMutex);
+        issueUs = nowUs();
+        if (armed.update && UpdateTI() < 0) {
+            *errorCode = GetLastEAIError();
+            result = -1;
+        }
+        for (int i = 0; i < armed.count && result >= 0; i++) {
+            if (isHalted(armed.cmds[i])) {
+                haltDropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            result = issueTrackedLocked(armed.cmds[i], errorCode);
+        }
+    }
+    urgentPending.fetch_sub(1, std::memory_order_acq_rel);
+
+    int64_t latency = issueUs - callUs;
+    armed.fires++;
+    fireStats.fires++;
+    if (result < 0) fireStats.failed++;
+    fireStats.lastLatencyUs = latency;
+    fireStats.totalLatencyUs += latency;
+    if (latency > fireStats.maxLatencyUs) fireStats.maxLatencyUs = latency;
+    return result;
+}
+
+inline void clearArmedSlots() {
+    for (auto& slot : armedSlots) slot = ArmedSlot();
+    fireStats = FireStats();
+}
+
+#endif
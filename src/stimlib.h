@@ -0,0 +1,305 @@
+#ifndef TDK_STIMLIB_H
+#define TDK_STIMLIB_H
+
+// Memory-mapped stimulus library.
+//
+// A library file holds precomputed gain envelopes (one gain track per channel,
+// channel c drives tactor + c) written by tdk.writeStimulusLibrary. The MEX
+// maps the file read-only and never copies it: opening checks the fixed-size
+// header only, so a multi-GB library opens in constant time and pages are read
+// on first touch. Stimuli are found by ID or name through two open-addressing
+// hash tables in the file, and the "stimulus" pattern plays one by reading its
+// rows straight from the mapping, sending ChangeGain only for channels that
+// changed since the previous row.
+//
+// File layout (little-endian, offsets in bytes):
+//   Header (64)
+//      0  char[8] magic      "TDKSTIM" + NUL
+//      8  uint32  version
+//     12  uint32  count      number of stimuli
+//     16  uint32  slots      hash table size (power of two, > count)
+//     24  uint64  entriesOffset, idSlotsOffset, nameSlotsOffset, dataOffset
+//     56  uint64  fileSize
+//   Entries (64 each)
+//      0  uint32  id
+//      4  uint32  numSamples
+//      8  uint64  offset     of the samples from the start of the file
+//     16  uint16  channels   1 - 64
+//     20  uint32  sampleRate Hz
+//     24  uint32  nameHash   FNV-1a of the name
+//     28  char[36] name      NUL padded
+//   ID slots, name slots (uint32 each): entry index + 1, 0 == empty; linear
+//   probing from FNV-1a(id as 4 bytes) and FNV-1a(name)
+//   Data: uint8 gains, sample-major (channels bytes per sample)
+
+#include "patterns.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char STIMLIB_MAGIC[8] = {'T', 'D', 'K', 'S', 'T', 'I', 'M', '\0'};
+constexpr uint32_t STIMLIB_VERSION = 1;
+constexpr int STIMLIB_NAME_CHARS = 36;
+constexpr uint32_t STIMLIB_MAX_RATE = 1000; // Hz; rows are sent from the 1 kHz pattern tick
+constexpr int STIMLIB_MAX_LOOPS = 1000000;  // Repetitions per playStimulus call
+
+struct StimulusHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t slots;
+    uint32_t reserved;
+    uint64_t entriesOffset;
+    uint64_t idSlotsOffset;
+    uint64_t nameSlotsOffset;
+    uint64_t dataOffset;
+    uint64_t fileSize;
+};
+
+struct StimulusEntry {
+    uint32_t id;
+    uint32_t numSamples;
+    uint64_t offset;
+    uint16_t channels;
+    uint16_t reserved;
+    uint32_t sampleRate;
+    uint32_t nameHash;
+    char name[STIMLIB_NAME_CHARS];
+};
+
+static_assert(sizeof(StimulusHeader) == 64, "Stimulus library header layout");
+static_assert(sizeof(StimulusEntry) == 64, "Stimulus library entry layout");
+
+struct StimulusLibrary {
+    const unsigned char* base = nullptr;
+    uint64_t size = 0;
+    const StimulusHeader* header = nullptr;
+    const StimulusEntry* entries = nullptr;
+    const uint32_t* idSlots = nullptr;
+    const uint32_t* nameSlots = nullptr;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// The open library, guarded by patternMutex (playback reads it from the
+// pattern tick)
+inline StimulusLibrary stimLibrary;
+inline uint64_t stimuliPlayed = 0;
+
+inline uint32_t fnv1a(const void* data, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+inline uint32_t stimulusIDHash(uint32_t id) {
+    unsigned char bytes[4] = {static_cast<unsigned char>(id), static_cast<unsigned char>(id >> 8),
+                              static_cast<unsigned char>(id >> 16), static_cast<unsigned char>(id >> 24)};
+    return fnv1a(bytes, 4);
+}
+
+inline void unmapStimulusLibrary(StimulusLibrary& lib) {
+#if defined(_WIN32)
+    if (lib.base) UnmapViewOfFile(lib.base);
+    if (lib.mapping) CloseHandle(lib.mapping);
+    if (lib.file != INVALID_HANDLE_VALUE) CloseHandle(lib.file);
+#else
+    if (lib.base) munmap(const_cast<unsigned char*>(lib.base), lib.size);
+#endif
+    lib = StimulusLibrary();
+}
+
+// Map a library read-only and check its header. Only the header page is
+// touched. Returns nullptr on success, otherwise what went wrong.
+inline const char* mapStimulusLibrary(const char* path, StimulusLibrary& lib) {
+    lib = StimulusLibrary();
+#if defined(_WIN32)
+    lib.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (lib.file == INVALID_HANDLE_VALUE) return "can't open the file";
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(lib.file, &fileSize)) {
+        unmapStimulusLibrary(lib);
+        return "can't read the file size";
+    }
+    lib.size = static_cast<uint64_t>(fileSize.QuadPart);
+    if (lib.size < sizeof(StimulusHeader)) {
+        unmapStimulusLibrary(lib);
+        return "file is too short";
+    }
+    lib.mapping = CreateFileMappingA(lib.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!lib.mapping) {
+        unmapStimulusLibrary(lib);
+        return "can't map the file";
+    }
+    lib.base = static_cast<const unsigned char*>(MapViewOfFile(lib.mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!lib.base) {
+        unmapStimulusLibrary(lib);
+        return "can't map the file";
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return "can't open the file";
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return "can't read the file size";
+    }
+    lib.size = static_cast<uint64_t>(info.st_size);
+    if (lib.size < sizeof(StimulusHeader)) {
+        close(fd);
+        return "file is too short";
+    }
+    void* mem = mmap(nullptr, lib.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return "can't map the file";
+    lib.base = static_cast<const unsigned char*>(mem);
+#endif
+    const StimulusHeader* h = reinterpret_cast<const StimulusHeader*>(lib.base);
+    auto tableFits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % 4 == 0 && offset <= lib.size && bytes <= lib.size - offset;
+    };
+    const char* problem = nullptr;
+    if (std::memcmp(h->magic, STIMLIB_MAGIC, sizeof(STIMLIB_MAGIC)) != 0) {
+        problem = "not a stimulus library";
+    } else if (h->version != STIMLIB_VERSION) {
+        problem = "unsupported library version";
+    } else if (h->fileSize != lib.size) {
+        problem = "file size doesn't match the header (truncated?)";
+    } else if (h->slots == 0 || (h->slots & (h->slots - 1)) != 0 || h->slots <= h->count ||
+               !tableFits(h->entriesOffset, static_cast<uint64_t>(h->count) * sizeof(StimulusEntry)) ||
+               !tableFits(h->idSlotsOffset, static_cast<uint64_t>(h->slots) * 4) ||
+               !tableFits(h->nameSlotsOffset, static_cast<uint64_t>(h->slots) * 4)) {
+        problem = "corrupt index";
+    }
+    if (problem) {
+        unmapStimulusLibrary(lib);
+        return problem;
+    }
+    lib.header = h;
+    lib.entries = reinterpret_cast<const StimulusEntry*>(lib.base + h->entriesOffset);
+    lib.idSlots = reinterpret_cast<const uint32_t*>(lib.base + h->idSlotsOffset);
+    lib.nameSlots = reinterpret_cast<const uint32_t*>(lib.base + h->nameSlotsOffset);
+    return nullptr;
+}
+
+// An entry is checked when it is looked up rather than when the library
+// opens, so opening stays O(1)
+inline const StimulusEntry* checkedStimulusEntry(const StimulusLibrary& lib, uint32_t slot) {
+    if (slot == 0 || slot > lib.header->count) return nullptr;
+    const StimulusEntry* e = &lib.entries[slot - 1];
+    uint64_t bytes = static_cast<uint64_t>(e->numSamples) * e->channels;
+    if (e->channels == 0 || e->channels > ENGINE_MAX_TACTOR || e->sampleRate == 0 ||
+        e->sampleRate > STIMLIB_MAX_RATE || e->offset > lib.size || bytes > lib.size - e->offset) {
+        return nullptr;
+    }
+    return e;
+}
+
+// O(1) expected: probe the ID table from the ID's hash
+inline const StimulusEntry* findStimulus(const StimulusLibrary& lib, uint32_t id) {
+    if (!lib.header) return nullptr;
+    uint32_t mask = lib.header->slots - 1;
+    for (uint32_t i = stimulusIDHash(id) & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        uint32_t slot = lib.idSlots[i];
+        if (slot == 0) return nullptr;
+        if (slot <= lib.header->count && lib.entries[slot - 1].id == id) return checkedStimulusEntry(lib, slot);
+    }
+    return nullptr;
+}
+
+inline const StimulusEntry* findStimulus(const StimulusLibrary& lib, const char* name) {
+    if (!lib.header) return nullptr;
+    size_t length = std::strlen(name);
+    if (length >= STIMLIB_NAME_CHARS) return nullptr;
+    uint32_t hash = fnv1a(name, length);
+    uint32_t mask = lib.header->slots - 1;
+    for (uint32_t i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        uint32_t slot = lib.nameSlots[i];
+        if (slot == 0) return nullptr;
+        if (slot > lib.header->count) continue;
+        const StimulusEntry& e = lib.entries[slot - 1];
+        if (e.nameHash == hash && std::strncmp(e.name, name, STIMLIB_NAME_CHARS) == 0) {
+            return checkedStimulusEntry(lib, slot);
+        }
+    }
+    return nullptr;
+}
+
+inline const uint8_t* stimulusSamples(const StimulusLibrary& lib, const StimulusEntry& e) {
+    return lib.base + e.offset;
+}
+
+// Read one byte per page so playback doesn't take page faults on the
+// scheduler thread. Called from MATLAB before launching.
+inline void prefetchStimulus(const StimulusLibrary& lib, const StimulusEntry& e) {
+    const volatile uint8_t* p = stimulusSamples(lib, e);
+    uint64_t bytes = static_cast<uint64_t>(e.numSamples) * e.channels;
+    uint8_t sink = 0;
+    for (uint64_t k = 0; k < bytes; k += 4096) sink ^= p[k];
+    if (bytes > 0) sink ^= p[bytes - 1];
+    (void)sink;
+}
+
+// Close the library. Playing stimuli read its pages, so they are cancelled
+// first. Caller holds patternMutex.
+inline void closeStimulusLibraryLocked() {
+    if (!stimLibrary.base) return;
+    int pattern = findPattern("stimulus");
+    if (pattern >= 0) cancelPatternsLocked(0, pattern);
+    unmapStimulusLibrary(stimLibrary);
+}
+
+// [id, gainScale 1, loops 1]: play a library stimulus from tactor onwards.
+// Rows are scheduled from the start time, so fractional sample periods don't
+// drift.
+inline Pattern stimulusPattern(PatternContext& ctx) {
+    const StimulusEntry* entry = findStimulus(stimLibrary, static_cast<uint32_t>(ctx.param(0, 0)));
+    if (!entry) co_return;
+    stimuliPlayed++;
+    const uint8_t* samples = stimulusSamples(stimLibrary, *entry);
+    const int channels = std::min<int>(entry->channels, ENGINE_MAX_TACTOR - ctx.tactor + 1);
+    const uint32_t numSamples = entry->numSamples;
+    const double periodUs = 1e6 / entry->sampleRate;
+    const double scale = ctx.param(1, 1.0);
+    const int loops = static_cast<int>(ctx.param(2, 1));
+    const int stride = entry->channels;
+    int64_t startUs = patternTickUs;
+    const uint8_t* previous = nullptr;
+    for (int loop = 0; loop < loops; loop++) {
+        for (uint32_t n = 0; n < numSamples; n++) {
+            const uint8_t* row = samples + static_cast<uint64_t>(n) * stride;
+            for (int c = 0; c < channels; c++) {
+                if (previous && row[c] == previous[c]) continue;
+                int gain = scale == 1.0 ? row[c] : static_cast<int>(row[c] * scale + 0.5);
+                ctx.gain(ctx.tactor + c, std::clamp(gain, 0, MAX_ACTION_GAIN));
+            }
+            previous = row;
+            int64_t nextUs = startUs + static_cast<int64_t>((static_cast<double>(loop) * numSamples + n + 1) * periodUs);
+            co_await wait((nextUs - patternTickUs) / 1000.0);
+        }
+    }
+}
+
+inline const bool stimulusPatternRegistered = registerPattern("stimulus", stimulusPattern);
+
+#endif
@@ -0,0 +1,171 @@
+// Stub TactorInterface backend.
+//
+// Implements the TactorInterface.h API without hardware so the daemon (tdkd)
+// and its self-tests run on machines without the EAI DLL, e.g. Linux CI. Link it
+// in place of TactorInterface.lib:
+//
+//   g++ -std=c++17 -O2 -ITDK_API src/tdkd.cpp src/stub_backend.cpp -lpthread -lrt -o tdkd
+//
+// Every call is counted in stubCallCount. TDK_STUB_LATENCY_US (environment)
+// adds a fixed busy delay to each device command to mimic a USB round trip.
+
+#include "TactorInterface.h"
+#include "EAI_Defines.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+std::atomic<unsigned long long> stubCallCount{0};
+std::atomic<unsigned long long> backendCommandCount{0}; // Device commands only (Pulse, ChangeGain, ...)
+
+namespace {
+
+constexpr int STUB_MAX_DEVICES = 8;
+
+int lastError = 0;
+bool initialized = false;
+bool open[STUB_MAX_DEVICES] = {};
+long long latencyUs = -1;
+char nameBuffer[32];
+
+long long commandLatencyUs() {
+    if (latencyUs < 0) {
+        const char* env = std::getenv("TDK_STUB_LATENCY_US");
+        latencyUs = env ? std::atoll(env) : 0;
+    }
+    return latencyUs;
+}
+
+int fail(int errorCode) {
+    lastError = errorCode;
+    return -1;
+}
+
+int deviceCommand(int deviceID) {
+    stubCallCount++;
+    if (!initialized) return fail(ERROR_NOINIT);
+    if (deviceID < 0 || deviceID >= STUB_MAX_DEVICES || !open[deviceID]) return fail(ERROR_CONNECTION);
+    long long delay = commandLatencyUs();
+    if (delay > 0) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(delay);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+    backendCommandCount++;
+    return 0;
+}
+
+} // namespace
+
+int InitializeTI() {
+    stubCallCount++;
+    initialized = true;
+    return 0;
+}
+
+int ShutdownTI() {
+    stubCallCount++;
+    initialized = false;
+    std::memset(open, 0, sizeof(open));
+    return 0;
+}
+
+const char* GetVersionNumber() {
+    return "stub";
+}
+
+int Connect(const char* name, int type, void* _callback) {
+    stubCallCount++;
+    (void)type;
+    (void)_callback;
+    if (!initialized) return fail(ERROR_NOINIT);
+    if (!name || std::strncmp(name, "STUB", 4) != 0) return fail(ERROR_CONNECTION);
+    for (int i = 0; i < STUB_MAX_DEVICES; i++) {
+        if (!open[i]) {
+            open[i] = true;
+            return i;
+        }
+    }
+    return fail(ERROR_CONNECTION);
+}
+
+int Discover(int type) {
+    stubCallCount++;
+    (void)type;
+    return initialized ? 1 : fail(ERROR_NOINIT);
+}
+
+int DiscoverLimited(int type, int amount) {
+    stubCallCount++;
+    (void)type;
+    if (!initialized) return fail(ERROR_NOINIT);
+    return amount < 1 ? 0 : 1;
+}
+
+const char* GetDiscoveredDeviceName(int index) {
+    stubCallCount++;
+    if (index != 0) {
+        lastError = ERROR_BADPARAMETER;
+        return nullptr;
+    }
+    std::snprintf(nameBuffer, sizeof(nameBuffer), "STUB%d", index);
+    return nameBuffer;
+}
+
+int GetDiscoveredDeviceType(int index) {
+    stubCallCount++;
+    return index == 0 ? 1 : 0;
+}
+
+int Close(int deviceID) {
+    stubCallCount++;
+    if (deviceID < 0 || deviceID >= STUB_MAX_DEVICES || !open[deviceID]) return fail(ERROR_BADPARAMETER);
+    open[deviceID] = false;
+    return 0;
+}
+
+int CloseAll() {
+    stubCallCount++;
+    std::memset(open, 0, sizeof(open));
+    return 0;
+}
+
+int Pulse(int deviceID, int, int, int) { return deviceCommand(deviceID); }
+int SendActionWait(int deviceID, int, int) { return deviceCommand(deviceID); }
+int ChangeGain(int deviceID, int, int, int) { return deviceCommand(deviceID); }
+int RampGain(int deviceID, int, int, int, int, int, int) { return deviceCommand(deviceID); }
+int ChangeFreq(int deviceID, int, int, int) { return deviceCommand(deviceID); }
+int RampFreq(int deviceID, int, int, int, int, int, int) { return deviceCommand(deviceID); }
+int ChangeSigSource(int deviceID, int, int, int) { return deviceCommand(deviceID); }
+int ReadFW(int deviceID) { return deviceCommand(deviceID); }
+int TactorSelfTest(int deviceID, int) { return deviceCommand(deviceID); }
+int ReadSegmentList(int deviceID, int) { return deviceCommand(deviceID); }
+int ReadBatteryLevel(int deviceID, int) { return deviceCommand(deviceID); }
+int Stop(int deviceID, int) { return deviceCommand(deviceID); }
+int SetTactors(int deviceID, int, unsigned char*) { return deviceCommand(deviceID); }
+int SetTactorType(int deviceID, int, int, int) { return deviceCommand(deviceID); }
+int BeginStoreTAction(int deviceID, int) { return deviceCommand(deviceID); }
+int FinishStoreTAction(int deviceID) { return deviceCommand(deviceID); }
+int PlayStoredTAction(int deviceID, int, int) { return deviceCommand(deviceID); }
+int SetFreqTimeDelay(int deviceID, bool) { return deviceCommand(deviceID); }
+
+int UpdateTI() {
+    stubCallCount++;
+    return initialized ? 0 : fail(ERROR_NOINIT);
+}
+
+int GetLastEAIError() {
+    return lastError;
+}
+
+int SetLastEAIError(int e) {
+    lastError = e;
+    return 0;
+}
+
+int SetTimeFactor(int value) {
+    stubCallCount++;
+    return value >= 1 && value <= 255 ? 0 : fail(ERROR_BADPARAMETER);
+}
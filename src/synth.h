@@ -0,0 +1,409 @@
+#ifndef TDK_SYNTH_H
+#define TDK_SYNTH_H
+
+// Offline drive-signal renderer.
+//
+// Turns a timed command stream (ChangeGain, ChangeFreq, RampGain, RampFreq,
+// Pulse, SetTactors, Stop, SetFreqTimeDelay) into the drive signal each
+// tactor would get: a phase-continuous sine at the current frequency times
+// gain / 255 while the tactor is on. Ramps are linear per sample; with
+// end-on-zero-crossing a pulse runs past its duration to the next zero of its
+// sine. Sig source, tactor type and time factor don't shape the signal and are
+// ignored.
+//
+// Commands are expanded into a min-heap of events (ramp ends, pulse ends and
+// zero crossings are events too). Between events every parameter is constant
+// or linear, so the kernel advances four tactors per SSE2 register with a
+// phase accumulator and a polynomial sine, and writes interleaved frames
+// (tactor fastest): the layout of a tactors x samples MATLAB matrix and of a
+// WAV data chunk.
+
+#include "engine.h"
+#include "validate.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TDK_SYNTH_SSE2 1
+#endif
+
+constexpr int SYNTH_LANES = 4; // Tactors per SIMD register
+constexpr int SYNTH_MAX_CHANNELS = ENGINE_MAX_TACTOR;
+constexpr int SYNTH_PADDED = (SYNTH_MAX_CHANNELS + SYNTH_LANES - 1) / SYNTH_LANES * SYNTH_LANES;
+
+// One command of the stream. Delays are folded into timeMs.
+struct SynthCommand {
+    double timeMs = 0.0;
+    uint8_t type = CMD_NONE; // CommandType; CMD_SET_TACTORS sets one tactor on (value 1) or off
+    int tacNum = 0;          // 0 == every tactor
+    int value = 0;
+    int endValue = 0;
+    int duration = 0;        // ms
+};
+
+struct SynthOptions {
+    double sampleRate = 16000.0;
+    int64_t numFrames = 0;
+    int tactors[SYNTH_MAX_CHANNELS] = {}; // Output channel -> tactor number
+    int numChannels = 0;
+    int initialGain = MAX_ACTION_GAIN;
+    int initialFreq = MIN_ACTION_FREQUENCY;
+};
+
+enum SynthEventKind : uint8_t {
+    SYNTH_EVENT_COMMAND = 0,
+    SYNTH_EVENT_GAIN_RAMP_END,
+    SYNTH_EVENT_FREQ_RAMP_END,
+    SYNTH_EVENT_PULSE_END,
+    SYNTH_EVENT_ZERO_CROSSING
+};
+
+struct SynthEvent {
+    int64_t frame;
+    uint64_t order;      // Ties run in submission order
+    uint8_t kind;
+    int index;           // Command index, or channel for internal events
+    uint32_t generation; // Internal events are stale once the channel's generation moved on
+    bool operator<(const SynthEvent& other) const { // Min-heap
+        return frame != other.frame ? frame > other.frame : order > other.order;
+    }
+};
+
+class SynthRenderer {
+public:
+    SynthRenderer(const SynthCommand* commands, size_t count, const SynthOptions& options)
+        : commands_(commands, commands + count), options_(options) {
+        for (int t = 0; t <= ENGINE_MAX_TACTOR; t++) channelOf_[t] = -1;
+        for (int c = 0; c < options_.numChannels; c++) channelOf_[options_.tactors[c]] = c;
+        float gain = std::clamp(options_.initialGain, 0, MAX_ACTION_GAIN) / 255.0f;
+        float inc = static_cast<float>(options_.initialFreq / options_.sampleRate);
+        for (int c = 0; c < SYNTH_PADDED; c++) {
+            gain_[c] = gain;
+            inc_[c] = inc;
+        }
+        for (size_t i = 0; i < commands_.size(); i++) {
+            TactorCommand cmd = toTactorCommand(commands_[i]);
+            clamped_ += (validateCommand(cmd) & ~INVALID_TACTOR) != 0; // Unknown tactors are skipped, not moved
+            commands_[i].value = cmd.value;
+            commands_[i].endValue = cmd.endValue;
+            commands_[i].duration = cmd.duration;
+            push(framesAt(commands_[i].timeMs), SYNTH_EVENT_COMMAND, static_cast<int>(i), 0);
+        }
+    }
+
+    int64_t framesRendered() const { return frame_; }
+    int64_t framesLeft() const { return options_.numFrames - frame_; }
+    uint64_t commandsClamped() const { return clamped_; }
+
+    // Render the next `frames` frames (numChannels floats each) into out
+    void render(float* out, int64_t frames) {
+        frames = std::min(frames, framesLeft());
+        int64_t end = frame_ + frames;
+        while (frame_ < end) {
+            while (!events_.empty() && events_.top().frame <= frame_) {
+                SynthEvent event = events_.top();
+                events_.pop();
+                apply(event);
+            }
+            int64_t next = events_.empty() ? end : std::min(end, events_.top().frame);
+            kernel(out, next - frame_);
+            out += (next - frame_) * options_.numChannels;
+            frame_ = next;
+        }
+    }
+
+private:
+    std::vector<SynthCommand> commands_;
+    SynthOptions options_;
+    std::priority_queue<SynthEvent> events_;
+    uint64_t order_ = 0;
+    int64_t frame_ = 0;
+    uint64_t clamped_ = 0;
+    int channelOf_[ENGINE_MAX_TACTOR + 1];
+    bool endOnZero_ = false;
+
+    // Per channel, structure of arrays for the kernel. Phase is in cycles
+    // [0, 1); inc is cycles per frame.
+    alignas(16) float phase_[SYNTH_PADDED] = {};
+    alignas(16) float inc_[SYNTH_PADDED] = {};
+    alignas(16) float incStep_[SYNTH_PADDED] = {};
+    alignas(16) float gain_[SYNTH_PADDED] = {};
+    alignas(16) float gainStep_[SYNTH_PADDED] = {};
+    alignas(16) float on_[SYNTH_PADDED] = {};
+    float gainTarget_[SYNTH_PADDED] = {};
+    float incTarget_[SYNTH_PADDED] = {};
+    uint32_t gainRampGen_[SYNTH_PADDED] = {};
+    uint32_t freqRampGen_[SYNTH_PADDED] = {};
+    uint32_t pulseGen_[SYNTH_PADDED] = {};
+
+    static TactorCommand toTactorCommand(const SynthCommand& c) {
+        TactorCommand cmd;
+        cmd.type = c.type;
+        cmd.tacNum = c.tacNum == 0 ? 1 : c.tacNum; // "All" passes the tactor check
+        cmd.value = c.value;
+        cmd.endValue = c.endValue;
+        cmd.duration = c.duration;
+        return cmd;
+    }
+
+    int64_t framesAt(double timeMs) const {
+        return std::max<int64_t>(0, std::llround(timeMs * options_.sampleRate / 1000.0));
+    }
+
+    void push(int64_t frame, uint8_t kind, int index, uint32_t generation) {
+        events_.push({frame, order_++, kind, index, generation});
+    }
+
+    // Channels a command addresses: one, or all for tactor 0
+    template <typename Fn>
+    void forChannels(int tacNum, Fn fn) {
+        if (tacNum == 0) {
+            for (int c = 0; c < options_.numChannels; c++) fn(c);
+        } else if (tacNum > 0 && tacNum <= ENGINE_MAX_TACTOR && channelOf_[tacNum] >= 0) {
+            fn(channelOf_[tacNum]);
+        }
+    }
+
+    void setGain(int c, float gain) {
+        gain_[c] = gain;
+        gainStep_[c] = 0.0f;
+        gainRampGen_[c]++;
+    }
+
+    void setInc(int c, float inc) {
+        inc_[c] = inc;
+        incStep_[c] = 0.0f;
+        freqRampGen_[c]++;
+    }
+
+    void turnOff(int c) {
+        on_[c] = 0.0f;
+        pulseGen_[c]++;
+    }
+
+    void apply(const SynthEvent& event) {
+        if (event.kind != SYNTH_EVENT_COMMAND) {
+            int c = event.index;
+            switch (event.kind) {
+                case SYNTH_EVENT_GAIN_RAMP_END:
+                    if (event.generation == gainRampGen_[c]) setGain(c, gainTarget_[c]);
+                    break;
+                case SYNTH_EVENT_FREQ_RAMP_END:
+                    if (event.generation == freqRampGen_[c]) setInc(c, incTarget_[c]);
+                    break;
+                case SYNTH_EVENT_PULSE_END:
+                    if (event.generation != pulseGen_[c]) break;
+                    if (endOnZero_ && inc_[c] > 0.0f) {
+                        // Run on to the next zero of the sine (phase 0 or 0.5)
+                        float remaining = phase_[c] < 0.5f ? 0.5f - phase_[c] : 1.0f - phase_[c];
+                        int64_t frames = static_cast<int64_t>(std::ceil(remaining / inc_[c]));
+                        if (frames > 0) {
+                            push(frame_ + frames, SYNTH_EVENT_ZERO_CROSSING, c, pulseGen_[c]);
+                            break;
+                        }
+                    }
+                    turnOff(c);
+                    break;
+                case SYNTH_EVENT_ZERO_CROSSING:
+                    if (event.generation == pulseGen_[c]) turnOff(c);
+                    break;
+            }
+            return;
+        }
+        const SynthCommand& cmd = commands_[event.index];
+        const double fs = options_.sampleRate;
+        int64_t durationFrames = std::max<int64_t>(1, framesAt(cmd.duration));
+        switch (cmd.type) {
+            case CMD_CHANGE_GAIN:
+                forChannels(cmd.tacNum, [&](int c) { setGain(c, cmd.value / 255.0f); });
+                break;
+            case CMD_CHANGE_FREQ:
+                forChannels(cmd.tacNum, [&](int c) { setInc(c, static_cast<float>(cmd.value / fs)); });
+                break;
+            case CMD_RAMP_GAIN:
+                forChannels(cmd.tacNum, [&](int c) {
+                    setGain(c, cmd.value / 255.0f);
+                    gainTarget_[c] = cmd.endValue / 255.0f;
+                    gainStep_[c] = (gainTarget_[c] - gain_[c]) / durationFrames;
+                    push(frame_ + durationFrames, SYNTH_EVENT_GAIN_RAMP_END, c, gainRampGen_[c]);
+                });
+                break;
+            case CMD_RAMP_FREQ:
+                forChannels(cmd.tacNum, [&](int c) {
+                    setInc(c, static_cast<float>(cmd.value / fs));
+                    incTarget_[c] = static_cast<float>(cmd.endValue / fs);
+                    incStep_[c] = (incTarget_[c] - inc_[c]) / durationFrames;
+                    push(frame_ + durationFrames, SYNTH_EVENT_FREQ_RAMP_END, c, freqRampGen_[c]);
+                });
+                break;
+            case CMD_PULSE:
+                forChannels(cmd.tacNum, [&](int c) {
+                    on_[c] = 1.0f;
+                    pulseGen_[c]++; // A new pulse replaces the end of the previous one
+                    push(frame_ + durationFrames, SYNTH_EVENT_PULSE_END, c, pulseGen_[c]);
+                });
+                break;
+            case CMD_SET_TACTORS:
+                forChannels(cmd.tacNum, [&](int c) {
+                    turnOff(c);
+                    on_[c] = cmd.value ? 1.0f : 0.0f;
+                });
+                break;
+            case CMD_STOP:
+                for (int c = 0; c < options_.numChannels; c++) {
+                    turnOff(c);
+                    setGain(c, gain_[c]);
+                    setInc(c, inc_[c]);
+                }
+                break;
+            case CMD_FREQ_TIME_DELAY:
+                endOnZero_ = cmd.value != 0;
+                break;
+            default:
+                break; // Sig source, tactor type: no effect on the drive signal
+        }
+    }
+
+    // sin(2 pi p) for p in [0, 1): u = 2p - 1 in [-1, 1), sin(2 pi p) = -sin(pi u),
+    // folded to |w| <= 0.5 and a degree-9 odd polynomial (error < 2e-6)
+    static float sinCycles(float p) {
+        float u = 2.0f * p - 1.0f;
+        float a = std::fabs(u);
+        float w = std::copysign(std::min(a, 1.0f - a), u);
+        float x = 3.14159265f * w;
+        float x2 = x * x;
+        float s = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880)))));
+        return -s;
+    }
+
+    void kernel(float* out, int64_t frames) {
+        const int channels = options_.numChannels;
+        if (frames <= 0 || channels == 0) return;
+        for (int c0 = 0; c0 < channels; c0 += SYNTH_LANES) {
+            int lanes = std::min(SYNTH_LANES, channels - c0);
+            float* o = out + c0;
+#if defined(TDK_SYNTH_SSE2)
+            __m128 p = _mm_load_ps(phase_ + c0);
+            __m128 inc = _mm_load_ps(inc_ + c0);
+            __m128 dinc = _mm_load_ps(incStep_ + c0);
+            __m128 g = _mm_load_ps(gain_ + c0);
+            __m128 dg = _mm_load_ps(gainStep_ + c0);
+            const __m128 on = _mm_load_ps(on_ + c0);
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 two = _mm_set1_ps(2.0f);
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+            const __m128 pi = _mm_set1_ps(3.14159265f);
+            const __m128 k3 = _mm_set1_ps(-1.0f / 6), k5 = _mm_set1_ps(1.0f / 120);
+            const __m128 k7 = _mm_set1_ps(-1.0f / 5040), k9 = _mm_set1_ps(1.0f / 362880);
+            alignas(16) float tail[SYNTH_LANES];
+            for (int64_t n = 0; n < frames; n++) {
+                __m128 u = _mm_sub_ps(_mm_mul_ps(two, p), one);
+                __m128 a = _mm_and_ps(u, absMask);
+                __m128 w = _mm_or_ps(_mm_min_ps(a, _mm_sub_ps(one, a)), _mm_and_ps(u, signMask));
+                __m128 x = _mm_mul_ps(pi, w);
+                __m128 x2 = _mm_mul_ps(x, x);
+                __m128 poly = _mm_add_ps(k7, _mm_mul_ps(x2, k9));
+                poly = _mm_add_ps(k5, _mm_mul_ps(x2, poly));
+                poly = _mm_add_ps(k3, _mm_mul_ps(x2, poly));
+                poly = _mm_add_ps(one, _mm_mul_ps(x2, poly));
+                __m128 s = _mm_mul_ps(_mm_mul_ps(on, g), _mm_mul_ps(x, poly)); // == -sample
+                s = _mm_xor_ps(s, signMask);
+                if (lanes == SYNTH_LANES) {
+                    _mm_storeu_ps(o, s);
+                } else {
+                    _mm_store_ps(tail, s);
+                    for (int l = 0; l < lanes; l++) o[l] = tail[l];
+                }
+                o += channels;
+                p = _mm_add_ps(p, inc);
+                p = _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvttps_epi32(p))); // Wrap to [0, 1)
+                inc = _mm_add_ps(inc, dinc);
+                g = _mm_add_ps(g, dg);
+            }
+            _mm_store_ps(phase_ + c0, p);
+            _mm_store_ps(inc_ + c0, inc);
+            _mm_store_ps(gain_ + c0, g);
+#else
+            for (int64_t n = 0; n < frames; n++) {
+                for (int l = 0; l < lanes; l++) {
+                    int c = c0 + l;
+                    o[l] = on_[c] * gain_[c] * sinCycles(phase_[c]);
+                    phase_[c] += inc_[c];
+                    phase_[c] -= static_cast<float>(static_cast<int>(phase_[c]));
+                    inc_[c] += incStep_[c];
+                    gain_[c] += gainStep_[c];
+                }
+                o += channels;
+            }
+#endif
+        }
+    }
+};
+
+// ---- Output files --------------------------------------------------------------
+
+// 32-bit float WAV (WAVE_FORMAT_EXTENSIBLE, one channel per tactor), header
+// written. Null if the file can't be opened or the data won't fit in a RIFF
+// chunk.
+inline FILE* openWavFile(const char* path, int channels, double sampleRate, int64_t frames) {
+    uint64_t dataBytes = static_cast<uint64_t>(frames) * channels * 4;
+    if (dataBytes > 0xFFFFFFFFull - 80) return nullptr;
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return nullptr;
+    auto u16 = [f](uint16_t v) { unsigned char b[2] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8)}; std::fwrite(b, 1, 2, f); };
+    auto u32 = [f](uint32_t v) {
+        unsigned char b[4] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8),
+                              static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24)};
+        std::fwrite(b, 1, 4, f);
+    };
+    static const unsigned char floatGuid[16] = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                                0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    uint32_t rate = static_cast<uint32_t>(std::lround(sampleRate));
+    std::fwrite("RIFF", 1, 4, f);
+    u32(static_cast<uint32_t>(4 + 8 + 40 + 8 + dataBytes));
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    u32(40);
+    u16(0xFFFE); // WAVE_FORMAT_EXTENSIBLE
+    u16(static_cast<uint16_t>(channels));
+    u32(rate);
+    u32(rate * channels * 4);
+    u16(static_cast<uint16_t>(channels * 4));
+    u16(32);
+    u16(22);     // Extension size
+    u16(32);     // Valid bits
+    u32(0);      // Channel mask: none assigned
+    std::fwrite(floatGuid, 1, 16, f);
+    std::fwrite("data", 1, 4, f);
+    u32(static_cast<uint32_t>(dataBytes));
+    return f;
+}
+
+// Render straight to a file, a block at a time: "wav" or "bin" (raw
+// little-endian float32 frames). Returns frames written, or -1 on an I/O error.
+inline int64_t renderToFile(SynthRenderer& renderer, const SynthOptions& options, const char* path, bool wav) {
+    FILE* f = wav ? openWavFile(path, options.numChannels, options.sampleRate, options.numFrames) : std::fopen(path, "wb");
+    if (!f) return -1;
+    constexpr int64_t BLOCK_FRAMES = 4096;
+    std::vector<float> block(static_cast<size_t>(BLOCK_FRAMES) * std::max(1, options.numChannels));
+    int64_t written = 0;
+    while (renderer.framesLeft() > 0) {
+        int64_t frames = std::min(BLOCK_FRAMES, renderer.framesLeft());
+        renderer.render(block.data(), frames);
+        size_t count = static_cast<size_t>(frames) * options.numChannels;
+        if (std::fwrite(block.data(), sizeof(float), count, f) != count) {
+            std::fclose(f);
+            return -1;
+        }
+        written += frames;
+    }
+    return std::fclose(f) == 0 ? written : -1;
+}
+
+#endif
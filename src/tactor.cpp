@@ -1,17 +1,93 @@
 #include "mex.h"
 #include "TactorInterface.h"
 #include "EAI_Defines.h"
+#include "engine.h"
+#include "commandqueue.h"
+#include "layout.h"
+#include "framebuffer.h"
+#include "reconnect.h"
+#include "slots.h"
+#include "ring.h"
+#include "mixer.h"
+#include "patterns.h"
+#include "lfo.h"
+#include "validate.h"
+#include "profile.h"
+#include "stimlib.h"
+#include "synth.h"
+#include "heartbeat.h"
+#include "inflight.h"
+#include "mapping.h"
+#include "health.h"
+#include <algorithm>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <map>
+#include <vector>
+#if defined(TDK_COUNT_ALLOCS)
+#include <cstdlib>
+#include <new>
+#endif
+
+#if defined(TDK_COUNT_ALLOCS)
+// Allocation-count build (tdk.install(true, 'CountAllocations', true)): every
+// C++ heap allocation made by the MEX, on any thread, is counted and reported
+// as stats.heapAllocations. tdk.testAllocations uses it to check that the
+// steady-state command path allocates nothing.
+static std::atomic<uint64_t> heapAllocations{0};
+
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+// How a device was opened, kept so the watchdog can reopen it
+struct DeviceInfo {
+    std::string name;
+    int type;
+};
 
 // Persistent device state
-static std::map<int, int> deviceConnections; // Map of device IDs to their types
+static std::map<int, DeviceInfo> deviceConnections; // Map of device IDs to their name and type
 static bool atExitRegistered = false;       // Track if mexAtExit has been registered
+static int64_t engineStartUs = 0;           // First call since the MEX was loaded
 static bool isConnected = false;
 static bool isInitialized = false;
+static bool serialWarningShown = false;     // The serial backend's framing warning, once per session
+static int64_t callStartUs = 0;             // When the current MEX call started (priority latency)
+static int numOutputs = 0;                  // nlhs of the current MEX call
+
+// Error code lookup table, sorted by code (binary searched, no allocation)
+struct ErrorDescription {
+    int code;
+    const char* text;
+};
 
-// Error code lookup table
-static std::map<int, std::string> errorDescriptions = {
+static constexpr ErrorDescription errorDescriptions[] = {
     {202000, "No initialization."},
     {202001, "Connection error."},
     {202002, "Bad parameter."},
@@ -41,79 +117,223 @@ static std::map<int, std::string> errorDescriptions = {
     {402000, "TM not initialized."},
     {402001, "No device."},
     {402002, "Can't map."},
-    {402003, "Failed to open."}, 
-    {402004, "Invalid parameter."}, 
-    {402005, "Missing connected segment."}, 
-    {402006, "Bad parameter."}, 
-    {402007, "TAction ID doesn't exist."}, 
-    {402008, "Database not initialized."}, 
-    {402009, "Max controller limit reached."}, 
-    {402010, "Max action limit reached."}, 
-    {402011, "Controller not found."}, 
-    {402012, "Max tactor location limit reached."}, 
-    {402013, "TAction not found."}, 
-    {402014, "Failed to unload."}, 
-    {402015, "No TActions in database."}, 
-    {402016, "Failed to open database."}, 
-    {402017, "Failed packet parse."}, 
+    {402003, "Failed to open."},
+    {402004, "Invalid parameter."},
+    {402005, "Missing connected segment."},
+    {402006, "Bad parameter."},
+    {402007, "TAction ID doesn't exist."},
+    {402008, "Database not initialized."},
+    {402009, "Max controller limit reached."},
+    {402010, "Max action limit reached."},
+    {402011, "Controller not found."},
+    {402012, "Max tactor location limit reached."},
+    {402013, "TAction not found."},
+    {402014, "Failed to unload."},
+    {402015, "No TActions in database."},
+    {402016, "Failed to open database."},
+    {402017, "Failed packet parse."},
     {402018, "Failed to clone TAction."},
     {502000, "DBM error."},
     {502001, "DBM No error."},
-    {602000, "Bad data."}
+    {602000, "Bad data."},
+    {902000, "Engine command queue full."},
+    {902001, "Flow control: no credit within the allowed wait, or device queue limit reached."},
+    {902002, "Daemon command ring full."},
+    {902003, "Daemon not running (attach with 'attach' after starting tdkd)."}
 };
 
-static std::map<std::string, uint8_t> stringCommands = {
-    {"initialize", 1},
-    {"shutdown", 2},
+// Command names, sorted by name (strcmp order) for binary search
+struct CommandName {
+    const char* name;
+    uint8_t code;
+};
+
+static constexpr CommandName stringCommands[] = {
+    {"ackStatus", 61},
+    {"addEffect", 38},
+    {"addLfo", 45},
+    {"applyProfile", 52},
+    {"arm", 33},
+    {"attach", 35},
+    {"beginStoreTAction", 14},
+    {"cancelPattern", 42},
+    {"changeFreq", 8},
+    {"changeGain", 7},
+    {"changeSigSource", 30},
+    {"checkConnection", 17},
+    {"closeStimulusLibrary", 54},
+    {"commitFrame", 23},
+    {"configureAckTracking", 60},
+    {"configureFlowControl", 28},
+    {"configureHeartbeat", 59},
+    {"configureMapping", 62},
+    {"configureMixer", 37},
+    {"configureQueue", 26},
+    {"configureRealtime", 56},
+    {"configureReconnect", 31},
+    {"configureTrace", 48},
+    {"configureValidation", 51},
+    {"connect", 5},
+    {"detach", 36},
     {"discover", 3},
+    {"dumpTrace", 50},
+    {"finishStoreTAction", 15},
+    {"fire", 34},
+    {"flowStatus", 29},
+    {"getDeviceIDs", 68},
     {"getName", 4},
-    {"connect", 5},
-    {"setTimeFactor", 6},
-    {"changeGain", 7},
-    {"changeFreq", 8},
-    {"rampGain", 9},
-    {"rampFreq", 10},
+    {"healthCheck", 65},
+    {"heartbeat", 58},
+    {"initialize", 1},
+    {"launchPattern", 41},
+    {"loadLayout", 18},
+    {"lock", 66},
+    {"mappingStatus", 64},
+    {"openStimulusLibrary", 53},
+    {"patternEvent", 44},
+    {"patternStatus", 43},
+    {"playStimulus", 55},
+    {"playStoredTAction", 16},
     {"pulse", 11},
-    {"stop", 12},
+    {"pushFeatures", 63},
+    {"rampFreq", 10},
+    {"rampGain", 9},
+    {"removeEffect", 40},
+    {"removeLfo", 47},
+    {"renderDrive", 57},
     {"setState", 13},
-    {"beginStoreTAction", 14},
-    {"finishStoreTAction", 15},
-    {"playStoredTAction", 16},
-    {"checkConnection", 17}
+    {"setStimulus", 19},
+    {"setTimeFactor", 6},
+    {"shutdown", 2},
+    {"silence", 32},
+    {"startFrameCommit", 24},
+    {"startRenderer", 20},
+    {"stats", 27},
+    {"stop", 12},
+    {"stopFrameCommit", 25},
+    {"stopRenderer", 21},
+    {"traceMarker", 49},
+    {"unlock", 67},
+    {"updateEffect", 39},
+    {"updateLfo", 46},
+    {"writeFrame", 22}
+};
+
+static const uint8_t lastCommandCode = 68;
+static const uint8_t fireCommandCode = 34; // Handled ahead of normal dispatch in mexFunction
+
+// Name/value pair for statistics returned to MATLAB
+struct StatField {
+    const char* name;
+    double value;
 };
 
+static_assert(std::is_sorted(std::begin(errorDescriptions), std::end(errorDescriptions),
+                             [](const ErrorDescription& a, const ErrorDescription& b) { return a.code < b.code; }),
+              "errorDescriptions must stay sorted by code");
+static_assert(std::is_sorted(std::begin(stringCommands), std::end(stringCommands),
+                             [](const CommandName& a, const CommandName& b) {
+                                 return std::string_view(a.name) < std::string_view(b.name);
+                             }),
+              "stringCommands must stay sorted by name");
+
 // Function to get error description
 const char* getErrorDescription(int errorCode) {
-    auto it = errorDescriptions.find(errorCode);
-    if (it != errorDescriptions.end()) {
-        return it->second.c_str();
+    auto it = std::lower_bound(std::begin(errorDescriptions), std::end(errorDescriptions), errorCode,
+                               [](const ErrorDescription& e, int code) { return e.code < code; });
+    if (it != std::end(errorDescriptions) && it->code == errorCode) {
+        return it->text;
     }
     return "Unknown error code.";
 }
 
 // Function to convert string command to uint8_t
 uint8_t stringCommandToCode(const char* command) {
-    auto it = stringCommands.find(command);
-    if (it != stringCommands.end()) {
-        return it->second;
+    auto it = std::lower_bound(std::begin(stringCommands), std::end(stringCommands), command,
+                               [](const CommandName& c, const char* name) { return std::strcmp(c.name, name) < 0; });
+    if (it != std::end(stringCommands) && std::strcmp(it->name, command) == 0) {
+        return it->code;
     }
     return 0;
 }
 
+// Leave client mode. Other threads may be mid-push, so wait them out before
+// unmapping the ring, and stop the heartbeat tripping the daemon's devices.
+void detachDaemon() {
+#if defined(__linux__)
+    commandSink.store(nullptr, std::memory_order_release);
+    SharedRing* ring = releaseClientRing();
+    if (!ring) return;
+    uint64_t attached = 0;
+    for (int i = 0; i < ring->header.deviceCount; i++) {
+        int id = ring->header.deviceIDs[i];
+        if (id >= 0 && id < 64) attached |= uint64_t{1} << id;
+    }
+    heartbeatDevices.fetch_and(~attached, std::memory_order_release);
+    closeRing(ring);
+#endif
+}
+
 // Cleanup function for when MATLAB exits
 void cleanup() {
-    for (const auto& [deviceID, type] : deviceConnections) {
-        Close(deviceID);
+    stopHeartbeat(); // Issues through the queue, so it goes first
+    stopScheduler(); // Background work must stop before the DLL is closed
+    detachDaemon();
+    stopQueue();
+    stopWatchdog();
+    {
+        std::lock_guard<std::mutex> lock(watchdogMutex);
+        reconnectTargets.clear();
+        reconnectStats = ReconnectStats();
+    }
+    renderers.clear();
+    {
+        std::lock_guard<std::mutex> flowLock(flowMutex);
+        for (auto& fs : flowStates) fs = FlowState();
+    }
+    frameBuffers.clear();
+    clearArmedSlots();
+    {
+        std::lock_guard<std::mutex> mixLock(mixMutex);
+        mixers.clear();
+    }
+    {
+        std::lock_guard<std::mutex> mapLock(mapMutex);
+        clearMappersLocked();
+    }
+    {
+        std::lock_guard<std::mutex> patternLock(patternMutex);
+        closeStimulusLibraryLocked();
+        stimuliPlayed = 0;
+        clearPatternsLocked();
+        patternTaskID = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lfoLock(lfoMutex);
+        for (auto& lfo : lfos) lfo = Lfo();
+        lfoStats = LfoStats();
+        lfoTaskID = 0;
+    }
+    resetRtConfig(); // Engine threads are stopped by now
+    configureAckTracking(false, ACK_DEFAULT_TIMEOUT_US, true);
+    validationPolicy.store(VALIDATE_CLAMP, std::memory_order_relaxed);
+    validationClamped.store(0, std::memory_order_relaxed);
+    validationRejected.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(tiMutex);
+    for (const auto& [deviceID, info] : deviceConnections) {
+        Close(physicalDeviceID(deviceID));
     }
+    for (auto& link : deviceLinks) link = DeviceLink();
     ShutdownTI();
+    appliedTimeFactor = PROFILE_UNSET;
     deviceConnections.clear();
     isConnected = false;
 }
 
 // Error handling function with descriptions
-void handleError(int result, const char* functionName) {
+void handleError(int result, const char* functionName, int errorCode = 0) {
     if (result < 0) {
-        int errorCode = GetLastEAIError();
+        if (errorCode == 0) errorCode = GetLastEAIError();
         const char* description = getErrorDescription(errorCode);
         mexErrMsgIdAndTxt("TDK:Error", "<strong>%s</strong> failed with error code: %d\n\t->\t(%s)", functionName, errorCode, description);
     }
@@ -137,12 +357,63 @@ void printHelpCodeList() {
     mexPrintf("  14 = 'beginStoreTAction'\n");
     mexPrintf("  15 = 'finishStoreTAction'\n");
     mexPrintf("  16 = 'playStoredTACtion'\n");
-    mexPrintf("  17 = 'checkConnection'\n\n");
+    mexPrintf("  17 = 'checkConnection'\n");
+    mexPrintf("  18 = 'loadLayout'\n");
+    mexPrintf("  19 = 'setStimulus'\n");
+    mexPrintf("  20 = 'startRenderer'\n");
+    mexPrintf("  21 = 'stopRenderer'\n");
+    mexPrintf("  22 = 'writeFrame'\n");
+    mexPrintf("  23 = 'commitFrame'\n");
+    mexPrintf("  24 = 'startFrameCommit'\n");
+    mexPrintf("  25 = 'stopFrameCommit'\n");
+    mexPrintf("  26 = 'configureQueue'\n");
+    mexPrintf("  27 = 'stats'\n");
+    mexPrintf("  28 = 'configureFlowControl'\n");
+    mexPrintf("  29 = 'flowStatus'\n");
+    mexPrintf("  30 = 'changeSigSource'\n");
+    mexPrintf("  31 = 'configureReconnect'\n");
+    mexPrintf("  32 = 'silence'\n");
+    mexPrintf("  33 = 'arm'\n");
+    mexPrintf("  34 = 'fire'\n");
+    mexPrintf("  35 = 'attach'\n");
+    mexPrintf("  36 = 'detach'\n");
+    mexPrintf("  37 = 'configureMixer'\n");
+    mexPrintf("  38 = 'addEffect'\n");
+    mexPrintf("  39 = 'updateEffect'\n");
+    mexPrintf("  40 = 'removeEffect'\n");
+    mexPrintf("  41 = 'launchPattern'\n");
+    mexPrintf("  42 = 'cancelPattern'\n");
+    mexPrintf("  43 = 'patternStatus'\n");
+    mexPrintf("  44 = 'patternEvent'\n");
+    mexPrintf("  45 = 'addLfo'\n");
+    mexPrintf("  46 = 'updateLfo'\n");
+    mexPrintf("  47 = 'removeLfo'\n");
+    mexPrintf("  48 = 'configureTrace'\n");
+    mexPrintf("  49 = 'traceMarker'\n");
+    mexPrintf("  50 = 'dumpTrace'\n");
+    mexPrintf("  51 = 'configureValidation'\n");
+    mexPrintf("  52 = 'applyProfile'\n");
+    mexPrintf("  53 = 'openStimulusLibrary'\n");
+    mexPrintf("  54 = 'closeStimulusLibrary'\n");
+    mexPrintf("  55 = 'playStimulus'\n");
+    mexPrintf("  56 = 'configureRealtime'\n");
+    mexPrintf("  57 = 'renderDrive'\n");
+    mexPrintf("  58 = 'heartbeat'\n");
+    mexPrintf("  59 = 'configureHeartbeat'\n");
+    mexPrintf("  60 = 'configureAckTracking'\n");
+    mexPrintf("  61 = 'ackStatus'\n");
+    mexPrintf("  62 = 'configureMapping'\n");
+    mexPrintf("  63 = 'pushFeatures'\n");
+    mexPrintf("  64 = 'mappingStatus'\n");
+    mexPrintf("  65 = 'healthCheck'\n");
+    mexPrintf("  66 = 'lock'\n");
+    mexPrintf("  67 = 'unlock'\n");
+    mexPrintf("  68 = 'getDeviceIDs'\n\n");
 }
 
 void printHelpCommandDetails(uint8_t command, bool detailed) {
     if (command == 0) {
-        for (int i = 1; i <= 17; i++) {
+        for (int i = 1; i <= lastCommandCode; i++) {
             printHelpCommandDetails(i, false);
         }
         mexPrintf("\n<strong>General</strong>\n");
@@ -195,7 +466,7 @@ void printHelpCommandDetails(uint8_t command, bool detailed) {
             
             break;
         case 5:
-            mexPrintf("  'connect', <name>, <type>\n");
+            mexPrintf("  'connect', <name>, <type>, <profile>\n");
             mexPrintf("                         Connect to a device with the given name and type.\n");
             if (detailed) {
                 mexPrintf("\n");
@@ -204,6 +475,8 @@ void printHelpCommandDetails(uint8_t command, bool detailed) {
                 mexPrintf("                                                    Example: 'COM9'.\n");
                 mexPrintf("                        IN: <strong>type</strong> - The enumerated interface type.\n");
                 mexPrintf("                                                    Defaults to 1 (WindowsUSB).\n");
+                mexPrintf("                        IN: <strong>profile</strong> - (Optional) Configuration applied right after Connect\n");
+                mexPrintf("                                                    (see 'applyProfile').\n");
                 mexPrintf("                                -> please check out tdk.open() <-\n");
             }
             break;
@@ -288,14 +561,20 @@ void printHelpCommandDetails(uint8_t command, bool detailed) {
                 mexPrintf("                        IN: <strong>deviceID</strong> - The device ID to apply the command to.\n");
                 mexPrintf("                        IN: <strong>delay</strong> - Delay before running command (ms).\n");
                 mexPrintf("                                                     Does not seem to do anything.\n");
+                mexPrintf("\n");
+                mexPrintf("                         Sent on the priority lane: queued commands for the device are cancelled,\n");
+                mexPrintf("                         Stop goes to the DLL ahead of other traffic, and renderers/frame commits\n");
+                mexPrintf("                         on the device are stopped.\n");
             }
             break;
         case 13:
-            mexPrintf("  'setState', <deviceID>, <delay>, <states>\n");
-            mexPrintf("                         Set the state of all tactors after the specified delay duration.\n");
+            mexPrintf("  'setState', <deviceID>, <states>\n");
+            mexPrintf("                         Set the on/off state of all 64 tactors at once.\n");
             if (detailed) {
                 mexPrintf("\n");
-                mexPrintf("                         <strong>Do not use! Seems to break MATLAB interface!</strong>\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID to apply the command to.\n");
+                mexPrintf("                        IN: <strong>states</strong> - uint64 mask (tactor 1 == LSB), logical vector of up to\n");
+                mexPrintf("                                                     64 tactors, or the 8-byte uint8 SetTactors layout.\n");
             }
             break;
         case 14:
@@ -331,6 +610,500 @@ void printHelpCommandDetails(uint8_t command, bool detailed) {
                 mexPrintf("                         <strong>Returns:</strong> logical scalar indicating connection status.\n");
             }
             break;
+        case 18:
+            mexPrintf("  'loadLayout', <deviceID>, <positions>, <tactors>, <radius>, <checkController>\n");
+            mexPrintf("                         Load the spatial layout used by the phantom-sensation renderer.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> funneling radius used by the renderer.\n\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID the layout belongs to.\n");
+                mexPrintf("                        IN: <strong>positions</strong> - N x 2 or N x 3 double matrix of tactor positions (e.g. mm).\n");
+                mexPrintf("                        IN: <strong>tactors</strong> - (Optional) 1 x N tactor numbers for each row. Defaults to 1:N.\n");
+                mexPrintf("                        IN: <strong>radius</strong> - (Optional) Funneling radius, same units as positions.\n");
+                mexPrintf("                                                     Defaults to 1.5x the mean neighbour spacing; at least\n");
+                mexPrintf("                                                     the layout's extent / %d.\n", LAYOUT_MAX_GRID_SIDE - 1);
+                mexPrintf("                        IN: <strong>checkController</strong> - (Optional) true to check the controller answers\n");
+                mexPrintf("                                                     ReadSegmentList first (the list isn't compared).\n");
+                mexPrintf("                                -> Stop the renderer before loading a new layout.\n");
+            }
+            break;
+        case 19:
+            mexPrintf("  'setStimulus', <deviceID>, <position>, <intensity>, <endPosition>, <model>\n");
+            mexPrintf("                         Move the virtual stimulus rendered on the layout.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID the layout belongs to.\n");
+                mexPrintf("                        IN: <strong>position</strong> - Stimulus point (1 x 2 or 1 x 3).\n");
+                mexPrintf("                        IN: <strong>intensity</strong> - Perceived intensity (0 - 1). 0 turns the stimulus off.\n");
+                mexPrintf("                        IN: <strong>endPosition</strong> - (Optional) Second point; renders a line from position.\n");
+                mexPrintf("                        IN: <strong>model</strong> - (Optional) 'energy' (default) or 'linear' summation.\n");
+            }
+            break;
+        case 20:
+            mexPrintf("  'startRenderer', <deviceID>, <rate>\n");
+            mexPrintf("                         Start rendering the stimulus at a fixed rate (Hz; default 100).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                         Only tactors whose gain changed receive a ChangeGain command.\n");
+                mexPrintf("                         Gains only; keep tactors running with 'pulse' as usual.\n");
+            }
+            break;
+        case 21:
+            mexPrintf("  'stopRenderer', <deviceID>\n");
+            mexPrintf("                         Stop the renderer and return rendered tactors to zero gain.\n");
+            break;
+        case 22:
+            mexPrintf("  'writeFrame', <deviceID>, <frame>, <gains>, <commit>\n");
+            mexPrintf("                         Write the back frame (tactor on/off states and optional gains).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> number of commands sent (only when commit is true).\n\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID to apply the frame to.\n");
+                mexPrintf("                        IN: <strong>frame</strong> - uint64 mask (tactor 1 == LSB) or logical vector (up to 64).\n");
+                mexPrintf("                        IN: <strong>gains</strong> - (Optional) per-tactor gains; double 0 - 1 (NaN = unchanged)\n");
+                mexPrintf("                                                     or uint8 0 - 255.\n");
+                mexPrintf("                        IN: <strong>commit</strong> - (Optional) true to commit immediately.\n");
+            }
+            break;
+        case 23:
+            mexPrintf("  'commitFrame', <deviceID>\n");
+            mexPrintf("                         Send only what changed since the last committed frame.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> number of commands sent (0 if nothing changed).\n");
+            }
+            break;
+        case 24:
+            mexPrintf("  'startFrameCommit', <deviceID>, <rate>\n");
+            mexPrintf("                         Commit written frames at a fixed rate (Hz; default 100) in the background.\n");
+            break;
+        case 25:
+            mexPrintf("  'stopFrameCommit', <deviceID>\n");
+            mexPrintf("                         Stop background frame commits.\n");
+            break;
+        case 26:
+            mexPrintf("  'configureQueue', <enabled>, <maxStaleness>\n");
+            mexPrintf("                         Route commands through the coalescing I/O queue.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to queue commands on the engine I/O thread.\n");
+                mexPrintf("                                                     false drains the queue and returns to direct calls.\n");
+                mexPrintf("                        IN: <strong>maxStaleness</strong> - (Optional) Drop queued commands older than this (ms).\n");
+                mexPrintf("                                                     Stop is never dropped. 0 (default) = unbounded.\n");
+                mexPrintf("\n");
+                mexPrintf("                         Pending gain/frequency updates (and ramps) for the same tactor are replaced\n");
+                mexPrintf("                         in place; pulse/stop/setState keep their order. Vendor errors are reported\n");
+                mexPrintf("                         through 'stats' instead of the calling command.\n");
+            }
+            break;
+        case 27:
+            mexPrintf("  'stats'\n");
+            mexPrintf("                         Get engine counters (queue depth, coalesced updates, errors, ...).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                         <strong>Returns:</strong> scalar struct of counters.\n");
+            }
+            break;
+        case 28:
+            mexPrintf("  'configureFlowControl', <enabled>, <rate>, <burst>, <queueLimit>, <maxWait>\n");
+            mexPrintf("                         Adaptive per-device token bucket in front of the DLL.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to rate-limit commands per device.\n");
+                mexPrintf("                        IN: <strong>rate</strong> - (Optional) Starting rate (commands/s; default 200).\n");
+                mexPrintf("                        IN: <strong>burst</strong> - (Optional) Largest burst allowed (default 32).\n");
+                mexPrintf("                        IN: <strong>queueLimit</strong> - (Optional) Queued commands per device before\n");
+                mexPrintf("                                                     rejecting (queue mode; default 256).\n");
+                mexPrintf("                        IN: <strong>maxWait</strong> - (Optional) Longest a direct call waits for credit (ms; default 20).\n");
+                mexPrintf("\n");
+                mexPrintf("                         The rate grows while commands succeed (up to the measured link\n");
+                mexPrintf("                         capacity) and halves on action-limit errors, which are retried.\n");
+            }
+            break;
+        case 29:
+            mexPrintf("  'flowStatus'\n");
+            mexPrintf("                         Get current flow-control credit and queue depth per connected device.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                         <strong>Returns:</strong> struct array (one element per device).\n");
+            }
+            break;
+        case 30:
+            mexPrintf("  'changeSigSource', <deviceID>, <tactor>, <type>, <delay>\n");
+            mexPrintf("                         Change the signal source of a tactor (1-indexed).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID to apply the command to.\n");
+                mexPrintf("                        IN: <strong>tactor</strong> - The tactor number for the command. 1-indexed.\n");
+                mexPrintf("                        IN: <strong>type</strong> - Bitwise OR of 1 (primary), 2 (modulation), 4 (noise).\n");
+                mexPrintf("                        IN: <strong>delay</strong> - Delay before running command (ms).\n");
+            }
+            break;
+        case 31:
+            mexPrintf("  'configureReconnect', <enabled>, <maxBackoff>\n");
+            mexPrintf("                         Reconnect automatically after connection errors and restore tactor state.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to watch connected devices.\n");
+                mexPrintf("                        IN: <strong>maxBackoff</strong> - (Optional) Longest wait between attempts (ms; default 1000).\n");
+                mexPrintf("\n");
+                mexPrintf("                         On ERROR_CONNECTION, ERROR_EAITIMEOUT or ERROR_FAILED_TO_WRITE the device is\n");
+                mexPrintf("                         reopened with its original name/type and each tactor's last gain, frequency\n");
+                mexPrintf("                         and sig source (and the last setState) are replayed. While the device is\n");
+                mexPrintf("                         down, commands only update that state and do not raise errors.\n");
+                mexPrintf("                         Outages and reconnects are reported by 'stats'.\n");
+            }
+            break;
+        case 32:
+            mexPrintf("  'silence', <deviceID>, <tactor>\n");
+            mexPrintf("                         Immediately set one tactor's gain to 0 (priority lane, like 'stop').\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - The device ID to apply the command to.\n");
+                mexPrintf("                        IN: <strong>tactor</strong> - The tactor number to silence. 1-indexed.\n");
+                mexPrintf("\n");
+                mexPrintf("                         Queued commands for the tactor are cancelled, and a renderer whose layout\n");
+                mexPrintf("                         uses the tactor is stopped.\n");
+            }
+            break;
+        case 33:
+            mexPrintf("  'arm', <slot>, <commands>\n");
+            mexPrintf("                         Validate and pre-encode commands into a slot (1 - %d) for 'fire'.\n", ARM_SLOTS);
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> number of commands armed.\n\n");
+                mexPrintf("                        IN: <strong>slot</strong> - Slot number (1 - %d).\n", ARM_SLOTS);
+                mexPrintf("                        IN: <strong>commands</strong> - One command as a cell of its normal arguments, e.g.\n");
+                mexPrintf("                                                     {'pulse', deviceID, 1, 100, 0}, or a cell array of\n");
+                mexPrintf("                                                     such cells (up to %d). {} disarms the slot.\n", ARM_MAX_COMMANDS);
+                mexPrintf("                                -> Supported: changeGain, changeFreq, rampGain, rampFreq, pulse,\n");
+                mexPrintf("                                   stop, setState, changeSigSource, silence.\n");
+            }
+            break;
+        case 34:
+            mexPrintf("  'fire', <slot>\n");
+            mexPrintf("                         Issue the commands armed in a slot, ahead of other traffic.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                         Call as tactor(uint8(34), slot) for the shortest path; nothing is\n");
+                mexPrintf("                         decoded at fire time. Fired commands bypass the I/O queue and flow\n");
+                mexPrintf("                         control. Fire-to-DLL latency is reported by 'stats'.\n");
+            }
+            break;
+        case 35:
+            mexPrintf("  'attach', <ringName>\n");
+            mexPrintf("                         Client mode: send commands to a running tdkd daemon (Linux).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> the device IDs the daemon has connected.\n\n");
+                mexPrintf("                        IN: <strong>ringName</strong> - (Optional) Shared-memory ring name (default '/tdk_ring').\n");
+                mexPrintf("\n");
+                mexPrintf("                         Device commands, renderers, frame commits and fired slots are written\n");
+                mexPrintf("                         to the daemon's command ring instead of the DLL. Don't 'connect' too.\n");
+            }
+            break;
+        case 36:
+            mexPrintf("  'detach'               Leave client mode and unmap the daemon's command ring.\n");
+            break;
+        case 37:
+            mexPrintf("  'configureMixer', <deviceID>, <enabled>, <rate>, <budget>, <pulseMs>\n");
+            mexPrintf("                         Start or stop the effect mixer for a device.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to start mixing, false to stop (all effects are removed).\n");
+                mexPrintf("                        IN: <strong>rate</strong> - (Optional) Mixer tick rate in Hz (1 - 1000, default 100).\n");
+                mexPrintf("                        IN: <strong>budget</strong> - (Optional) Maximum commands issued per tick (default 32).\n");
+                mexPrintf("                        IN: <strong>pulseMs</strong> - (Optional) Keep sounding tactors on with Pulse commands of this\n");
+                mexPrintf("                                                     length (ms, longer than one tick). 0 (default) only changes gain.\n");
+            }
+            break;
+        case 38:
+            mexPrintf("  'addEffect', <deviceID>, <tactor>, <envelope>, <mode>, <priority>, <freq>, <duration>, <delay>\n");
+            mexPrintf("                         Layer an effect on a tactor; the mixer blends all of the tactor's effects.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> effect ID.\n\n");
+                mexPrintf("                        IN: <strong>envelope</strong> - Constant gain (0 - 255), or a 2 x N [t_ms; gain] piecewise-linear\n");
+                mexPrintf("                                                     envelope (up to %d points).\n", MIX_MAX_POINTS);
+                mexPrintf("                        IN: <strong>mode</strong> - (Optional) 'max' (default), 'sum' (clamped to 255) or 'override'.\n");
+                mexPrintf("                        IN: <strong>priority</strong> - (Optional) Effects blend in ascending priority (default 0).\n");
+                mexPrintf("                        IN: <strong>freq</strong> - (Optional) Frequency (Hz); 0 (default) leaves it to other effects.\n");
+                mexPrintf("                        IN: <strong>duration</strong> - (Optional) ms; 0 (default) = the envelope's length, or until\n");
+                mexPrintf("                                                     removed for a constant gain.\n");
+                mexPrintf("                        IN: <strong>delay</strong> - (Optional) ms before the effect starts (default 0).\n");
+            }
+            break;
+        case 39:
+            mexPrintf("  'updateEffect', <effectID>, <gain>, <freq>\n");
+            mexPrintf("                         Set an effect to a constant gain (and optionally frequency), e.g. for proportional feedback.\n");
+            break;
+        case 40:
+            mexPrintf("  'removeEffect', <effectID>\n");
+            mexPrintf("                         Remove an effect; the tactor falls back to its remaining effects.\n");
+            break;
+        case 41:
+            mexPrintf("  'launchPattern', <name>, <deviceID>, <tactor>, <params>, <delay>\n");
+            mexPrintf("                         Start a registered native pattern (coroutine) on a tactor.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> pattern instance ID.\n\n");
+                mexPrintf("                        IN: <strong>name</strong> - Registered pattern name (see 'patternStatus').\n");
+                mexPrintf("                        IN: <strong>params</strong> - (Optional) Up to %d pattern parameters; [] for defaults.\n", PATTERN_MAX_PARAMS);
+                mexPrintf("                        IN: <strong>delay</strong> - (Optional) ms before the first step (default 0).\n");
+                mexPrintf("\n");
+                mexPrintf("                         Built-in: pulseTrain [count, onMs, offMs, gain], sweep [lastTactor, stepMs,\n");
+                mexPrintf("                         gain, pulseMs], swell [peak, riseMs, holdMs, fallMs], cue [event, gain, pulseMs,\n");
+                mexPrintf("                         repeat]. Up to %d patterns run at once on the scheduler thread.\n", PATTERN_MAX_INSTANCES);
+            }
+            break;
+        case 42:
+            mexPrintf("  'cancelPattern', <id or name>\n");
+            mexPrintf("                         Cancel one pattern instance, or every instance of a named pattern.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> number of instances cancelled.\n");
+            }
+            break;
+        case 43:
+            mexPrintf("  'patternStatus', <name>\n");
+            mexPrintf("                         Registered pattern names, running instances (optionally of one pattern), and counters.\n");
+            break;
+        case 44:
+            mexPrintf("  'patternEvent', <event>\n");
+            mexPrintf("                         Raise an event (1 - %d), resuming patterns waiting on it with until(event).\n", PATTERN_EVENTS);
+            break;
+        case 45:
+            mexPrintf("  'addLfo', <deviceID>, <tactor>, <target>, <shape>, <depth>, <offset>, <period>, <phase>, <syncGroup>, <tolerance>\n");
+            mexPrintf("                         Modulate a tactor's gain or frequency natively with RampGain/RampFreq segments.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> LFO ID.\n\n");
+                mexPrintf("                        IN: <strong>target</strong> - 'gain' (0 - 255) or 'freq' (300 - 3500 Hz).\n");
+                mexPrintf("                        IN: <strong>shape</strong> - 'sine', 'triangle', 'square' or 'sawtooth'.\n");
+                mexPrintf("                        IN: <strong>depth</strong>, <strong>offset</strong> - value = offset + depth * wave, wave in [-1, 1].\n");
+                mexPrintf("                        IN: <strong>period</strong> - Modulation period (ms).\n");
+                mexPrintf("                        IN: <strong>phase</strong> - (Optional) Phase offset in cycles (0 - 1, default 0).\n");
+                mexPrintf("                        IN: <strong>syncGroup</strong> - (Optional) LFOs in the same group (1 - %d) share one phase clock;\n", LFO_SYNC_GROUPS);
+                mexPrintf("                                                     0 (default) runs free.\n");
+                mexPrintf("                        IN: <strong>tolerance</strong> - (Optional) Allowed error of the ramp segments (default 2).\n");
+            }
+            break;
+        case 46:
+            mexPrintf("  'updateLfo', <lfoID>, <depth>, <offset>, <period>, <phase>\n");
+            mexPrintf("                         Change LFO parameters mid-flight (NaN keeps a value); the output glides, never steps.\n");
+            break;
+        case 47:
+            mexPrintf("  'removeLfo', <lfoID>\n");
+            mexPrintf("                         Stop an LFO, holding the tactor at the value it has reached.\n");
+            break;
+        case 48:
+            mexPrintf("  'configureTrace', <enabled>, <clear>\n");
+            mexPrintf("                         Record engine activity (MEX calls, decode, UpdateTI, vendor calls, background ticks).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to record, false to stop.\n");
+                mexPrintf("                        IN: <strong>clear</strong> - (Optional) true discards everything recorded so far.\n");
+            }
+            break;
+        case 49:
+            mexPrintf("  'traceMarker', <text>\n");
+            mexPrintf("                         Add a marker (e.g. an experiment phase) to the trace timeline.\n");
+            break;
+        case 50:
+            mexPrintf("  'dumpTrace', <filename>\n");
+            mexPrintf("                         Write the trace as Chrome trace-event JSON (open in Perfetto or chrome://tracing).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Number of events written.\n");
+            }
+            break;
+        case 51:
+            mexPrintf("  'configureValidation', <policy>\n");
+            mexPrintf("                         Set what happens to out-of-range tactor, gain, frequency, duration and delay values.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>policy</strong> - 'clamp' (default) clamps into the EAI_Defines.h limits,\n");
+                mexPrintf("                                                 'error' rejects the command, 'off' passes raw values to the DLL.\n");
+                mexPrintf("                        Limits: tactor 1 - %d, gain 0 - %d, frequency %d - %d Hz, duration %d - %d ms, delay >= 0.\n",
+                          ENGINE_MAX_TACTOR, MAX_ACTION_GAIN, MIN_ACTION_FREQUENCY, MAX_ACTION_FREQUENCY,
+                          MIN_ACTION_DURATION, MAX_ACTION_DURATION);
+            }
+            break;
+        case 52:
+            mexPrintf("  'applyProfile', <deviceID>, <profile>\n");
+            mexPrintf("                         Apply a configuration profile in one burst, skipping settings already in place.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with applied, skipped (settings) and elapsedMs.\n\n");
+                mexPrintf("                        IN: <strong>profile</strong> - Struct with any of timeFactor (1 - 255, all devices),\n");
+                mexPrintf("                                                    endOnZeroCrossing (logical), and device-wide tactorType\n");
+                mexPrintf("                                                    ('C3', 'C2', 'EMS', 'EMR'), sigSource (1 - 7), freq (Hz),\n");
+                mexPrintf("                                                    gain (0 - 255); tactors is a struct array of per-tactor\n");
+                mexPrintf("                                                    overrides (tactor plus any of the four).\n");
+            }
+            break;
+        case 53:
+            mexPrintf("  'openStimulusLibrary', <filename>\n");
+            mexPrintf("                         Memory-map a stimulus library (see tdk.writeStimulusLibrary), replacing any open one.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Number of stimuli in the library.\n\n");
+                mexPrintf("                        The file is mapped read-only and only its header is read, so opening takes\n");
+                mexPrintf("                        constant time; stimulus data is paged in when played.\n");
+            }
+            break;
+        case 54:
+            mexPrintf("  'closeStimulusLibrary'\n");
+            mexPrintf("                         Cancel playing stimuli and unmap the library.\n");
+            break;
+        case 55:
+            mexPrintf("  'playStimulus', <deviceID>, <tactor>, <stimulus>, <gainScale>, <loops>, <delay>\n");
+            mexPrintf("                         Play a library stimulus natively, channel c on tactor + c - 1.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Pattern instance ID (see 'cancelPattern', 'patternStatus').\n\n");
+                mexPrintf("                        IN: <strong>stimulus</strong> - Stimulus ID or name.\n");
+                mexPrintf("                        IN: <strong>gainScale</strong> - (Optional) Multiplies every gain (default 1).\n");
+                mexPrintf("                        IN: <strong>loops</strong> - (Optional) Number of repetitions (default 1).\n");
+                mexPrintf("                        IN: <strong>delay</strong> - (Optional) Start delay (ms).\n");
+                mexPrintf("                        Rows are read straight from the mapped file; ChangeGain is sent only for\n");
+                mexPrintf("                        channels that changed since the previous row.\n");
+            }
+            break;
+        case 56:
+            mexPrintf("  'configureRealtime', <thread>, <policy>, <priority>, <cpus>, <memory>\n");
+            mexPrintf("                         Set an engine thread's scheduling policy, priority and CPU affinity, and lock memory.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with per-thread status (applied, message) and memory locking status.\n");
+                mexPrintf("                                          Called with no arguments, only returns the status.\n\n");
+                mexPrintf("                        IN: <strong>thread</strong> - 'scheduler', 'io', 'watchdog', 'heartbeat' or 'all'.\n");
+                mexPrintf("                        IN: <strong>policy</strong> - 'normal', 'fifo' (SCHED_FIFO) or 'rr' (SCHED_RR).\n");
+                mexPrintf("                        IN: <strong>priority</strong> - (Optional) 1 - 99 for 'fifo'/'rr' (default 50).\n");
+                mexPrintf("                        IN: <strong>cpus</strong> - (Optional) CPU numbers (0-based) the thread may run on; [] == any.\n");
+                mexPrintf("                        IN: <strong>memory</strong> - (Optional) 'none', 'engine' (lock engine buffers) or 'all' (mlockall).\n");
+                mexPrintf("                        Settings apply to running threads at once and to threads started later. What the\n");
+                mexPrintf("                        OS refuses is reported in the status; the engine keeps running without it.\n");
+            }
+            break;
+        case 57:
+            mexPrintf("  'renderDrive', <commands>, <sampleRate>, <duration>, <tactors>, <filename>, <initialGain>, <initialFreq>\n");
+            mexPrintf("                         Render the drive signal a command stream produces, offline (no device needed).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> tactors x samples single matrix, or frames written with a filename.\n\n");
+                mexPrintf("                        IN: <strong>commands</strong> - N x 6 [timeMs type tactor value endValue durationMs]; type 1 pulse,\n");
+                mexPrintf("                                                    2 gain, 3 freq, 4 rampGain, 5 rampFreq, 6 stop, 7 on/off (value 1/0),\n");
+                mexPrintf("                                                    10 end on zero crossing (value 1/0). Tactor 0 == all.\n");
+                mexPrintf("                        IN: <strong>sampleRate</strong> - (Optional) Hz (default 16000).\n");
+                mexPrintf("                        IN: <strong>duration</strong> - (Optional) Seconds; [] == until the last command ends, plus 100 ms.\n");
+                mexPrintf("                        IN: <strong>tactors</strong> - (Optional) Tactor for each output channel (default 1 to highest used).\n");
+                mexPrintf("                        IN: <strong>filename</strong> - (Optional) Write to a .wav (32-bit float) or raw float32 file instead.\n");
+                mexPrintf("                        IN: <strong>initialGain</strong>, <strong>initialFreq</strong> - (Optional) State before the first command\n");
+                mexPrintf("                                                    (default 255, 300 Hz).\n");
+                mexPrintf("                        Each channel is sin(phase) * gain / 255 while the tactor is on, with phase\n");
+                mexPrintf("                        continuous across frequency changes and ramps linear per sample.\n");
+            }
+            break;
+        case 58:
+            mexPrintf("  'heartbeat'\n");
+            mexPrintf("                         Tell the heartbeat watchdog the control loop is alive (any other call does too).\n");
+            break;
+        case 59:
+            mexPrintf("  'configureHeartbeat', <intervalMs>\n");
+            mexPrintf("                         Stop every device if no call arrives within intervalMs.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with intervalMs, armed, tripped, trips, stopFailures, maxGapMs,\n");
+                mexPrintf("                                          maxTripLatencyMs and the recent trips (log).\n");
+                mexPrintf("                                          Called with no arguments, only returns the status.\n\n");
+                mexPrintf("                        IN: <strong>intervalMs</strong> - Longest allowed time between calls (>= %g ms); 0 == off.\n",
+                          HEARTBEAT_MIN_INTERVAL_US / 1000.0);
+                mexPrintf("                        A trip sends Stop through the priority lane on each connected device, which also\n");
+                mexPrintf("                        cancels renderers, patterns and LFOs. The watchdog re-arms on the next call.\n");
+            }
+            break;
+        case 60:
+            mexPrintf("  'configureAckTracking', <enabled>, <timeoutMs>, <reset>\n");
+            mexPrintf("                         Track each command until the controller acknowledges it (see 'ackStatus').\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>enabled</strong> - true to tag and track commands.\n");
+                mexPrintf("                        IN: <strong>timeoutMs</strong> - (Optional) Unanswered commands are given up on after this (default 1000).\n");
+                mexPrintf("                        IN: <strong>reset</strong> - (Optional) Clear histograms and the timeout log (default false).\n");
+                mexPrintf("                        Responses come through the Connect callback, which only the native serial\n");
+                mexPrintf("                        backend provides; with the EAI DLL every command times out.\n");
+            }
+            break;
+        case 61:
+            mexPrintf("  'ackStatus'\n");
+            mexPrintf("                         Acknowledgement latency per command type, and the commands that timed out.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with counters, outstanding, lastSequence, edgesMs (histogram bin\n");
+                mexPrintf("                                          edges), commands (per type: acked, rejected, timedOut, min/mean/\n");
+                mexPrintf("                                          p50/p90/p99/max ms, counts) and timeouts (the last %d).\n", INFLIGHT_TIMEOUT_LOG);
+            }
+            break;
+        case 62:
+            mexPrintf("  'configureMapping', <deviceID>, <rules>, <tables>, <rate>, <source>\n");
+            mexPrintf("                         Map feature channels to tactor gain/frequency natively at a fixed rate.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>deviceID</strong> - Device identifier.\n");
+                mexPrintf("                        IN: <strong>rules</strong> - N x 11 [tactor target channel transfer inMin inMax outMin outMax shape\n");
+                mexPrintf("                                                 center deadband]; target 1 gain, 2 freq; transfer 1 linear,\n");
+                mexPrintf("                                                 2 power (shape = exponent), 3 sigmoid (shape = slope, center\n");
+                mexPrintf("                                                 in 0 - 1), 4 table (shape = row of tables). [] == stop mapping.\n");
+                mexPrintf("                        IN: <strong>tables</strong> - (Optional) K x %d lookup tables, y over x = 0 - 1.\n", MAP_TABLE_POINTS);
+                mexPrintf("                        IN: <strong>rate</strong> - (Optional) Output rate (Hz, default 100).\n");
+                mexPrintf("                        IN: <strong>source</strong> - (Optional) Shared-memory feature block name (Linux); '' == pushFeatures.\n");
+                mexPrintf("                        Only changes of at least a rule's deadband are sent.\n");
+            }
+            break;
+        case 63:
+            mexPrintf("  'pushFeatures', <deviceID>, <frame>\n");
+            mexPrintf("                         Hand the mapping a feature frame (up to %d channels); the next tick uses it.\n", MAP_MAX_FEATURES);
+            break;
+        case 64:
+            mexPrintf("  'mappingStatus', <deviceID>\n");
+            mexPrintf("                         Mapping counters, frame-to-command latency and the latest targets.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with running, rateHz, source, frames, superseded, ticks, commands,\n");
+                mexPrintf("                                          failed, last/mean/maxLatencyMs, maxTickMs and targets (per rule).\n");
+            }
+            break;
+        case 65:
+            mexPrintf("  'healthCheck', <tactors>, <pulseMs>, <spacingMs>, <timeoutMs>\n");
+            mexPrintf("                         Self-test, segment list and battery on every device at once, then a pulse sweep.\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        IN: <strong>tactors</strong> - (Optional) Tactors to sweep (default 1 - 8; [] == no sweep).\n");
+                mexPrintf("                        IN: <strong>pulseMs</strong> - (Optional) Sweep pulse length (default 50).\n");
+                mexPrintf("                        IN: <strong>spacingMs</strong> - (Optional) Time between sweep pulses (default 100).\n");
+                mexPrintf("                        IN: <strong>timeoutMs</strong> - (Optional) Wait for answers, per phase (default 500).\n");
+                mexPrintf("                <strong>Returns:</strong> Struct with healthy, elapsedMs and devices (per device: deviceID, healthy,\n");
+                mexPrintf("                                          selfTest/segments/battery results, pulse counts, failedTactors).\n");
+            }
+            break;
+        case 66:
+            mexPrintf("  'lock'\n");
+            mexPrintf("                         Keep the engine loaded through 'clear tactor' and 'clear all' (mexLock).\n");
+            if (detailed) {
+                mexPrintf("\n");
+                mexPrintf("                        Connections, configuration and engine threads stay up; the next call\n");
+                mexPrintf("                        after a clear finds them as they were. Use 'unlock' to tear down.\n");
+            }
+            break;
+        case 67:
+            mexPrintf("  'unlock'\n");
+            mexPrintf("                         Full teardown (as 'shutdown'), then allow the MEX to be cleared again.\n");
+            break;
+        case 68:
+            mexPrintf("  'getDeviceIDs'\n");
+            mexPrintf("                         IDs of the devices connected in this session (row vector).\n");
+            break;
         default:
             mexErrMsgIdAndTxt("TDK:UnknownCommand", "Unknown command code: %d", command);
     }
@@ -368,8 +1141,9 @@ void printHelp() {
 // Individual command functions
 void initializeTI() {
     if (isInitialized) return;
-    int result = InitializeTI();
-    handleError(result, "InitializeTI");
+    int errorCode = 0;
+    int result = callTI([] { return InitializeTI(); }, errorCode);
+    handleError(result, "InitializeTI", errorCode);
     if (result == 0) {
         isInitialized = true;
     }
@@ -380,187 +1154,2207 @@ void shutdownTI() {
     isInitialized = false;
 }
 
+// Pin the MEX in memory: everything static (devices, queue, scheduler, caches)
+// outlives 'clear tactor' and 'clear all' until unlockEngine
+void lockEngine() {
+    if (!mexIsLocked()) mexLock();
+}
+
+void unlockEngine() {
+    shutdownTI();
+    if (mexIsLocked()) mexUnlock();
+}
+
+void getDeviceIDs(mxArray*& plhs) {
+    plhs = mxCreateDoubleMatrix(1, deviceConnections.size(), mxREAL);
+    double* ids = mxGetPr(plhs);
+    for (const auto& [deviceID, info] : deviceConnections) *ids++ = deviceID;
+}
+
 void discoverDevices(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
     if (nrhs < 2 || !mxIsNumeric(prhs[1])) {
         mexErrMsgIdAndTxt("TDK:InputError", "Discover requires a device type as an argument.");
     }
     int type = static_cast<int>(mxGetScalar(prhs[1]));
-    int result = Discover(type);
-    handleError(result, "Discover");
+    int errorCode = 0;
+    int result = callTI([&] { return Discover(type); }, errorCode);
+    handleError(result, "Discover", errorCode);
     plhs = mxCreateDoubleScalar(result);
 }
 
-void connectDevice(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
-    if (nrhs < 3 || !mxIsChar(prhs[1]) || !mxIsNumeric(prhs[2])) {
-        mexErrMsgIdAndTxt("TDK:InputError", "Connect requires a device name (string) and type (integer).");
+// Parse a name from a fixed list; returns its index
+uint8_t decodeChoice(const mxArray* arr, const char* const* choices, int count, const char* what) {
+    char name[16] = "";
+    if (mxIsChar(arr)) mxGetString(arr, name, sizeof(name));
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, choices[i]) == 0) return static_cast<uint8_t>(i);
     }
-    if (isConnected) {
-        mexErrMsgIdAndTxt("TDK:ConnectionError", "Already connected to a device. Close the current connection first.");
-    }
-    char deviceName[64];
-    mxGetString(prhs[1], deviceName, sizeof(deviceName));
-    int type = static_cast<int>(mxGetScalar(prhs[2]));
-    int deviceID = Connect(deviceName, type, nullptr);
-    handleError(deviceID, "Connect");
-    deviceConnections[deviceID] = type;
-    plhs = mxCreateDoubleScalar(deviceID);
-    isConnected = true;
+    mexErrMsgIdAndTxt("TDK:InputError", "Unknown %s '%s'.", what, name);
+    return 0;
 }
 
-void checkConnection(mxArray*& plhs) {
-    plhs = mxCreateLogicalScalar(isConnected);
+// Read an optional integer field of a profile struct (PROFILE_UNSET when absent or empty)
+int decodeProfileField(const mxArray* s, mwIndex i, const char* name, int lo, int hi) {
+    const mxArray* field = mxGetField(s, i, name);
+    if (!field || mxIsEmpty(field)) return PROFILE_UNSET;
+    double value = (mxIsNumeric(field) || mxIsLogical(field)) ? mxGetScalar(field) : NAN;
+    if (!(value >= lo && value <= hi) || value != std::floor(value)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Profile field '%s' must be an integer %d - %d.", name, lo, hi);
+    }
+    return static_cast<int>(value);
 }
 
-void pulseTactor(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 5) {
-        mexErrMsgIdAndTxt("TDK:InputError", "Pulse requires deviceID, tactor number, duration, and delay.");
+// Tactor type by name ('C3', 'C2', 'EMS', 'EMR') or TDK_TACTOR_TYPE_* code
+int decodeTactorType(const mxArray* s, mwIndex i) {
+    static const char* const names[] = {"C3", "C2", "EMS", "EMR"};
+    static const int codes[] = {TDK_TACTOR_TYPE_C3, TDK_TACTOR_TYPE_C2, TDK_TACTOR_TYPE_EMS, TDK_TACTOR_TYPE_EMR};
+    const mxArray* field = mxGetField(s, i, "tactorType");
+    if (!field || mxIsEmpty(field)) return PROFILE_UNSET;
+    if (mxIsChar(field)) return codes[decodeChoice(field, names, 4, "tactor type")];
+    int code = decodeProfileField(s, i, "tactorType", 0, 255);
+    for (int c : codes) {
+        if (c == code) return code;
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacNum = static_cast<int>(mxGetScalar(prhs[2]));
-    int duration = static_cast<int>(mxGetScalar(prhs[3]));
-    int delay = static_cast<int>(mxGetScalar(prhs[4]));
-
-    int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
-    handleError(internalUpdateResult, "UpdateTI");
-
-    int actualPulseFunctionResult = Pulse(deviceID, tacNum, duration, delay);
-    handleError(actualPulseFunctionResult, "Pulse");
+    mexErrMsgIdAndTxt("TDK:InputError", "Unknown tactor type code %d.", code);
+    return PROFILE_UNSET;
 }
 
-void setState(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 3) {
-        mexErrMsgIdAndTxt("TDK:InputError", "SetState requires deviceID and states (64-bit mask of ON/OFF with tactor1 == LSB).");
+void checkProfileFields(const mxArray* s, const char* const* allowed, int count, const char* what) {
+    for (int f = 0; f < mxGetNumberOfFields(s); f++) {
+        const char* name = mxGetFieldNameByNumber(s, f);
+        bool known = false;
+        for (int k = 0; k < count && !known; k++) known = strcmp(name, allowed[k]) == 0;
+        if (!known) mexErrMsgIdAndTxt("TDK:InputError", "Unknown %s field '%s'.", what, name);
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    unsigned char* states = (unsigned char*)mxGetData(prhs[2]);
-    int result = SetTactors(deviceID, 0, states);
-    handleError(result, "SetTactors");
 }
 
-void changeGain(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 5) {
-        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, gain value, and delay.");
+void decodeTactorSettings(const mxArray* s, mwIndex i, TactorSettings& settings) {
+    settings.type = decodeTactorType(s, i);
+    settings.sigSource = decodeProfileField(s, i, "sigSource", TDK_SIG_SRC_PRIMARY, TDK_SIG_SRC_PRIMARY_MOD_NOISE);
+    settings.freq = decodeProfileField(s, i, "freq", MIN_ACTION_FREQUENCY, MAX_ACTION_FREQUENCY);
+    settings.gain = decodeProfileField(s, i, "gain", 0, MAX_ACTION_GAIN);
+}
+
+// Decode a profile struct:
+//   timeFactor, endOnZeroCrossing, tactorType, sigSource, freq, gain (device-wide)
+//   tactors - struct array (or cell of structs) with tactor and any of
+//             tactorType, sigSource, freq, gain
+void decodeProfile(const mxArray* arr, DeviceProfile& profile) {
+    static const char* const deviceFields[] = {"timeFactor", "endOnZeroCrossing", "tactorType", "sigSource",
+                                               "freq", "gain", "tactors"};
+    static const char* const tactorFields[] = {"tactor", "tactorType", "sigSource", "freq", "gain"};
+    if (!mxIsStruct(arr) || mxGetNumberOfElements(arr) != 1) {
+        mexErrMsgIdAndTxt("TDK:InputError", "A profile must be a scalar struct.");
+    }
+    checkProfileFields(arr, deviceFields, 7, "profile");
+    profile = DeviceProfile();
+    profile.timeFactor = decodeProfileField(arr, 0, "timeFactor", 1, 255);
+    profile.freqTimeDelay = decodeProfileField(arr, 0, "endOnZeroCrossing", 0, 1);
+    decodeTactorSettings(arr, 0, profile.tactors[0]);
+    const mxArray* tactors = mxGetField(arr, 0, "tactors");
+    if (!tactors || mxIsEmpty(tactors)) return;
+    bool isCell = mxIsCell(tactors);
+    if (!isCell && !mxIsStruct(tactors)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Profile field 'tactors' must be a struct array.");
+    }
+    size_t n = mxGetNumberOfElements(tactors);
+    for (size_t k = 0; k < n; k++) {
+        const mxArray* s = isCell ? mxGetCell(tactors, k) : tactors;
+        mwIndex i = isCell ? 0 : k;
+        if (!s || !mxIsStruct(s)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Profile field 'tactors' must be a struct array.");
+        }
+        checkProfileFields(s, tactorFields, 5, "profile tactor");
+        int tacNum = decodeProfileField(s, i, "tactor", 1, ENGINE_MAX_TACTOR);
+        if (tacNum == PROFILE_UNSET) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Each profile tactor entry needs a tactor number (1 - %d).", ENGINE_MAX_TACTOR);
+        }
+        decodeTactorSettings(s, i, profile.tactors[tacNum]);
+    }
+}
+
+// Apply a profile and raise an error naming the call that failed
+ProfileReport applyProfileChecked(int deviceID, const DeviceProfile& profile) {
+    ProfileReport report;
+    {
+        std::lock_guard<std::mutex> lock(tiMutex);
+        report = applyProfileLocked(deviceID, profile);
+    }
+    handleError(report.result, report.failedCall ? report.failedCall : "ApplyProfile", report.errorCode);
+    return report;
+}
+
+void connectDevice(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 3 || !mxIsChar(prhs[1]) || !mxIsNumeric(prhs[2])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Connect requires a device name (string) and type (integer), and optionally a profile.");
+    }
+    if (isConnected) {
+        mexErrMsgIdAndTxt("TDK:ConnectionError", "Already connected to a device. Close the current connection first.");
+    }
+    char deviceName[64];
+    mxGetString(prhs[1], deviceName, sizeof(deviceName));
+    int type = static_cast<int>(mxGetScalar(prhs[2]));
+    bool hasProfile = nrhs > 3 && !mxIsEmpty(prhs[3]);
+    DeviceProfile profile;
+    if (hasProfile) decodeProfile(prhs[3], profile); // Before connecting, so a bad profile leaves no connection
+#if defined(TDK_SERIAL_BACKEND)
+    if (!serialWarningShown) {
+        serialWarningShown = true;
+        mexWarnMsgIdAndTxt("TDK:Experimental", "The native serial backend's packet framing has not been verified against "
+                           "TDK hardware. Check the device responds as expected before relying on it.");
+    }
+#endif
+    int errorCode = 0;
+    int deviceID = callTI([&] { return Connect(deviceName, type, ackCallback()); }, errorCode);
+    handleError(deviceID, "Connect", errorCode);
+    deviceConnections[deviceID] = {deviceName, type};
+    if (deviceID >= 0 && deviceID < 64) heartbeatDevices.fetch_or(uint64_t{1} << deviceID, std::memory_order_release);
+    watchDevice(deviceID, deviceName, type);
+    isConnected = true;
+    if (hasProfile) applyProfileChecked(deviceID, profile);
+    plhs = mxCreateDoubleScalar(deviceID);
+}
+
+void checkConnection(mxArray*& plhs) {
+    if (numOutputs > 0) plhs = mxCreateLogicalScalar(isConnected);
+}
+
+// Send a command, either through the I/O queue or directly. Direct realtime
+// commands are preceded by UpdateTI, as the DLL expects, and go through the
+// device's flow control like queued ones.
+void sendCommand(const TactorCommand& cmd, const char* functionName, bool update) {
+    TRACE_SCOPE("send");
+    int errorCode = 0;
+    if (CommandSink sink = commandSink.load(std::memory_order_acquire)) {
+        int result = sink(cmd, update ? COMMAND_FLAG_UPDATE : 0, &errorCode);
+        handleError(result, functionName, errorCode);
+        return;
+    }
+    if (queueEnabled.load(std::memory_order_acquire)) {
+        int result = enqueueCommand(cmd, &errorCode);
+        handleError(result, functionName, errorCode);
+        return;
+    }
+    if (update) {
+        int internalUpdateResult = updateInterface(&errorCode); // Update the Tactor Interface
+        handleError(internalUpdateResult, "UpdateTI", errorCode);
+    }
+    int result = issueWithFlowControl(cmd, &errorCode, getFlowConfig().maxWaitUs);
+    handleError(result, functionName, errorCode);
+}
+
+// Range-check a decoded command under the session validation policy
+void checkRange(TactorCommand& cmd, const char* functionName) {
+    uint8_t policy = validationPolicy.load(std::memory_order_relaxed);
+    if (policy == VALIDATE_OFF) return;
+    TactorCommand original = cmd;
+    unsigned invalid = validateCommand(cmd);
+    if (invalid == 0) return;
+    if (policy == VALIDATE_CLAMP) {
+        validationClamped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    validationRejected.fetch_add(1, std::memory_order_relaxed);
+    int value = 0;
+    FieldLimits limits;
+    const char* field = invalidField(original.type, invalid, original, &value, &limits);
+    if (limits.hi == INT_MAX) {
+        mexErrMsgIdAndTxt("TDK:OutOfRange", "%s: %s %d is below %d.", functionName, field, value, limits.lo);
+    }
+    mexErrMsgIdAndTxt("TDK:OutOfRange", "%s: %s %d is outside %d - %d.", functionName, field, value, limits.lo, limits.hi);
+}
+
+void decodePulse(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 5) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Pulse requires deviceID, tactor number, duration, and delay.");
+    }
+    cmd.type = CMD_PULSE;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.duration = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.delay = static_cast<int>(mxGetScalar(prhs[4]));
+    checkRange(cmd, "Pulse");
+}
+
+void pulseTactor(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodePulse(nrhs, prhs, cmd);
+    sendCommand(cmd, "Pulse", true);
+}
+
+// Decode a tactor on/off frame: uint64 scalar, logical vector (up to 64), or the
+// raw 8-byte uint8 SetTactors layout. Returns false if the array is none of those.
+bool decodeTactorMask(const mxArray* arr, uint64_t& mask) {
+    size_t n = mxGetNumberOfElements(arr);
+    mask = 0;
+    if (mxGetClassID(arr) == mxUINT64_CLASS && n == 1) {
+        mask = *static_cast<const uint64_t*>(mxGetData(arr));
+        return true;
+    }
+    if (mxIsLogical(arr) && n >= 1 && n <= 64) {
+        const mxLogical* states = mxGetLogicals(arr);
+        for (size_t i = 0; i < n; i++) {
+            mask |= static_cast<uint64_t>(states[i] != 0) << i;
+        }
+        return true;
+    }
+    if (mxGetClassID(arr) == mxUINT8_CLASS && n == 8) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(mxGetData(arr));
+        for (size_t i = 0; i < 8; i++) {
+            mask |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return true;
+    }
+    return false;
+}
+
+void decodeSetState(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "SetState requires deviceID and states (64-bit mask of ON/OFF with tactor1 == LSB).");
+    }
+    cmd.type = CMD_SET_TACTORS;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    if (!decodeTactorMask(prhs[2], cmd.mask)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "States must be a uint64 scalar, a logical vector of up to 64 tactors, or 8 uint8 bytes.");
+    }
+}
+
+void setState(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeSetState(nrhs, prhs, cmd);
+    sendCommand(cmd, "SetTactors", false);
+}
+
+void decodeChangeGain(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 5) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, gain value, and delay.");
+    }
+    cmd.type = CMD_CHANGE_GAIN;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.value = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.delay = static_cast<int>(mxGetScalar(prhs[4]));
+    checkRange(cmd, "ChangeGain");
+}
+
+void changeGain(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeChangeGain(nrhs, prhs, cmd);
+    sendCommand(cmd, "ChangeGain", true);
+}
+
+void decodeChangeFreq(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 5) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ChangeFreq requires deviceID, tactor number, freq value (300 - 3500), and delay.");
+    }
+    cmd.type = CMD_CHANGE_FREQ;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.value = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.delay = static_cast<int>(mxGetScalar(prhs[4]));
+    checkRange(cmd, "ChangeFreq");
+}
+
+void changeFreq(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeChangeFreq(nrhs, prhs, cmd);
+    sendCommand(cmd, "ChangeFreq", true);
+}
+
+void decodeSigSource(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 4) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ChangeSigSource requires deviceID, tactor number, sig source type (1 - 7), and optionally delay.");
+    }
+    cmd.type = CMD_SIG_SOURCE;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.value = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.delay = nrhs > 4 ? static_cast<int>(mxGetScalar(prhs[4])) : 0;
+    if (cmd.value < TDK_SIG_SRC_PRIMARY || cmd.value > TDK_SIG_SRC_PRIMARY_MOD_NOISE) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Sig source type must be 1 - 7 (1 = primary, 2 = modulation, 4 = noise; OR-able).");
+    }
+    checkRange(cmd, "ChangeSigSource");
+}
+
+void changeSigSource(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeSigSource(nrhs, prhs, cmd);
+    sendCommand(cmd, "ChangeSigSource", true);
+}
+
+void getName(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2) mexErrMsgIdAndTxt("TDK:InputError", "getName requires an index.");
+    int index = static_cast<int>(mxGetScalar(prhs[1]));
+    const char* deviceName;
+    {
+        std::lock_guard<std::mutex> lock(tiMutex);
+        deviceName = GetDiscoveredDeviceName(index);
+    }
+    if (!deviceName) handleError(GetLastEAIError(), "getName");
+    plhs = mxCreateString(deviceName); // Return the device name
+}
+
+void decodeRampFreq(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 7) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, start frequency (300 - 3500), end frequency (300 - 3500), ramp duration, and delay.");
+    }
+    cmd.type = CMD_RAMP_FREQ;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.value = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.endValue = static_cast<int>(mxGetScalar(prhs[4]));
+    cmd.duration = static_cast<int>(mxGetScalar(prhs[5]));
+    cmd.delay = static_cast<int>(mxGetScalar(prhs[6]));
+    checkRange(cmd, "RampFreq");
+}
+
+void rampFreq(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeRampFreq(nrhs, prhs, cmd);
+
+    // int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
+    // handleError(internalUpdateResult, "UpdateTI");
+
+    sendCommand(cmd, "RampFreq", false);
+}
+
+void decodeRampGain(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 7) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, start gain (0 - 255), end gain (0 - 255), ramp duration, and delay.");
+    }
+    cmd.type = CMD_RAMP_GAIN;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    cmd.value = static_cast<int>(mxGetScalar(prhs[3]));
+    cmd.endValue = static_cast<int>(mxGetScalar(prhs[4]));
+    cmd.duration = static_cast<int>(mxGetScalar(prhs[5]));
+    cmd.delay = static_cast<int>(mxGetScalar(prhs[6]));
+    checkRange(cmd, "RampGain");
+}
+
+void rampGain(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeRampGain(nrhs, prhs, cmd);
+
+    // int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
+    // handleError(internalUpdateResult, "UpdateTI");
+
+    sendCommand(cmd, "RampGain", false);
+}
+
+void setTimeFactor(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "SetTimeFactor requires a byte value (1 - 255).");
+    }
+    int value = static_cast<int>(mxGetScalar(prhs[1]));
+
+    int errorCode = 0;
+    int result = callTI([&] {
+        int r = SetTimeFactor(value);
+        if (r >= 0) appliedTimeFactor = value;
+        return r;
+    }, errorCode);
+    handleError(result, "SetTimeFactor", errorCode);
+}
+
+void decodeStop(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Stop requires deviceID.");
+    }
+    cmd.type = CMD_STOP;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.delay = nrhs > 2 ? static_cast<int>(mxGetScalar(prhs[2])) : 0;
+    checkRange(cmd, "Stop");
+}
+
+void stopTactor(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeStop(nrhs, prhs, cmd);
+    int errorCode = 0;
+    int result = issuePriority(cmd, callStartUs, &errorCode);
+    handleError(result, "Stop", errorCode);
+}
+
+void decodeSilence(int nrhs, const mxArray* prhs[], TactorCommand& cmd) {
+    TRACE_SCOPE("decode");
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Silence requires deviceID and tactor number.");
+    }
+    cmd.type = CMD_CHANGE_GAIN;
+    cmd.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    cmd.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    if (cmd.tacNum < 1 || cmd.tacNum > ENGINE_MAX_TACTOR) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Silence needs a tactor number between 1 and %d (use 'stop' for the whole device).", ENGINE_MAX_TACTOR);
+    }
+}
+
+void silenceTactor(int nrhs, const mxArray* prhs[]) {
+    TactorCommand cmd;
+    decodeSilence(nrhs, prhs, cmd);
+    int errorCode = 0;
+    int result = issuePriority(cmd, callStartUs, &errorCode);
+    handleError(result, "ChangeGain", errorCode);
+}
+
+// Decode one command for a slot. args[0] is the command name or uint8 code;
+// the rest are the command's usual arguments.
+bool decodeArmedCommand(int nargs, const mxArray* args[], TactorCommand& cmd) {
+    uint8_t code = 0;
+    if (mxIsChar(args[0])) {
+        char name[64];
+        mxGetString(args[0], name, sizeof(name));
+        code = stringCommandToCode(name);
+    } else if (mxGetClassID(args[0]) == mxUINT8_CLASS) {
+        code = static_cast<uint8_t>(mxGetScalar(args[0]));
+    }
+    switch (code) {
+        case 7:
+            decodeChangeGain(nargs, args, cmd);
+            return true;
+        case 8:
+            decodeChangeFreq(nargs, args, cmd);
+            return true;
+        case 9:
+            decodeRampGain(nargs, args, cmd);
+            return false;
+        case 10:
+            decodeRampFreq(nargs, args, cmd);
+            return false;
+        case 11:
+            decodePulse(nargs, args, cmd);
+            return true;
+        case 12:
+            decodeStop(nargs, args, cmd);
+            return false;
+        case 13:
+            decodeSetState(nargs, args, cmd);
+            return false;
+        case 30:
+            decodeSigSource(nargs, args, cmd);
+            return true;
+        case 32:
+            decodeSilence(nargs, args, cmd);
+            return false;
+        default:
+            mexErrMsgIdAndTxt("TDK:InputError", "Command code %d can't be armed.", code);
+    }
+    return false;
+}
+
+void armSlot(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 3 || !mxIsCell(prhs[2])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Arm requires a slot (1 - %d) and a command cell, e.g. {'pulse', deviceID, 1, 100, 0}.", ARM_SLOTS);
+    }
+    int slot = static_cast<int>(mxGetScalar(prhs[1]));
+    if (slot < 1 || slot > ARM_SLOTS) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Slot must be between 1 and %d.", ARM_SLOTS);
+    }
+    // A cell whose first element is itself a cell is a sequence
+    const mxArray* commands = prhs[2];
+    size_t n = mxGetNumberOfElements(commands);
+    bool sequence = n > 0 && mxIsCell(mxGetCell(commands, 0));
+    size_t count = sequence ? n : (n > 0 ? 1 : 0);
+    if (count > ARM_MAX_COMMANDS) {
+        mexErrMsgIdAndTxt("TDK:InputError", "A slot holds at most %d commands.", ARM_MAX_COMMANDS);
+    }
+
+    ArmedSlot armed;
+    for (size_t k = 0; k < count; k++) {
+        const mxArray* command = sequence ? mxGetCell(commands, k) : commands;
+        size_t nargs = mxIsCell(command) ? mxGetNumberOfElements(command) : 0;
+        if (nargs < 1 || nargs > 8) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Armed command %d must be a cell of 1 - 8 elements: {name, args...}.", static_cast<int>(k + 1));
+        }
+        const mxArray* args[8];
+        for (size_t a = 0; a < nargs; a++) {
+            args[a] = mxGetCell(command, a);
+            if (!args[a]) {
+                mexErrMsgIdAndTxt("TDK:InputError", "Armed command %d has an empty argument.", static_cast<int>(k + 1));
+            }
+        }
+        armed.update |= decodeArmedCommand(static_cast<int>(nargs), args, armed.cmds[k]);
+    }
+    armed.count = static_cast<int>(count);
+    armedSlots[slot - 1] = armed; // Only replaced once every command decoded
+    plhs = mxCreateDoubleScalar(static_cast<double>(count));
+}
+
+void fireArmedSlot(int nrhs, const mxArray* prhs[]) {
+    TRACE_SCOPE("fire");
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Fire requires a slot (1 - %d).", ARM_SLOTS);
+    }
+    int slot = static_cast<int>(mxGetScalar(prhs[1]));
+    if (slot < 1 || slot > ARM_SLOTS || armedSlots[slot - 1].count == 0) {
+        mexErrMsgIdAndTxt("TDK:NotArmed", "Slot %d is not armed.", slot);
+    }
+    int errorCode = 0;
+    int result = fireSlot(slot - 1, callStartUs, &errorCode);
+    handleError(result, "Fire", errorCode);
+}
+
+void beginStoreTAction(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "BeginStoreTACtion requires deviceID and TActionID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int tacID = static_cast<int>(mxGetScalar(prhs[2]));
+    int errorCode = 0;
+    int result = callTI([&] { return BeginStoreTAction(physicalDeviceID(deviceID), tacID); }, errorCode);
+    handleError(result, "BeginStoreTAction", errorCode);
+}
+
+void finishStoreTAction(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "FinishStoreTACtion requires deviceID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int errorCode = 0;
+    int result = callTI([&] { return FinishStoreTAction(physicalDeviceID(deviceID)); }, errorCode);
+    handleError(result, "FinishStoreTAction", errorCode);
+}
+
+void playStoredTAction(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 4) {
+        mexErrMsgIdAndTxt("TDK:InputError", "BeginStoreTACtion requires deviceID and TActionID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int delay = static_cast<int>(mxGetScalar(prhs[2])); 
+    int tacID = static_cast<int>(mxGetScalar(prhs[3]));
+    int errorCode = 0;
+    int result = callTI([&] { return PlayStoredTAction(physicalDeviceID(deviceID), delay, tacID); }, errorCode);
+    handleError(result, "PlayStoredTAction", errorCode);
+}
+
+void loadLayout(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 3 || !mxIsDouble(prhs[2])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "LoadLayout requires deviceID and an N x 2 or N x 3 matrix of tactor positions.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    size_t n = mxGetM(prhs[2]);
+    size_t dims = mxGetN(prhs[2]);
+    if (n < 1 || (dims != 2 && dims != 3)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Tactor positions must be an N x 2 or N x 3 matrix.");
+    }
+    const double* positions = mxGetPr(prhs[2]);
+
+    TactorLayout layout;
+    layout.dims = static_cast<int>(dims);
+    layout.tacNum.resize(n);
+    layout.x.resize(n);
+    layout.y.resize(n);
+    layout.z.assign(n, 0.0f);
+    for (size_t i = 0; i < n; i++) {
+        layout.tacNum[i] = static_cast<int>(i + 1);
+        layout.x[i] = static_cast<float>(positions[i]);
+        layout.y[i] = static_cast<float>(positions[n + i]);
+        if (dims == 3) layout.z[i] = static_cast<float>(positions[2 * n + i]);
+        if (!std::isfinite(layout.x[i]) || !std::isfinite(layout.y[i]) || !std::isfinite(layout.z[i])) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Tactor positions must be finite.");
+        }
+    }
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        if (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3]) != n) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Tactor numbers must be a double vector with one entry per position row.");
+        }
+        const double* tactors = mxGetPr(prhs[3]);
+        for (size_t i = 0; i < n; i++) {
+            layout.tacNum[i] = static_cast<int>(tactors[i]);
+        }
+    }
+    // A radius far below the layout's extent would make the grid index huge
+    float minRadius = minLayoutRadius(layout);
+    layout.radius = std::max(1.5f * meanNeighbourSpacing(layout), minRadius);
+    if (!(layout.radius > 0.0f)) layout.radius = 1.0f; // Every site at one point
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        layout.radius = static_cast<float>(mxGetScalar(prhs[4]));
+        if (!(layout.radius > 0.0f) || !std::isfinite(layout.radius)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Layout radius must be positive.");
+        }
+        if (layout.radius < minRadius) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Layout radius must be at least %g (the layout's extent / %d).",
+                              minRadius, LAYOUT_MAX_GRID_SIDE - 1);
+        }
+    }
+    if (nrhs > 5 && mxIsLogicalScalarTrue(prhs[5])) {
+        // Only confirms the controller answers for the device before we render
+        // to it; the segment list comes back through the Connect callback and
+        // isn't compared with the layout.
+        int errorCode = 0;
+        int result = callTI([&] { return ReadSegmentList(physicalDeviceID(deviceID), 0); }, errorCode);
+        handleError(result, "ReadSegmentList", errorCode);
+    }
+    buildSpatialIndex(layout);
+
+    // MATLAB errors never unwind through a held lock, so only record state here
+    bool running = false;
+    float radius = layout.radius;
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        PhantomRenderer& renderer = renderers[deviceID];
+        running = renderer.taskID != 0;
+        if (!running) {
+            renderer.layout = std::move(layout);
+            renderer.sentGain.assign(n, 0);
+            renderer.activeSites.clear();
+        }
+    }
+    if (running) {
+        mexErrMsgIdAndTxt("TDK:RendererRunning", "Stop the renderer for device %d before loading a new layout.", deviceID);
+    }
+    plhs = mxCreateDoubleScalar(radius);
+}
+
+void setStimulus(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 4 || !mxIsDouble(prhs[2])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "SetStimulus requires deviceID, position (1 x 2 or 1 x 3), and intensity (0 - 1).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    PhantomStimulus stim;
+    size_t dims = mxGetNumberOfElements(prhs[2]);
+    if (dims != 2 && dims != 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Stimulus position must have 2 or 3 elements.");
+    }
+    const double* p0 = mxGetPr(prhs[2]);
+    for (size_t k = 0; k < dims; k++) stim.p0[k] = static_cast<float>(p0[k]);
+    stim.intensity = static_cast<float>(mxGetScalar(prhs[3]));
+    stim.active = stim.intensity > 0.0f;
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        if (!mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) != dims) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Stimulus end position must match the size of position.");
+        }
+        const double* p1 = mxGetPr(prhs[4]);
+        for (size_t k = 0; k < dims; k++) stim.p1[k] = static_cast<float>(p1[k]);
+        stim.isLine = true;
+    }
+    if (nrhs > 5) {
+        char model[16];
+        mxGetString(prhs[5], model, sizeof(model));
+        if (strcmp(model, "linear") == 0) {
+            stim.model = MODEL_LINEAR;
+        } else if (strcmp(model, "energy") != 0) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Unknown summation model: %s (expected 'energy' or 'linear').", model);
+        }
+    }
+
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        auto it = renderers.find(deviceID);
+        if (it != renderers.end()) {
+            std::lock_guard<std::mutex> stimLock(stimulusMutex);
+            it->second.stimulus = stim;
+            found = true;
+        }
+    }
+    if (!found) {
+        mexErrMsgIdAndTxt("TDK:NoLayout", "No layout loaded for device %d. Call 'loadLayout' first.", deviceID);
+    }
+}
+
+void startRenderer(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "StartRenderer requires deviceID and optionally a rate (Hz).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    double rate = nrhs > 2 ? mxGetScalar(prhs[2]) : 100.0;
+    if (!(rate >= 1.0 && rate <= 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Render rate must be between 1 and 1000 Hz.");
+    }
+    int previousTask = -1;
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        auto it = renderers.find(deviceID);
+        if (it != renderers.end()) previousTask = it->second.taskID;
+    }
+    if (previousTask < 0) {
+        mexErrMsgIdAndTxt("TDK:NoLayout", "No layout loaded for device %d. Call 'loadLayout' first.", deviceID);
+    }
+    // Scheduler tasks take renderMutex, so never (un)register while holding it
+    if (previousTask > 0) removePeriodicTask(previousTask);
+    int taskID = addPeriodicTask(rate, [deviceID](int64_t) {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        auto it = renderers.find(deviceID);
+        if (it != renderers.end()) renderPhantomFrame(deviceID, it->second);
+    });
+    std::lock_guard<std::mutex> lock(renderMutex);
+    renderers[deviceID].taskID = taskID;
+}
+
+void stopRenderer(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "StopRenderer requires deviceID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        auto it = renderers.find(deviceID);
+        if (it == renderers.end()) return;
+        taskID = it->second.taskID;
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+
+    std::lock_guard<std::mutex> lock(renderMutex);
+    PhantomRenderer& renderer = renderers[deviceID];
+    renderer.taskID = 0;
+    {
+        std::lock_guard<std::mutex> stimLock(stimulusMutex);
+        renderer.stimulus.active = false;
+    }
+    renderPhantomFrame(deviceID, renderer); // Drives every rendered tactor back to 0
+}
+
+void writeFrame(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "WriteFrame requires deviceID and a frame (logical vector or uint64 mask).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    TactorFrame frame;
+    if (!decodeTactorMask(prhs[2], frame.mask)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Frame must be a uint64 scalar, a logical vector of up to 64 tactors, or 8 uint8 bytes.");
+    }
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        size_t n = mxGetNumberOfElements(prhs[3]);
+        if (n > 64) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Frame gains can cover at most 64 tactors.");
+        }
+        if (mxIsDouble(prhs[3])) {
+            // 0 - 1 gains; NaN leaves that tactor's gain unchanged
+            const double* gains = mxGetPr(prhs[3]);
+            for (size_t i = 0; i < n; i++) {
+                if (gains[i] != gains[i]) continue;
+                double g = gains[i] < 0.0 ? 0.0 : (gains[i] > 1.0 ? 1.0 : gains[i]);
+                frame.gain[i] = static_cast<uint8_t>(255.0 * g + 0.5);
+                frame.gainMask |= uint64_t(1) << i;
+            }
+        } else if (mxGetClassID(prhs[3]) == mxUINT8_CLASS) {
+            const uint8_t* gains = static_cast<const uint8_t*>(mxGetData(prhs[3]));
+            for (size_t i = 0; i < n; i++) {
+                frame.gain[i] = gains[i];
+            }
+            frame.gainMask = n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+        } else {
+            mexErrMsgIdAndTxt("TDK:InputError", "Frame gains must be double (0 - 1) or uint8 (0 - 255).");
+        }
+    }
+    writeBackFrame(deviceID, frame);
+    if (nrhs > 4 && mxIsLogicalScalarTrue(prhs[4])) {
+        int errorCode = 0;
+        int sent = commitFrame(deviceID, &errorCode);
+        handleError(sent, "CommitFrame", errorCode);
+        if (numOutputs > 0) plhs = mxCreateDoubleScalar(sent);
+    }
+}
+
+void commitFrameCommand(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "CommitFrame requires deviceID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int errorCode = 0;
+    int sent = commitFrame(deviceID, &errorCode);
+    handleError(sent, "CommitFrame", errorCode);
+    if (numOutputs > 0) plhs = mxCreateDoubleScalar(sent);
+}
+
+void startFrameCommit(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "StartFrameCommit requires deviceID and optionally a rate (Hz).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    double rate = nrhs > 2 ? mxGetScalar(prhs[2]) : 100.0;
+    if (!(rate >= 1.0 && rate <= 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Commit rate must be between 1 and 1000 Hz.");
+    }
+    int previousTask = 0;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        previousTask = frameBuffers[deviceID].taskID;
+    }
+    if (previousTask != 0) removePeriodicTask(previousTask);
+    int taskID = addPeriodicTask(rate, [deviceID](int64_t) {
+        commitFrame(deviceID); // Failures stay dirty and retry next tick
+    });
+    std::lock_guard<std::mutex> lock(frameMutex);
+    frameBuffers[deviceID].taskID = taskID;
+}
+
+void stopFrameCommit(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "StopFrameCommit requires deviceID.");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    int taskID = 0;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        auto it = frameBuffers.find(deviceID);
+        if (it == frameBuffers.end()) return;
+        taskID = it->second.taskID;
+        it->second.taskID = 0;
+    }
+    if (taskID != 0) removePeriodicTask(taskID);
+}
+
+void configureQueue(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureQueue requires enabled (logical) and optionally the maximum staleness (ms).");
+    }
+    bool enabled = mxGetScalar(prhs[1]) != 0.0;
+    double stalenessMs = nrhs > 2 ? mxGetScalar(prhs[2]) : 0.0;
+    if (!(stalenessMs >= 0.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Maximum staleness must be >= 0 ms (0 = unbounded).");
+    }
+    if (enabled) {
+        startQueue(static_cast<int64_t>(stalenessMs * 1000.0));
+    } else {
+        stopQueue();
+    }
+}
+
+constexpr int STATS_MAX_FIELDS = 96;
+
+// Build a 1x1 struct of scalar statistics
+mxArray* createStatsStruct(const StatField* fields, int count) {
+    const char* names[STATS_MAX_FIELDS];
+    for (int i = 0; i < count; i++) names[i] = fields[i].name;
+    mxArray* out = mxCreateStructMatrix(1, 1, count, names);
+    for (int i = 0; i < count; i++) {
+        mxSetField(out, 0, fields[i].name, mxCreateDoubleScalar(fields[i].value));
+    }
+    return out;
+}
+
+void getStats(mxArray*& plhs) {
+#if defined(TDK_COUNT_ALLOCS)
+    uint64_t allocations = heapAllocations.load(std::memory_order_relaxed); // Before this call allocates anything
+#endif
+    uint64_t depth = 0;
+    QueueStats q = getQueueStats(&depth);
+    int linksDown = 0;
+    uint64_t dropped = 0;
+    ReconnectStats r = getReconnectStats(&linksDown, &dropped);
+    PriorityStats p = getPriorityStats();
+    uint64_t priorityCommands = p.stops + p.silences;
+    const FireStats& f = fireStats;
+    int activeEffects = 0;
+    MixerStats m = getMixerStats(&activeEffects);
+    ProfileReport profile;
+    {
+        std::lock_guard<std::mutex> lock(tiMutex);
+        profile = lastProfileReport;
+    }
+    HeartbeatStats h;
+    {
+        std::lock_guard<std::mutex> lock(heartbeatMutex);
+        h = heartbeatStats;
+    }
+    MappingStats mapping = getMappingStats();
+    AckStats a;
+    {
+        std::lock_guard<std::mutex> lock(ackMutex);
+        a = ackStats;
+    }
+    int activeLfos = 0;
+    LfoStats l;
+    {
+        std::lock_guard<std::mutex> lock(lfoMutex);
+        for (const auto& lfo : lfos) activeLfos += lfo.id != 0 ? 1 : 0;
+        l = lfoStats;
+    }
+    const StatField fields[] = {
+        {"queueEnabled", queueEnabled.load() ? 1.0 : 0.0},
+        {"queueDepth", static_cast<double>(depth)},
+        {"maxQueueDepth", static_cast<double>(q.maxDepth)},
+        {"submitted", static_cast<double>(q.submitted)},
+        {"coalesced", static_cast<double>(q.coalesced)},
+        {"issued", static_cast<double>(q.issued)},
+        {"failed", static_cast<double>(q.failed)},
+        {"expired", static_cast<double>(q.expired)},
+        {"rejected", static_cast<double>(q.rejected)},
+        {"purged", static_cast<double>(q.purged)},
+        {"maxStalenessMs", maxStalenessUs / 1000.0},
+        {"maxAgeMs", q.maxAgeUs / 1000.0},
+        {"lastError", static_cast<double>(q.lastError)},
+        {"schedulerOverruns", static_cast<double>(schedulerOverruns)},
+        {"stops", static_cast<double>(p.stops)},
+        {"silences", static_cast<double>(p.silences)},
+        {"lastStopLatencyMs", p.lastLatencyUs / 1000.0},
+        {"maxStopLatencyMs", p.maxLatencyUs / 1000.0},
+        {"meanStopLatencyMs", priorityCommands ? p.totalLatencyUs / 1000.0 / priorityCommands : 0.0},
+        {"haltDropped", static_cast<double>(haltDropped.load())},
+        {"validationClamped", static_cast<double>(validationClamped.load())},
+        {"validationRejected", static_cast<double>(validationRejected.load())},
+        {"fires", static_cast<double>(f.fires)},
+        {"fireFailures", static_cast<double>(f.failed)},
+        {"lastFireLatencyMs", f.lastLatencyUs / 1000.0},
+        {"maxFireLatencyMs", f.maxLatencyUs / 1000.0},
+        {"meanFireLatencyMs", f.fires ? f.totalLatencyUs / 1000.0 / f.fires : 0.0},
+        {"activeEffects", static_cast<double>(activeEffects)},
+        {"mixerTicks", static_cast<double>(m.ticks)},
+        {"mixerCommands", static_cast<double>(m.commands)},
+        {"mixerDeferred", static_cast<double>(m.deferred)},
+        {"effectsExpired", static_cast<double>(m.expired)},
+        {"maxMixTickMs", m.maxTickUs / 1000.0},
+        {"mappingFrames", static_cast<double>(mapping.frames)},
+        {"mappingCommands", static_cast<double>(mapping.commands)},
+        {"meanMappingLatencyMs", mapping.latencySamples ? mapping.totalLatencyUs / 1000.0 / mapping.latencySamples : 0.0},
+        {"maxMappingLatencyMs", mapping.maxLatencyUs / 1000.0},
+        {"activeLfos", static_cast<double>(activeLfos)},
+        {"lfoSegments", static_cast<double>(l.segments)},
+        {"lfoSteps", static_cast<double>(l.steps)},
+        {"lfoGlides", static_cast<double>(l.glides)},
+        {"maxLfoTickMs", l.maxTickUs / 1000.0},
+        {"autoReconnect", autoReconnect.load() ? 1.0 : 0.0},
+        {"linksDown", static_cast<double>(linksDown)},
+        {"outages", static_cast<double>(r.outages)},
+        {"reconnects", static_cast<double>(r.reconnects)},
+        {"reconnectFailures", static_cast<double>(r.failures)},
+        {"droppedWhileDown", static_cast<double>(dropped)},
+        {"lastOutageMs", r.lastOutageUs / 1000.0},
+        {"maxOutageMs", r.maxOutageUs / 1000.0},
+        {"totalOutageMs", r.totalOutageUs / 1000.0},
+        {"lastReplayMs", r.lastReplayUs / 1000.0},
+        {"lastReconnectError", static_cast<double>(r.lastError)},
+        {"profileApplied", static_cast<double>(profile.applied)},
+        {"profileSkipped", static_cast<double>(profile.skipped)},
+        {"lastProfileMs", profile.elapsedUs / 1000.0},
+        {"heartbeatTrips", static_cast<double>(h.trips)},
+        {"heartbeatStopFailures", static_cast<double>(h.stopFailures)},
+        {"maxHeartbeatGapMs", heartbeatMaxGapUs.load(std::memory_order_relaxed) / 1000.0},
+        {"ackTracking", issueObserver.load() ? 1.0 : 0.0},
+        {"acked", static_cast<double>(a.acked)},
+        {"ackTimeouts", static_cast<double>(a.timedOut)},
+        {"engineLocked", mexIsLocked() ? 1.0 : 0.0},
+        {"engineUptimeS", (nowUs() - engineStartUs) / 1e6},
+#if defined(TDK_COUNT_ALLOCS)
+        {"heapAllocations", static_cast<double>(allocations)},
+#endif
+    };
+    static_assert(sizeof(fields) / sizeof(fields[0]) <= STATS_MAX_FIELDS, "Raise STATS_MAX_FIELDS");
+    plhs = createStatsStruct(fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+void configureFlowControl(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureFlowControl requires enabled (logical) and optionally rate, burst, queue limit, and max wait (ms).");
+    }
+    FlowConfig config = getFlowConfig();
+    config.enabled = mxGetScalar(prhs[1]) != 0.0;
+    if (nrhs > 2 && !mxIsEmpty(prhs[2])) config.initialRate = mxGetScalar(prhs[2]);
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) config.maxBurst = mxGetScalar(prhs[3]);
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) config.queueLimit = static_cast<int>(mxGetScalar(prhs[4]));
+    if (nrhs > 5 && !mxIsEmpty(prhs[5])) config.maxWaitUs = static_cast<int64_t>(mxGetScalar(prhs[5]) * 1000.0);
+    if (!(config.initialRate >= FLOW_MIN_RATE) || !(config.maxBurst >= 1.0) || config.queueLimit < 1 || config.maxWaitUs < 0) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Flow control needs rate >= %g, burst >= 1, queue limit >= 1, and max wait >= 0.", FLOW_MIN_RATE);
+    }
+    std::lock_guard<std::mutex> lock(flowMutex);
+    flowConfig = config;
+    for (auto& fs : flowStates) fs = FlowState(); // Re-learn the link with the new settings
+}
+
+void getFlowStatus(mxArray*& plhs) {
+    const char* names[] = {"deviceID", "rate", "burst", "credit", "capacity", "queueDepth",
+                           "throttled", "limitErrors", "retries", "rejected"};
+    const int numFields = sizeof(names) / sizeof(names[0]);
+    int depths[QUEUE_MAX_DEVICES];
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (int d = 0; d < QUEUE_MAX_DEVICES; d++) depths[d] = ioRunning ? deviceDepth[d] : 0;
+    }
+    std::vector<int> ids;
+    for (const auto& [deviceID, info] : deviceConnections) {
+        if (flowControlled(deviceID)) ids.push_back(deviceID);
+    }
+    plhs = mxCreateStructMatrix(1, ids.size(), numFields, names);
+    std::lock_guard<std::mutex> lock(flowMutex);
+    for (size_t k = 0; k < ids.size(); k++) {
+        FlowState& fs = flowStates[ids[k]];
+        refillLocked(fs, nowUs());
+        const double values[] = {static_cast<double>(ids[k]), fs.rate, fs.burst, fs.tokens, fs.capacity,
+                                 static_cast<double>(depths[ids[k]]), static_cast<double>(fs.throttled),
+                                 static_cast<double>(fs.limitErrors), static_cast<double>(fs.retries),
+                                 static_cast<double>(fs.rejected)};
+        for (int f = 0; f < numFields; f++) {
+            mxSetField(plhs, k, names[f], mxCreateDoubleScalar(values[f]));
+        }
+    }
+}
+
+void configureReconnect(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureReconnect requires enabled (logical) and optionally the maximum backoff (ms).");
+    }
+    bool enabled = mxGetScalar(prhs[1]) != 0.0;
+    double maxBackoffMs = nrhs > 2 ? mxGetScalar(prhs[2]) : 1000.0;
+    if (!(maxBackoffMs >= RECONNECT_MIN_BACKOFF_US / 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Maximum backoff must be at least %g ms.", RECONNECT_MIN_BACKOFF_US / 1000.0);
+    }
+    if (enabled) {
+        startWatchdog(static_cast<int64_t>(maxBackoffMs * 1000.0));
+    } else {
+        stopWatchdog();
+    }
+}
+
+void configureMixer(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureMixer requires deviceID, enabled (logical), and optionally rate (Hz), budget, and pulse length (ms).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    bool enabled = mxGetScalar(prhs[2]) != 0.0;
+    double rate = nrhs > 3 ? mxGetScalar(prhs[3]) : 100.0;
+    int budget = nrhs > 4 ? static_cast<int>(mxGetScalar(prhs[4])) : 32;
+    int pulseMs = nrhs > 5 ? static_cast<int>(mxGetScalar(prhs[5])) : 0;
+    if (!(rate >= 1.0 && rate <= 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Mixer rate must be between 1 and 1000 Hz.");
+    }
+    if (budget < MIX_MIN_BUDGET) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Mixer budget must be at least %d commands per tick.", MIX_MIN_BUDGET);
+    }
+    int64_t periodUs = static_cast<int64_t>(1e6 / rate);
+    if (pulseMs < 0 || (pulseMs > 0 && pulseMs * 1000 <= periodUs)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Pulse length must be 0 or longer than one mixer tick (%g ms).", periodUs / 1000.0);
+    }
+    int previousTask = 0;
+    {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        auto it = mixers.find(deviceID);
+        if (it != mixers.end()) previousTask = it->second.taskID;
+    }
+    // Scheduler tasks take mixMutex, so never (un)register while holding it
+    if (previousTask != 0) removePeriodicTask(previousTask);
+    if (!enabled) {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        auto it = mixers.find(deviceID);
+        if (it == mixers.end()) return;
+        EffectMixer& mixer = it->second;
+        mixer.taskID = 0;
+        mixer.effects.clear();
+        mixer.budget = ENGINE_MAX_TACTOR * 3;
+        mixTick(deviceID, mixer, nowUs()); // Drives every mixed tactor back to 0
+        return;
+    }
+    int taskID = addPeriodicTask(rate, [deviceID](int64_t tickUs) {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        auto it = mixers.find(deviceID);
+        if (it != mixers.end()) mixTick(deviceID, it->second, tickUs);
+    });
+    std::lock_guard<std::mutex> lock(mixMutex);
+    EffectMixer& mixer = mixers[deviceID];
+    mixer.taskID = taskID;
+    mixer.budget = budget;
+    mixer.pulseMs = pulseMs;
+    mixer.periodUs = periodUs;
+}
+
+// Parse a blend mode name ('max', 'sum', 'override')
+uint8_t decodeBlendMode(const mxArray* arr) {
+    char name[16] = "max";
+    if (mxIsChar(arr)) mxGetString(arr, name, sizeof(name));
+    if (strcmp(name, "max") == 0) return BLEND_MAX;
+    if (strcmp(name, "sum") == 0) return BLEND_SUM;
+    if (strcmp(name, "override") == 0) return BLEND_OVERRIDE;
+    mexErrMsgIdAndTxt("TDK:InputError", "Blend mode must be 'max', 'sum' or 'override'.");
+    return BLEND_MAX;
+}
+
+void addEffect(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 4 || !mxIsDouble(prhs[3])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "AddEffect requires deviceID, tactor number, and a gain or 2 x N [t_ms; gain] envelope.");
+    }
+    HapticEffect effect;
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    effect.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    if (effect.tacNum < 1 || effect.tacNum > ENGINE_MAX_TACTOR) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Tactor number must be between 1 and %d.", ENGINE_MAX_TACTOR);
+    }
+    const mxArray* env = prhs[3];
+    size_t n = mxGetNumberOfElements(env);
+    const double* v = mxGetPr(env);
+    if (n == 1) {
+        effect.points = 1;
+        effect.envelope[0] = {0, static_cast<float>(v[0])};
+    } else if (mxGetM(env) == 2 && mxGetN(env) >= 2 && mxGetN(env) <= MIX_MAX_POINTS) {
+        effect.points = static_cast<int>(mxGetN(env));
+        for (int k = 0; k < effect.points; k++) {
+            effect.envelope[k] = {static_cast<int64_t>(v[2 * k] * 1000.0), static_cast<float>(v[2 * k + 1])};
+            if (k > 0 && effect.envelope[k].tUs <= effect.envelope[k - 1].tUs) {
+                mexErrMsgIdAndTxt("TDK:InputError", "Envelope times must be strictly increasing.");
+            }
+        }
+    } else {
+        mexErrMsgIdAndTxt("TDK:InputError", "Envelope must be a gain or a 2 x N [t_ms; gain] matrix with 2 - %d points.", MIX_MAX_POINTS);
+    }
+    for (int k = 0; k < effect.points; k++) {
+        if (!(effect.envelope[k].gain >= 0.0f && effect.envelope[k].gain <= 255.0f)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Envelope gains must be between 0 and 255.");
+        }
+    }
+    effect.mode = nrhs > 4 ? decodeBlendMode(prhs[4]) : static_cast<uint8_t>(BLEND_MAX);
+    effect.priority = nrhs > 5 ? static_cast<int>(mxGetScalar(prhs[5])) : 0;
+    effect.freq = nrhs > 6 ? static_cast<int>(mxGetScalar(prhs[6])) : 0;
+    double durationMs = nrhs > 7 ? mxGetScalar(prhs[7]) : 0.0;
+    double delayMs = nrhs > 8 ? mxGetScalar(prhs[8]) : 0.0;
+    if (effect.freq < 0 || !(durationMs >= 0.0) || !(delayMs >= 0.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Frequency, duration and delay must be >= 0.");
+    }
+    effect.durationUs = durationMs > 0.0 ? static_cast<int64_t>(durationMs * 1000.0)
+                                         : (effect.points > 1 ? effect.envelope[effect.points - 1].tUs : 0);
+    effect.startUs = nowUs() + static_cast<int64_t>(delayMs * 1000.0);
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        EffectMixer& mixer = mixers[deviceID];
+        full = mixer.effects.size() >= static_cast<size_t>(MIX_MAX_EFFECTS);
+        if (!full) {
+            effect.id = nextEffectID++;
+            insertEffectLocked(mixer, effect);
+        }
+    }
+    if (full) {
+        mexErrMsgIdAndTxt("TDK:MixerFull", "Device %d already has %d active effects.", deviceID, MIX_MAX_EFFECTS);
+    }
+    plhs = mxCreateDoubleScalar(effect.id);
+}
+
+void updateEffect(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "UpdateEffect requires effectID, gain, and optionally frequency.");
+    }
+    int effectID = static_cast<int>(mxGetScalar(prhs[1]));
+    double gain = mxGetScalar(prhs[2]);
+    int freq = nrhs > 3 ? static_cast<int>(mxGetScalar(prhs[3])) : -1;
+    if (!(gain >= 0.0 && gain <= 255.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Gain must be between 0 and 255.");
+    }
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(mixMutex);
+        HapticEffect* effect = findEffectLocked(effectID);
+        found = effect != nullptr;
+        if (found) {
+            effect->points = 1;
+            effect->cursor = 0;
+            effect->envelope[0] = {0, static_cast<float>(gain)};
+            if (freq >= 0) effect->freq = freq;
+        }
+    }
+    if (!found) {
+        mexErrMsgIdAndTxt("TDK:NoEffect", "Effect %d is not active.", effectID);
+    }
+}
+
+void removeEffect(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "RemoveEffect requires effectID.");
+    }
+    int effectID = static_cast<int>(mxGetScalar(prhs[1]));
+    std::lock_guard<std::mutex> lock(mixMutex);
+    int deviceID = 0;
+    HapticEffect* effect = findEffectLocked(effectID, &deviceID);
+    if (!effect) return; // Already expired
+    auto& effects = mixers[deviceID].effects;
+    effects.erase(effects.begin() + (effect - effects.data()));
+}
+
+// Decode N x 11 mapping rules (and the K x MAP_TABLE_POINTS tables they use)
+int decodeMappingRules(const mxArray* arr, const mxArray* tables, MappingRule* rules) {
+    if (mxIsEmpty(arr)) return 0;
+    if (!mxIsDouble(arr) || mxGetN(arr) != 11 || mxGetM(arr) > MAP_MAX_RULES) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Mapping rules must be an N x 11 double matrix with up to %d rows.", MAP_MAX_RULES);
+    }
+    size_t n = mxGetM(arr);
+    size_t numTables = 0;
+    if (tables && !mxIsEmpty(tables)) {
+        if (!mxIsDouble(tables) || mxGetN(tables) != MAP_TABLE_POINTS) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping tables must be a K x %d double matrix.", MAP_TABLE_POINTS);
+        }
+        numTables = mxGetM(tables);
+    }
+    const double* v = mxGetPr(arr);
+    auto at = [&](size_t r, int c) { return v[r + c * n]; };
+    uint64_t used[3] = {};
+    for (size_t r = 0; r < n; r++) {
+        MappingRule& rule = rules[r];
+        rule.tacNum = static_cast<int>(at(r, 0));
+        rule.target = static_cast<uint8_t>(at(r, 1));
+        rule.channel = static_cast<int>(at(r, 2)) - 1;
+        rule.transfer = static_cast<uint8_t>(at(r, 3));
+        rule.inMin = static_cast<float>(at(r, 4));
+        rule.inMax = static_cast<float>(at(r, 5));
+        rule.outMin = static_cast<float>(at(r, 6));
+        rule.outMax = static_cast<float>(at(r, 7));
+        rule.shape = static_cast<float>(at(r, 8));
+        rule.center = static_cast<float>(at(r, 9));
+        rule.deadband = static_cast<float>(at(r, 10));
+        if (rule.tacNum < 1 || rule.tacNum > ENGINE_MAX_TACTOR) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: tactor must be 1 - %d.", static_cast<int>(r + 1), ENGINE_MAX_TACTOR);
+        }
+        if (rule.target != MAP_GAIN && rule.target != MAP_FREQ) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: target must be 1 (gain) or 2 (frequency).", static_cast<int>(r + 1));
+        }
+        if (used[rule.target] >> (rule.tacNum - 1) & 1) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: tactor %d already has a rule for that target.", static_cast<int>(r + 1), rule.tacNum);
+        }
+        used[rule.target] |= uint64_t(1) << (rule.tacNum - 1);
+        if (rule.channel < 0 || rule.channel >= MAP_MAX_FEATURES) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: feature channel must be 1 - %d.", static_cast<int>(r + 1), MAP_MAX_FEATURES);
+        }
+        if (rule.transfer < MAP_LINEAR || rule.transfer > MAP_TABLE) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: transfer must be 1 (linear), 2 (power), 3 (sigmoid) or 4 (table).", static_cast<int>(r + 1));
+        }
+        if (!(rule.inMax > rule.inMin) || !std::isfinite(rule.outMin) || !std::isfinite(rule.outMax) || !(rule.deadband >= 0.0f)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: needs inMax > inMin, finite outputs and deadband >= 0.", static_cast<int>(r + 1));
+        }
+        if (rule.transfer == MAP_POWER && !(rule.shape > 0.0f)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: power exponent must be > 0.", static_cast<int>(r + 1));
+        }
+        if (rule.transfer == MAP_SIGMOID && !(rule.shape > 0.0f && std::isfinite(rule.center))) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: sigmoid slope must be > 0.", static_cast<int>(r + 1));
+        }
+        if (rule.transfer == MAP_TABLE) {
+            int row = static_cast<int>(rule.shape) - 1;
+            if (row < 0 || static_cast<size_t>(row) >= numTables) {
+                mexErrMsgIdAndTxt("TDK:InputError", "Mapping rule %d: table row %d does not exist.", static_cast<int>(r + 1), row + 1);
+            }
+            const double* t = mxGetPr(tables);
+            for (int k = 0; k < MAP_TABLE_POINTS; k++) rule.table[k] = static_cast<float>(t[row + k * numTables]);
+        }
+    }
+    return static_cast<int>(n);
+}
+
+void configureMapping(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureMapping requires deviceID, rules (N x 11, [] to stop), and optionally tables, rate (Hz) and a source name.");
     }
     int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacNum = static_cast<int>(mxGetScalar(prhs[2]));
-    int gainValue = static_cast<int>(mxGetScalar(prhs[3]));
-    int delay = static_cast<int>(mxGetScalar(prhs[4]));
-
-    int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
-    handleError(internalUpdateResult, "UpdateTI");
+    MappingRule rules[MAP_MAX_RULES];
+    int count = decodeMappingRules(prhs[2], nrhs > 3 ? prhs[3] : nullptr, rules);
+    double rate = nrhs > 4 && !mxIsEmpty(prhs[4]) ? mxGetScalar(prhs[4]) : 100.0;
+    if (!(rate >= 1.0 && rate <= 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Mapping rate must be between 1 and 1000 Hz.");
+    }
+    char sourceName[64] = "";
+    if (nrhs > 5 && mxIsChar(prhs[5])) mxGetString(prhs[5], sourceName, sizeof(sourceName));
+    FeatureBlock* source = nullptr;
+    if (count > 0 && sourceName[0] != '\0') {
+        source = openFeatureBlock(sourceName);
+        if (!source) {
+            mexErrMsgIdAndTxt("TDK:FileError", "Could not open feature block '%s' (shared memory, Linux only).", sourceName);
+        }
+    }
+    int previousTask = 0;
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        auto it = mappers.find(deviceID);
+        if (it != mappers.end()) previousTask = it->second.taskID;
+    }
+    // Scheduler tasks take mapMutex, so never (un)register while holding it
+    if (previousTask != 0) removePeriodicTask(previousTask);
+    if (count == 0) {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        auto it = mappers.find(deviceID);
+        if (it == mappers.end()) return;
+        const FeatureMapper& mapper = it->second;
+        TactorCommand cmd; // Leave nothing buzzing at a mapped gain
+        cmd.type = CMD_CHANGE_GAIN;
+        cmd.deviceID = deviceID;
+        cmd.value = 0;
+        for (int i = 0; i < mapper.plan.count; i++) {
+            if (mapper.plan.target[i] != MAP_GAIN || mapper.sent[i] <= 0) continue;
+            cmd.tacNum = mapper.plan.tacNum[i];
+            submitCommand(cmd);
+        }
+        eraseMapperLocked(deviceID);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        eraseMapperLocked(deviceID);
+        FeatureMapper& mapper = mappers[deviceID];
+        buildMappingPlan(rules, count, mapper.plan);
+        mapper.periodUs = static_cast<int64_t>(1e6 / rate);
+        mapper.source = source;
+        std::snprintf(mapper.sourceName, sizeof(mapper.sourceName), "%s", sourceName);
+    }
+    int taskID = addPeriodicTask(rate, [deviceID](int64_t tickUs) {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        auto it = mappers.find(deviceID);
+        if (it != mappers.end()) mapTick(deviceID, it->second, tickUs);
+    });
+    std::lock_guard<std::mutex> lock(mapMutex);
+    mappers[deviceID].taskID = taskID;
+}
 
-    int result = ChangeGain(deviceID, tacNum, gainValue, delay);
-    handleError(result, "ChangeGain");
+void pushFeatures(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3 || !(mxIsDouble(prhs[2]) || mxIsSingle(prhs[2]))) {
+        mexErrMsgIdAndTxt("TDK:InputError", "PushFeatures requires deviceID and a feature frame (double or single).");
+    }
+    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    size_t n = mxGetNumberOfElements(prhs[2]);
+    if (n > MAP_MAX_FEATURES) {
+        mexErrMsgIdAndTxt("TDK:InputError", "A feature frame has at most %d channels.", MAP_MAX_FEATURES);
+    }
+    float values[MAP_MAX_FEATURES];
+    if (mxIsSingle(prhs[2])) {
+        const float* f = static_cast<const float*>(mxGetData(prhs[2]));
+        std::copy(f, f + n, values);
+    } else {
+        const double* d = mxGetPr(prhs[2]);
+        for (size_t k = 0; k < n; k++) values[k] = static_cast<float>(d[k]);
+    }
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        auto it = mappers.find(deviceID);
+        found = it != mappers.end();
+        if (found) pushFeaturesLocked(it->second, values, static_cast<int>(n), callStartUs);
+    }
+    if (!found) {
+        mexErrMsgIdAndTxt("TDK:InputError", "No mapping configured for device %d (see 'configureMapping').", deviceID);
+    }
 }
 
-void changeFreq(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 5) {
-        mexErrMsgIdAndTxt("TDK:InputError", "ChangeFreq requires deviceID, tactor number, freq value (300 - 3550), and delay.");
+void getMappingStatus(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "MappingStatus requires deviceID.");
     }
     int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacNum = static_cast<int>(mxGetScalar(prhs[2]));
-    int freqValue = static_cast<int>(mxGetScalar(prhs[3]));
-    int delay = static_cast<int>(mxGetScalar(prhs[4]));
+    const char* fields[] = {"running", "rateHz", "source", "frames", "superseded", "ticks", "commands", "failed",
+                            "lastLatencyMs", "meanLatencyMs", "maxLatencyMs", "maxTickMs", "targets"};
+    plhs = mxCreateStructMatrix(1, 1, 13, fields);
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = mappers.find(deviceID);
+    FeatureMapper empty;
+    const FeatureMapper& mapper = it != mappers.end() ? it->second : empty;
+    const MappingStats& s = mapper.stats;
+    mxArray* targets = mxCreateDoubleMatrix(1, mapper.plan.count, mxREAL);
+    for (int i = 0; i < mapper.plan.count; i++) mxGetPr(targets)[mapper.plan.order[i]] = mapper.targets[i];
+    mxSetField(plhs, 0, "running", mxCreateLogicalScalar(mapper.taskID != 0));
+    mxSetField(plhs, 0, "rateHz", mxCreateDoubleScalar(mapper.taskID != 0 ? 1e6 / mapper.periodUs : 0.0));
+    mxSetField(plhs, 0, "source", mxCreateString(mapper.sourceName));
+    mxSetField(plhs, 0, "frames", mxCreateDoubleScalar(static_cast<double>(s.frames)));
+    mxSetField(plhs, 0, "superseded", mxCreateDoubleScalar(static_cast<double>(s.superseded)));
+    mxSetField(plhs, 0, "ticks", mxCreateDoubleScalar(static_cast<double>(s.ticks)));
+    mxSetField(plhs, 0, "commands", mxCreateDoubleScalar(static_cast<double>(s.commands)));
+    mxSetField(plhs, 0, "failed", mxCreateDoubleScalar(static_cast<double>(s.failed)));
+    mxSetField(plhs, 0, "lastLatencyMs", mxCreateDoubleScalar(s.lastLatencyUs / 1000.0));
+    mxSetField(plhs, 0, "meanLatencyMs", mxCreateDoubleScalar(s.latencySamples ? s.totalLatencyUs / 1000.0 / s.latencySamples : 0.0));
+    mxSetField(plhs, 0, "maxLatencyMs", mxCreateDoubleScalar(s.maxLatencyUs / 1000.0));
+    mxSetField(plhs, 0, "maxTickMs", mxCreateDoubleScalar(s.maxTickUs / 1000.0));
+    mxSetField(plhs, 0, "targets", targets);
+}
+
+mxArray* healthAnswerStruct(const HealthAnswer& a, bool responses) {
+    const char* fields[] = {"ok", "errorCode", "answered", "status", "latencyMs", "data"};
+    mxArray* s = mxCreateStructMatrix(1, 1, 6, fields);
+    mxArray* data = mxCreateNumericMatrix(1, a.answered ? a.frame.length : 0, mxUINT8_CLASS, mxREAL);
+    if (a.answered) std::copy(a.frame.payload, a.frame.payload + a.frame.length, static_cast<uint8_t*>(mxGetData(data)));
+    bool statusByte = a.answered && a.frame.length >= 1;
+    mxSetField(s, 0, "ok", mxCreateLogicalScalar(a.result >= 0 && (!responses || a.answered)));
+    mxSetField(s, 0, "errorCode", mxCreateDoubleScalar(a.errorCode));
+    mxSetField(s, 0, "answered", mxCreateLogicalScalar(a.answered));
+    mxSetField(s, 0, "status", mxCreateDoubleScalar(statusByte ? a.frame.payload[0] : mxGetNaN()));
+    mxSetField(s, 0, "latencyMs", mxCreateDoubleScalar(a.answered ? a.latencyUs / 1000.0 : mxGetNaN()));
+    mxSetField(s, 0, "data", data);
+    return s;
+}
 
-    int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
-    handleError(internalUpdateResult, "UpdateTI");
+void healthCheck(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    HealthOptions options;
+    options.tactors = 0xFF;
+    if (nrhs > 1) {
+        if (!mxIsEmpty(prhs[1]) && !mxIsDouble(prhs[1])) {
+            mexErrMsgIdAndTxt("TDK:InputError", "HealthCheck tactors must be a double vector (or [] for no sweep).");
+        }
+        options.tactors = 0;
+        const double* t = mxIsEmpty(prhs[1]) ? nullptr : mxGetPr(prhs[1]);
+        for (size_t i = 0; t && i < mxGetNumberOfElements(prhs[1]); i++) {
+            int tacNum = static_cast<int>(t[i]);
+            if (tacNum < 1 || tacNum > ENGINE_MAX_TACTOR) {
+                mexErrMsgIdAndTxt("TDK:InputError", "HealthCheck tactors must be 1 - %d.", ENGINE_MAX_TACTOR);
+            }
+            options.tactors |= uint64_t(1) << (tacNum - 1);
+        }
+    }
+    if (nrhs > 2 && !mxIsEmpty(prhs[2])) options.pulseMs = static_cast<int>(mxGetScalar(prhs[2]));
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) options.spacingMs = static_cast<int>(mxGetScalar(prhs[3]));
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) options.timeoutUs = static_cast<int64_t>(mxGetScalar(prhs[4]) * 1000.0);
+    if (options.pulseMs < 1 || options.spacingMs < 1 || options.timeoutUs < 0) {
+        mexErrMsgIdAndTxt("TDK:InputError", "HealthCheck pulse length and spacing must be >= 1 ms, and the timeout >= 0.");
+    }
+    std::vector<int> deviceIDs;
+    for (const auto& [deviceID, info] : deviceConnections) deviceIDs.push_back(deviceID);
+    if (deviceIDs.empty()) {
+        mexErrMsgIdAndTxt("TDK:ConnectionError", "No devices connected to check.");
+    }
+    int64_t startUs = nowUs();
+    std::vector<HealthDevice> results = runHealthCheck(deviceIDs, options);
+    double elapsedMs = (nowUs() - startUs) / 1000.0;
 
-    int result = ChangeFreq(deviceID, tacNum, freqValue, delay);
-    handleError(result, "ChangeFreq");
+    bool responses = healthResponsesAvailable();
+    const char* fields[] = {"deviceID", "healthy", "selfTest", "segments", "battery", "pulsesIssued",
+                            "pulsesFailed", "pulsesAnswered", "pulsesRejected", "failedTactors", "answeredMs"};
+    mxArray* devices = mxCreateStructMatrix(1, results.size(), 11, fields);
+    bool allHealthy = true;
+    for (size_t k = 0; k < results.size(); k++) {
+        const HealthDevice& d = results[k];
+        bool healthy = d.pulsesFailed == 0 && (!responses || (d.pulsesAnswered >= d.pulsesIssued && d.pulsesRejected == 0));
+        for (int q = 0; q < HEALTH_NUM_QUERIES; q++) {
+            const HealthAnswer& a = d.answers[q];
+            healthy = healthy && a.result >= 0 && (!responses || a.answered);
+            mxSetField(devices, k, healthQueryNames[q], healthAnswerStruct(a, responses));
+        }
+        const HealthAnswer& selfTest = d.answers[HEALTH_SELF_TEST];
+        if (selfTest.answered && selfTest.frame.length >= 1 && selfTest.frame.payload[0] != SERIAL_STATUS_OK) healthy = false;
+        allHealthy = allHealthy && healthy;
+        std::vector<double> failedTactors;
+        for (uint64_t bits = d.failedMask; bits; bits &= bits - 1) failedTactors.push_back(countTrailingZeros(bits) + 1);
+        mxArray* failed = mxCreateDoubleMatrix(1, failedTactors.size(), mxREAL);
+        std::copy(failedTactors.begin(), failedTactors.end(), mxGetPr(failed));
+        mxSetField(devices, k, "deviceID", mxCreateDoubleScalar(d.deviceID));
+        mxSetField(devices, k, "healthy", mxCreateLogicalScalar(healthy));
+        mxSetField(devices, k, "pulsesIssued", mxCreateDoubleScalar(d.pulsesIssued));
+        mxSetField(devices, k, "pulsesFailed", mxCreateDoubleScalar(d.pulsesFailed));
+        mxSetField(devices, k, "pulsesAnswered", mxCreateDoubleScalar(d.pulsesAnswered));
+        mxSetField(devices, k, "pulsesRejected", mxCreateDoubleScalar(d.pulsesRejected));
+        mxSetField(devices, k, "failedTactors", failed);
+        mxSetField(devices, k, "answeredMs", mxCreateDoubleScalar(d.lastAnswerUs ? (d.lastAnswerUs - startUs) / 1000.0 : mxGetNaN()));
+    }
+    const char* reportFields[] = {"healthy", "responses", "elapsedMs", "devices"};
+    plhs = mxCreateStructMatrix(1, 1, 4, reportFields);
+    mxSetField(plhs, 0, "healthy", mxCreateLogicalScalar(allHealthy));
+    mxSetField(plhs, 0, "responses", mxCreateLogicalScalar(responses));
+    mxSetField(plhs, 0, "elapsedMs", mxCreateDoubleScalar(elapsedMs));
+    mxSetField(plhs, 0, "devices", devices);
 }
 
-void getName(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
-    if (nrhs < 2) mexErrMsgIdAndTxt("TDK:InputError", "getName requires an index.");
-    int index = static_cast<int>(mxGetScalar(prhs[1]));
-    const char* deviceName = GetDiscoveredDeviceName(index);
-    if (!deviceName) handleError(GetLastEAIError(), "getName");
-    plhs = mxCreateString(deviceName); // Return the device name
+// The runner task takes patternMutex, so register it before locking
+void ensurePatternTask() {
+    bool needTask;
+    {
+        std::lock_guard<std::mutex> lock(patternMutex);
+        needTask = patternTaskID == 0;
+    }
+    if (needTask) {
+        int taskID = addPeriodicTask(PATTERN_TICK_HZ, patternTick);
+        std::lock_guard<std::mutex> lock(patternMutex);
+        patternTaskID = taskID;
+    }
 }
 
-void rampFreq(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 7) {
-        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, start frequency (300 - 3550), end frequency (300 - 3550), ramp duration, and delay.");
+void launchPattern(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 4 || !mxIsChar(prhs[1])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "LaunchPattern requires a pattern name, deviceID, tactor number, and optionally parameters and a delay (ms).");
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacNum = static_cast<int>(mxGetScalar(prhs[2]));
-    int startFreq = static_cast<int>(mxGetScalar(prhs[3]));
-    int endFreq = static_cast<int>(mxGetScalar(prhs[4]));
-    int duration = static_cast<int>(mxGetScalar(prhs[5]));
-    int delay = static_cast<int>(mxGetScalar(prhs[6]));
+    char name[64];
+    mxGetString(prhs[1], name, sizeof(name));
+    int pattern = findPattern(name);
+    if (pattern < 0) {
+        mexErrMsgIdAndTxt("TDK:NoPattern", "No pattern named '%s' is registered.", name);
+    }
+    PatternContext ctx;
+    ctx.deviceID = static_cast<int>(mxGetScalar(prhs[2]));
+    ctx.tactor = static_cast<int>(mxGetScalar(prhs[3]));
+    if (ctx.tactor < 1 || ctx.tactor > ENGINE_MAX_TACTOR) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Tactor number must be between 1 and %d.", ENGINE_MAX_TACTOR);
+    }
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        if (!mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) > static_cast<size_t>(PATTERN_MAX_PARAMS)) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Pattern parameters must be a double vector of up to %d values.", PATTERN_MAX_PARAMS);
+        }
+        ctx.numParams = static_cast<int>(mxGetNumberOfElements(prhs[4]));
+        std::memcpy(ctx.params, mxGetPr(prhs[4]), ctx.numParams * sizeof(double));
+    }
+    double delayMs = nrhs > 5 ? mxGetScalar(prhs[5]) : 0.0;
+    if (!(delayMs >= 0.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Delay must be >= 0 ms.");
+    }
+    ensurePatternTask();
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(patternMutex);
+        id = launchPatternLocked(pattern, ctx, static_cast<int64_t>(delayMs * 1000.0));
+    }
+    if (id == 0) {
+        mexErrMsgIdAndTxt("TDK:PatternLimit", "Can't launch '%s': %d patterns running, or its coroutine frame exceeds %d bytes.",
+                          name, PATTERN_MAX_INSTANCES, static_cast<int>(PATTERN_FRAME_BYTES));
+    }
+    plhs = mxCreateDoubleScalar(id);
+}
 
-    // int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
-    // handleError(internalUpdateResult, "UpdateTI");
+void cancelPattern(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "CancelPattern requires an instance ID or a pattern name.");
+    }
+    int id = 0;
+    int pattern = -1;
+    if (mxIsChar(prhs[1])) {
+        char name[64];
+        mxGetString(prhs[1], name, sizeof(name));
+        pattern = findPattern(name);
+        if (pattern < 0) {
+            mexErrMsgIdAndTxt("TDK:NoPattern", "No pattern named '%s' is registered.", name);
+        }
+    } else {
+        id = static_cast<int>(mxGetScalar(prhs[1]));
+        if (id < 1) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Pattern instance IDs start at 1.");
+        }
+    }
+    int count;
+    {
+        std::lock_guard<std::mutex> lock(patternMutex);
+        count = cancelPatternsLocked(id, pattern);
+    }
+    plhs = mxCreateDoubleScalar(count);
+}
+
+void getPatternStatus(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    int filter = -1;
+    if (nrhs > 1 && mxIsChar(prhs[1])) {
+        char name[64];
+        mxGetString(prhs[1], name, sizeof(name));
+        filter = findPattern(name);
+        if (filter < 0) {
+            mexErrMsgIdAndTxt("TDK:NoPattern", "No pattern named '%s' is registered.", name);
+        }
+    }
+    static const char* stateNames[] = {"ready", "waiting", "ramping", "event"};
+    const char* runningFields[] = {"id", "name", "deviceID", "tactor", "state", "elapsedMs"};
+    const char* fields[] = {"registered", "running", "launched", "completed", "cancelled", "failed", "commands", "maxTickMs", "stimuliPlayed"};
+    std::lock_guard<std::mutex> lock(patternMutex);
+    mxArray* registered = mxCreateCellMatrix(1, numRegisteredPatterns);
+    for (int i = 0; i < numRegisteredPatterns; i++) {
+        mxSetCell(registered, i, mxCreateString(registeredPatterns[i].name));
+    }
+    int count = 0;
+    for (const auto& p : patternInstances) {
+        if (p.id != 0 && (filter < 0 || p.pattern == filter)) count++;
+    }
+    mxArray* running = mxCreateStructMatrix(1, count, 6, runningFields);
+    int64_t now = nowUs();
+    int k = 0;
+    for (const auto& p : patternInstances) {
+        if (p.id == 0 || (filter >= 0 && p.pattern != filter)) continue;
+        mxSetField(running, k, "id", mxCreateDoubleScalar(p.id));
+        mxSetField(running, k, "name", mxCreateString(registeredPatterns[p.pattern].name));
+        mxSetField(running, k, "deviceID", mxCreateDoubleScalar(p.ctx.deviceID));
+        mxSetField(running, k, "tactor", mxCreateDoubleScalar(p.ctx.tactor));
+        mxSetField(running, k, "state", mxCreateString(stateNames[p.wait]));
+        mxSetField(running, k, "elapsedMs", mxCreateDoubleScalar((now - p.startUs) / 1000.0));
+        k++;
+    }
+    plhs = mxCreateStructMatrix(1, 1, 9, fields);
+    mxSetField(plhs, 0, "registered", registered);
+    mxSetField(plhs, 0, "running", running);
+    mxSetField(plhs, 0, "launched", mxCreateDoubleScalar(static_cast<double>(patternStats.launched)));
+    mxSetField(plhs, 0, "completed", mxCreateDoubleScalar(static_cast<double>(patternStats.completed)));
+    mxSetField(plhs, 0, "cancelled", mxCreateDoubleScalar(static_cast<double>(patternStats.cancelled)));
+    mxSetField(plhs, 0, "failed", mxCreateDoubleScalar(static_cast<double>(patternStats.failed)));
+    mxSetField(plhs, 0, "commands", mxCreateDoubleScalar(static_cast<double>(patternStats.commands)));
+    mxSetField(plhs, 0, "maxTickMs", mxCreateDoubleScalar(patternStats.maxTickUs / 1000.0));
+    mxSetField(plhs, 0, "stimuliPlayed", mxCreateDoubleScalar(static_cast<double>(stimuliPlayed)));
+}
 
-    int result = RampFreq(deviceID, tacNum, startFreq, endFreq, duration, 0x01, delay);
-    handleError(result, "RampFreq");
+void raisePatternEvent(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "PatternEvent requires an event number (1 - %d).", PATTERN_EVENTS);
+    }
+    int event = static_cast<int>(mxGetScalar(prhs[1]));
+    if (event < 1 || event > PATTERN_EVENTS) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Event number must be between 1 and %d.", PATTERN_EVENTS);
+    }
+    std::lock_guard<std::mutex> lock(patternMutex);
+    signalPatternEventLocked(event, nowUs());
 }
 
-void rampGain(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 7) {
-        mexErrMsgIdAndTxt("TDK:InputError", "ChangeGain requires deviceID, tactor number, start gain (0 - 255), end gain (0 - 255), ramp duration, and delay.");
+void addLfo(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 8) {
+        mexErrMsgIdAndTxt("TDK:InputError", "AddLfo requires deviceID, tactor number, target, shape, depth, offset, and period (ms).");
+    }
+    static const char* const targets[] = {"gain", "freq"};
+    static const char* const shapes[] = {"sine", "triangle", "square", "sawtooth"};
+    Lfo config;
+    config.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    config.tacNum = static_cast<int>(mxGetScalar(prhs[2]));
+    config.target = decodeChoice(prhs[3], targets, 2, "LFO target");
+    config.shape = decodeChoice(prhs[4], shapes, 4, "LFO shape");
+    config.depth = mxGetScalar(prhs[5]);
+    config.offset = mxGetScalar(prhs[6]);
+    double periodMs = mxGetScalar(prhs[7]);
+    config.phase0 = nrhs > 8 ? mxGetScalar(prhs[8]) : 0.0;
+    config.syncGroup = nrhs > 9 ? static_cast<int>(mxGetScalar(prhs[9])) : 0;
+    config.tolerance = nrhs > 10 ? mxGetScalar(prhs[10]) : 2.0;
+    if (config.tacNum < 0 || config.tacNum > ENGINE_MAX_TACTOR) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Tactor number must be between 0 (all) and %d.", ENGINE_MAX_TACTOR);
+    }
+    if (!(periodMs >= 2.0 * LFO_MIN_SEGMENT_US / 1000.0) || !std::isfinite(config.depth) || !std::isfinite(config.offset) ||
+        !std::isfinite(config.phase0) || !(config.tolerance > 0.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "LFO needs finite depth/offset/phase, period >= %g ms, and tolerance > 0.",
+                          2.0 * LFO_MIN_SEGMENT_US / 1000.0);
+    }
+    if (config.syncGroup < 0 || config.syncGroup > LFO_SYNC_GROUPS) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Sync group must be between 0 (none) and %d.", LFO_SYNC_GROUPS);
+    }
+    // The LFO task takes lfoMutex, so register it before locking
+    bool needTask;
+    {
+        std::lock_guard<std::mutex> lock(lfoMutex);
+        needTask = lfoTaskID == 0;
+    }
+    if (needTask) {
+        int taskID = addPeriodicTask(LFO_TICK_HZ, lfoTick);
+        std::lock_guard<std::mutex> lock(lfoMutex);
+        lfoTaskID = taskID;
+    }
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(lfoMutex);
+        id = addLfoLocked(config, static_cast<int64_t>(periodMs * 1000.0), nowUs());
+    }
+    if (id == 0) {
+        mexErrMsgIdAndTxt("TDK:LfoLimit", "All %d LFOs are in use.", LFO_MAX);
+    }
+    plhs = mxCreateDoubleScalar(id);
+}
+
+void updateLfo(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "UpdateLfo requires lfoID and any of depth, offset, period (ms), phase (NaN keeps a value).");
+    }
+    int id = static_cast<int>(mxGetScalar(prhs[1]));
+    auto arg = [&](int i) { return nrhs > i && !mxIsEmpty(prhs[i]) ? mxGetScalar(prhs[i]) : NAN; };
+    double depth = arg(2);
+    double offset = arg(3);
+    double periodMs = arg(4);
+    double phase = arg(5);
+    if (!std::isnan(periodMs) && !(periodMs >= 2.0 * LFO_MIN_SEGMENT_US / 1000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "LFO period must be at least %g ms.", 2.0 * LFO_MIN_SEGMENT_US / 1000.0);
+    }
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(lfoMutex);
+        Lfo* lfo = findLfoLocked(id);
+        found = lfo != nullptr;
+        if (found) {
+            if (!std::isnan(depth)) lfo->depth = depth;
+            if (!std::isnan(offset)) lfo->offset = offset;
+            if (!std::isnan(phase)) lfo->phase0 = phase;
+            if (!std::isnan(periodMs)) setLfoPeriodLocked(*lfo, static_cast<int64_t>(periodMs * 1000.0), nowUs());
+            lfo->glide = true; // Replanned on the next tick from the value reached
+        }
+    }
+    if (!found) {
+        mexErrMsgIdAndTxt("TDK:NoLfo", "LFO %d is not running.", id);
+    }
+}
+
+void removeLfo(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "RemoveLfo requires lfoID.");
+    }
+    int id = static_cast<int>(mxGetScalar(prhs[1]));
+    std::lock_guard<std::mutex> lock(lfoMutex);
+    if (id > 0) removeLfosLocked(id);
+}
+
+void applyProfile(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 3) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ApplyProfile requires deviceID and a profile struct.");
+    }
+    if (commandSink.load(std::memory_order_acquire)) {
+        mexErrMsgIdAndTxt("TDK:Unsupported", "Profiles are applied by the process that owns the device; not available while attached to tdkd.");
     }
     int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacNum = static_cast<int>(mxGetScalar(prhs[2]));
-    int gainStart = static_cast<int>(mxGetScalar(prhs[3]));
-    int gainEnd = static_cast<int>(mxGetScalar(prhs[4]));
-    int duration = static_cast<int>(mxGetScalar(prhs[5]));
-    int delay = static_cast<int>(mxGetScalar(prhs[6]));
+    DeviceProfile profile;
+    decodeProfile(prhs[2], profile);
+    ProfileReport report = applyProfileChecked(deviceID, profile);
+    const StatField fields[] = {
+        {"applied", static_cast<double>(report.applied)},
+        {"skipped", static_cast<double>(report.skipped)},
+        {"elapsedMs", report.elapsedUs / 1000.0}
+    };
+    plhs = createStatsStruct(fields, sizeof(fields) / sizeof(fields[0]));
+}
 
-    // int internalUpdateResult = UpdateTI(); // Update the Tactor Interface
-    // handleError(internalUpdateResult, "UpdateTI");
+void openStimulusLibrary(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2 || !mxIsChar(prhs[1])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "OpenStimulusLibrary requires a library filename.");
+    }
+    char filename[1024];
+    mxGetString(prhs[1], filename, sizeof(filename));
+    StimulusLibrary lib;
+    const char* problem = mapStimulusLibrary(filename, lib);
+    if (problem) {
+        mexErrMsgIdAndTxt("TDK:FileError", "Could not open stimulus library %s: %s.", filename, problem);
+    }
+    uint32_t count = lib.header->count;
+    {
+        std::lock_guard<std::mutex> lock(patternMutex);
+        closeStimulusLibraryLocked(); // Replaces any open library
+        stimLibrary = lib;
+    }
+    plhs = mxCreateDoubleScalar(count);
+}
 
-    int result = RampGain(deviceID, tacNum, gainStart, gainEnd, duration, 0x01, delay);
-    handleError(result, "RampGain");
+void closeStimulusLibrary() {
+    std::lock_guard<std::mutex> lock(patternMutex);
+    closeStimulusLibraryLocked();
 }
 
-void setTimeFactor(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 2) {
-        mexErrMsgIdAndTxt("TDK:InputError", "SetTimeFactor requires a byte value (1 - 255).");
+void playStimulus(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 4) {
+        mexErrMsgIdAndTxt("TDK:InputError", "PlayStimulus requires deviceID, first tactor, a stimulus ID or name, and optionally gain scale, loops and delay (ms).");
     }
-    int value = static_cast<int>(mxGetScalar(prhs[1]));
+    PatternContext ctx;
+    ctx.deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    ctx.tactor = static_cast<int>(mxGetScalar(prhs[2]));
+    if (ctx.tactor < 1 || ctx.tactor > ENGINE_MAX_TACTOR) {
+        mexErrMsgIdAndTxt("TDK:InputError", "First tactor must be 1 - %d.", ENGINE_MAX_TACTOR);
+    }
+    char name[STIMLIB_NAME_CHARS] = "";
+    uint32_t stimulusID = 0;
+    if (mxIsChar(prhs[3])) {
+        mxGetString(prhs[3], name, sizeof(name));
+    } else {
+        double id = mxGetScalar(prhs[3]);
+        if (!(id >= 0.0 && id <= 4294967295.0) || id != static_cast<double>(static_cast<uint32_t>(id))) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Stimulus ID must be an integer 0 - 4294967295.");
+        }
+        stimulusID = static_cast<uint32_t>(id);
+    }
+    double scale = nrhs > 4 && !mxIsEmpty(prhs[4]) ? mxGetScalar(prhs[4]) : 1.0;
+    double loops = nrhs > 5 && !mxIsEmpty(prhs[5]) ? mxGetScalar(prhs[5]) : 1.0;
+    double delayMs = nrhs > 6 ? mxGetScalar(prhs[6]) : 0.0;
+    if (!(scale >= 0.0) || !(delayMs >= 0.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Gain scale must be >= 0 and delay >= 0 ms.");
+    }
+    if (!(loops >= 1.0 && loops <= STIMLIB_MAX_LOOPS) || loops != std::floor(loops)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Loops must be an integer 1 - %d.", STIMLIB_MAX_LOOPS);
+    }
+    int pattern = findPattern("stimulus");
+    ensurePatternTask();
+    int id = 0;
+    bool found = false;
+    bool open = false;
+    {
+        std::lock_guard<std::mutex> lock(patternMutex);
+        open = stimLibrary.base != nullptr;
+        const StimulusEntry* entry = name[0] ? findStimulus(stimLibrary, name) : findStimulus(stimLibrary, stimulusID);
+        if (entry) {
+            found = true;
+            prefetchStimulus(stimLibrary, *entry);
+            ctx.params[0] = entry->id;
+            ctx.params[1] = scale;
+            ctx.params[2] = loops;
+            ctx.numParams = 3;
+            id = launchPatternLocked(pattern, ctx, static_cast<int64_t>(delayMs * 1000.0));
+        }
+    }
+    if (!open) {
+        mexErrMsgIdAndTxt("TDK:NoLibrary", "No stimulus library is open. Call 'openStimulusLibrary' first.");
+    }
+    if (!found) {
+        if (name[0]) {
+            mexErrMsgIdAndTxt("TDK:NoStimulus", "No valid stimulus named '%s' in the library.", name);
+        }
+        mexErrMsgIdAndTxt("TDK:NoStimulus", "No valid stimulus with ID %u in the library.", stimulusID);
+    }
+    if (id == 0) {
+        mexErrMsgIdAndTxt("TDK:PatternLimit", "Can't play the stimulus: %d patterns running.", PATTERN_MAX_INSTANCES);
+    }
+    plhs = mxCreateDoubleScalar(id);
+}
 
-    int result = SetTimeFactor(value);
-    handleError(result, "SetTimeFactor");
+// Apply a role's configuration to its thread now if the thread is running.
+// The module lock keeps the thread from being joined meanwhile.
+void applyRealtimeToRunning(int role) {
+    auto apply = [role](std::thread& thread, bool running) {
+        if (!running || !thread.joinable()) return;
+        std::lock_guard<std::mutex> rtLock(rtMutex);
+        applyRtConfigLocked(thread.native_handle(), role);
+    };
+    if (role == RT_SCHEDULER) {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        apply(schedulerThread, schedulerRunning);
+    } else if (role == RT_IO) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        apply(ioThread, ioRunning);
+    } else if (role == RT_WATCHDOG) {
+        std::lock_guard<std::mutex> lock(watchdogMutex);
+        apply(watchdogThread, watchdogRunning);
+    } else if (role == RT_HEARTBEAT) {
+        std::lock_guard<std::mutex> lock(heartbeatMutex);
+        apply(heartbeatThread, heartbeatRunning);
+    }
 }
 
-void stopTactor(int nrhs, const mxArray* prhs[]) {
+mxArray* createRealtimeReport() {
+    static const char* const policyNames[] = {"normal", "fifo", "rr"};
+    static const char* const memoryNames[] = {"none", "engine", "all"};
+    const char* threadFields[] = {"thread", "policy", "priority", "cpus", "running", "applied", "message"};
+    const char* fields[] = {"threads", "memory", "memoryApplied", "memoryMessage"};
+    mxArray* threads = mxCreateStructMatrix(1, RT_SERVE, 7, threadFields); // The serve role is tdkd's
+    mxArray* report = mxCreateStructMatrix(1, 1, 4, fields);
+    std::lock_guard<std::mutex> lock(rtMutex);
+    for (int role = 0; role < RT_SERVE; role++) {
+        const RtConfig& config = rtConfigs[role];
+        const RtStatus& status = rtStatus[role];
+        int numCpus = 0;
+        for (int cpu = 0; cpu < 64; cpu++) numCpus += (config.cpuMask >> cpu) & 1;
+        mxArray* cpus = mxCreateDoubleMatrix(1, numCpus, mxREAL);
+        double* c = mxGetPr(cpus);
+        for (int cpu = 0; cpu < 64; cpu++) {
+            if ((config.cpuMask >> cpu) & 1) *c++ = cpu;
+        }
+        mxSetField(threads, role, "thread", mxCreateString(rtRoleNames[role]));
+        mxSetField(threads, role, "policy", mxCreateString(policyNames[config.policy]));
+        mxSetField(threads, role, "priority", mxCreateDoubleScalar(config.priority));
+        mxSetField(threads, role, "cpus", cpus);
+        mxSetField(threads, role, "running", mxCreateLogicalScalar(status.running));
+        mxSetField(threads, role, "applied", mxCreateLogicalScalar(status.applied));
+        mxSetField(threads, role, "message", mxCreateString(status.message));
+    }
+    mxSetField(report, 0, "threads", threads);
+    mxSetField(report, 0, "memory", mxCreateString(memoryNames[rtMemoryMode]));
+    mxSetField(report, 0, "memoryApplied", mxCreateLogicalScalar(rtMemoryApplied));
+    mxSetField(report, 0, "memoryMessage", mxCreateString(rtMemoryMessage));
+    return report;
+}
+
+void configureRealtime(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    static const char* const roles[] = {"scheduler", "io", "watchdog", "heartbeat", "all"};
+    static const char* const policies[] = {"normal", "fifo", "rr"};
+    static const char* const memoryModes[] = {"none", "engine", "all"};
+    if (nrhs > 1) {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("TDK:InputError", "ConfigureRealtime requires a thread, a policy, and optionally priority, CPUs and memory locking.");
+        }
+        uint8_t role = decodeChoice(prhs[1], roles, 5, "thread");
+        RtConfig config;
+        config.policy = decodeChoice(prhs[2], policies, 3, "scheduling policy");
+        if (config.policy != RT_POLICY_NORMAL) {
+            double priority = nrhs > 3 && !mxIsEmpty(prhs[3]) ? mxGetScalar(prhs[3]) : 50.0;
+            if (!(priority >= 1.0 && priority <= 99.0)) {
+                mexErrMsgIdAndTxt("TDK:InputError", "Real-time priority must be 1 - 99.");
+            }
+            config.priority = static_cast<int>(priority);
+        }
+        if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+            if (!mxIsDouble(prhs[4])) {
+                mexErrMsgIdAndTxt("TDK:InputError", "CPUs must be a double vector of CPU numbers (0 - 63).");
+            }
+            const double* cpus = mxGetPr(prhs[4]);
+            for (size_t k = 0; k < mxGetNumberOfElements(prhs[4]); k++) {
+                if (!(cpus[k] >= 0.0 && cpus[k] <= 63.0)) {
+                    mexErrMsgIdAndTxt("TDK:InputError", "CPU numbers must be 0 - 63.");
+                }
+                config.cpuMask |= uint64_t{1} << static_cast<int>(cpus[k]);
+            }
+        }
+        int first = role == 4 ? 0 : role;
+        int last = role == 4 ? RT_SERVE - 1 : role;
+        for (int r = first; r <= last; r++) {
+            {
+                std::lock_guard<std::mutex> lock(rtMutex);
+                rtConfigs[r] = config;
+                rtStatus[r].applied = false;
+                rtStatus[r].message[0] = '\0';
+            }
+            applyRealtimeToRunning(r);
+        }
+        if (nrhs > 5 && !mxIsEmpty(prhs[5])) {
+            uint8_t memory = decodeChoice(prhs[5], memoryModes, 3, "memory locking mode");
+            std::lock_guard<std::mutex> lock(rtMutex);
+            applyRtMemoryLocked(memory);
+        }
+    }
+    plhs = createRealtimeReport();
+}
+
+void renderDrive(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2 || !mxIsDouble(prhs[1]) || (!mxIsEmpty(prhs[1]) && mxGetN(prhs[1]) != 6)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "RenderDrive requires an N x 6 command matrix [timeMs type tactor value endValue durationMs].");
+    }
+    size_t count = mxGetM(prhs[1]);
+    const double* m = mxGetPr(prhs[1]);
+    std::vector<SynthCommand> commands(count);
+    double endMs = 0.0;
+    int highest = 1;
+    for (size_t i = 0; i < count; i++) {
+        SynthCommand& c = commands[i];
+        c.timeMs = m[i];
+        c.type = static_cast<uint8_t>(m[i + count]);
+        c.tacNum = static_cast<int>(m[i + 2 * count]);
+        c.value = static_cast<int>(m[i + 3 * count]);
+        c.endValue = static_cast<int>(m[i + 4 * count]);
+        c.duration = static_cast<int>(m[i + 5 * count]);
+        if (!(c.timeMs >= 0.0) || c.type == CMD_NONE || c.type > CMD_FREQ_TIME_DELAY) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Command %d: time must be >= 0 and type 1 - %d.", static_cast<int>(i + 1), CMD_FREQ_TIME_DELAY);
+        }
+        endMs = std::max(endMs, c.timeMs + std::max(c.duration, 0));
+        if (c.tacNum <= ENGINE_MAX_TACTOR) highest = std::max(highest, c.tacNum);
+    }
+
+    SynthOptions options;
+    if (nrhs > 2 && !mxIsEmpty(prhs[2])) options.sampleRate = mxGetScalar(prhs[2]);
+    if (!(options.sampleRate >= 1000.0 && options.sampleRate <= 384000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Sample rate must be 1000 - 384000 Hz.");
+    }
+    double seconds = nrhs > 3 && !mxIsEmpty(prhs[3]) ? mxGetScalar(prhs[3]) : endMs / 1000.0 + 0.1;
+    if (!(seconds > 0.0 && seconds * options.sampleRate < 9.0e15)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Duration must be a positive number of seconds.");
+    }
+    options.numFrames = static_cast<int64_t>(std::ceil(seconds * options.sampleRate));
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        if (!mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) > SYNTH_MAX_CHANNELS) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Tactors must be a double vector of up to %d tactor numbers.", SYNTH_MAX_CHANNELS);
+        }
+        const double* tactors = mxGetPr(prhs[4]);
+        options.numChannels = static_cast<int>(mxGetNumberOfElements(prhs[4]));
+        for (int c = 0; c < options.numChannels; c++) {
+            if (!(tactors[c] >= 1.0 && tactors[c] <= ENGINE_MAX_TACTOR)) {
+                mexErrMsgIdAndTxt("TDK:InputError", "Tactors must be 1 - %d.", ENGINE_MAX_TACTOR);
+            }
+            options.tactors[c] = static_cast<int>(tactors[c]);
+        }
+    } else {
+        options.numChannels = highest;
+        for (int c = 0; c < highest; c++) options.tactors[c] = c + 1;
+    }
+    char filename[1024] = "";
+    if (nrhs > 5 && !mxIsEmpty(prhs[5])) {
+        if (!mxIsChar(prhs[5])) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Filename must be a character vector.");
+        }
+        mxGetString(prhs[5], filename, sizeof(filename));
+    }
+    if (nrhs > 6 && !mxIsEmpty(prhs[6])) options.initialGain = static_cast<int>(mxGetScalar(prhs[6]));
+    if (nrhs > 7 && !mxIsEmpty(prhs[7])) options.initialFreq = static_cast<int>(mxGetScalar(prhs[7]));
+    if (options.initialFreq < MIN_ACTION_FREQUENCY || options.initialFreq > MAX_ACTION_FREQUENCY) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Initial frequency must be %d - %d Hz.", MIN_ACTION_FREQUENCY, MAX_ACTION_FREQUENCY);
+    }
+
+    SynthRenderer renderer(commands.data(), commands.size(), options);
+    if (filename[0]) {
+        size_t length = std::strlen(filename);
+        bool wav = length >= 4 && (strcmp(filename + length - 4, ".wav") == 0 || strcmp(filename + length - 4, ".WAV") == 0);
+        int64_t written = renderToFile(renderer, options, filename, wav);
+        if (written < 0) {
+            mexErrMsgIdAndTxt("TDK:FileError", "Could not write %s%s.", filename,
+                              wav ? " (WAV data is limited to 4 GB; use a raw file)" : "");
+        }
+        plhs = mxCreateDoubleScalar(static_cast<double>(written));
+    } else {
+        plhs = mxCreateNumericMatrix(options.numChannels, static_cast<size_t>(options.numFrames), mxSINGLE_CLASS, mxREAL);
+        renderer.render(static_cast<float*>(mxGetData(plhs)), options.numFrames);
+    }
+    if (renderer.commandsClamped()) {
+        mexWarnMsgIdAndTxt("TDK:Clamped", "%llu command(s) had out-of-range values and were rendered clamped.",
+                           static_cast<unsigned long long>(renderer.commandsClamped()));
+    }
+}
+
+void configureValidation(int nrhs, const mxArray* prhs[]) {
+    static const char* const policies[] = {"off", "clamp", "error"};
     if (nrhs < 2) {
-        mexErrMsgIdAndTxt("TDK:InputError", "Stop requires deviceID.");
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureValidation requires a policy ('off', 'clamp' or 'error').");
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
+    uint8_t policy = decodeChoice(prhs[1], policies, 3, "validation policy");
+    validationPolicy.store(policy, std::memory_order_relaxed);
+}
 
-    int result = Stop(deviceID, 0);
-    handleError(result, "Stop");
+void configureTrace(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureTrace requires enabled (true/false) and optionally clear.");
+    }
+    bool enabled = mxGetScalar(prhs[1]) != 0;
+    bool clear = nrhs > 2 && mxGetScalar(prhs[2]) != 0;
+    if (clear) clearTrace();
+    traceEnabled.store(enabled, std::memory_order_relaxed);
 }
 
-void beginStoreTAction(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 3) {
-        mexErrMsgIdAndTxt("TDK:InputError", "BeginStoreTACtion requires deviceID and TActionID.");
+void setHeartbeat(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs > 1) {
+        double intervalMs = mxGetScalar(prhs[1]);
+        if (!(intervalMs == 0.0 || (intervalMs >= HEARTBEAT_MIN_INTERVAL_US / 1000.0 && intervalMs <= 3.6e6))) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Heartbeat interval must be 0 (off) or %g ms - 1 hour.", HEARTBEAT_MIN_INTERVAL_US / 1000.0);
+        }
+        configureHeartbeat(static_cast<int64_t>(intervalMs * 1000.0));
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int tacID = static_cast<int>(mxGetScalar(prhs[2]));
-    int result = BeginStoreTAction(deviceID, tacID); 
-    handleError(result, "BeginStoreTAction");
+    if (numOutputs == 0) return;
+    HeartbeatStats h;
+    int64_t intervalUs = heartbeatIntervalUs.load(std::memory_order_relaxed);
+    bool tripped;
+    {
+        std::lock_guard<std::mutex> lock(heartbeatMutex);
+        h = heartbeatStats;
+        tripped = heartbeatTripped;
+    }
+    const char* logFields[] = {"time", "gapMs", "devices", "failures"};
+    mxArray* log = mxCreateStructMatrix(h.logCount, 1, 4, logFields);
+    for (int k = 0; k < h.logCount; k++) { // Oldest first
+        const HeartbeatTrip& trip = h.log[(h.logNext - h.logCount + k + HEARTBEAT_LOG_SIZE) % HEARTBEAT_LOG_SIZE];
+        mxSetField(log, k, "time", mxCreateDoubleScalar(trip.unixTime));
+        mxSetField(log, k, "gapMs", mxCreateDoubleScalar(trip.gapUs / 1000.0));
+        mxSetField(log, k, "devices", mxCreateDoubleScalar(trip.devices));
+        mxSetField(log, k, "failures", mxCreateDoubleScalar(trip.failures));
+    }
+    const char* fields[] = {"intervalMs", "armed", "tripped", "trips", "stopFailures", "maxGapMs", "maxTripLatencyMs", "log"};
+    plhs = mxCreateStructMatrix(1, 1, 8, fields);
+    mxSetField(plhs, 0, "intervalMs", mxCreateDoubleScalar(intervalUs / 1000.0));
+    mxSetField(plhs, 0, "armed", mxCreateLogicalScalar(intervalUs > 0 && !tripped));
+    mxSetField(plhs, 0, "tripped", mxCreateLogicalScalar(tripped));
+    mxSetField(plhs, 0, "trips", mxCreateDoubleScalar(static_cast<double>(h.trips)));
+    mxSetField(plhs, 0, "stopFailures", mxCreateDoubleScalar(static_cast<double>(h.stopFailures)));
+    mxSetField(plhs, 0, "maxGapMs", mxCreateDoubleScalar(heartbeatMaxGapUs.load(std::memory_order_relaxed) / 1000.0));
+    mxSetField(plhs, 0, "maxTripLatencyMs", mxCreateDoubleScalar(h.maxTripLatencyUs / 1000.0));
+    mxSetField(plhs, 0, "log", log);
 }
 
-void finishStoreTAction(int nrhs, const mxArray* prhs[]) {
+void setAckTracking(int nrhs, const mxArray* prhs[]) {
     if (nrhs < 2) {
-        mexErrMsgIdAndTxt("TDK:InputError", "FinishStoreTACtion requires deviceID.");
+        mexErrMsgIdAndTxt("TDK:InputError", "ConfigureAckTracking requires enabled (logical) and optionally a timeout (ms) and reset.");
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int result = FinishStoreTAction(deviceID); 
-    handleError(result, "FinishStoreTAction");
+    bool enabled = mxGetScalar(prhs[1]) != 0.0;
+    double timeoutMs = nrhs > 2 && !mxIsEmpty(prhs[2]) ? mxGetScalar(prhs[2]) : ACK_DEFAULT_TIMEOUT_US / 1000.0;
+    bool reset = nrhs > 3 && mxGetScalar(prhs[3]) != 0.0;
+    if (!(timeoutMs >= 1.0 && timeoutMs <= 60000.0)) {
+        mexErrMsgIdAndTxt("TDK:InputError", "Acknowledgement timeout must be 1 - 60000 ms.");
+    }
+    if (enabled && ackCallback() == nullptr) { // Every command would time out
+        mexErrMsgIdAndTxt("TDK:Unsupported", "Acknowledgement tracking needs controller responses, which only the native serial backend delivers.");
+    }
+    configureAckTracking(enabled, static_cast<int64_t>(timeoutMs * 1000.0), reset);
 }
 
-void playStoredTAction(int nrhs, const mxArray* prhs[]) {
-    if (nrhs < 4) {
-        mexErrMsgIdAndTxt("TDK:InputError", "BeginStoreTACtion requires deviceID and TActionID.");
+void getAckStatus(mxArray*& plhs) {
+    const char* commandFields[] = {"command", "acked", "rejected", "timedOut", "minMs", "meanMs",
+                                   "p50Ms", "p90Ms", "p99Ms", "maxMs", "counts"};
+    const char* timeoutFields[] = {"sequence", "deviceID", "command", "tactor", "ageMs"};
+    const char* fields[] = {"enabled", "timeoutMs", "tracked", "acked", "timedOut", "missed", "overflowed", "unmatched",
+                            "outstanding", "lastSequence", "edgesMs", "commands", "timeouts"};
+    mxArray* edges = mxCreateDoubleMatrix(1, ACK_BUCKETS + 1, mxREAL);
+    for (int b = 0; b <= ACK_BUCKETS; b++) mxGetPr(edges)[b] = ackBucketEdgeUs(b) / 1000.0;
+    mxArray* commands = mxCreateStructMatrix(1, ACK_NUM_TYPES - 1, 11, commandFields);
+    std::lock_guard<std::mutex> lock(ackMutex);
+    expireAllLocked(nowUs());
+    int outstanding = 0;
+    for (const auto& list : inflight) outstanding += list.count;
+    for (int type = 1; type < ACK_NUM_TYPES; type++) {
+        const AckHistogram& h = ackHistograms[type];
+        int k = type - 1;
+        mxArray* counts = mxCreateDoubleMatrix(1, ACK_BUCKETS, mxREAL);
+        for (int b = 0; b < ACK_BUCKETS; b++) mxGetPr(counts)[b] = static_cast<double>(h.counts[b]);
+        mxSetField(commands, k, "command", mxCreateString(ackTypeNames[type]));
+        mxSetField(commands, k, "acked", mxCreateDoubleScalar(static_cast<double>(h.acked)));
+        mxSetField(commands, k, "rejected", mxCreateDoubleScalar(static_cast<double>(h.rejected)));
+        mxSetField(commands, k, "timedOut", mxCreateDoubleScalar(static_cast<double>(h.timedOut)));
+        mxSetField(commands, k, "minMs", mxCreateDoubleScalar(h.minUs / 1000.0));
+        mxSetField(commands, k, "meanMs", mxCreateDoubleScalar(h.acked ? h.totalUs / 1000.0 / h.acked : 0.0));
+        mxSetField(commands, k, "p50Ms", mxCreateDoubleScalar(ackPercentileUs(h, 0.50) / 1000.0));
+        mxSetField(commands, k, "p90Ms", mxCreateDoubleScalar(ackPercentileUs(h, 0.90) / 1000.0));
+        mxSetField(commands, k, "p99Ms", mxCreateDoubleScalar(ackPercentileUs(h, 0.99) / 1000.0));
+        mxSetField(commands, k, "maxMs", mxCreateDoubleScalar(h.maxUs / 1000.0));
+        mxSetField(commands, k, "counts", counts);
     }
-    int deviceID = static_cast<int>(mxGetScalar(prhs[1]));
-    int delay = static_cast<int>(mxGetScalar(prhs[2])); 
-    int tacID = static_cast<int>(mxGetScalar(prhs[3]));
-    int result = PlayStoredTAction(deviceID, delay, tacID); 
-    handleError(result, "PlayStoredTAction");
+    mxArray* timeouts = mxCreateStructMatrix(ackTimeoutCount, 1, 5, timeoutFields);
+    for (int k = 0; k < ackTimeoutCount; k++) { // Oldest first
+        const AckTimeout& t = ackTimeouts[(ackTimeoutNext - ackTimeoutCount + k + INFLIGHT_TIMEOUT_LOG) % INFLIGHT_TIMEOUT_LOG];
+        mxSetField(timeouts, k, "sequence", mxCreateDoubleScalar(static_cast<double>(t.sequence)));
+        mxSetField(timeouts, k, "deviceID", mxCreateDoubleScalar(t.deviceID));
+        mxSetField(timeouts, k, "command", mxCreateString(ackTypeNames[t.type]));
+        mxSetField(timeouts, k, "tactor", mxCreateDoubleScalar(t.tacNum));
+        mxSetField(timeouts, k, "ageMs", mxCreateDoubleScalar(t.ageUs / 1000.0));
+    }
+    plhs = mxCreateStructMatrix(1, 1, 13, fields);
+    mxSetField(plhs, 0, "enabled", mxCreateLogicalScalar(issueObserver.load() != nullptr));
+    mxSetField(plhs, 0, "timeoutMs", mxCreateDoubleScalar(ackTimeoutUs / 1000.0));
+    mxSetField(plhs, 0, "tracked", mxCreateDoubleScalar(static_cast<double>(ackStats.tracked)));
+    mxSetField(plhs, 0, "acked", mxCreateDoubleScalar(static_cast<double>(ackStats.acked)));
+    mxSetField(plhs, 0, "timedOut", mxCreateDoubleScalar(static_cast<double>(ackStats.timedOut)));
+    mxSetField(plhs, 0, "missed", mxCreateDoubleScalar(static_cast<double>(ackStats.missed)));
+    mxSetField(plhs, 0, "overflowed", mxCreateDoubleScalar(static_cast<double>(ackStats.overflowed)));
+    mxSetField(plhs, 0, "unmatched", mxCreateDoubleScalar(static_cast<double>(ackStats.unmatched)));
+    mxSetField(plhs, 0, "outstanding", mxCreateDoubleScalar(outstanding));
+    mxSetField(plhs, 0, "lastSequence", mxCreateDoubleScalar(static_cast<double>(commandSequence.load())));
+    mxSetField(plhs, 0, "edgesMs", edges);
+    mxSetField(plhs, 0, "commands", commands);
+    mxSetField(plhs, 0, "timeouts", timeouts);
+}
+
+void addTraceMarker(int nrhs, const mxArray* prhs[]) {
+    if (nrhs < 2 || !mxIsChar(prhs[1])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "TraceMarker requires marker text.");
+    }
+    char text[TRACE_MARKER_CHARS];
+    mxGetString(prhs[1], text, sizeof(text));
+    if (!traceMarker(text)) {
+        mexWarnMsgIdAndTxt("TDK:TraceFull", "Trace marker table is full (%d); marker dropped.", TRACE_MAX_MARKERS);
+    }
+}
+
+void writeTrace(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+    if (nrhs < 2 || !mxIsChar(prhs[1])) {
+        mexErrMsgIdAndTxt("TDK:InputError", "DumpTrace requires a filename.");
+    }
+    char filename[1024];
+    mxGetString(prhs[1], filename, sizeof(filename));
+    long long count = dumpTrace(filename);
+    if (count < 0) {
+        mexErrMsgIdAndTxt("TDK:FileError", "Could not open %s for writing.", filename);
+    }
+    plhs = mxCreateDoubleScalar(static_cast<double>(count));
+}
+
+void attachDaemon(int nrhs, const mxArray* prhs[], mxArray*& plhs) {
+#if defined(__linux__)
+    if (isConnected) {
+        mexErrMsgIdAndTxt("TDK:ConnectionError", "A device is connected directly. Shut down before attaching to the daemon.");
+    }
+    char ringName[64] = "/tdk_ring";
+    if (nrhs > 1) {
+        if (!mxIsChar(prhs[1])) {
+            mexErrMsgIdAndTxt("TDK:InputError", "Attach takes an optional ring name (string).");
+        }
+        mxGetString(prhs[1], ringName, sizeof(ringName));
+    }
+    detachDaemon();
+    SharedRing* ring = openRing(ringName);
+    if (!ring) {
+        mexErrMsgIdAndTxt("TDK:ConnectionError", "No tdkd command ring named '%s'. Start the daemon first.", ringName);
+    }
+    if (!daemonAlive(ring)) {
+        closeRing(ring);
+        handleError(-1, "Attach", ENGINE_ERROR_NO_DAEMON);
+    }
+    clientRing.store(ring);
+    commandSink.store(ringSink, std::memory_order_release);
+    int count = ring->header.deviceCount;
+    plhs = mxCreateDoubleMatrix(1, count, mxREAL);
+    double* ids = mxGetPr(plhs);
+    for (int i = 0; i < count; i++) {
+        ids[i] = ring->header.deviceIDs[i];
+        if (ids[i] >= 0 && ids[i] < 64) heartbeatDevices.fetch_or(uint64_t{1} << ring->header.deviceIDs[i], std::memory_order_release);
+    }
+#else
+    (void)nrhs;
+    (void)prhs;
+    (void)plhs;
+    mexErrMsgIdAndTxt("TDK:Unsupported", "Client mode (tdkd) is only available on Linux.");
+#endif
 }
 
 // Dispatch Table for String-based Commands
@@ -599,6 +3393,108 @@ void dispatchCommand(const char* command, int nrhs, const mxArray* prhs[], mxArr
         playStoredTAction(nrhs, prhs);  
     } else if (strcmp(command, "checkConnection") == 0) {
         checkConnection(plhs);
+    } else if (strcmp(command, "loadLayout") == 0) {
+        loadLayout(nrhs, prhs, plhs);
+    } else if (strcmp(command, "setStimulus") == 0) {
+        setStimulus(nrhs, prhs);
+    } else if (strcmp(command, "startRenderer") == 0) {
+        startRenderer(nrhs, prhs);
+    } else if (strcmp(command, "stopRenderer") == 0) {
+        stopRenderer(nrhs, prhs);
+    } else if (strcmp(command, "writeFrame") == 0) {
+        writeFrame(nrhs, prhs, plhs);
+    } else if (strcmp(command, "commitFrame") == 0) {
+        commitFrameCommand(nrhs, prhs, plhs);
+    } else if (strcmp(command, "startFrameCommit") == 0) {
+        startFrameCommit(nrhs, prhs);
+    } else if (strcmp(command, "stopFrameCommit") == 0) {
+        stopFrameCommit(nrhs, prhs);
+    } else if (strcmp(command, "configureQueue") == 0) {
+        configureQueue(nrhs, prhs);
+    } else if (strcmp(command, "stats") == 0) {
+        getStats(plhs);
+    } else if (strcmp(command, "configureFlowControl") == 0) {
+        configureFlowControl(nrhs, prhs);
+    } else if (strcmp(command, "flowStatus") == 0) {
+        getFlowStatus(plhs);
+    } else if (strcmp(command, "changeSigSource") == 0) {
+        changeSigSource(nrhs, prhs);
+    } else if (strcmp(command, "configureReconnect") == 0) {
+        configureReconnect(nrhs, prhs);
+    } else if (strcmp(command, "silence") == 0) {
+        silenceTactor(nrhs, prhs);
+    } else if (strcmp(command, "arm") == 0) {
+        armSlot(nrhs, prhs, plhs);
+    } else if (strcmp(command, "fire") == 0) {
+        fireArmedSlot(nrhs, prhs);
+    } else if (strcmp(command, "attach") == 0) {
+        attachDaemon(nrhs, prhs, plhs);
+    } else if (strcmp(command, "detach") == 0) {
+        detachDaemon();
+    } else if (strcmp(command, "configureMixer") == 0) {
+        configureMixer(nrhs, prhs);
+    } else if (strcmp(command, "addEffect") == 0) {
+        addEffect(nrhs, prhs, plhs);
+    } else if (strcmp(command, "updateEffect") == 0) {
+        updateEffect(nrhs, prhs);
+    } else if (strcmp(command, "removeEffect") == 0) {
+        removeEffect(nrhs, prhs);
+    } else if (strcmp(command, "launchPattern") == 0) {
+        launchPattern(nrhs, prhs, plhs);
+    } else if (strcmp(command, "cancelPattern") == 0) {
+        cancelPattern(nrhs, prhs, plhs);
+    } else if (strcmp(command, "patternStatus") == 0) {
+        getPatternStatus(nrhs, prhs, plhs);
+    } else if (strcmp(command, "patternEvent") == 0) {
+        raisePatternEvent(nrhs, prhs);
+    } else if (strcmp(command, "addLfo") == 0) {
+        addLfo(nrhs, prhs, plhs);
+    } else if (strcmp(command, "updateLfo") == 0) {
+        updateLfo(nrhs, prhs);
+    } else if (strcmp(command, "removeLfo") == 0) {
+        removeLfo(nrhs, prhs);
+    } else if (strcmp(command, "applyProfile") == 0) {
+        applyProfile(nrhs, prhs, plhs);
+    } else if (strcmp(command, "openStimulusLibrary") == 0) {
+        openStimulusLibrary(nrhs, prhs, plhs);
+    } else if (strcmp(command, "closeStimulusLibrary") == 0) {
+        closeStimulusLibrary();
+    } else if (strcmp(command, "playStimulus") == 0) {
+        playStimulus(nrhs, prhs, plhs);
+    } else if (strcmp(command, "configureRealtime") == 0) {
+        configureRealtime(nrhs, prhs, plhs);
+    } else if (strcmp(command, "renderDrive") == 0) {
+        renderDrive(nrhs, prhs, plhs);
+    } else if (strcmp(command, "heartbeat") == 0) {
+        // The call itself is the beat (mexFunction)
+    } else if (strcmp(command, "configureHeartbeat") == 0) {
+        setHeartbeat(nrhs, prhs, plhs);
+    } else if (strcmp(command, "configureAckTracking") == 0) {
+        setAckTracking(nrhs, prhs);
+    } else if (strcmp(command, "ackStatus") == 0) {
+        getAckStatus(plhs);
+    } else if (strcmp(command, "configureMapping") == 0) {
+        configureMapping(nrhs, prhs);
+    } else if (strcmp(command, "pushFeatures") == 0) {
+        pushFeatures(nrhs, prhs);
+    } else if (strcmp(command, "mappingStatus") == 0) {
+        getMappingStatus(nrhs, prhs, plhs);
+    } else if (strcmp(command, "healthCheck") == 0) {
+        healthCheck(nrhs, prhs, plhs);
+    } else if (strcmp(command, "lock") == 0) {
+        lockEngine();
+    } else if (strcmp(command, "unlock") == 0) {
+        unlockEngine();
+    } else if (strcmp(command, "getDeviceIDs") == 0) {
+        getDeviceIDs(plhs);
+    } else if (strcmp(command, "configureValidation") == 0) {
+        configureValidation(nrhs, prhs);
+    } else if (strcmp(command, "configureTrace") == 0) {
+        configureTrace(nrhs, prhs);
+    } else if (strcmp(command, "traceMarker") == 0) {
+        addTraceMarker(nrhs, prhs);
+    } else if (strcmp(command, "dumpTrace") == 0) {
+        writeTrace(nrhs, prhs, plhs);
     } else if ((strcmp(command, "help") == 0) || (strcmp(command,"-help") == 0)) {
         printHelp();
     } else if ((strcmp(command, "h") == 0) || (strcmp(command,"-h") == 0)) {
@@ -673,6 +3569,158 @@ void dispatchCommand(uint8_t command, int nrhs, const mxArray* prhs[], mxArray*&
         case 17:
             checkConnection(plhs);
             break;
+        case 18:
+            loadLayout(nrhs, prhs, plhs);
+            break;
+        case 19:
+            setStimulus(nrhs, prhs);
+            break;
+        case 20:
+            startRenderer(nrhs, prhs);
+            break;
+        case 21:
+            stopRenderer(nrhs, prhs);
+            break;
+        case 22:
+            writeFrame(nrhs, prhs, plhs);
+            break;
+        case 23:
+            commitFrameCommand(nrhs, prhs, plhs);
+            break;
+        case 24:
+            startFrameCommit(nrhs, prhs);
+            break;
+        case 25:
+            stopFrameCommit(nrhs, prhs);
+            break;
+        case 26:
+            configureQueue(nrhs, prhs);
+            break;
+        case 27:
+            getStats(plhs);
+            break;
+        case 28:
+            configureFlowControl(nrhs, prhs);
+            break;
+        case 29:
+            getFlowStatus(plhs);
+            break;
+        case 30:
+            changeSigSource(nrhs, prhs);
+            break;
+        case 31:
+            configureReconnect(nrhs, prhs);
+            break;
+        case 32:
+            silenceTactor(nrhs, prhs);
+            break;
+        case 33:
+            armSlot(nrhs, prhs, plhs);
+            break;
+        case 34:
+            fireArmedSlot(nrhs, prhs);
+            break;
+        case 35:
+            attachDaemon(nrhs, prhs, plhs);
+            break;
+        case 36:
+            detachDaemon();
+            break;
+        case 37:
+            configureMixer(nrhs, prhs);
+            break;
+        case 38:
+            addEffect(nrhs, prhs, plhs);
+            break;
+        case 39:
+            updateEffect(nrhs, prhs);
+            break;
+        case 40:
+            removeEffect(nrhs, prhs);
+            break;
+        case 41:
+            launchPattern(nrhs, prhs, plhs);
+            break;
+        case 42:
+            cancelPattern(nrhs, prhs, plhs);
+            break;
+        case 43:
+            getPatternStatus(nrhs, prhs, plhs);
+            break;
+        case 44:
+            raisePatternEvent(nrhs, prhs);
+            break;
+        case 45:
+            addLfo(nrhs, prhs, plhs);
+            break;
+        case 46:
+            updateLfo(nrhs, prhs);
+            break;
+        case 47:
+            removeLfo(nrhs, prhs);
+            break;
+        case 48:
+            configureTrace(nrhs, prhs);
+            break;
+        case 49:
+            addTraceMarker(nrhs, prhs);
+            break;
+        case 50:
+            writeTrace(nrhs, prhs, plhs);
+            break;
+        case 51:
+            configureValidation(nrhs, prhs);
+            break;
+        case 52:
+            applyProfile(nrhs, prhs, plhs);
+            break;
+        case 53:
+            openStimulusLibrary(nrhs, prhs, plhs);
+            break;
+        case 54:
+            closeStimulusLibrary();
+            break;
+        case 55:
+            playStimulus(nrhs, prhs, plhs);
+            break;
+        case 56:
+            configureRealtime(nrhs, prhs, plhs);
+            break;
+        case 57:
+            renderDrive(nrhs, prhs, plhs);
+            break;
+        case 58:
+            break; // The call itself is the beat (mexFunction)
+        case 59:
+            setHeartbeat(nrhs, prhs, plhs);
+            break;
+        case 60:
+            setAckTracking(nrhs, prhs);
+            break;
+        case 61:
+            getAckStatus(plhs);
+            break;
+        case 62:
+            configureMapping(nrhs, prhs);
+            break;
+        case 63:
+            pushFeatures(nrhs, prhs);
+            break;
+        case 64:
+            getMappingStatus(nrhs, prhs, plhs);
+            break;
+        case 65:
+            healthCheck(nrhs, prhs, plhs);
+            break;
+        case 66:
+            lockEngine();
+            break;
+        case 67:
+            unlockEngine();
+            break;
+        case 68:
+            getDeviceIDs(plhs);
+            break;
         default:
             printHelp();
             mexErrMsgIdAndTxt("TDK:UnknownCommand", "Unknown command code: %d", command);
@@ -681,6 +3729,17 @@ void dispatchCommand(uint8_t command, int nrhs, const mxArray* prhs[], mxArray*&
 
 // MEX entry point
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+    callStartUs = nowUs();
+    heartbeat(callStartUs);
+    numOutputs = nlhs;
+
+    // Fire path: tactor(uint8(34), slot) goes straight to the armed slot
+    if (nrhs == 2 && mxGetClassID(prhs[0]) == mxUINT8_CLASS && mxGetNumberOfElements(prhs[0]) == 1 &&
+        *static_cast<const uint8_t*>(mxGetData(prhs[0])) == fireCommandCode) {
+        fireArmedSlot(nrhs, prhs);
+        return;
+    }
+
     // If no arguments are provided, print help
     if (nrhs == 0) {
         printHelp();
@@ -690,6 +3749,8 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
     // Register cleanup function once
     if (!atExitRegistered) {
         mexAtExit(cleanup);
+        traceThreadName("matlab");
+        engineStartUs = callStartUs;
         atExitRegistered = true;
     }
 
@@ -697,11 +3758,13 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
     if (mxIsNumeric(prhs[0]) && mxGetClassID(prhs[0]) == mxUINT8_CLASS) {
         // Integer-based dispatch
         uint8_t command = static_cast<uint8_t>(mxGetScalar(prhs[0]));
+        TRACE_SCOPE_ARG("mex", command);
         dispatchCommand(command, nrhs, prhs, plhs[0]);
     } else if (mxIsChar(prhs[0])) {
         // String-based dispatch
         char command[64];
         mxGetString(prhs[0], command, sizeof(command));
+        TRACE_SCOPE("mex");
         dispatchCommand(command, nrhs, prhs, plhs[0]);
     } else {
         mexErrMsgIdAndTxt("TDK:InputError", "First argument must be a command string or uint8.");
@@ -0,0 +1,1093 @@
+// tdkd: device-owning daemon for the tactor engine (Linux).
+//
+// Owns the Connect()ed controllers and serves the shared-memory command ring
+// (ring.h), so several processes (MATLAB in client mode, Python, C++) can drive
+// the same tactors. Commands are issued with the same engine code as the MEX:
+// priority stop/silence, the coalescing I/O queue, and flow control.
+//
+// Build (stub backend, no hardware):
+//   g++ -std=c++17 -O2 -ITDK_API src/tdkd.cpp src/stub_backend.cpp -lpthread -lrt -o tdkd
+// Build (native serial backend, serial_backend.cpp):
+//   g++ -std=c++17 -O2 -DTDK_SERIAL_BACKEND -ITDK_API src/tdkd.cpp src/serial_backend.cpp -lpthread -lrt -o tdkd
+//
+// Usage:
+//   tdkd [--ring /tdk_ring] [--device NAME[:TYPE]]... [--queue] [--verbose] [RT options]
+//   tdkd --self-test [--producers N] [--count N]
+//   tdkd --jitter-test [--seconds S] [--rate HZ] [--load N] [RT options]
+//   tdkd --serial-test [--count N]   (serial backend builds)
+//   tdkd --queue-test
+//   tdkd --soak-test [--seconds S] [--interval S] [--rate HZ] [--tactors N] [--queue] [--report FILE]
+//
+// RT options (rt.h) apply to every engine thread and the serve loop:
+//   --rt-policy fifo|rr --rt-priority N --cpus LIST --mlock engine|all
+//
+// Without --device, the first discovered USB device (type 1) is connected.
+
+#include "engine.h"
+#include "commandqueue.h"
+#include "ring.h"
+#include "rt.h"
+#include "validate.h"
+#if defined(TDK_SERIAL_BACKEND)
+#include "serial.h"
+#include <fcntl.h>
+#include <poll.h>
+#endif
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+struct DaemonDevice {
+    std::string name;
+    int type = 1;
+    int deviceID = -1;
+};
+
+struct DaemonOptions {
+    std::string ring = RING_DEFAULT_NAME;
+    std::vector<DaemonDevice> devices;
+    bool queue = false;
+    bool verbose = false;
+    bool selfTest = false;
+    int producers = 4;
+    int count = 50000; // Records per producer in the self-test
+    RtConfig rt;
+    bool rtRequested = false;
+    uint8_t memory = RT_MEMORY_NONE;
+    bool jitterTest = false;
+    double seconds = 5.0; // Per jitter-test phase
+    double rate = 1000.0; // Jitter-test task rate (Hz)
+    int load = -1;        // Busy threads during the jitter test; -1 == one per CPU
+    bool serialTest = false;
+    bool queueTest = false;
+    bool soakTest = false;
+    double interval = 10.0; // Soak-test sampling interval (s)
+    int tactors = 32;       // Soak-test tactors per device
+    std::string report;     // Soak-test CSV time series
+};
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+// Optional per-record observer (self-test)
+using RecordObserver = void (*)(const RingRecord& record, int64_t issuedUs);
+static RecordObserver recordObserver = nullptr;
+
+static void onSignal(int) {
+    stopRequested = 1; // The serve loop wakes at least every RING_WAIT_US
+}
+
+constexpr int64_t RING_WAIT_US = 100000; // Longest sleep between heartbeats
+constexpr int SERVE_BATCH = 256;         // Records issued per heartbeat/UpdateTI batch
+
+static void printUsage() {
+    std::printf("Usage:\n");
+    std::printf("  tdkd [--ring NAME] [--device NAME[:TYPE]]... [--queue] [--verbose] [RT options]\n");
+    std::printf("  tdkd --self-test [--producers N] [--count N]\n");
+    std::printf("  tdkd --jitter-test [--seconds S] [--rate HZ] [--load N] [RT options]\n");
+    std::printf("  tdkd --serial-test [--count N]\n");
+    std::printf("  tdkd --queue-test\n");
+    std::printf("  tdkd --soak-test [--seconds S] [--interval S] [--rate HZ] [--tactors N] [--queue] [--report FILE]\n\n");
+    std::printf("  --ring NAME        Shared-memory ring name (default %s).\n", RING_DEFAULT_NAME);
+    std::printf("  --device NAME:TYPE Connect this device (repeatable; TYPE defaults to 1, USB).\n");
+    std::printf("  --queue            Issue ring commands through the coalescing I/O queue.\n");
+    std::printf("  --verbose          Print ring statistics every second.\n");
+    std::printf("  --self-test        Run a multi-process ring test against the backend and exit.\n");
+    std::printf("  --jitter-test      Measure scheduler wake-up jitter with default and RT settings, and exit.\n");
+    std::printf("  --serial-test      Drive a pseudo-terminal stand-in device through the serial backend, and exit.\n");
+    std::printf("  --queue-test       Check that queue coalescing keeps the last value written, and exit.\n");
+    std::printf("  --soak-test        Drive a command mix for --seconds, sample every --interval, flag drift, and exit.\n");
+    std::printf("  --seconds S        Jitter-test phase length, or soak-test length (e.g. 14400 for 4 h).\n");
+    std::printf("  --interval S       Soak-test sampling interval (default 10).\n");
+    std::printf("  --rate HZ          Jitter-test task rate, or soak-test commands per second (default 1000).\n");
+    std::printf("  --tactors N        Tactors the soak-test mix spreads over (default 32).\n");
+    std::printf("  --report FILE      Write the soak-test samples as CSV.\n");
+    std::printf("  --rt-policy P      fifo or rr for the engine threads (default fifo with --rt-priority).\n");
+    std::printf("  --rt-priority N    Real-time priority 1 - 99.\n");
+    std::printf("  --cpus LIST        CPUs the engine threads may run on, e.g. 2,3 or 2-3.\n");
+    std::printf("  --mlock MODE       engine (lock engine buffers) or all (mlockall).\n");
+}
+
+// "2,3,6-7" -> CPU mask. Returns false on a malformed list.
+static bool parseCpuList(const std::string& list, uint64_t& mask) {
+    mask = 0;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(pos, end - pos);
+        size_t dash = item.find('-');
+        int lo = std::atoi(item.c_str());
+        int hi = dash == std::string::npos ? lo : std::atoi(item.c_str() + dash + 1);
+        if (item.empty() || lo < 0 || hi > 63 || lo > hi) return false;
+        for (int cpu = lo; cpu <= hi; cpu++) mask |= uint64_t{1} << cpu;
+        pos = end + 1;
+    }
+    return mask != 0;
+}
+
+static bool parseOptions(int argc, char** argv, DaemonOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--ring" && hasValue) {
+            options.ring = argv[++i];
+            if (options.ring.empty() || options.ring[0] != '/') options.ring = "/" + options.ring;
+        } else if (arg == "--device" && hasValue) {
+            DaemonDevice device;
+            std::string spec = argv[++i];
+            size_t colon = spec.rfind(':');
+            device.name = spec.substr(0, colon);
+            if (colon != std::string::npos) device.type = std::atoi(spec.c_str() + colon + 1);
+            options.devices.push_back(device);
+        } else if (arg == "--queue") {
+            options.queue = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--self-test") {
+            options.selfTest = true;
+        } else if (arg == "--producers" && hasValue) {
+            options.producers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--count" && hasValue) {
+            options.count = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--serial-test") {
+            options.serialTest = true;
+        } else if (arg == "--queue-test") {
+            options.queueTest = true;
+        } else if (arg == "--soak-test") {
+            options.soakTest = true;
+        } else if (arg == "--interval" && hasValue) {
+            options.interval = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--tactors" && hasValue) {
+            options.tactors = std::min(ENGINE_MAX_TACTOR, std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--report" && hasValue) {
+            options.report = argv[++i];
+        } else if (arg == "--jitter-test") {
+            options.jitterTest = true;
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--rate" && hasValue) {
+            options.rate = std::min(10000.0, std::max(1.0, std::atof(argv[++i])));
+        } else if (arg == "--load" && hasValue) {
+            options.load = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--rt-policy" && hasValue) {
+            std::string policy = argv[++i];
+            if (policy != "fifo" && policy != "rr") return false;
+            options.rt.policy = policy == "fifo" ? RT_POLICY_FIFO : RT_POLICY_RR;
+            options.rtRequested = true;
+        } else if (arg == "--rt-priority" && hasValue) {
+            options.rt.priority = std::min(99, std::max(1, std::atoi(argv[++i])));
+            options.rtRequested = true;
+        } else if (arg == "--cpus" && hasValue) {
+            if (!parseCpuList(argv[++i], options.rt.cpuMask)) return false;
+            options.rtRequested = true;
+        } else if (arg == "--mlock" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode != "engine" && mode != "all") return false;
+            options.memory = mode == "engine" ? RT_MEMORY_ENGINE : RT_MEMORY_ALL;
+        } else {
+            return false;
+        }
+    }
+    if (options.rt.priority > 0 && options.rt.policy == RT_POLICY_NORMAL) options.rt.policy = RT_POLICY_FIFO;
+    if (options.rt.policy != RT_POLICY_NORMAL && options.rt.priority == 0) options.rt.priority = 50;
+    return true;
+}
+
+// Configure every engine role and lock memory before any engine thread starts.
+// Prints what the OS refused; the daemon runs on regardless.
+static void configureRealtime(const RtConfig& config, uint8_t memory) {
+    std::lock_guard<std::mutex> lock(rtMutex);
+    for (auto& role : rtConfigs) role = config;
+    if (memory != RT_MEMORY_NONE) {
+        applyRtMemoryLocked(memory);
+        if (!rtMemoryApplied) std::fprintf(stderr, "tdkd: memory locking: %s\n", rtMemoryMessage);
+    }
+}
+
+static void reportRealtime(int role) {
+    std::lock_guard<std::mutex> lock(rtMutex);
+    if (!rtStatus[role].applied) {
+        std::fprintf(stderr, "tdkd: %s thread: %s\n", rtRoleNames[role], rtStatus[role].message);
+    }
+}
+
+// Initialize the interface and connect every requested device
+static bool connectDevices(std::vector<DaemonDevice>& devices) {
+    if (InitializeTI() < 0) {
+        std::fprintf(stderr, "tdkd: InitializeTI failed (%d)\n", GetLastEAIError());
+        return false;
+    }
+    if (devices.empty()) {
+        if (Discover(1) < 1) {
+            std::fprintf(stderr, "tdkd: no devices discovered (%d)\n", GetLastEAIError());
+            return false;
+        }
+        const char* name = GetDiscoveredDeviceName(0);
+        if (!name) return false;
+        devices.push_back({name, 1, -1});
+    }
+    for (auto& device : devices) {
+        device.deviceID = Connect(device.name.c_str(), device.type, nullptr);
+        if (device.deviceID < 0) {
+            std::fprintf(stderr, "tdkd: Connect(%s, %d) failed (%d)\n", device.name.c_str(), device.type, GetLastEAIError());
+            return false;
+        }
+        std::printf("tdkd: connected %s (type %d) as device %d\n", device.name.c_str(), device.type, device.deviceID);
+    }
+    return true;
+}
+
+static void closeDevices(const std::vector<DaemonDevice>& devices) {
+    std::lock_guard<std::mutex> lock(tiMutex);
+    for (const auto& device : devices) {
+        if (device.deviceID >= 0) Close(device.deviceID);
+    }
+    ShutdownTI();
+}
+
+// Issue one ring record with the same engine paths the MEX uses
+static void serveRecord(SharedRing* ring, const RingRecord& record, bool& updated) {
+    RingHeader& h = ring->header;
+    TactorCommand cmd = fromRingRecord(record);
+    int errorCode = 0;
+    int result;
+    if (record.flags & COMMAND_FLAG_PREEMPT) {
+        result = issuePriority(cmd, record.submitUs, &errorCode);
+    } else if (record.flags & COMMAND_FLAG_URGENT) {
+        urgentPending.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(tiMutex);
+            if (record.flags & COMMAND_FLAG_UPDATE) UpdateTI();
+            if (isHalted(cmd)) {
+                haltDropped.fetch_add(1, std::memory_order_relaxed);
+                result = 0;
+            } else {
+                result = issueTrackedLocked(cmd, &errorCode);
+            }
+        }
+        urgentPending.fetch_sub(1, std::memory_order_acq_rel);
+    } else {
+        if ((record.flags & COMMAND_FLAG_UPDATE) && !updated && !queueEnabled.load(std::memory_order_acquire)) {
+            updateInterface(); // Once per batch, as the DLL expects once per frame
+            updated = true;
+        }
+        result = submitCommand(cmd, &errorCode);
+    }
+    int64_t issuedUs = nowUs();
+    int64_t latency = issuedUs - record.submitUs;
+    h.issued.fetch_add(1, std::memory_order_relaxed);
+    h.totalLatencyUs.fetch_add(latency, std::memory_order_relaxed);
+    if (latency > h.maxLatencyUs.load(std::memory_order_relaxed)) h.maxLatencyUs.store(latency, std::memory_order_relaxed);
+    if (result < 0) {
+        h.failed.fetch_add(1, std::memory_order_relaxed);
+        h.lastError.store(errorCode, std::memory_order_relaxed);
+    }
+    if (recordObserver) recordObserver(record, issuedUs);
+}
+
+static void serve(SharedRing* ring, bool verbose) {
+    int64_t reportUs = nowUs() + 1000000;
+    while (!stopRequested) {
+        ring->header.heartbeatUs.store(nowUs(), std::memory_order_relaxed);
+        RingRecord record;
+        bool updated = false;
+        int served = 0;
+        while (served < SERVE_BATCH && ringPop(ring, record)) {
+            serveRecord(ring, record, updated);
+            served++;
+        }
+        if (served == 0) ringWait(ring, RING_WAIT_US);
+        if (verbose && nowUs() >= reportUs) {
+            const RingHeader& h = ring->header;
+            uint64_t issued = h.issued.load();
+            std::printf("tdkd: submitted %llu issued %llu failed %llu full %llu mean latency %.1f us max %lld us\n",
+                        static_cast<unsigned long long>(h.submitted.load()), static_cast<unsigned long long>(issued),
+                        static_cast<unsigned long long>(h.failed.load()), static_cast<unsigned long long>(h.full.load()),
+                        issued ? static_cast<double>(h.totalLatencyUs.load()) / issued : 0.0,
+                        static_cast<long long>(h.maxLatencyUs.load()));
+            reportUs += 1000000;
+        }
+    }
+}
+
+// ---- Self-test ------------------------------------------------------------
+// A forked client process submits records from several threads while the
+// daemon serves them; every record must arrive exactly once and in
+// per-producer order, and the backend must see each command.
+
+extern std::atomic<unsigned long long> backendCommandCount; // stub_backend.cpp, serial_backend.cpp
+
+struct SelfTestState {
+    int producers = 0;
+    std::vector<int> nextValue;     // Per producer: next expected sequence number
+    std::vector<int64_t> latencies; // Submit to issue (us)
+    uint64_t received = 0;
+    uint64_t outOfOrder = 0;
+};
+
+static SelfTestState selfTest;
+
+static void observeSelfTest(const RingRecord& record, int64_t issuedUs) {
+    selfTest.received++;
+    int producer = static_cast<int>(record.clientID);
+    if (producer < 0 || producer >= selfTest.producers || record.value != selfTest.nextValue[producer]) {
+        selfTest.outOfOrder++;
+    } else {
+        selfTest.nextValue[producer]++;
+    }
+    selfTest.latencies.push_back(issuedUs - record.submitUs);
+}
+
+static void runProducers(const char* ringName, int producers, int count, int deviceID) {
+    SharedRing* ring = openRing(ringName);
+    if (!ring) _exit(2);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([=] {
+            TactorCommand cmd;
+            cmd.type = CMD_CHANGE_GAIN;
+            cmd.deviceID = deviceID;
+            cmd.tacNum = 1 + p;
+            RingRecord record;
+            for (int i = 0; i < count; i++) {
+                cmd.value = i;
+                toRingRecord(cmd, COMMAND_FLAG_UPDATE, record);
+                record.clientID = static_cast<uint32_t>(p);
+                while (!ringPush(ring, record)) {
+                    std::this_thread::yield(); // Full: the daemon is behind
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    closeRing(ring);
+    _exit(0);
+}
+
+static int runSelfTest(DaemonOptions& options) {
+    std::string ringName = "/tdk_selftest_" + std::to_string(getpid());
+    if (options.devices.empty()) options.devices.push_back({"STUB0", 1, -1});
+    if (!connectDevices(options.devices)) return 1;
+    int deviceID = options.devices[0].deviceID;
+    SharedRing* ring = createRing(ringName.c_str(), &deviceID, 1);
+    if (!ring) {
+        std::perror("tdkd: shm_open");
+        return 1;
+    }
+
+    uint64_t expected = static_cast<uint64_t>(options.producers) * options.count;
+    selfTest.producers = options.producers;
+    selfTest.nextValue.assign(options.producers, 0);
+    selfTest.latencies.reserve(expected);
+    recordObserver = observeSelfTest;
+    unsigned long long commandsBefore = backendCommandCount.load();
+
+    int64_t t0 = nowUs();
+    pid_t child = fork(); // Before any threads exist in this process
+    if (child == 0) runProducers(ringName.c_str(), options.producers, options.count, deviceID);
+    if (child < 0) {
+        std::perror("tdkd: fork");
+        return 1;
+    }
+    std::thread watcher([&] {
+        int status = 0;
+        waitpid(child, &status, 0);
+        // Let the serve loop drain what is left, then stop it
+        while (!ringEmpty(ring)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stopRequested = 1;
+        ringWake(ring);
+    });
+    serve(ring, false);
+    watcher.join();
+    double seconds = (nowUs() - t0) * 1e-6;
+
+    std::vector<int64_t>& lat = selfTest.latencies;
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double q) { return lat.empty() ? 0 : lat[static_cast<size_t>(q * (lat.size() - 1))]; };
+    unsigned long long commands = backendCommandCount.load() - commandsBefore;
+    bool ok = selfTest.received == expected && selfTest.outOfOrder == 0 && commands == expected &&
+              ring->header.failed.load() == 0;
+
+    std::printf("tdkd self-test: %d producers x %d records over %s\n", options.producers, options.count, ringName.c_str());
+    std::printf("  received %llu / %llu, out of order %llu, backend commands %llu, ring full %llu\n",
+                static_cast<unsigned long long>(selfTest.received), static_cast<unsigned long long>(expected),
+                static_cast<unsigned long long>(selfTest.outOfOrder), commands,
+                static_cast<unsigned long long>(ring->header.full.load()));
+    std::printf("  %.0f records/s, submit-to-issue p50 %lld us, p99 %lld us, max %lld us\n",
+                expected / seconds, static_cast<long long>(pct(0.5)), static_cast<long long>(pct(0.99)),
+                static_cast<long long>(pct(1.0)));
+    std::printf("  %s\n", ok ? "PASSED" : "FAILED");
+
+    closeRing(ring);
+    shm_unlink(ringName.c_str());
+    closeDevices(options.devices);
+    return ok ? 0 : 1;
+}
+
+// ---- Serial test ----------------------------------------------------------
+// A stand-in controller on the master side of a pseudo-terminal decodes what
+// the serial backend sends and acknowledges each packet. Commands go out in
+// bursts; every one must arrive intact and in order, every acknowledgement
+// must be parsed, and hanging up the stand-in must fail the next command with
+// ERROR_CONNECTION.
+
+#if defined(TDK_SERIAL_BACKEND)
+struct SerialTestState {
+    std::vector<SerialFrame> received; // Guarded by mutex
+    std::mutex mutex;
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> callbacks{0};
+};
+
+static SerialTestState serialTest;
+
+static void serialTestResponse(int, const SerialFrame&) {
+    serialTest.callbacks++;
+}
+
+// The stand-in controller: parse, record, acknowledge
+static void runStandIn(int master) {
+    SerialParser parser;
+    uint8_t in[4096];
+    std::vector<uint8_t> replies;
+    while (serialTest.running.load()) {
+        pollfd fd = {master, POLLIN, 0};
+        if (::poll(&fd, 1, 10) <= 0) continue;
+        ssize_t n = ::read(master, in, sizeof(in));
+        if (n <= 0) continue;
+        replies.clear();
+        parser.feed(in, static_cast<size_t>(n), [&](const SerialFrame& frame) {
+            {
+                std::lock_guard<std::mutex> lock(serialTest.mutex);
+                serialTest.received.push_back(frame);
+            }
+            SerialPacket ack(frame.command);
+            ack.u8(SERIAL_STATUS_OK);
+            size_t size;
+            const uint8_t* bytes = ack.finish(&size);
+            replies.insert(replies.end(), bytes, bytes + size);
+        });
+        size_t sent = 0;
+        while (sent < replies.size()) {
+            ssize_t w = ::write(master, replies.data() + sent, replies.size() - sent);
+            if (w > 0) sent += static_cast<size_t>(w);
+        }
+    }
+}
+
+// Command i of the test stream, and a check of its decoded frame
+static int sendSerialTestCommand(int deviceID, int i) {
+    int tactor = 1 + i % 16;
+    switch (i % 5) {
+        case 0: return Pulse(deviceID, tactor, 10 + i % 2000, i % 100);
+        case 1: return ChangeGain(deviceID, tactor, i % 256, 0);
+        case 2: return ChangeFreq(deviceID, tactor, 300 + i % 3200, 0);
+        case 3: return RampGain(deviceID, tactor, 0, i % 256, 100, TDK_LINEAR_RAMP, 5);
+        default: {
+            unsigned char states[8] = {static_cast<unsigned char>(i & 0xFF)};
+            return SetTactors(deviceID, 0, states);
+        }
+    }
+}
+
+static bool checkSerialTestFrame(const SerialFrame& f, int i) {
+    int tactor = 1 + i % 16;
+    switch (i % 5) {
+        case 0: return f.command == TDK_COMMAND_PULSE && f.length == 5 && f.payload[0] == tactor &&
+                       f.u16(1) == 10 + i % 2000 && f.u16(3) == i % 100;
+        case 1: return f.command == TDK_COMMAND_GAIN && f.length == 4 && f.payload[0] == tactor && f.payload[1] == i % 256;
+        case 2: return f.command == TDK_COMMAND_FREQ && f.length == 5 && f.payload[0] == tactor && f.u16(1) == 300 + i % 3200;
+        case 3: return f.command == TDK_COMMAND_RAMP && f.length == 11 && f.payload[0] == TDK_COMMAND_GAIN &&
+                       f.payload[1] == tactor && f.u16(4) == i % 256 && f.u16(6) == 100 && f.payload[8] == TDK_LINEAR_RAMP;
+        default: return f.command == TDK_COMMAND_SET_TACTORS && f.length == 10 && f.payload[2] == (i & 0xFF);
+    }
+}
+
+static int runSerialTest(const DaemonOptions& options) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::perror("tdkd: posix_openpt");
+        return 1;
+    }
+    std::string port = ptsname(master);
+    std::thread standIn(runStandIn, master);
+    InitializeTI();
+    int deviceID = Connect(port.c_str(), DEVICE_TYPE_SERIAL, reinterpret_cast<void*>(serialTestResponse));
+    if (deviceID < 0) {
+        std::fprintf(stderr, "tdkd: Connect(%s) failed (%d)\n", port.c_str(), GetLastEAIError());
+        serialTest.running = false;
+        standIn.join();
+        return 1;
+    }
+
+    // Bursts of 64 back-to-back commands, as a queue drain or frame commit issues them
+    const int count = std::min(options.count, 20000);
+    int failures = 0;
+    int64_t sendUs = 0; // Time spent in the command calls
+    for (int i = 0; i < count; i++) {
+        int64_t t0 = nowUs();
+        if (sendSerialTestCommand(deviceID, i) < 0) failures++;
+        sendUs += nowUs() - t0;
+        if (i % 64 == 63) std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    for (int wait = 0; wait < 500 && serialCounters().responses < static_cast<uint64_t>(count); wait++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    SerialCounters counters = serialCounters();
+    int corrupt = 0;
+    size_t received;
+    {
+        std::lock_guard<std::mutex> lock(serialTest.mutex);
+        received = serialTest.received.size();
+        for (size_t i = 0; i < received; i++) corrupt += !checkSerialTestFrame(serialTest.received[i], static_cast<int>(i));
+    }
+
+    // Hang up: the next commands must fail as a lost connection
+    serialTest.running = false;
+    standIn.join();
+    ::close(master);
+    int hangupError = 0;
+    for (int attempt = 0; attempt < 100 && hangupError == 0; attempt++) {
+        if (ChangeGain(deviceID, 1, 0, 0) < 0) {
+            hangupError = GetLastEAIError();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    Close(deviceID);
+    ShutdownTI();
+
+    bool ok = failures == 0 && received == static_cast<size_t>(count) && corrupt == 0 &&
+              counters.responses == static_cast<uint64_t>(count) && counters.rejected == 0 &&
+              counters.parseErrors == 0 && serialTest.callbacks.load() == static_cast<uint64_t>(count) &&
+              hangupError == ERROR_CONNECTION;
+    std::printf("tdkd serial test: %d commands to a stand-in on %s\n", count, port.c_str());
+    std::printf("  received %zu, corrupt %d, send failures %d, acknowledged %llu (callbacks %llu), parse errors %llu\n",
+                received, corrupt, failures, static_cast<unsigned long long>(counters.responses),
+                static_cast<unsigned long long>(serialTest.callbacks.load()),
+                static_cast<unsigned long long>(counters.parseErrors));
+    std::printf("  %llu packets in %llu writes (%.1f per write), %.2f us per command call\n",
+                static_cast<unsigned long long>(counters.packets), static_cast<unsigned long long>(counters.writes),
+                counters.writes ? static_cast<double>(counters.packets) / counters.writes : 0.0,
+                static_cast<double>(sendUs) / count);
+    std::printf("  after hang-up: error %d (expected %d)\n", hangupError, ERROR_CONNECTION);
+    std::printf("  %s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
+#else
+static int runSerialTest(const DaemonOptions&) {
+    std::fprintf(stderr, "tdkd: --serial-test needs the serial backend (build with -DTDK_SERIAL_BACKEND and serial_backend.cpp)\n");
+    return 2;
+}
+#endif
+
+// ---- Queue test -----------------------------------------------------------
+// Gain updates for tactors 0 (all) - 3 are enqueued with the I/O thread
+// stopped, and the queue is then replayed in order. Whatever was coalesced, the
+// replay must leave every tactor at the last value written to it. The fixed
+// cases are the tactor 0 / per-tactor interleavings; the rest are random.
+
+struct QueueTestWrite {
+    int tacNum;
+    int value;
+};
+
+// Returns the number of entries left after coalescing, or -1 on a mismatch
+static int checkQueueWrites(const std::vector<QueueTestWrite>& writes) {
+    int expected[5] = {-1, -1, -1, -1, -1};
+    int replayed[5] = {-1, -1, -1, -1, -1};
+    auto apply = [](int* gains, int tacNum, int value) {
+        for (int t = 1; t <= 4; t++) {
+            if (tacNum == 0 || tacNum == t) gains[t] = value;
+        }
+    };
+    std::lock_guard<std::mutex> lock(queueMutex);
+    resetQueueIndex();
+    queueHead = queueTail = 1;
+    TactorCommand cmd;
+    cmd.type = CMD_CHANGE_GAIN;
+    for (const QueueTestWrite& w : writes) {
+        cmd.tacNum = w.tacNum;
+        cmd.value = w.value;
+        enqueueLocked(cmd, nowUs(), nullptr);
+        apply(expected, w.tacNum, w.value);
+    }
+    int entries = static_cast<int>(queueTail - queueHead);
+    for (uint64_t seq = queueHead; seq != queueTail; seq++) {
+        const TactorCommand& queued = queueRing[seq & (QUEUE_CAPACITY - 1)].cmd;
+        apply(replayed, queued.tacNum, queued.value);
+    }
+    queueHead = queueTail;
+    resetQueueIndex();
+    return std::equal(expected + 1, expected + 5, replayed + 1) ? entries : -1;
+}
+
+static int runQueueTest() {
+    const std::vector<std::vector<QueueTestWrite>> cases = {
+        {{3, 100}, {0, 50}, {3, 200}},           // Per-tactor update after an "all" update
+        {{0, 50}, {3, 200}, {0, 70}},            // "All" update after a per-tactor update
+        {{3, 100}, {0, 50}, {3, 200}, {0, 70}},
+        {{3, 100}, {3, 150}, {3, 200}},          // Plain coalescing still applies
+    };
+    int failed = 0;
+    for (size_t i = 0; i < cases.size(); i++) {
+        int entries = checkQueueWrites(cases[i]);
+        if (entries < 0) {
+            std::printf("  case %zu: %zu writes -> WRONG VALUES\n", i + 1, cases[i].size());
+            failed++;
+        } else {
+            std::printf("  case %zu: %zu writes -> %d entries\n", i + 1, cases[i].size(), entries);
+        }
+    }
+    if (checkQueueWrites(cases.back()) != 1) {
+        std::printf("  same-tactor updates were not coalesced\n");
+        failed++;
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    int randomFailed = 0;
+    for (int i = 0; i < 10000; i++) {
+        std::vector<QueueTestWrite> writes(2 + i % 10);
+        for (QueueTestWrite& w : writes) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            w.tacNum = static_cast<int>(state >> 60) % 5;
+            w.value = static_cast<int>(state >> 32) & 0xFF;
+        }
+        if (checkQueueWrites(writes) < 0) randomFailed++;
+    }
+    std::printf("  random interleavings: %d of 10000 wrong\n", randomFailed);
+    bool ok = failed == 0 && randomFailed == 0;
+    std::printf("  %s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// ---- Jitter test ----------------------------------------------------------
+// A periodic scheduler task records how late each tick runs, first with
+// default thread settings and then with the RT options (SCHED_FIFO priority 80
+// and engine memory locking when none are given), while busy threads load
+// every CPU.
+
+struct JitterResult {
+    std::vector<int64_t> lateUs;
+    uint64_t overruns = 0;
+    bool applied = false;
+    std::string message;
+};
+
+static JitterResult runJitterPhase(const DaemonOptions& options, const RtConfig& config, uint8_t memory) {
+    JitterResult result;
+    size_t expected = static_cast<size_t>(options.seconds * options.rate) + 16;
+    result.lateUs.reserve(expected);
+    configureRealtime(config, memory);
+
+    std::atomic<bool> loadRunning{true};
+    std::vector<std::thread> load;
+    int numLoad = options.load >= 0 ? options.load : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < numLoad; i++) {
+        load.emplace_back([&loadRunning] {
+            volatile uint64_t spin = 0;
+            while (loadRunning.load(std::memory_order_relaxed)) spin = spin + 1;
+        });
+    }
+    uint64_t overrunsBefore;
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        overrunsBefore = schedulerOverruns;
+    }
+    std::vector<int64_t>* late = &result.lateUs;
+    int taskID = addPeriodicTask(options.rate, [late](int64_t scheduledUs) {
+        if (late->size() < late->capacity()) late->push_back(nowUs() - scheduledUs);
+    }); // Starts the scheduler thread, which applies its role's settings
+    std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(options.seconds * 1e6)));
+    removePeriodicTask(taskID);
+    {
+        std::lock_guard<std::mutex> lock(rtMutex);
+        result.applied = rtStatus[RT_SCHEDULER].applied && rtMemoryApplied;
+        result.message = rtStatus[RT_SCHEDULER].message;
+        if (!rtMemoryApplied) result.message += (result.message.empty() ? "" : "; ") + std::string(rtMemoryMessage);
+    }
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        result.overruns = schedulerOverruns - overrunsBefore;
+    }
+    stopScheduler(); // The next phase starts a fresh thread with its own settings
+    loadRunning.store(false);
+    for (auto& thread : load) thread.join();
+    resetRtConfig();
+    return result;
+}
+
+static void printJitter(const char* label, JitterResult& result) {
+    std::vector<int64_t>& lat = result.lateUs;
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double q) { return lat.empty() ? 0 : lat[static_cast<size_t>(q * (lat.size() - 1))]; };
+    std::printf("  %-8s ticks %7zu  p50 %6lld us  p99 %6lld us  p99.9 %6lld us  max %6lld us  overruns %llu\n",
+                label, lat.size(), static_cast<long long>(pct(0.5)), static_cast<long long>(pct(0.99)),
+                static_cast<long long>(pct(0.999)), static_cast<long long>(pct(1.0)),
+                static_cast<unsigned long long>(result.overruns));
+    if (!result.applied && !result.message.empty()) std::printf("           not fully applied: %s\n", result.message.c_str());
+}
+
+static int runJitterTest(const DaemonOptions& options) {
+    RtConfig rt = options.rt;
+    uint8_t memory = options.memory;
+    if (!options.rtRequested && memory == RT_MEMORY_NONE) {
+        rt.policy = RT_POLICY_FIFO;
+        rt.priority = 80;
+        memory = RT_MEMORY_ENGINE;
+    }
+    int numLoad = options.load >= 0 ? options.load : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::printf("tdkd jitter test: %.0f Hz task, %.1f s per phase, %d load thread%s\n", options.rate, options.seconds,
+                numLoad, numLoad == 1 ? "" : "s");
+    JitterResult normal = runJitterPhase(options, RtConfig(), RT_MEMORY_NONE);
+    JitterResult realtime = runJitterPhase(options, rt, memory);
+    printJitter("default", normal);
+    printJitter("realtime", realtime);
+    return 0;
+}
+
+// ---- Soak test ------------------------------------------------------------
+// A driver thread issues a fixed, seeded mix of commands (gain and frequency
+// updates, pulses, ramps, SetTactors) across many tactors at a steady rate,
+// through the same submit path the MEX uses. Every interval the main thread
+// takes the call latencies of that interval, resident memory, open file
+// descriptors, threads and queue depth. At the end each series is checked for
+// monotonic drift: a Kendall tau above SOAK_DRIFT_TAU and a last-quarter median
+// above the first-quarter median by SOAK_DRIFT_RATIO (and the metric's
+// floor). The seed is fixed, so reports from two releases drive the same
+// stream and can be compared row by row.
+
+constexpr uint64_t SOAK_SEED = 0x7D6B5EEDULL;
+constexpr double SOAK_DRIFT_TAU = 0.6;
+constexpr double SOAK_DRIFT_RATIO = 0.10;
+constexpr int SOAK_MIN_SAMPLES = 8;
+
+struct SoakSample {
+    double seconds = 0.0;
+    uint64_t commands = 0; // In this interval
+    uint64_t failed = 0;
+    double p50Us = 0.0, p99Us = 0.0, p999Us = 0.0, maxUs = 0.0; // Call latency
+    double rssKb = 0.0;
+    double fds = 0.0;
+    double threads = 0.0;
+    double queueDepth = 0.0;
+};
+
+// A metric checked for drift, and the smallest rise that counts
+struct SoakMetric {
+    const char* name;
+    double SoakSample::*field;
+    double floor;
+};
+
+struct SoakDriver {
+    std::mutex mutex; // Guards latencies, commands, failed
+    std::vector<int64_t> latencies;
+    uint64_t commands = 0;
+    uint64_t failed = 0;
+    std::atomic<bool> running{true};
+};
+
+static uint64_t soakRandom(uint64_t& state) { // splitmix64
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// A value inside a validation row
+static int soakValue(FieldLimits limits, int value) {
+    return limits.lo + value % (limits.hi - limits.lo + 1);
+}
+
+// Command n of the mix: 40% gain, 25% frequency, 20% pulse, 10% ramp, 5% SetTactors.
+// Every value is inside the EAI action limits, so the soak measures traffic the
+// DLL accepts.
+static TactorCommand soakCommand(uint64_t& state, int deviceID, int tactors) {
+    uint64_t r = soakRandom(state);
+    TactorCommand cmd;
+    cmd.deviceID = deviceID;
+    cmd.tacNum = 1 + static_cast<int>((r >> 8) % tactors);
+    int kind = static_cast<int>(r % 100);
+    int value = static_cast<int>((r >> 24) & 0xFFFF);
+    if (kind < 40) {
+        cmd.type = CMD_CHANGE_GAIN;
+        cmd.value = soakValue(LIMIT_GAIN, value);
+    } else if (kind < 65) {
+        cmd.type = CMD_CHANGE_FREQ;
+        cmd.value = soakValue(LIMIT_FREQ, value);
+    } else if (kind < 85) {
+        cmd.type = CMD_PULSE;
+        cmd.duration = LIMIT_DURATION.lo + value % 90;
+    } else if (kind < 95) {
+        cmd.type = (r >> 40) & 1 ? CMD_RAMP_GAIN : CMD_RAMP_FREQ;
+        FieldLimits limits = cmd.type == CMD_RAMP_GAIN ? LIMIT_GAIN : LIMIT_FREQ;
+        cmd.value = soakValue(limits, value);
+        cmd.endValue = soakValue(limits, value >> 4);
+        cmd.duration = 50 + value % 450;
+    } else {
+        cmd.type = CMD_SET_TACTORS;
+        cmd.tacNum = 0;
+        cmd.mask = soakRandom(state) & ((tactors >= 64 ? 0 : uint64_t(1) << tactors) - 1);
+    }
+    return cmd;
+}
+
+// Paced in 1 ms ticks; latency is the submitCommand call (the vendor call
+// itself without the queue, the enqueue with it)
+static void runSoakDriver(SoakDriver& driver, const DaemonOptions& options, int deviceID) {
+    uint64_t state = SOAK_SEED;
+    std::vector<int64_t> tick;
+    tick.reserve(static_cast<size_t>(options.rate / 1000.0) + 2);
+    double owed = 0.0;
+    auto next = std::chrono::steady_clock::now();
+    while (driver.running.load(std::memory_order_relaxed)) {
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+        owed += options.rate / 1000.0;
+        tick.clear();
+        uint64_t failed = 0;
+        if (owed >= 1.0 && !queueEnabled.load(std::memory_order_acquire)) updateInterface();
+        for (; owed >= 1.0; owed -= 1.0) {
+            TactorCommand cmd = soakCommand(state, deviceID, options.tactors);
+            int64_t t0 = nowUs();
+            if (submitCommand(cmd) < 0) failed++;
+            tick.push_back(nowUs() - t0);
+        }
+        std::lock_guard<std::mutex> lock(driver.mutex);
+        for (int64_t us : tick) {
+            if (driver.latencies.size() < driver.latencies.capacity()) driver.latencies.push_back(us);
+        }
+        driver.commands += tick.size();
+        driver.failed += failed;
+    }
+}
+
+static double procStatusValue(const char* key) { // e.g. "VmRSS:" (kB) or "Threads:"
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return 0.0;
+    char line[256];
+    double value = 0.0;
+    size_t n = std::strlen(key);
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, key, n) == 0) {
+            value = std::atof(line + n);
+            break;
+        }
+    }
+    std::fclose(f);
+    return value;
+}
+
+static double openFileCount() {
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return 0.0;
+    int count = 0;
+    while (dirent* entry = readdir(dir)) count += entry->d_name[0] != '.';
+    closedir(dir);
+    return count - 1; // Not counting the directory handle itself
+}
+
+static double medianOf(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Kendall tau of a series against time: +1 == rising every step
+static double kendallTau(const std::vector<double>& y) {
+    long long concordant = 0, discordant = 0;
+    for (size_t i = 0; i < y.size(); i++) {
+        for (size_t j = i + 1; j < y.size(); j++) {
+            if (y[j] > y[i]) concordant++;
+            if (y[j] < y[i]) discordant++;
+        }
+    }
+    long long pairs = static_cast<long long>(y.size()) * (static_cast<long long>(y.size()) - 1) / 2;
+    return pairs ? static_cast<double>(concordant - discordant) / pairs : 0.0;
+}
+
+// The mix must pass validation untouched, or the soak would measure clamped or
+// refused traffic
+static bool checkSoakMix(int tactors) {
+    uint64_t state = SOAK_SEED;
+    for (int i = 0; i < 100000; i++) {
+        TactorCommand cmd = soakCommand(state, 0, tactors);
+        unsigned invalid = validateCommand(cmd);
+        if (invalid != 0) {
+            std::fprintf(stderr, "tdkd: soak command %d (type %d) is out of range (0x%x)\n", i, cmd.type, invalid);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int runSoakTest(DaemonOptions& options) {
+    if (!checkSoakMix(options.tactors)) return 1;
+    if (options.devices.empty()) options.devices.push_back({"STUB0", 1, -1});
+    if (!connectDevices(options.devices)) return 1;
+    int deviceID = options.devices[0].deviceID;
+    if (options.queue) startQueue(0);
+    FILE* csv = nullptr;
+    if (!options.report.empty()) {
+        csv = std::fopen(options.report.c_str(), "w");
+        if (!csv) {
+            std::perror("tdkd: report");
+            closeDevices(options.devices);
+            return 1;
+        }
+        std::fprintf(csv, "# tdkd soak test, backend %s\n", GetVersionNumber());
+        std::fprintf(csv, "# rate %.0f/s, %d tactors, interval %.1f s, queue %s, seed %llx\n", options.rate,
+                     options.tactors, options.interval, options.queue ? "on" : "off",
+                     static_cast<unsigned long long>(SOAK_SEED));
+        std::fprintf(csv, "seconds,commands,failed,p50_us,p99_us,p999_us,max_us,rss_kb,fds,threads,queue_depth\n");
+    }
+    std::printf("tdkd soak test: %.0f commands/s over %d tactors for %.0f s, sampled every %.1f s%s\n", options.rate,
+                options.tactors, options.seconds, options.interval, options.queue ? " (queue)" : "");
+
+    SoakDriver driver;
+    size_t perInterval = static_cast<size_t>(options.rate * options.interval * 1.5) + 1024;
+    driver.latencies.reserve(perInterval);
+    std::vector<int64_t> latencies;
+    latencies.reserve(perInterval);
+    std::vector<SoakSample> samples;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    int64_t startUs = nowUs();
+    std::thread thread(runSoakDriver, std::ref(driver), std::cref(options), deviceID);
+
+    int64_t endUs = startUs + static_cast<int64_t>(options.seconds * 1e6);
+    int64_t sampleUs = startUs;
+    while (!stopRequested && sampleUs < endUs) {
+        sampleUs = std::min(endUs, sampleUs + static_cast<int64_t>(options.interval * 1e6));
+        while (!stopRequested && nowUs() < sampleUs) {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(100000, sampleUs - nowUs())));
+        }
+        SoakSample s;
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            latencies.swap(driver.latencies);
+            s.commands = driver.commands;
+            s.failed = driver.failed;
+            driver.commands = 0;
+            driver.failed = 0;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto pct = [&](double q) {
+            return latencies.empty() ? 0.0 : static_cast<double>(latencies[static_cast<size_t>(q * (latencies.size() - 1))]);
+        };
+        uint64_t depth = 0;
+        getQueueStats(&depth);
+        s.seconds = (nowUs() - startUs) * 1e-6;
+        s.p50Us = pct(0.5);
+        s.p99Us = pct(0.99);
+        s.p999Us = pct(0.999);
+        s.maxUs = pct(1.0);
+        s.rssKb = procStatusValue("VmRSS:");
+        s.fds = openFileCount();
+        s.threads = procStatusValue("Threads:");
+        s.queueDepth = static_cast<double>(depth);
+        latencies.clear();
+        samples.push_back(s);
+        if (csv) {
+            std::fprintf(csv, "%.1f,%llu,%llu,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", s.seconds,
+                         static_cast<unsigned long long>(s.commands), static_cast<unsigned long long>(s.failed), s.p50Us,
+                         s.p99Us, s.p999Us, s.maxUs, s.rssKb, s.fds, s.threads, s.queueDepth);
+            std::fflush(csv);
+        }
+        if (options.verbose) {
+            std::printf("  %8.1f s  %7llu cmds  p50 %4.0f us  p99 %5.0f us  max %6.0f us  rss %.0f kB  fds %.0f  threads %.0f  depth %.0f\n",
+                        s.seconds, static_cast<unsigned long long>(s.commands), s.p50Us, s.p99Us, s.maxUs, s.rssKb,
+                        s.fds, s.threads, s.queueDepth);
+        }
+    }
+    driver.running = false;
+    thread.join();
+    if (options.queue) stopQueue();
+    if (csv) std::fclose(csv);
+    closeDevices(options.devices);
+
+    uint64_t commands = 0, failed = 0;
+    for (const auto& s : samples) {
+        commands += s.commands;
+        failed += s.failed;
+    }
+    std::printf("  %zu samples, %llu commands, %llu failed\n", samples.size(), static_cast<unsigned long long>(commands),
+                static_cast<unsigned long long>(failed));
+    const SoakMetric metrics[] = {
+        {"p50 latency (us)", &SoakSample::p50Us, 2.0},
+        {"p99 latency (us)", &SoakSample::p99Us, 5.0},
+        {"resident memory (kB)", &SoakSample::rssKb, 256.0},
+        {"open files", &SoakSample::fds, 1.0},
+        {"threads", &SoakSample::threads, 1.0},
+        {"queue depth", &SoakSample::queueDepth, 8.0},
+    };
+    int drifting = 0;
+    bool enough = samples.size() >= SOAK_MIN_SAMPLES + 1;
+    for (const auto& metric : metrics) {
+        std::vector<double> series; // The first sample holds start-up (allocation, page faults), so it is left out
+        for (size_t i = 1; i < samples.size(); i++) series.push_back(samples[i].*metric.field);
+        size_t quarter = std::max<size_t>(1, series.size() / 4);
+        double first = medianOf(std::vector<double>(series.begin(), series.begin() + std::min(quarter, series.size())));
+        double last = medianOf(std::vector<double>(series.end() - std::min(quarter, series.size()), series.end()));
+        double tau = kendallTau(series);
+        bool drift = enough && tau > SOAK_DRIFT_TAU && last - first > std::max(metric.floor, SOAK_DRIFT_RATIO * first);
+        drifting += drift;
+        std::printf("  %-22s first %10.1f  last %10.1f  tau %+.2f  %s\n", metric.name, first, last, tau,
+                    drift ? "DRIFT" : "ok");
+    }
+    if (!enough) std::printf("  (drift needs at least %d samples after the first)\n", SOAK_MIN_SAMPLES);
+    bool ok = drifting == 0 && failed == 0;
+    std::printf("  %s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    DaemonOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    std::printf("tdkd: backend %s\n", GetVersionNumber());
+    if (options.selfTest) return runSelfTest(options);
+    if (options.jitterTest) return runJitterTest(options);
+    if (options.serialTest) return runSerialTest(options);
+    if (options.queueTest) return runQueueTest();
+    if (options.soakTest) return runSoakTest(options);
+
+    configureRealtime(options.rt, options.memory);
+    if (!connectDevices(options.devices)) return 1;
+    std::vector<int> ids;
+    for (const auto& device : options.devices) ids.push_back(device.deviceID);
+    SharedRing* ring = createRing(options.ring.c_str(), ids.data(), static_cast<int>(ids.size()));
+    if (!ring) {
+        std::perror("tdkd: shm_open");
+        closeDevices(options.devices);
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    if (options.queue) startQueue(0);
+    rtThreadStart(RT_SERVE);
+    if (options.rtRequested) {
+        reportRealtime(RT_SERVE);
+        if (options.queue) reportRealtime(RT_IO);
+    }
+    std::printf("tdkd: serving %s\n", options.ring.c_str());
+
+    serve(ring, options.verbose);
+
+    std::printf("tdkd: shutting down\n");
+    stopScheduler();
+    stopQueue();
+    closeRing(ring);
+    shm_unlink(options.ring.c_str());
+    closeDevices(options.devices);
+    return 0;
+}
@@ -0,0 +1,240 @@
+#ifndef TDK_TRACE_H
+#define TDK_TRACE_H
+
+// Scoped trace events, exported as Chrome trace-event JSON (Perfetto,
+// chrome://tracing).
+//
+// TRACE_SCOPE("name") records a complete event ("ph":"X") for the enclosing
+// scope on the calling thread; TRACE_SCOPE_ARG adds one integer argument.
+// Every thread writes to its own fixed ring of events (single writer, no
+// locks, no allocation after the thread's first event), and the dump reads
+// whatever the rings hold. Markers from MATLAB land on a separate "markers"
+// track as global instant events.
+//
+// Tracing is compiled in unless TDK_NO_TRACE is defined. While disabled, a
+// scope costs one relaxed load and one branch on entry; its exit tests the
+// flag that entry cached.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+constexpr int TRACE_MAX_THREADS = 16;
+constexpr uint32_t TRACE_BUFFER_EVENTS = 1 << 16; // Per thread, power of two
+constexpr int TRACE_MAX_MARKERS = 1024;
+constexpr int TRACE_MARKER_CHARS = 64;
+
+struct TraceEvent {
+    const char* name; // String literal
+    int64_t startNs;
+    int64_t durationNs;
+    int64_t arg;
+    bool hasArg;
+};
+
+struct TraceBuffer {
+    std::atomic<uint64_t> head{0}; // Events written; the ring keeps the last TRACE_BUFFER_EVENTS
+    char threadName[32] = "";
+    int tid = 0;
+    bool retired = false;          // Owner thread exited; reusable once every slot is taken
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+struct TraceMarker {
+    int64_t ns;
+    char text[TRACE_MARKER_CHARS];
+};
+
+inline std::atomic<bool> traceEnabled{false};
+inline std::mutex traceMutex; // Guards buffer registration, markers and dumps
+inline TraceBuffer* traceBuffers[TRACE_MAX_THREADS] = {};
+inline int numTraceBuffers = 0;
+inline TraceMarker traceMarkers[TRACE_MAX_MARKERS];
+inline int numTraceMarkers = 0;
+inline uint64_t traceDroppedThreads = 0; // Threads that found every buffer taken
+
+inline int64_t traceNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Per-thread handle; gives the buffer back (retired) when the thread exits
+struct TraceThread {
+    TraceBuffer* buffer = nullptr;
+    const char* name = nullptr;
+    bool failed = false;
+    ~TraceThread() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(traceMutex);
+        buffer->retired = true;
+    }
+};
+
+inline thread_local TraceThread traceThread;
+
+inline TraceBuffer* registerTraceBuffer() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    TraceBuffer* buffer = nullptr;
+    if (numTraceBuffers < TRACE_MAX_THREADS) {
+        buffer = new TraceBuffer;
+        buffer->tid = numTraceBuffers + 1;
+        traceBuffers[numTraceBuffers++] = buffer;
+    } else {
+        for (int i = 0; i < numTraceBuffers && !buffer; i++) {
+            if (traceBuffers[i]->retired) buffer = traceBuffers[i];
+        }
+        if (!buffer) {
+            traceDroppedThreads++;
+            return nullptr;
+        }
+        buffer->head.store(0, std::memory_order_relaxed);
+        buffer->retired = false;
+    }
+    const char* name = traceThread.name;
+    if (name) {
+        std::snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", name);
+    } else {
+        std::snprintf(buffer->threadName, sizeof(buffer->threadName), "thread %d", buffer->tid);
+    }
+    return buffer;
+}
+
+// Name the calling thread's track (call at thread start)
+inline void traceThreadName(const char* name) {
+    traceThread.name = name;
+    if (traceThread.buffer) {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        std::snprintf(traceThread.buffer->threadName, sizeof(traceThread.buffer->threadName), "%s", name);
+    }
+}
+
+inline void traceRecord(const char* name, int64_t startNs, int64_t endNs, int64_t arg, bool hasArg) {
+    TraceThread& thread = traceThread;
+    if (!thread.buffer) {
+        if (thread.failed) return;
+        thread.buffer = registerTraceBuffer();
+        if (!thread.buffer) {
+            thread.failed = true;
+            return;
+        }
+    }
+    TraceBuffer* buffer = thread.buffer;
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[head & (TRACE_BUFFER_EVENTS - 1)];
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+    event.arg = arg;
+    event.hasArg = hasArg;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int64_t arg = 0, bool hasArg = false) {
+        if (traceEnabled.load(std::memory_order_relaxed)) {
+            name_ = name;
+            arg_ = arg;
+            hasArg_ = hasArg;
+            startNs_ = traceNowNs();
+        }
+    }
+    ~TraceScope() {
+        if (name_) traceRecord(name_, startNs_, traceNowNs(), arg_, hasArg_);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_ = nullptr;
+    int64_t startNs_ = 0;
+    int64_t arg_ = 0;
+    bool hasArg_ = false;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#if defined(TDK_NO_TRACE)
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARG(name, arg)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, static_cast<int64_t>(arg), true)
+#endif
+
+// MATLAB marker (copied; any text). Returns false once the marker table is full.
+inline bool traceMarker(const char* text) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (numTraceMarkers >= TRACE_MAX_MARKERS) return false;
+    TraceMarker& marker = traceMarkers[numTraceMarkers++];
+    marker.ns = traceNowNs();
+    std::snprintf(marker.text, sizeof(marker.text), "%s", text);
+    return true;
+}
+
+inline void clearTrace() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    for (int i = 0; i < numTraceBuffers; i++) traceBuffers[i]->head.store(0, std::memory_order_relaxed);
+    numTraceMarkers = 0;
+}
+
+inline void writeJsonString(FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            std::fputc('\\', f);
+            std::fputc(c, f);
+        } else if (c < 0x20) {
+            std::fprintf(f, "\\u%04x", c);
+        } else {
+            std::fputc(c, f);
+        }
+    }
+    std::fputc('"', f);
+}
+
+// Write everything recorded so far as Chrome trace-event JSON. Timestamps are
+// microseconds on the engine clock (nowUs). Returns the number of events
+// written, or -1 if the file can't be opened.
+inline long long dumpTrace(const char* path) {
+    FILE* f = std::fopen(path, "w");
+    if (!f) return -1;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    long long count = 0;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"tactor\"}}");
+    std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"markers\"}}");
+    for (int i = 0; i < numTraceBuffers; i++) {
+        const TraceBuffer* buffer = traceBuffers[i];
+        std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", buffer->tid);
+        writeJsonString(f, buffer->threadName);
+        std::fprintf(f, "}}");
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t k = first; k < head; k++) {
+            const TraceEvent& e = buffer->events[k & (TRACE_BUFFER_EVENTS - 1)];
+            std::fprintf(f, ",\n{\"name\":");
+            writeJsonString(f, e.name);
+            std::fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->tid,
+                         e.startNs / 1000.0, e.durationNs / 1000.0);
+            if (e.hasArg) std::fprintf(f, ",\"args\":{\"value\":%lld}", static_cast<long long>(e.arg));
+            std::fprintf(f, "}");
+            count++;
+        }
+    }
+    for (int i = 0; i < numTraceMarkers; i++) {
+        std::fprintf(f, ",\n{\"name\":");
+        writeJsonString(f, traceMarkers[i].text);
+        std::fprintf(f, ",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}", traceMarkers[i].ns / 1000.0);
+        count++;
+    }
+    std::fprintf(f, "\n]}\n");
+    std::fclose(f);
+    return count;
+}
+
+#endif
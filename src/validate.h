@@ -0,0 +1,121 @@
+#ifndef TDK_VALIDATE_H
+#define TDK_VALIDATE_H
+
+// Range validation for decoded commands, against the action limits in
+// EAI_Defines.h.
+//
+// Each command type has a row of limits (tactor, start/end value, duration;
+// delay is always >= 0). validateCommand clamps every field into its row with
+// min/max, which compile to conditional moves, and ORs the fields that moved
+// into a bit mask, so an in-range command costs a handful of compares and no
+// unpredictable branches. What happens to an out-of-range command is the
+// session policy: pass it through untouched, clamp it, or reject it.
+
+#include "engine.h"
+#include <algorithm>
+#include <climits>
+
+enum ValidationPolicy : uint8_t {
+    VALIDATE_OFF = 0,   // Raw values go to the DLL
+    VALIDATE_CLAMP = 1, // Clamp into range (default)
+    VALIDATE_ERROR = 2  // Reject the command
+};
+
+// Bits of the validateCommand result
+constexpr unsigned INVALID_TACTOR = 1u << 0;
+constexpr unsigned INVALID_VALUE = 1u << 1;
+constexpr unsigned INVALID_END_VALUE = 1u << 2;
+constexpr unsigned INVALID_DURATION = 1u << 3;
+constexpr unsigned INVALID_DELAY = 1u << 4;
+
+struct FieldLimits {
+    int lo;
+    int hi;
+};
+
+struct CommandLimits {
+    FieldLimits tactor;
+    FieldLimits value;
+    FieldLimits endValue;
+    FieldLimits duration;
+};
+
+constexpr FieldLimits LIMIT_ANY = {INT_MIN, INT_MAX};
+constexpr FieldLimits LIMIT_TACTOR = {1, ENGINE_MAX_TACTOR};
+constexpr FieldLimits LIMIT_GAIN = {0, MAX_ACTION_GAIN}; // 0 == off, below MIN_ACTION_GAIN on purpose
+constexpr FieldLimits LIMIT_FREQ = {MIN_ACTION_FREQUENCY, MAX_ACTION_FREQUENCY};
+constexpr FieldLimits LIMIT_DURATION = {MIN_ACTION_DURATION, MAX_ACTION_DURATION};
+constexpr FieldLimits LIMIT_DELAY = {0, INT_MAX};
+
+// Indexed by CommandType. Sig source values are checked by their decoder (a
+// bit mask doesn't clamp meaningfully).
+inline constexpr CommandLimits commandLimits[] = {
+    {LIMIT_ANY, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY},                        // CMD_NONE
+    {LIMIT_TACTOR, LIMIT_ANY, LIMIT_ANY, LIMIT_DURATION},                // CMD_PULSE
+    {LIMIT_TACTOR, LIMIT_GAIN, LIMIT_ANY, LIMIT_ANY},                    // CMD_CHANGE_GAIN
+    {LIMIT_TACTOR, LIMIT_FREQ, LIMIT_ANY, LIMIT_ANY},                    // CMD_CHANGE_FREQ
+    {LIMIT_TACTOR, LIMIT_GAIN, LIMIT_GAIN, LIMIT_DURATION},              // CMD_RAMP_GAIN
+    {LIMIT_TACTOR, LIMIT_FREQ, LIMIT_FREQ, LIMIT_DURATION},              // CMD_RAMP_FREQ
+    {LIMIT_ANY, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY},                        // CMD_STOP
+    {LIMIT_ANY, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY},                        // CMD_SET_TACTORS
+    {LIMIT_TACTOR, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY},                     // CMD_SIG_SOURCE
+    {LIMIT_ANY, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY},                        // CMD_TACTOR_TYPE
+    {LIMIT_ANY, LIMIT_ANY, LIMIT_ANY, LIMIT_ANY}                         // CMD_FREQ_TIME_DELAY
+};
+constexpr int NUM_COMMAND_LIMITS = sizeof(commandLimits) / sizeof(commandLimits[0]);
+
+inline std::atomic<uint8_t> validationPolicy{VALIDATE_CLAMP};
+inline std::atomic<uint64_t> validationClamped{0};  // Commands clamped into range
+inline std::atomic<uint64_t> validationRejected{0}; // Commands rejected under VALIDATE_ERROR
+
+inline unsigned clampField(int& v, FieldLimits limits) {
+    int c = std::min(std::max(v, limits.lo), limits.hi);
+    unsigned moved = c != v;
+    v = c;
+    return moved;
+}
+
+inline const CommandLimits& limitsFor(uint8_t type) {
+    return commandLimits[type < NUM_COMMAND_LIMITS ? type : static_cast<uint8_t>(CMD_NONE)];
+}
+
+// Clamp cmd into range. Returns the INVALID_* bits of the fields that moved.
+inline unsigned validateCommand(TactorCommand& cmd) {
+    const CommandLimits& limits = limitsFor(cmd.type);
+    return clampField(cmd.tacNum, limits.tactor) |
+           clampField(cmd.value, limits.value) << 1 |
+           clampField(cmd.endValue, limits.endValue) << 2 |
+           clampField(cmd.duration, limits.duration) << 3 |
+           clampField(cmd.delay, LIMIT_DELAY) << 4;
+}
+
+// Describe the first field in `invalid`, for error messages
+inline const char* invalidField(uint8_t type, unsigned invalid, const TactorCommand& original,
+                                int* value, FieldLimits* limits) {
+    const CommandLimits& l = limitsFor(type);
+    if (invalid & INVALID_TACTOR) {
+        *value = original.tacNum;
+        *limits = l.tactor;
+        return "tactor";
+    }
+    if (invalid & INVALID_VALUE) {
+        *value = original.value;
+        *limits = l.value;
+        return type == CMD_CHANGE_FREQ || type == CMD_RAMP_FREQ ? "frequency" : "gain";
+    }
+    if (invalid & INVALID_END_VALUE) {
+        *value = original.endValue;
+        *limits = l.endValue;
+        return type == CMD_RAMP_FREQ ? "end frequency" : "end gain";
+    }
+    if (invalid & INVALID_DURATION) {
+        *value = original.duration;
+        *limits = l.duration;
+        return "duration";
+    }
+    *value = original.delay;
+    *limits = LIMIT_DELAY;
+    return "delay";
+}
+
+#endif
@@ -0,0 +1,18 @@
+function startFrameCommit(deviceID, rate)
+%STARTFRAMECOMMIT Commits written frames at a fixed rate (Hz) from a background thread.
+%
+% Syntax:
+%   tdk.startFrameCommit(deviceID);
+%   tdk.startFrameCommit(deviceID, rate);
+%
+% See also: tdk.writeFrame, tdk.stopFrameCommit
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    rate (1,1) double {mustBeInRange(rate,1,1000)} = 100;
+end
+
+% uint8(24) == 'startFrameCommit' code
+tactor(uint8(24), deviceID, rate);
+
+end
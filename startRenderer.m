@@ -0,0 +1,18 @@
+function startRenderer(deviceID, rate)
+%STARTRENDERER Starts rendering the phantom stimulus at a fixed rate (Hz).
+%
+% Syntax:
+%   tdk.startRenderer(deviceID);
+%   tdk.startRenderer(deviceID, rate);
+%
+% See also: tdk.loadLayout, tdk.setStimulus, tdk.stopRenderer
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    rate (1,1) double {mustBeInRange(rate,1,1000)} = 100;
+end
+
+% uint8(20) == 'startRenderer' code
+tactor(uint8(20), deviceID, rate);
+
+end
@@ -0,0 +1,12 @@
+function s = stats()
+%STATS Returns the MEX engine counters (queue depth, coalesced updates, errors, ...).
+%
+% Syntax:
+%   s = tdk.stats();
+%
+% See also: tdk.configureQueue
+
+% uint8(27) == 'stats' code
+s = tactor(uint8(27));
+
+end
@@ -0,0 +1,16 @@
+function stopFrameCommit(deviceID)
+%STOPFRAMECOMMIT Stops background frame commits.
+%
+% Syntax:
+%   tdk.stopFrameCommit(deviceID);
+%
+% See also: tdk.startFrameCommit
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+end
+
+% uint8(25) == 'stopFrameCommit' code
+tactor(uint8(25), deviceID);
+
+end
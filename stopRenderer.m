@@ -0,0 +1,16 @@
+function stopRenderer(deviceID)
+%STOPRENDERER Stops the phantom renderer and returns rendered tactors to zero gain.
+%
+% Syntax:
+%   tdk.stopRenderer(deviceID);
+%
+% See also: tdk.startRenderer
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+end
+
+% uint8(21) == 'stopRenderer' code
+tactor(uint8(21), deviceID);
+
+end
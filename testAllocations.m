@@ -0,0 +1,71 @@
+function allocations = testAllocations(deviceID, numLoops)
+%TESTALLOCATIONS Checks that the steady-state command path does no heap allocation.
+%
+% Requires the allocation-count build of the MEX:
+%   tdk.install(true, 'CountAllocations', true);
+%
+% Syntax:
+%   allocations = tdk.testAllocations(deviceID, numLoops);
+%
+% Inputs:
+%   deviceID - Integer index of tactor device
+%   numLoops - Number of times to run the command mix after warm-up.
+%
+% Output:
+%   allocations - 1 x 2 C++ heap allocations made by the measured loop, with
+%                 the I/O queue off and on. Both must be 0.
+%
+% The mix covers uint8 and string dispatch, decode, issue (direct and
+% queued), a fired slot, stop, and a status return.
+%
+% See also: tdk.install, tdk.stats, tdk.test
+
+arguments
+    deviceID (1,1) {mustBeInteger}
+    numLoops (1,1) {mustBeInteger, mustBePositive} = 1000;
+end
+
+s = tactor(uint8(27)); % 'stats'
+assert(isfield(s, 'heapAllocations'), 'tdk:testAllocations', ...
+    'Rebuild with tdk.install(true, ''CountAllocations'', true) to count allocations.');
+
+fprintf(1, '\nRunning allocation test...\n');
+tdk.arm(1, {'pulse', deviceID, 3, 50, 0});
+modes = {'direct', 'queued'};
+allocations = zeros(1, 2);
+for m = 1:2
+    tdk.configureQueue(m == 2);
+    runMix(deviceID, 10); % Warm-up: thread-local state, link bookkeeping, ...
+    before = countAllocations();
+    runMix(deviceID, numLoops);
+    after = countAllocations();
+    statsCost = countAllocations() - after; % What one 'stats' call itself allocates
+    allocations(m) = after - before - statsCost;
+    fprintf(1, '  %-6s: %d allocations in %d calls\n', modes{m}, allocations(m), 8 * numLoops);
+end
+tdk.configureQueue(false);
+tdk.arm(1, {});
+
+assert(all(allocations == 0), 'tdk:testAllocations', ...
+    'Steady-state calls allocated (direct: %d, queued: %d).', allocations(1), allocations(2));
+fprintf(1, '  PASSED\n');
+
+end
+
+function runMix(deviceID, numLoops)
+for i = 1:numLoops
+    tactor(uint8(11), deviceID, 1, 10, 0);           % 'pulse'
+    tactor(uint8(7), deviceID, 1, 200, 0);           % 'changeGain'
+    tactor(uint8(8), deviceID, 1, 250, 0);           % 'changeFreq'
+    tactor(uint8(9), deviceID, 1, 0, 255, 10, 0);    % 'rampGain'
+    tactor('pulse', deviceID, 2, 10, 0);
+    tactor(uint8(34), 1);                            % 'fire'
+    tactor(uint8(12), deviceID, 0);                  % 'stop'
+    connected = tactor(uint8(17)); %#ok<NASGU>       % 'checkConnection'
+end
+end
+
+function n = countAllocations()
+s = tactor(uint8(27)); % 'stats'
+n = s.heapAllocations;
+end
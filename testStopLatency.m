@@ -0,0 +1,53 @@
+function latency = testStopLatency(deviceID, numLoops, options)
+%TESTSTOPLATENCY Checks that stop preempts a backlog of queued commands within a bound.
+%
+% Syntax:
+%   latency = tdk.testStopLatency(deviceID, numLoops);
+%   latency = tdk.testStopLatency(deviceID, numLoops, 'Backlog', 500, 'MaxLatency', 2);
+%
+% Inputs:
+%   deviceID - Integer index of tactor device
+%   numLoops - Number of stop calls to time.
+%
+% Options:
+%   Backlog    - Ramps/pulses queued before each stop (default 200).
+%   MaxLatency - Bound (ms) on MATLAB call to Stop() issue (default 5).
+%
+% Output:
+%   latency - numLoops x 1 MATLAB-call-to-Stop() times (ms), as measured in the MEX.
+%
+% See also: tdk.stop, tdk.silence, tdk.stats, tdk.test
+
+arguments
+    deviceID (1,1) {mustBeInteger}
+    numLoops (1,1) {mustBeInteger, mustBePositive} = 50;
+    options.Backlog (1,1) {mustBeInteger, mustBeNonnegative} = 200;
+    options.MaxLatency (1,1) double {mustBePositive} = 5;
+end
+
+fprintf(1, '\nRunning stop latency test...\n');
+
+tdk.configureQueue(true);
+latency = zeros(numLoops, 1);
+for i = 1:numLoops
+    % Fill the I/O queue with work that would otherwise be ahead of the stop
+    for k = 1:options.Backlog
+        tactor(uint8(9), deviceID, mod(k, 8) + 1, 255, 0, 500, 0); % 'rampGain'
+        tactor(uint8(11), deviceID, mod(k, 8) + 1, 100, 0);        % 'pulse'
+    end
+    tactor(uint8(12), deviceID, 0);                                % 'stop'
+    s = tactor(uint8(27));                                         % 'stats'
+    latency(i) = s.lastStopLatencyMs;
+end
+s = tdk.stats();
+tdk.configureQueue(false);
+
+fprintf(1, 'Stop latency (%d stops, %d queued commands each):\n', numLoops, 2 * options.Backlog);
+fprintf(1, '  median: %.3f ms\n', median(latency));
+fprintf(1, '  max:    %.3f ms\n', max(latency));
+fprintf(1, '  purged: %d queued commands\n', s.purged);
+assert(max(latency) <= options.MaxLatency, 'tdk:testStopLatency', ...
+    'Stop took %.3f ms to reach the DLL (bound %.3f ms).', max(latency), options.MaxLatency);
+fprintf(1, '  PASSED (bound %.3f ms)\n', options.MaxLatency);
+
+end
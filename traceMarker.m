@@ -0,0 +1,18 @@
+function traceMarker(text)
+%TRACEMARKER Marks a point (e.g. an experiment phase) on the trace timeline.
+%
+% Syntax:
+%   tdk.traceMarker('baseline');
+%
+% Markers are kept while tracing is off, up to 1024 per trace.
+%
+% See also: tdk.configureTrace, tdk.dumpTrace
+
+arguments
+    text {mustBeTextScalar}
+end
+
+% uint8(49) == 'traceMarker' code
+tactor(uint8(49), char(text));
+
+end
@@ -0,0 +1,19 @@
+function updateEffect(effectID, gain, frequency)
+%UPDATEEFFECT Sets an effect to a constant gain, e.g. for proportional feedback.
+%
+% Syntax:
+%   tdk.updateEffect(effectID, gain);
+%   tdk.updateEffect(effectID, gain, frequency);
+%
+% See also: tdk.addEffect, tdk.removeEffect
+
+arguments
+    effectID (1,1) {mustBeInteger}
+    gain (1,1) double {mustBeInRange(gain,0,255)}
+    frequency (1,1) {mustBeInteger} = -1; % -1 keeps the current frequency
+end
+
+% uint8(39) == 'updateEffect' code
+tactor(uint8(39), effectID, gain, frequency);
+
+end
@@ -0,0 +1,24 @@
+function updateLfo(id, options)
+%UPDATELFO Changes LFO parameters mid-flight; the output glides, never steps.
+%
+% Syntax:
+%   tdk.updateLfo(id, 'Depth', 40);
+%   tdk.updateLfo(id, 'Period', 300, 'Offset', 150);
+%
+% A period change keeps the phase continuous (for a sync group, the whole
+% group is retimed).
+%
+% See also: tdk.addLfo, tdk.removeLfo
+
+arguments
+    id (1,1) {mustBeInteger}
+    options.Depth (1,1) double = NaN;
+    options.Offset (1,1) double = NaN;
+    options.Period (1,1) double = NaN; % ms
+    options.Phase (1,1) double = NaN;
+end
+
+% uint8(46) == 'updateLfo' code
+tactor(uint8(46), id, options.Depth, options.Offset, options.Period, options.Phase);
+
+end
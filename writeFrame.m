@@ -0,0 +1,38 @@
+function nSent = writeFrame(deviceID, frame, gains, options)
+%WRITEFRAME Writes a 64-tactor frame (on/off states and optional gains) to the back buffer.
+%
+% Syntax:
+%   tdk.writeFrame(deviceID, frame);
+%   tdk.writeFrame(deviceID, frame, gains);
+%   nSent = tdk.writeFrame(deviceID, frame, gains, 'Commit', true);
+%
+% Inputs:
+%   deviceID - Identifier for device
+%   frame    - uint64 bit mask (tactor 1 == LSB) or logical vector of up to 64 tactor states
+%   gains    - (Optional) per-tactor gains, 0 (off) to 1 (maximum); NaN leaves a gain unchanged
+%   Commit   - Set true to send the frame immediately
+%
+% Output:
+%   nSent - Number of commands sent by the commit (empty if not committed)
+%
+% Only the differences from the last committed frame are sent. Frames can also
+% be committed in the background with tdk.startFrameCommit.
+%
+% See also: tdk.commitFrame, tdk.startFrameCommit, tdk.setState
+
+arguments
+    deviceID (1,1) {mustBeInteger} % Identifier for device
+    frame (1,:) {mustBeA(frame,["uint64","logical"])}
+    gains (1,:) double {mustBeLessThanOrEqual(gains,1)} = [];
+    options.Commit (1,1) logical = false;
+end
+
+% uint8(22) == 'writeFrame' code
+if options.Commit
+    nSent = tactor(uint8(22), deviceID, frame, gains, true);
+else
+    tactor(uint8(22), deviceID, frame, gains);
+    nSent = [];
+end
+
+end
@@ -0,0 +1,128 @@
+function writeStimulusLibrary(filename, stimuli)
+%WRITESTIMULUSLIBRARY Writes stimuli to a memory-mappable library file.
+%
+% Syntax:
+%   tdk.writeStimulusLibrary('stimuli.tdkstim', stimuli);
+%
+% Inputs:
+%   filename - Output file
+%   stimuli  - Struct array with fields:
+%                id         - Unique integer 0 - 4294967295
+%                name       - Unique name, up to 35 characters
+%                sampleRate - Hz (1 - 1000)
+%                samples    - numSamples x channels gains (0 - 255);
+%                             channel c drives tactor + c - 1 (1 - 64 channels)
+%
+% The file has a fixed-size header, an index with hash tables by ID and by
+% name, and contiguous sample data. tdk.openStimulusLibrary maps it without
+% reading it, and tdk.playStimulus plays entries straight from the mapping.
+% The layout is documented in src/stimlib.h.
+%
+% See also: tdk.openStimulusLibrary, tdk.playStimulus
+
+arguments
+    filename {mustBeTextScalar}
+    stimuli struct
+end
+
+count = numel(stimuli);
+slots = 2^nextpow2(max(2*count, 2)); % Power of two, at most half full
+entriesOffset = 64;
+idSlotsOffset = entriesOffset + 64*count;
+nameSlotsOffset = idSlotsOffset + 4*slots;
+dataOffset = align64(nameSlotsOffset + 4*slots);
+
+ids = zeros(count, 1);
+names = cell(count, 1);
+offsets = zeros(count, 1);
+offset = dataOffset;
+for k = 1:count
+    s = stimuli(k);
+    if ~isscalar(s.id) || s.id < 0 || s.id > 4294967295 || s.id ~= round(s.id)
+        error('TDK:InputError', 'Stimulus %d: id must be an integer 0 - 4294967295.', k);
+    end
+    if strlength(string(s.name)) == 0 || strlength(string(s.name)) > 35
+        error('TDK:InputError', 'Stimulus %d: name must be 1 - 35 characters.', k);
+    end
+    if ~isscalar(s.sampleRate) || s.sampleRate < 1 || s.sampleRate > 1000 || s.sampleRate ~= round(s.sampleRate)
+        error('TDK:InputError', 'Stimulus %d: sampleRate must be an integer 1 - 1000 Hz.', k);
+    end
+    if size(s.samples, 2) < 1 || size(s.samples, 2) > 64 || any(s.samples(:) < 0 | s.samples(:) > 255)
+        error('TDK:InputError', 'Stimulus %d: samples must be numSamples x (1 - 64) gains 0 - 255.', k);
+    end
+    ids(k) = s.id;
+    names{k} = char(s.name);
+    offsets(k) = offset;
+    offset = align64(offset + numel(s.samples));
+end
+if numel(unique(ids)) < count
+    error('TDK:InputError', 'Stimulus IDs must be unique.');
+end
+if numel(unique(names)) < count
+    error('TDK:InputError', 'Stimulus names must be unique.');
+end
+fileSize = offset;
+
+% Hash tables: entry index + 1 per slot, linear probing
+idSlots = zeros(slots, 1, 'uint32');
+nameSlots = zeros(slots, 1, 'uint32');
+nameHashes = zeros(count, 1);
+for k = 1:count
+    idSlots = insertSlot(idSlots, fnv1a(typecast(uint32(ids(k)), 'uint8')), k);
+    nameHashes(k) = fnv1a(uint8(names{k}));
+    nameSlots = insertSlot(nameSlots, nameHashes(k), k);
+end
+
+fid = fopen(filename, 'w', 'l');
+if fid < 0
+    error('TDK:FileError', 'Could not open %s for writing.', filename);
+end
+cleanup = onCleanup(@() fclose(fid));
+fwrite(fid, uint8(['TDKSTIM' 0]), 'uint8');
+fwrite(fid, [1 count slots 0], 'uint32');
+fwrite(fid, [entriesOffset idSlotsOffset nameSlotsOffset dataOffset fileSize], 'uint64');
+for k = 1:count
+    s = stimuli(k);
+    fwrite(fid, [ids(k) size(s.samples, 1)], 'uint32');
+    fwrite(fid, offsets(k), 'uint64');
+    fwrite(fid, [size(s.samples, 2) 0], 'uint16');
+    fwrite(fid, [s.sampleRate nameHashes(k)], 'uint32');
+    name = zeros(1, 36, 'uint8');
+    name(1:numel(names{k})) = uint8(names{k});
+    fwrite(fid, name, 'uint8');
+end
+fwrite(fid, idSlots, 'uint32');
+fwrite(fid, nameSlots, 'uint32');
+for k = 1:count
+    pad(fid, offsets(k));
+    fwrite(fid, uint8(round(stimuli(k).samples.')), 'uint8'); % Sample-major
+end
+pad(fid, fileSize);
+
+end
+
+function n = align64(n)
+n = ceil(n / 64) * 64;
+end
+
+function pad(fid, offset)
+fwrite(fid, zeros(1, offset - ftell(fid), 'uint8'), 'uint8');
+end
+
+function slots = insertSlot(slots, hash, k)
+n = numel(slots);
+i = mod(hash, n);
+while slots(i + 1) ~= 0
+    i = mod(i + 1, n);
+end
+slots(i + 1) = k;
+end
+
+function h = fnv1a(bytes)
+% 32-bit FNV-1a in doubles: 16777619 == 2^24 + 403 keeps every product exact
+h = 2166136261;
+for b = double(bytes(:)).'
+    h = bitxor(h, b);
+    h = mod(mod(h, 256) * 2^24 + h * 403, 2^32);
+end
+end